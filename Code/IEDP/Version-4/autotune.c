@@ -0,0 +1,352 @@
+/**
+ * @file autotune.c
+ * @brief Auto-tuner: short benchmarks on a synthetic frame of a representative size pick the row
+ *        kernel variant of each stage and the thread count, tile size and fusion of the stencil
+ *        pipeline; the winner is persisted in a small profile file that later runs load at startup.
+ *
+ * Profile format: "key = value" lines, '#' comments.
+ *   frame   = WxH                    Frame size tuned on (informational)
+ *   threads = N                      Worker threads
+ *   tile    = WxH                    Fused pipeline tile, 0 = image width / height
+ *   fuse    = 0|1                    Fuse pipeline stages
+ *   isa     = median=..,grey=..,...  Kernel variants (dispatch.c spec)
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For string operations
+#include <errno.h> // For errno
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For sysconf
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// Constants
+// ==============================================================================================
+// Timed runs of each configuration (the fastest counts), after one warm-up run
+#define AUTOTUNE_REPS 3
+// Rows of the frame each kernel variant is timed on; the kernels cost the same on every row
+#define AUTOTUNE_KERNEL_ROWS 32
+// A configuration with more threads or a later tile must be this much faster to win, so that noise
+// does not pick extra threads
+#define AUTOTUNE_MARGIN 0.97
+
+// Candidate tiles of the fused passes (0: image width), tried for every thread count
+static const int tile_widths[] = { 0, 512, 256 };
+static const int tile_heights[] = { 16, 32, 64, 128, 256 };
+
+// ==============================================================================================
+// A: Benchmarks
+// ==============================================================================================
+/**
+ * @brief Monotonic wall-clock time in milliseconds.
+ */
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec * 1e-6;
+}
+
+/**
+ * @brief Fills a synthetic RGB frame: smooth gradients, hard-edged rectangles and noise, so the
+ *        median and edge stages see both flat areas and edges.
+ *
+ * @param rgb    Frame, width * height * 3
+ * @param width  Frame width
+ * @param height Frame height
+ */
+static void synthetic_frame(unsigned char *rgb, int width, int height) {
+    uint32_t seed = 12345;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            seed = seed * 1664525u + 1013904223u;
+            int noise = (int)(seed >> 28) - 8;
+            int block = ((x / 64) ^ (y / 48)) & 1 ? 96 : 0;
+            for (int c = 0; c < 3; c++) {
+                int v = (x * (c + 1) * 255 / (width + 1) + y * 255 / (height + 1)) / 2 + block + noise;
+                rgb[((size_t)y * width + x) * 3 + c] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Time of one stage's row kernel over a band of rows in the middle of the frame.
+ *
+ * @param kernels Kernels
+ * @param stage   STAGE_FILTERED (median), STAGE_GREY or STAGE_EDGES (Sobel)
+ * @param rgb     RGB frame
+ * @param grey    Greyscale frame
+ * @param out     Output rows, width * 3 * AUTOTUNE_KERNEL_ROWS
+ * @param width   Frame width
+ * @param height  Frame height
+ * @return Fastest of AUTOTUNE_REPS runs, in milliseconds
+ */
+static double time_kernel(const StageKernels *kernels, StageId stage, const unsigned char *rgb,
+                          const unsigned char *grey, unsigned char *out, int width, int height) {
+    int rows = height < AUTOTUNE_KERNEL_ROWS ? height : AUTOTUNE_KERNEL_ROWS;
+    int y0 = (height - rows) / 2;
+    double best = 0;
+    for (int rep = -1; rep < AUTOTUNE_REPS; rep++) {
+        double start = now_ms();
+        for (int y = y0; y < y0 + rows; y++) {
+            unsigned char *dst = out + (size_t)(y - y0) * width * 3;
+            if (stage == STAGE_FILTERED) {
+                const unsigned char *mid = rgb + (size_t)y * width * 3;
+                kernels->median_row(y > 0 ? mid - width * 3 : NULL, mid, y < height - 1 ? mid + width * 3 : NULL,
+                                    dst, width, 0, width);
+            } else if (stage == STAGE_GREY) {
+                kernels->grey_row(rgb + (size_t)y * width * 3, dst, 0, width);
+            } else {
+                const unsigned char *mid = grey + (size_t)y * width;
+                kernels->sobel_row(y > 0 ? mid - width : NULL, mid, y < height - 1 ? mid + width : NULL,
+                                   dst, width, 0, width);
+            }
+        }
+        double elapsed = now_ms() - start;
+        // The first run warms the caches and is not counted
+        if (rep == 0 || (rep > 0 && elapsed < best)) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Time of the stencil pipeline over the whole frame with one configuration.
+ *
+ * @return Fastest of AUTOTUNE_REPS runs in milliseconds, or -1 on failure
+ */
+static double time_pipeline(const StencilPipeline *pipeline, const Image *grey, const Image *out, int threads,
+                            int tile_w, int tile_h, int fuse) {
+    StencilSchedule schedule;
+    StencilSchedulePlan(pipeline, grey->width, grey->height, tile_w, tile_h, fuse, &schedule);
+    double best = 0;
+    for (int rep = -1; rep < AUTOTUNE_REPS; rep++) {
+        double start = now_ms();
+        if (!StencilPipelineRun(pipeline, &schedule, grey, out, threads)) {
+            return -1;
+        }
+        double elapsed = now_ms() - start;
+        if (rep == 0 || (rep > 0 && elapsed < best)) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+// ==============================================================================================
+// B: Tuning
+// ==============================================================================================
+/**
+ * @brief Benchmarks the candidate configurations on a synthetic frame and returns the fastest:
+ *        for each stage the fastest kernel variant the CPU supports, then for the pipeline every
+ *        thread count from 1 to the online CPUs (powers of two and the CPU count) with every
+ *        candidate tile, fused and unfused.
+ *
+ * @param width    Frame width
+ * @param height   Frame height
+ * @param pipeline Stencil pipeline to tune for
+ * @param profile  Result
+ * @param log      Stream the timings are printed to
+ * @return 1 on success, 0 on failure
+ */
+int Autotune(int width, int height, const StencilPipeline *pipeline, TuneProfile *profile, FILE *log) {
+    size_t pixels = (size_t)width * height;
+    unsigned char *rgb = malloc(pixels * 3);
+    unsigned char *grey = malloc(pixels);
+    size_t kernel_bytes = (size_t)width * 3 * AUTOTUNE_KERNEL_ROWS;
+    unsigned char *out = malloc(pixels > kernel_bytes ? pixels : kernel_bytes);
+    if (!rgb || !grey || !out) {
+        free(rgb);
+        free(grey);
+        free(out);
+        return 0;
+    }
+    memset(profile, 0, sizeof(*profile));
+    profile->width = width;
+    profile->height = height;
+    synthetic_frame(rgb, width, height);
+    Image rgb_view = ImageWrap(rgb, width, height, 3);
+    Image grey_view = ImageWrap(grey, width, height, 1);
+    Image out_view = ImageWrap(out, width, height, 1);
+    ConvertToGreyscale(&rgb_view, &grey_view);
+
+    // 1. Kernel variant of each stage
+    static const char *isa_names[KERNEL_ISA_COUNT] = { "scalar", "sse2", "avx2", "avx512" };
+    static const StageId stages[3] = { STAGE_FILTERED, STAGE_GREY, STAGE_EDGES };
+    static const char *stage_names[3] = { "median", "grey", "sobel" };
+    const char *best_isa[3] = { "scalar", "scalar", "scalar" };
+    double best_ms[3] = { -1, -1, -1 };
+    for (int isa = 0; isa < KERNEL_ISA_COUNT; isa++) {
+        StageKernels kernels;
+        if (!KernelIsaSupported((KernelIsa)isa) || !StageKernelsSelect(isa_names[isa], width, height, &kernels)) {
+            continue;
+        }
+        const char *chosen[3] = { kernels.median_isa, kernels.grey_isa, kernels.sobel_isa };
+        for (int s = 0; s < 3; s++) {
+            // A stage without a variant of this instruction set falls back to one already timed
+            if (strcmp(chosen[s], isa_names[isa]) != 0) {
+                continue;
+            }
+            double ms = time_kernel(&kernels, stages[s], rgb, grey, out, width, height);
+            fprintf(log, "  %-6s %-6s %8.3f ms / %d rows\n", stage_names[s], isa_names[isa], ms,
+                    height < AUTOTUNE_KERNEL_ROWS ? height : AUTOTUNE_KERNEL_ROWS);
+            if (best_ms[s] < 0 || ms < best_ms[s]) {
+                best_ms[s] = ms;
+                best_isa[s] = isa_names[isa];
+            }
+        }
+    }
+    snprintf(profile->isa, sizeof(profile->isa), "median=%s,grey=%s,sobel=%s", best_isa[0], best_isa[1], best_isa[2]);
+
+    // 2. Threads, tile and fusion of the stencil pipeline
+    // Candidates in order of preference (fewer threads first): a later one must beat the best so far
+    // by AUTOTUNE_MARGIN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cpus > 1 ? (int)cpus : 1;
+    double best = -1;
+    int ok = 1;
+    for (int threads = 1; ok; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        // Fused with each tile, then unfused (tile_w -1)
+        for (size_t w = 0; ok && w <= sizeof(tile_widths) / sizeof(tile_widths[0]); w++) {
+            int fuse = w < sizeof(tile_widths) / sizeof(tile_widths[0]);
+            if (fuse && tile_widths[w] >= width && tile_widths[w] > 0) {
+                continue;
+            }
+            for (size_t h = 0; ok && h < (fuse ? sizeof(tile_heights) / sizeof(tile_heights[0]) : 1); h++) {
+                int tile_w = fuse ? tile_widths[w] : 0;
+                int tile_h = fuse ? tile_heights[h] : 0;
+                double ms = time_pipeline(pipeline, &grey_view, &out_view, threads, tile_w, tile_h, fuse);
+                ok = ms >= 0;
+                char config[64];
+                if (fuse) {
+                    snprintf(config, sizeof(config), "threads %d, tile %dx%d", threads, tile_w, tile_h);
+                } else {
+                    snprintf(config, sizeof(config), "threads %d, unfused", threads);
+                }
+                fprintf(log, "  pipeline %-26s %8.3f ms\n", config, ms);
+                if (ok && (best < 0 || ms < AUTOTUNE_MARGIN * best)) {
+                    best = ms;
+                    profile->threads = threads;
+                    profile->tile_w = tile_w;
+                    profile->tile_h = tile_h;
+                    profile->fuse = fuse;
+                }
+            }
+        }
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    free(rgb);
+    free(grey);
+    free(out);
+    return ok;
+}
+
+// ==============================================================================================
+// C: Profile File
+// ==============================================================================================
+/**
+ * @brief Prints the settings of a profile on one line.
+ *
+ * @param profile Profile
+ * @param out     Output stream
+ */
+void TuneProfilePrint(const TuneProfile *profile, FILE *out) {
+    fprintf(out, "threads %d, tile %dx%d, %s, isa %s\n", profile->threads, profile->tile_w, profile->tile_h,
+            profile->fuse ? "fused" : "unfused", profile->isa[0] ? profile->isa : "auto");
+}
+
+/**
+ * @brief Writes a profile file.
+ *
+ * @param path    File path
+ * @param profile Profile
+ * @return 1 on success, 0 on failure (reported to stderr)
+ */
+int TuneProfileSave(const char *path, const TuneProfile *profile) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to write profile '%s'\n", path);
+        return 0;
+    }
+    fprintf(file, "# IEDP auto-tuning profile (--autotune); tile 0 = image width / height\n");
+    fprintf(file, "frame = %dx%d\n", profile->width, profile->height);
+    fprintf(file, "threads = %d\n", profile->threads);
+    fprintf(file, "tile = %dx%d\n", profile->tile_w, profile->tile_h);
+    fprintf(file, "fuse = %d\n", profile->fuse);
+    fprintf(file, "isa = %s\n", profile->isa[0] ? profile->isa : "auto");
+    int ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed to write profile '%s'\n", path);
+    }
+    return ok;
+}
+
+/**
+ * @brief Reads a profile file. Settings the file does not mention keep their defaults: 1 thread,
+ *        STENCIL_TILE_W x STENCIL_TILE_H tiles, fused, automatic kernel variants.
+ *
+ * @param path    File path
+ * @param profile Result
+ * @return 1 on success, 0 on an invalid file (reported to stderr), -1 if the file does not exist
+ */
+int TuneProfileLoad(const char *path, TuneProfile *profile) {
+    memset(profile, 0, sizeof(*profile));
+    profile->threads = 1;
+    profile->tile_w = STENCIL_TILE_W;
+    profile->tile_h = STENCIL_TILE_H;
+    profile->fuse = 1;
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        if (errno == ENOENT) {
+            return -1;
+        }
+        fprintf(stderr, "Failed to open profile '%s'\n", path);
+        return 0;
+    }
+    char line[256];
+    int line_no = 0, ok = 1;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_no++;
+        char key[32], value[sizeof(profile->isa)], tail;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        int fields = sscanf(line, " %31[a-z] = %63s %c", key, value, &tail);
+        if (fields <= 0) {
+            continue; // Blank or comment line
+        }
+        if (fields != 2) {
+            ok = 0;
+        } else if (strcmp(key, "frame") == 0) {
+            ok = sscanf(value, "%dx%d%c", &profile->width, &profile->height, &tail) == 2;
+        } else if (strcmp(key, "threads") == 0) {
+            ok = sscanf(value, "%d%c", &profile->threads, &tail) == 1 && profile->threads >= 1;
+        } else if (strcmp(key, "tile") == 0) {
+            ok = sscanf(value, "%dx%d%c", &profile->tile_w, &profile->tile_h, &tail) == 2 &&
+                 profile->tile_w >= 0 && profile->tile_h >= 0;
+        } else if (strcmp(key, "fuse") == 0) {
+            ok = sscanf(value, "%d%c", &profile->fuse, &tail) == 1 && (profile->fuse == 0 || profile->fuse == 1);
+        } else if (strcmp(key, "isa") == 0) {
+            snprintf(profile->isa, sizeof(profile->isa), "%s", strcmp(value, "auto") == 0 ? "" : value);
+        } else {
+            fprintf(stderr, "Profile '%s' line %d: unknown setting '%s' ignored\n", path, line_no, key);
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "Invalid profile '%s' at line %d\n", path, line_no);
+    }
+    return ok;
+}
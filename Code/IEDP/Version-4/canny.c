@@ -0,0 +1,400 @@
+/**
+ * @file canny.c
+ * @brief Canny edge detection on the Sobel gradients: non-maximum suppression in the gradient row pass
+ *        and hysteresis with a band-parallel union-find
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For memset
+
+#include "iedp.h" // Shared types and stage prototypes
+#include "perf_counters.h" // PERF_STAGE_SOBEL for the worker threads
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Pixel classes after non-maximum suppression
+#define CANNY_NONE   0
+#define CANNY_WEAK   1 // low <= magnitude < high
+#define CANNY_STRONG 2 // magnitude >= high (at a union-find root: the component holds a strong pixel)
+
+// tan(22.5°) and tan(67.5°) scaled by 100000, for sector selection without atan2
+#define TAN_22_5 41421
+#define TAN_67_5 241421
+#define TAN_SCALE 100000
+
+/**
+ * @brief Work for one thread: a band of rows plus the shared image buffers
+ */
+typedef struct {
+    const Image *grey;         // Greyscale image
+    unsigned char *cls;        // Pixel classes (CANNY_*), width * height
+    int *parent;               // Union-find parent of each weak / strong pixel, width * height
+    const Image *edges;        // Output image
+    int width, height;         // Image size
+    int y0, y1;                // Rows y0 ... y1 - 1
+    int low2, high2;           // Squared thresholds
+    const RoiMask *roi;        // Pixels that may be edges, or NULL for all
+    int roi_x, roi_y;          // Position of the image in the mask
+    int failed;                // Allocation failed
+} CannyBand;
+
+// ==============================================================================================
+// A: Union-Find
+// ==============================================================================================
+/**
+ * @brief Root of a pixel's component, with path halving. Only used while a single thread owns every
+ *        pixel on the path.
+ *
+ * @param parent Parent array
+ * @param p      Pixel index
+ * @return Root index
+ */
+static int uf_find(int *parent, int p) {
+    while (parent[p] != p) {
+        parent[p] = parent[parent[p]];
+        p = parent[p];
+    }
+    return p;
+}
+
+/**
+ * @brief Joins the components of two pixels. The smaller index becomes the root and inherits the
+ *        strongest class of the two roots.
+ *
+ * @param parent Parent array
+ * @param cls    Pixel classes
+ * @param a      First pixel
+ * @param b      Second pixel
+ */
+static void uf_union(int *parent, unsigned char *cls, int a, int b) {
+    a = uf_find(parent, a);
+    b = uf_find(parent, b);
+    if (a == b) {
+        return;
+    }
+    if (a > b) {
+        int t = a;
+        a = b;
+        b = t;
+    }
+    parent[b] = a;
+    if (cls[b] > cls[a]) {
+        cls[a] = cls[b];
+    }
+}
+
+// ==============================================================================================
+// B: Gradient Row Pass - Sobel gradients, non-maximum suppression, local union-find
+// ==============================================================================================
+/**
+ * @brief Sobel gradients and squared magnitude of one row. Border rows and columns are 0, as in
+ *        SobelEdgeDetection.
+ *
+ * @param band Band being processed
+ * @param y    Row
+ * @param gx   Horizontal gradients, width entries
+ * @param gy   Vertical gradients, width entries
+ * @param mag  Squared magnitudes, width entries
+ */
+static void gradient_row(const CannyBand *band, int y, int *gx, int *gy, int *mag) {
+    int width = band->width;
+    memset(mag, 0, (size_t)width * sizeof(int));
+    if (y <= 0 || y >= band->height - 1) {
+        return;
+    }
+    for (int x = 1; x < width - 1; x++) {
+        SobelGradient(band->grey, x, y, &gx[x], &gy[x]);
+        mag[x] = gx[x] * gx[x] + gy[x] * gy[x];
+    }
+}
+
+/**
+ * @brief Band worker, phase 1: computes the gradients one row ahead, keeps a pixel only where its
+ *        magnitude is a maximum across the edge (gradient direction in four sectors), classifies it
+ *        against the thresholds and joins it with its weak / strong 8-neighbours in the band.
+ *
+ * @param band Band to process
+ */
+static void canny_band_suppress(CannyBand *band) {
+    int width = band->width;
+
+    // Three-row ring of gradients: rows y - 1, y, y + 1
+    int *buffer = malloc((size_t)9 * width * sizeof(int));
+    if (!buffer) {
+        band->failed = 1;
+        return;
+    }
+    int *gx[3], *gy[3], *mag[3];
+    for (int i = 0; i < 3; i++) {
+        gx[i]  = buffer + (size_t)(3 * i) * width;
+        gy[i]  = buffer + (size_t)(3 * i + 1) * width;
+        mag[i] = buffer + (size_t)(3 * i + 2) * width;
+    }
+    for (int y = band->y0 - 1; y <= band->y0; y++) {
+        gradient_row(band, y, gx[y % 3], gy[y % 3], mag[y % 3]);
+    }
+
+    for (int y = band->y0; y < band->y1; y++) {
+        gradient_row(band, y + 1, gx[(y + 1) % 3], gy[(y + 1) % 3], mag[(y + 1) % 3]);
+        const int *up = mag[(y - 1) % 3];
+        const int *mid = mag[y % 3];
+        const int *dn = mag[(y + 1) % 3];
+        const int *row_gx = gx[y % 3];
+        const int *row_gy = gy[y % 3];
+        unsigned char *cls = band->cls + (size_t)y * width;
+
+        for (int x = 1; x < width - 1; x++) {
+            int m = mid[x];
+            cls[x] = CANNY_NONE;
+            if (m < band->low2) {
+                continue;
+            }
+            // Outside the mask a pixel is never an edge, so components do not connect through it
+            if (band->roi) {
+                int mx = band->roi_x + x, my = band->roi_y + y;
+                if (!(band->roi->bits[(size_t)my * band->roi->stride + (mx >> 3)] & (0x80u >> (mx & 7)))) {
+                    continue;
+                }
+            }
+
+            // Neighbours across the edge: a is on the positive side of the gradient, b on the negative
+            int ax = row_gx[x] < 0 ? -row_gx[x] : row_gx[x];
+            int ay = row_gy[x] < 0 ? -row_gy[x] : row_gy[x];
+            int a, b;
+            if (ay * TAN_SCALE <= ax * TAN_22_5) {
+                a = mid[x + 1];
+                b = mid[x - 1];
+            } else if (ay * TAN_SCALE > ax * TAN_67_5) {
+                a = up[x];
+                b = dn[x];
+            } else if ((row_gx[x] > 0) == (row_gy[x] > 0)) {
+                // Gradient towards the upper right (gy is positive when the row above is brighter)
+                a = up[x + 1];
+                b = dn[x - 1];
+            } else {
+                a = up[x - 1];
+                b = dn[x + 1];
+            }
+            if (m <= a || m < b) {
+                continue;
+            }
+
+            int p = y * width + x;
+            cls[x] = m >= band->high2 ? CANNY_STRONG : CANNY_WEAK;
+            band->parent[p] = p;
+
+            // Join with the neighbours already visited in this band: left, and the row above
+            if (cls[x - 1]) {
+                uf_union(band->parent, band->cls, p, p - 1);
+            }
+            if (y > band->y0) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (cls[x + dx - width]) {
+                        uf_union(band->parent, band->cls, p, p + dx - width);
+                    }
+                }
+            }
+        }
+        cls[0] = CANNY_NONE;
+        cls[width - 1] = CANNY_NONE;
+    }
+    free(buffer);
+}
+
+// ==============================================================================================
+// C: Hysteresis Output
+// ==============================================================================================
+/**
+ * @brief Band worker, phase 2: a weak or strong pixel is an edge when its component holds a strong
+ *        pixel. Roots are looked up without path compression, so bands can share the parent array.
+ *
+ * @param band Band to process
+ */
+static void canny_band_output(CannyBand *band) {
+    int width = band->width;
+    const int *parent = band->parent;
+
+    for (int y = band->y0; y < band->y1; y++) {
+        unsigned char *edges = ImageRow(band->edges, y, 0);
+        for (int x = 0; x < width; x++) {
+            int p = y * width + x;
+            unsigned char edge = 0;
+            if (band->cls[p]) {
+                int root = p;
+                while (parent[root] != root) {
+                    root = parent[root];
+                }
+                edge = band->cls[root] == CANNY_STRONG ? 255 : 0;
+            }
+            edges[x] = edge;
+        }
+    }
+}
+
+/**
+ * @brief ParallelRows worker over band indices, phase 1: runs canny_band_suppress on bands t0 ... t1 - 1.
+ *
+ * @param ctx CannyBand array
+ * @param t0  First band
+ * @param t1  One past the last band
+ */
+static void canny_suppress_bands(void *ctx, int t0, int t1) {
+    CannyBand *bands = ctx;
+    for (int t = t0; t < t1; t++) {
+        canny_band_suppress(&bands[t]);
+    }
+}
+
+/**
+ * @brief ParallelRows worker over band indices, phase 2: runs canny_band_output on bands t0 ... t1 - 1.
+ */
+static void canny_output_bands(void *ctx, int t0, int t1) {
+    CannyBand *bands = ctx;
+    for (int t = t0; t < t1; t++) {
+        canny_band_output(&bands[t]);
+    }
+}
+
+// ==============================================================================================
+// D: Canny Edge Detection
+// ==============================================================================================
+/**
+ * @brief CannyEdgeDetection, with the edge candidates limited to a mask when one is given.
+ *
+ * @param grey    Input greyscale image
+ * @param edges   Output edge image of the same size
+ * @param low     Weak edge threshold
+ * @param high    Strong edge threshold
+ * @param threads Number of threads (1 = run on the calling thread)
+ * @param roi     Mask, or NULL
+ * @param roi_x   Column of the image's left edge in the mask
+ * @param roi_y   Row of the image's top edge in the mask
+ * @return 1 on success, 0 on failure
+ */
+static int canny_run(const Image *grey, const Image *edges, int low, int high, int threads, const RoiMask *roi,
+                     int roi_x, int roi_y) {
+    int width = grey->width, height = grey->height;
+    for (int y = 0; y < height; y++) {
+        memset(ImageRow(edges, y, 0), 0, (size_t)width);
+    }
+    int rows = height - 2;
+    if (rows <= 0 || width < 3) {
+        return 1;
+    }
+    if (low > high) {
+        int t = low;
+        low = high;
+        high = t;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > rows) {
+        threads = rows;
+    }
+
+    unsigned char *cls = calloc((size_t)width * height, 1);
+    int *parent = malloc((size_t)width * height * sizeof(int));
+    CannyBand *bands = calloc((size_t)threads, sizeof(CannyBand));
+    if (!cls || !parent || !bands) {
+        free(cls);
+        free(parent);
+        free(bands);
+        return 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        bands[t].grey = grey;
+        bands[t].cls = cls;
+        bands[t].parent = parent;
+        bands[t].edges = edges;
+        bands[t].width = width;
+        bands[t].height = height;
+        bands[t].y0 = 1 + (int)((long long)rows * t / threads);
+        bands[t].y1 = 1 + (int)((long long)rows * (t + 1) / threads);
+        bands[t].low2 = low * low;
+        bands[t].high2 = high * high;
+        bands[t].roi = roi;
+        bands[t].roi_x = roi_x;
+        bands[t].roi_y = roi_y;
+    }
+
+    // Phase 1: gradients, non-maximum suppression and union-find inside each band, one band per thread
+    ParallelRows(0, threads, threads, canny_suppress_bands, bands, PERF_STAGE_SOBEL);
+    int ok = 1;
+    for (int t = 0; t < threads; t++) {
+        ok = ok && !bands[t].failed;
+    }
+
+    // Join components across band boundaries: first row of each band with the last row of the previous
+    for (int t = 1; t < threads && ok; t++) {
+        int y = bands[t].y0;
+        for (int x = 1; x < width - 1; x++) {
+            int p = y * width + x;
+            if (!cls[p]) {
+                continue;
+            }
+            for (int dx = -1; dx <= 1; dx++) {
+                if (cls[p + dx - width]) {
+                    uf_union(parent, cls, p, p + dx - width);
+                }
+            }
+        }
+    }
+
+    // Phase 2: hysteresis output
+    if (ok) {
+        ParallelRows(0, threads, threads, canny_output_bands, bands, PERF_STAGE_SOBEL);
+    }
+
+    free(cls);
+    free(parent);
+    free(bands);
+    return ok;
+}
+
+/**
+ * @brief Canny edge detection with the Sobel gradients of SobelEdgeDetection. Edges are 255, all
+ *        other pixels 0. Magnitudes are compared squared, so the thresholds are in the same units as
+ *        the Sobel edge image.
+ *
+ * The interior rows are split into one band per thread. Each band computes gradients a row ahead of
+ * non-maximum suppression (one pass over the image) and links its weak / strong pixels with a local
+ * union-find. The calling thread then joins components across the band boundaries (one row per
+ * boundary), and the bands label their pixels in parallel.
+ *
+ * @param grey    Input greyscale image
+ * @param edges   Output edge image of the same size
+ * @param low     Weak edge threshold
+ * @param high    Strong edge threshold
+ * @param threads Number of threads (1 = run on the calling thread)
+ * @return 1 on success, 0 on failure
+ */
+int CannyEdgeDetection(const Image *grey, const Image *edges, int low, int high, int threads) {
+    return canny_run(grey, edges, low, high, threads, NULL, 0, 0);
+}
+
+/**
+ * @brief CannyEdgeDetection with hysteresis limited to the set pixels of a mask: pixels outside it are
+ *        never edges, and a weak pixel only becomes an edge through a chain of mask pixels. The result
+ *        depends on the image only through the mask pixels and the 2-pixel halo their gradients and
+ *        non-maximum suppression read, so the image can be a view of the mask's bounding box grown by 2.
+ *
+ * @param grey    Input greyscale image (or a view of it)
+ * @param edges   Output edge image of the same size
+ * @param low     Weak edge threshold
+ * @param high    Strong edge threshold
+ * @param threads Number of threads (1 = run on the calling thread)
+ * @param roi     Mask
+ * @param roi_x   Column of grey's left edge in the mask
+ * @param roi_y   Row of grey's top edge in the mask
+ * @return 1 on success, 0 on failure
+ */
+int CannyEdgeDetectionMasked(const Image *grey, const Image *edges, int low, int high, int threads,
+                             const RoiMask *roi, int roi_x, int roi_y) {
+    return canny_run(grey, edges, low, high, threads, roi, roi_x, roi_y);
+}
@@ -0,0 +1,606 @@
+/**
+ * @file conv.c
+ * @brief Integer 3x3 / 5x5 convolution engine: kernel analysis (zero taps, ±1 / ±2 weights,
+ *        separability), SSE2 code paths and row-band threading. Sobel, Scharr and Prewitt are presets.
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation and strtol
+#include <string.h> // For string operations
+#include <math.h> // For sqrt
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#include "iedp.h" // Shared types and stage prototypes
+#include "perf_counters.h" // For PERF_STAGE_SOBEL
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Largest sum of |weight| for which every partial sum of 8-bit pixels fits in a signed 16-bit lane
+#define CONV_MAX_L1_INT16 (32767 / 255)
+
+/**
+ * @brief Work shared by all bands of one convolution
+ */
+typedef struct {
+    const Image *src;         // Greyscale input
+    const Image *dst;         // Output
+    int width, height;        // Image size
+    int radius;               // Largest radius of the plans
+    int gradient;             // 1: dst = |(plan 0, plan 1)|, 0: dst = plan 0 >> shift
+    ConvPlan plans[2];        // Compiled kernels
+} ConvJob;
+
+/**
+ * @brief Named kernels
+ */
+typedef struct {
+    const char *name;
+    int size;
+    int shift;
+    int gradient;                          // Pair of kernels combined as a gradient magnitude
+    int kx[CONV_MAX_SIZE * CONV_MAX_SIZE]; // First (or only) kernel
+    int ky[CONV_MAX_SIZE * CONV_MAX_SIZE]; // Second kernel of a gradient pair
+} ConvPresetDef;
+
+static const ConvPresetDef presets[] = {
+    { "sobel", 3, 0, 1,
+      { -1, 0, 1,  -2, 0, 2,  -1, 0, 1 },
+      { 1, 2, 1,  0, 0, 0,  -1, -2, -1 } },
+    { "scharr", 3, 0, 1,
+      { -3, 0, 3,  -10, 0, 10,  -3, 0, 3 },
+      { 3, 10, 3,  0, 0, 0,  -3, -10, -3 } },
+    { "prewitt", 3, 0, 1,
+      { -1, 0, 1,  -1, 0, 1,  -1, 0, 1 },
+      { 1, 1, 1,  0, 0, 0,  -1, -1, -1 } },
+    { "sobel5", 5, 0, 1,
+      { -1, -2, 0, 2, 1,  -4, -8, 0, 8, 4,  -6, -12, 0, 12, 6,  -4, -8, 0, 8, 4,  -1, -2, 0, 2, 1 },
+      { 1, 4, 6, 4, 1,  2, 8, 12, 8, 2,  0, 0, 0, 0, 0,  -2, -8, -12, -8, -2,  -1, -4, -6, -4, -1 } },
+    { "sharpen", 3, 0, 0,
+      { 0, -1, 0,  -1, 5, -1,  0, -1, 0 },
+      { 0 } },
+    { "blur", 3, 4, 0,
+      { 1, 2, 1,  2, 4, 2,  1, 2, 1 },
+      { 0 } },
+};
+
+// ==============================================================================================
+// A: Kernels - presets, parsing and compilation
+// ==============================================================================================
+/**
+ * @brief Looks up a named kernel.
+ *
+ * @param name Preset name: sobel, scharr, prewitt, sobel5 (gradient pairs), sharpen, blur
+ * @param kx   First kernel (the only one for single kernels)
+ * @param ky   Second kernel of a gradient pair
+ * @return 2 for a gradient pair, 1 for a single kernel, 0 if the name is unknown
+ */
+int ConvKernelPreset(const char *name, ConvKernel *kx, ConvKernel *ky) {
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+        const ConvPresetDef *p = &presets[i];
+        if (strcmp(name, p->name) != 0) {
+            continue;
+        }
+        int n = p->size * p->size;
+        kx->size = ky->size = p->size;
+        kx->shift = ky->shift = p->shift;
+        memcpy(kx->weights, p->kx, (size_t)n * sizeof(int));
+        memcpy(ky->weights, p->ky, (size_t)n * sizeof(int));
+        return p->gradient ? 2 : 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses a custom kernel: 9 or 25 comma separated integers, row by row, optionally followed
+ *        by ">>shift", e.g. "1,2,1,2,4,2,1,2,1>>4".
+ *
+ * @param text Kernel text
+ * @param k    Parsed kernel
+ * @return 1 on success, 0 on a malformed kernel
+ */
+int ConvKernelParse(const char *text, ConvKernel *k) {
+    int n = 0;
+    const char *p = text;
+    memset(k, 0, sizeof(*k));
+    while (*p) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || n == CONV_MAX_SIZE * CONV_MAX_SIZE || v < -1024 || v > 1024) {
+            return 0;
+        }
+        k->weights[n++] = (int)v;
+        p = end;
+        if (*p == ',') {
+            p++;
+        } else if (strncmp(p, ">>", 2) == 0) {
+            long s = strtol(p + 2, &end, 10);
+            if (end == p + 2 || *end != '\0' || s < 0 || s > 15) {
+                return 0;
+            }
+            k->shift = (int)s;
+            p = end;
+        } else if (*p != '\0') {
+            return 0;
+        }
+    }
+    if (n != 9 && n != 25) {
+        return 0;
+    }
+    k->size = n == 9 ? 3 : 5;
+    return 1;
+}
+
+/**
+ * @brief Compiles a kernel: drops zero weights, and splits it into a column and a row vector when it
+ *        has rank one (checked exactly on the integer weights).
+ *
+ * @param k    Kernel
+ * @param plan Compiled kernel
+ */
+void ConvPlanCompile(const ConvKernel *k, ConvPlan *plan) {
+    int size = k->size;
+    int r = size / 2;
+    memset(plan, 0, sizeof(*plan));
+    plan->radius = r;
+    plan->shift = k->shift;
+
+    int l1 = 0;
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            int w = k->weights[j * size + i];
+            l1 += w < 0 ? -w : w;
+            if (w != 0) {
+                plan->taps[plan->tap_count++] = (ConvTap){ i - r, j - r, w };
+            }
+        }
+    }
+    plan->simd = l1 <= CONV_MAX_L1_INT16;
+    if (plan->tap_count == 0) {
+        return;
+    }
+
+    // Rank one: every row is a multiple of a reference row. Divide the reference row by the gcd of
+    // its weights, then each row's factor is an integer
+    int ref = plan->taps[0].dy + r;
+    const int *row = &k->weights[ref * size];
+    int g = 0;
+    for (int i = 0; i < size; i++) {
+        int a = row[i] < 0 ? -row[i] : row[i];
+        while (a) {
+            int t = g % a;
+            g = a;
+            a = t;
+        }
+    }
+    int pivot = 0;
+    while (row[pivot] == 0) {
+        pivot++;
+    }
+    for (int j = 0; j < size; j++) {
+        const int *other = &k->weights[j * size];
+        for (int i = 0; i < size; i++) {
+            if (other[i] * row[pivot] != row[i] * other[pivot]) {
+                return;
+            }
+        }
+    }
+    plan->separable = 1;
+    for (int i = 0; i < size; i++) {
+        if (row[i] != 0) {
+            plan->row_taps[plan->row_count++] = (ConvTap){ i - r, 0, row[i] / g };
+        }
+    }
+    for (int j = 0; j < size; j++) {
+        int factor = k->weights[j * size + pivot] / (row[pivot] / g);
+        if (factor != 0) {
+            plan->col_taps[plan->col_count++] = (ConvTap){ 0, j - r, factor };
+        }
+    }
+}
+
+// ==============================================================================================
+// B: Scalar Path - borders, row tails, wide weights and non-SSE2 builds
+// ==============================================================================================
+/**
+ * @brief Kernel sum at one pixel, 32-bit.
+ *
+ * @param plan Compiled kernel
+ * @param src  Input image
+ * @param x    Column, radius ... width - radius - 1
+ * @param y    Row, radius ... height - radius - 1
+ * @return Sum of weight * pixel
+ */
+static inline int conv_pixel(const ConvPlan *plan, const Image *src, int x, int y) {
+    int sum = 0;
+    for (int t = 0; t < plan->tap_count; t++) {
+        const ConvTap *tap = &plan->taps[t];
+        sum += tap->weight * ImageRow(src, y + tap->dy, 0)[x + tap->dx];
+    }
+    return sum;
+}
+
+/**
+ * @brief Output value of one interior pixel.
+ *
+ * @param job Convolution
+ * @param x   Column
+ * @param y   Row
+ * @return Gradient magnitude (as SobelEdgeDetection) or shifted sum, clamped to 0 ... 255
+ */
+static inline unsigned char conv_output(const ConvJob *job, int x, int y) {
+    int v;
+    if (job->gradient) {
+        long long gx = conv_pixel(&job->plans[0], job->src, x, y);
+        long long gy = conv_pixel(&job->plans[1], job->src, x, y);
+        v = (int)(sqrt((double)(gx * gx + gy * gy)));
+    } else {
+        v = conv_pixel(&job->plans[0], job->src, x, y) >> job->plans[0].shift;
+        v = v < 0 ? 0 : v;
+    }
+    return (unsigned char)(v > 255 ? 255 : v);
+}
+
+// ==============================================================================================
+// C: SSE2 Path - 16 pixels per step in signed 16-bit lanes
+// ==============================================================================================
+#if defined(__SSE2__)
+/**
+ * @brief Adds weight * (lo, hi) to the accumulators. Weights ±1 and ±2 become add / subtract (and a
+ *        shift); other weights multiply.
+ */
+static inline void conv_accumulate(__m128i *acc_lo, __m128i *acc_hi, __m128i lo, __m128i hi, int weight) {
+    switch (weight) {
+        case 1:
+            *acc_lo = _mm_add_epi16(*acc_lo, lo);
+            *acc_hi = _mm_add_epi16(*acc_hi, hi);
+            break;
+        case -1:
+            *acc_lo = _mm_sub_epi16(*acc_lo, lo);
+            *acc_hi = _mm_sub_epi16(*acc_hi, hi);
+            break;
+        case 2:
+            *acc_lo = _mm_add_epi16(*acc_lo, _mm_slli_epi16(lo, 1));
+            *acc_hi = _mm_add_epi16(*acc_hi, _mm_slli_epi16(hi, 1));
+            break;
+        case -2:
+            *acc_lo = _mm_sub_epi16(*acc_lo, _mm_slli_epi16(lo, 1));
+            *acc_hi = _mm_sub_epi16(*acc_hi, _mm_slli_epi16(hi, 1));
+            break;
+        default: {
+            __m128i w = _mm_set1_epi16((short)weight);
+            *acc_lo = _mm_add_epi16(*acc_lo, _mm_mullo_epi16(lo, w));
+            *acc_hi = _mm_add_epi16(*acc_hi, _mm_mullo_epi16(hi, w));
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Applies taps to 16 consecutive 8-bit pixels.
+ *
+ * @param rows  Row pointers, rows[radius + dy] is the row at offset dy
+ * @param taps  Taps
+ * @param count Number of taps
+ * @param x     First column
+ * @param lo    Sums of pixels x ... x + 7
+ * @param hi    Sums of pixels x + 8 ... x + 15
+ */
+static inline void conv_taps_u8(const unsigned char *const *rows, int radius, const ConvTap *taps, int count,
+                                int x, __m128i *lo, __m128i *hi) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc_lo = zero, acc_hi = zero;
+    for (int t = 0; t < count; t++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(rows[radius + taps[t].dy] + x + taps[t].dx));
+        conv_accumulate(&acc_lo, &acc_hi, _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero), taps[t].weight);
+    }
+    *lo = acc_lo;
+    *hi = acc_hi;
+}
+
+/**
+ * @brief Applies taps to 16 consecutive 16-bit values (vertical pass of a separable kernel).
+ */
+static inline void conv_taps_s16(const int16_t *const *rows, int radius, const ConvTap *taps, int count,
+                                 int x, __m128i *lo, __m128i *hi) {
+    __m128i acc_lo = _mm_setzero_si128(), acc_hi = _mm_setzero_si128();
+    for (int t = 0; t < count; t++) {
+        const int16_t *p = rows[radius + taps[t].dy] + x + taps[t].dx;
+        conv_accumulate(&acc_lo, &acc_hi, _mm_loadu_si128((const __m128i *)p),
+                        _mm_loadu_si128((const __m128i *)(p + 8)), taps[t].weight);
+    }
+    *lo = acc_lo;
+    *hi = acc_hi;
+}
+
+/**
+ * @brief Gradient magnitude of 4 pixels: floor(sqrt(min(gx² + gy², 255²))), which equals the clamped
+ *        double-precision result of SobelEdgeDetection (single precision is exact below 2^24).
+ */
+static inline __m128i conv_magnitude4(__m128i pairs) {
+    const __m128i limit = _mm_set1_epi32(255 * 255);
+    __m128i m = _mm_madd_epi16(pairs, pairs);
+    __m128i over = _mm_cmpgt_epi32(m, limit);
+    m = _mm_or_si128(_mm_and_si128(over, limit), _mm_andnot_si128(over, m));
+    return _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(m)));
+}
+
+/**
+ * @brief Final 8-bit output of 16 pixels from the kernel sums.
+ *
+ * @param gradient 1: magnitude of sums 0 and 1, 0: sum 0 >> shift
+ * @param shift    Shift of a single kernel
+ */
+static inline __m128i conv_pack(int gradient, int shift, __m128i *sum_lo, __m128i *sum_hi) {
+    if (gradient) {
+        __m128i m0 = conv_magnitude4(_mm_unpacklo_epi16(sum_lo[0], sum_lo[1]));
+        __m128i m1 = conv_magnitude4(_mm_unpackhi_epi16(sum_lo[0], sum_lo[1]));
+        __m128i m2 = conv_magnitude4(_mm_unpacklo_epi16(sum_hi[0], sum_hi[1]));
+        __m128i m3 = conv_magnitude4(_mm_unpackhi_epi16(sum_hi[0], sum_hi[1]));
+        return _mm_packus_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3));
+    }
+    __m128i count = _mm_cvtsi32_si128(shift);
+    return _mm_packus_epi16(_mm_sra_epi16(sum_lo[0], count), _mm_sra_epi16(sum_hi[0], count));
+}
+#endif
+
+// ==============================================================================================
+// D: Band Worker
+// ==============================================================================================
+/**
+ * @brief Convolves output rows y0 ... y1 - 1 (all inside the border). Non-separable kernels read the
+ *        input rows directly; separable kernels keep a ring of horizontally filtered rows, so each
+ *        input row is filtered horizontally once per band.
+ *
+ * @param arg ConvJob
+ * @param y0  First row
+ * @param y1  One past the last row
+ */
+static void conv_rows(void *arg, int y0, int y1) {
+    const ConvJob *job = arg;
+    int width = job->width;
+    int r = job->radius;
+    int plan_count = job->gradient ? 2 : 1;
+    int x_simd_end = r; // First column left to the scalar tail
+
+#if defined(__SSE2__)
+    int simd = 1;
+    for (int p = 0; p < plan_count; p++) {
+        simd = simd && job->plans[p].simd;
+    }
+
+    // Ring of horizontally filtered rows for each separable plan: slot (row mod (2r + 1))
+    int ring_rows = 2 * r + 1;
+    int16_t *ring = NULL;
+    int separable[2] = { 0, 0 };
+    if (simd) {
+        int any = 0;
+        for (int p = 0; p < plan_count; p++) {
+            separable[p] = job->plans[p].separable && job->plans[p].radius == r;
+            any |= separable[p];
+        }
+        if (any) {
+            ring = malloc((size_t)plan_count * ring_rows * (width + 16) * sizeof(int16_t));
+            if (!ring) {
+                separable[0] = separable[1] = 0;
+            }
+        }
+    }
+#define RING(p, row) (ring + ((size_t)(p) * ring_rows + (size_t)(((row) % ring_rows + ring_rows) % ring_rows)) \
+                      * (width + 16))
+
+    // Horizontal pass of one input row into its ring slot (columns r ... width - r - 1)
+#define HORIZONTAL(p, row) do { \
+        const ConvPlan *hp = &job->plans[p]; \
+        const unsigned char *in = ImageRow(job->src, row, 0); \
+        const unsigned char *in_rows[1] = { in }; \
+        int16_t *out = RING(p, row); \
+        int hx = r; \
+        for (; hx + 16 + r <= width; hx += 16) { \
+            __m128i lo, hi; \
+            conv_taps_u8(in_rows, 0, hp->row_taps, hp->row_count, hx, &lo, &hi); \
+            _mm_storeu_si128((__m128i *)(out + hx), lo); \
+            _mm_storeu_si128((__m128i *)(out + hx + 8), hi); \
+        } \
+        for (; hx < width - r; hx++) { \
+            int s = 0; \
+            for (int t = 0; t < hp->row_count; t++) { \
+                s += hp->row_taps[t].weight * in[hx + hp->row_taps[t].dx]; \
+            } \
+            out[hx] = (int16_t)s; \
+        } \
+    } while (0)
+
+    for (int p = 0; p < plan_count; p++) {
+        if (separable[p]) {
+            for (int row = y0 - r; row < y0 + r; row++) {
+                HORIZONTAL(p, row);
+            }
+        }
+    }
+#endif
+
+    for (int y = y0; y < y1; y++) {
+        unsigned char *dst = ImageRow(job->dst, y, 0);
+        x_simd_end = r;
+
+#if defined(__SSE2__)
+        if (simd) {
+            const unsigned char *rows[CONV_MAX_SIZE];
+            const int16_t *hrows[2][CONV_MAX_SIZE];
+            for (int j = -r; j <= r; j++) {
+                rows[r + j] = ImageRow(job->src, y + j, 0);
+            }
+            for (int p = 0; p < plan_count; p++) {
+                if (separable[p]) {
+                    HORIZONTAL(p, y + r);
+                    for (int j = -r; j <= r; j++) {
+                        hrows[p][r + j] = RING(p, y + j);
+                    }
+                }
+            }
+            int x = r;
+            for (; x + 16 + r <= width; x += 16) {
+                __m128i lo[2], hi[2];
+                for (int p = 0; p < plan_count; p++) {
+                    const ConvPlan *plan = &job->plans[p];
+                    if (separable[p]) {
+                        conv_taps_s16(hrows[p], r, plan->col_taps, plan->col_count, x, &lo[p], &hi[p]);
+                    } else {
+                        conv_taps_u8(rows, r, plan->taps, plan->tap_count, x, &lo[p], &hi[p]);
+                    }
+                }
+                _mm_storeu_si128((__m128i *)(dst + x), conv_pack(job->gradient, job->plans[0].shift, lo, hi));
+            }
+            x_simd_end = x;
+        }
+#endif
+        for (int x = x_simd_end; x < width - r; x++) {
+            dst[x] = conv_output(job, x, y);
+        }
+    }
+
+#if defined(__SSE2__)
+#undef HORIZONTAL
+#undef RING
+    free(ring);
+#endif
+}
+
+// ==============================================================================================
+// E: Convolution Stages
+// ==============================================================================================
+/**
+ * @brief Compiles the kernels, handles the border and runs the interior in row bands.
+ *
+ * @param job     Convolution with src, dst, size and gradient set
+ * @param kx      First kernel
+ * @param ky      Second kernel (gradient only)
+ * @param threads Number of threads
+ */
+static void conv_run(ConvJob *job, const ConvKernel *kx, const ConvKernel *ky, int threads) {
+    int width = job->width, height = job->height;
+    ConvPlanCompile(kx, &job->plans[0]);
+    job->radius = job->plans[0].radius;
+    if (job->gradient) {
+        ConvPlanCompile(ky, &job->plans[1]);
+        if (job->plans[1].radius > job->radius) {
+            job->radius = job->plans[1].radius;
+        }
+    }
+    int r = job->radius;
+
+    // Border: 0 for gradients (as SobelEdgeDetection), the input pixel for filters (as MedianFilter)
+    for (int y = 0; y < height; y++) {
+        const unsigned char *src = ImageRow(job->src, y, 0);
+        unsigned char *dst = ImageRow(job->dst, y, 0);
+        if (y >= r && y < height - r) {
+            for (int x = 0; x < r && x < width; x++) {
+                dst[x] = job->gradient ? 0 : src[x];
+            }
+            for (int x = width - r > r ? width - r : r; x < width; x++) {
+                dst[x] = job->gradient ? 0 : src[x];
+            }
+        } else if (job->gradient) {
+            memset(dst, 0, (size_t)width);
+        } else {
+            memcpy(dst, src, (size_t)width);
+        }
+    }
+    if (width <= 2 * r) {
+        return;
+    }
+    ParallelRows(r, height - r, threads, conv_rows, job, PERF_STAGE_SOBEL);
+}
+
+/**
+ * @brief Gradient magnitude sqrt(gx² + gy²), clamped to 255, of two kernels (e.g. the sobel, scharr
+ *        or prewitt presets). With the sobel preset the output equals SobelEdgeDetection.
+ *
+ * @param grey    Input greyscale image
+ * @param edges   Output edge image of the same size
+ * @param kx      Horizontal gradient kernel
+ * @param ky      Vertical gradient kernel
+ * @param threads Number of threads
+ */
+void ConvolveGradient(const Image *grey, const Image *edges, const ConvKernel *kx, const ConvKernel *ky,
+                      int threads) {
+    ConvJob job = { grey, edges, grey->width, grey->height, 0, 1, { { 0 } } };
+    conv_run(&job, kx, ky, threads);
+}
+
+/**
+ * @brief Filters a greyscale image with one kernel: clamp(sum >> shift, 0, 255). Border pixels keep
+ *        their input value.
+ *
+ * @param grey    Input greyscale image
+ * @param output  Output image of the same size
+ * @param k       Kernel
+ * @param threads Number of threads
+ */
+void Convolve(const Image *grey, const Image *output, const ConvKernel *k, int threads) {
+    ConvJob job = { grey, output, grey->width, grey->height, 0, 0, { { 0 } } };
+    conv_run(&job, k, NULL, threads);
+}
+
+/**
+ * @brief Kernel sum at one column of a row span, 32-bit.
+ */
+static inline int conv_row_pixel(const ConvPlan *plan, const unsigned char *const *rows, int radius, int x) {
+    int sum = 0;
+    for (int t = 0; t < plan->tap_count; t++) {
+        const ConvTap *tap = &plan->taps[t];
+        sum += tap->weight * rows[radius + tap->dy][x + tap->dx];
+    }
+    return sum;
+}
+
+/**
+ * @brief Convolve / ConvolveGradient of the columns x0 ... x1 - 1 of one row, from row pointers so
+ *        the rows can live in any buffer (e.g. the tiles of a fused stencil pipeline). The whole
+ *        window of every column must lie inside the rows.
+ *
+ * @param rows Input rows y - radius ... y + radius, indexed by column
+ * @param dst  Output row, indexed by column
+ * @param x0   First column
+ * @param x1   One past the last column
+ * @param px   First kernel, compiled (ConvPlanCompile)
+ * @param py   Second kernel of a gradient pair, compiled from a kernel of the same size as px's; NULL
+ *             for a single kernel
+ */
+void ConvolveRow(const unsigned char *const *rows, unsigned char *dst, int x0, int x1, const ConvPlan *px,
+                 const ConvPlan *py) {
+    int r = px->radius;
+    int x = x0;
+
+#if defined(__SSE2__)
+    if (px->simd && (!py || py->simd)) {
+        for (; x + 16 <= x1; x += 16) {
+            __m128i lo[2], hi[2];
+            conv_taps_u8(rows, r, px->taps, px->tap_count, x, &lo[0], &hi[0]);
+            if (py) {
+                conv_taps_u8(rows, r, py->taps, py->tap_count, x, &lo[1], &hi[1]);
+            }
+            _mm_storeu_si128((__m128i *)(dst + x), conv_pack(py != NULL, px->shift, lo, hi));
+        }
+    }
+#endif
+    for (; x < x1; x++) {
+        int v;
+        if (py) {
+            long long gx = conv_row_pixel(px, rows, r, x);
+            long long gy = conv_row_pixel(py, rows, r, x);
+            v = (int)(sqrt((double)(gx * gx + gy * gy)));
+        } else {
+            v = conv_row_pixel(px, rows, r, x) >> px->shift;
+            v = v < 0 ? 0 : v;
+        }
+        dst[x] = (unsigned char)(v > 255 ? 255 : v);
+    }
+}
@@ -0,0 +1,289 @@
+/**
+ * @file dispatch.c
+ * @brief Runtime CPU feature dispatch for the median, greyscale and Sobel row kernels. CPUID (and
+ *        XGETBV for the register state the OS saves) decides which instruction sets the machine
+ *        supports; each stage gets the widest variant it has, unless a spec from --isa or the
+ *        IEDP_ISA environment variable caps it.
+ *
+ * Spec: comma-separated items, later items win. "auto" or an instruction set ("scalar", "sse2",
+ * "avx2", "avx512") applies to every stage, "median=...", "grey=..." and "sobel=..." to one.
+ * A stage without a variant for the requested instruction set uses the widest one below it.
+ * "planar" or "interleaved" picks the layout the stage graph streams the median and greyscale
+ * rows in; by default it is planar when the median has an AVX2 or wider planar variant, where
+ * one plane per channel lets the median select its output pixel in vector registers (the
+ * deinterleave and interleave around it cost less than the gathers they save).
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdio.h> // For I/O operations
+#include <string.h> // For string operations
+
+#include "iedp.h" // Shared types and stage prototypes
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h> // For __get_cpuid and __get_cpuid_count
+#endif
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Stages with kernel variants, in the order of their spec names
+enum { KERNEL_STAGE_MEDIAN, KERNEL_STAGE_GREY, KERNEL_STAGE_SOBEL, KERNEL_STAGE_COUNT };
+static const char *stage_names[KERNEL_STAGE_COUNT] = { "median", "grey", "sobel" };
+
+/**
+ * @brief Row kernels of one instruction set (NULL: no variant of that stage)
+ */
+typedef struct {
+    const char *name;       // Spec and log name
+    MedianRowFn median_row; // Median filter
+    GreyRowFn grey_row;     // Greyscale conversion
+    SobelRowFn sobel_row;   // Sobel edge detection
+    MedianPlanarRowFn median_planar_row; // Planar median filter, same instruction sets as median_row
+    GreyPlanarRowFn grey_planar_row;     // Planar greyscale conversion, same as grey_row
+} KernelVariant;
+
+// Indexed by KernelIsa. Greyscale has no SSE2 or AVX-512 variant: the AVX2 one already converts
+// four pixels per step in double precision and is limited by the RGB gathers.
+static const KernelVariant variants[KERNEL_ISA_COUNT] = {
+    { "scalar", MedianFilterRow, ConvertToGreyscaleRow, SobelEdgeRow, MedianFilterPlanarRow,
+      ConvertToGreyscalePlanarRow },
+#if defined(__SSE2__)
+    { "sse2", MedianFilterRowSSE2, NULL, SobelEdgeRowSSE2, MedianFilterPlanarRowSSE2, NULL },
+#else
+    { "sse2", NULL, NULL, NULL, NULL, NULL },
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    { "avx2", MedianFilterRowAVX2, ConvertToGreyscaleRowAVX2, SobelEdgeRowAVX2, MedianFilterPlanarRowAVX2,
+      ConvertToGreyscalePlanarRowAVX2 },
+    { "avx512", MedianFilterRowAVX512, NULL, SobelEdgeRowAVX512, MedianFilterPlanarRowAVX512, NULL },
+#else
+    { "avx2", NULL, NULL, NULL, NULL, NULL },
+    { "avx512", NULL, NULL, NULL, NULL, NULL },
+#endif
+};
+
+// ==============================================================================================
+// A: CPU Feature Probe
+// ==============================================================================================
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * @brief Register state the OS saves on context switches (XCR0).
+ *
+ * @return XCR0, 0 when XGETBV is not enabled
+ */
+static unsigned long long read_xcr0(void) {
+    unsigned int eax, ebx, ecx, edx;
+    // CPUID.1:ECX.OSXSAVE[bit 27]
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1u << 27))) {
+        return 0;
+    }
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+}
+#endif
+
+/**
+ * @brief Widest instruction set the CPU and OS support.
+ *
+ * @return KernelIsa
+ */
+static KernelIsa probe_isa(void) {
+    KernelIsa isa = KERNEL_ISA_SCALAR;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return isa;
+    }
+    // CPUID.1:EDX.SSE2[bit 26]
+    if (edx & (1u << 26)) {
+        isa = KERNEL_ISA_SSE2;
+    }
+    unsigned long long xcr0 = read_xcr0();
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return isa;
+    }
+    // CPUID.7.0:EBX.AVX2[bit 5]; XCR0: SSE and AVX state
+    if ((ebx & (1u << 5)) && (xcr0 & 0x6) == 0x6) {
+        isa = KERNEL_ISA_AVX2;
+        // CPUID.7.0:EBX.AVX512F[bit 16] and AVX512BW[bit 30]; XCR0: opmask and ZMM state as well
+        if ((ebx & (1u << 16)) && (ebx & (1u << 30)) && (xcr0 & 0xe6) == 0xe6) {
+            isa = KERNEL_ISA_AVX512;
+        }
+    }
+#endif
+    return isa;
+}
+
+/**
+ * @brief Whether the CPU and OS support an instruction set.
+ *
+ * @param isa Instruction set
+ * @return 1 if supported, 0 otherwise
+ */
+int KernelIsaSupported(KernelIsa isa) {
+    // Probed once; the instruction sets do not change while the process runs
+    static int widest = -1;
+    if (widest < 0) {
+        widest = (int)probe_isa();
+    }
+    return (int)isa <= widest;
+}
+
+// ==============================================================================================
+// B: Variant Selection
+// ==============================================================================================
+/**
+ * @brief Instruction set named by a spec value.
+ *
+ * @param name Value, length len ("auto": the widest supported one)
+ * @param len  Length of the value
+ * @param isa  Result
+ * @return 1 on success, 0 on an unknown or unsupported instruction set (reported to stderr)
+ */
+static int parse_isa(const char *name, size_t len, KernelIsa *isa) {
+    if (len == 4 && strncmp(name, "auto", 4) == 0) {
+        *isa = KERNEL_ISA_AVX512;
+        while (!KernelIsaSupported(*isa)) {
+            (*isa)--;
+        }
+        return 1;
+    }
+    for (int i = 0; i < KERNEL_ISA_COUNT; i++) {
+        if (strlen(variants[i].name) == len && strncmp(name, variants[i].name, len) == 0) {
+            if (!KernelIsaSupported((KernelIsa)i)) {
+                fprintf(stderr, "Kernel instruction set '%s' is not supported on this CPU\n", variants[i].name);
+                return 0;
+            }
+            *isa = (KernelIsa)i;
+            return 1;
+        }
+    }
+    fprintf(stderr, "Unknown kernel instruction set '%.*s' (scalar, sse2, avx2, avx512 or auto)\n", (int)len, name);
+    return 0;
+}
+
+/**
+ * @brief Whether an instruction set has a variant of a stage.
+ *
+ * @param variant Kernels of the instruction set
+ * @param stage   KERNEL_STAGE_*
+ * @return 1 if it has one, 0 otherwise
+ */
+static int has_variant(const KernelVariant *variant, int stage) {
+    switch (stage) {
+        case KERNEL_STAGE_MEDIAN:
+            return variant->median_row != NULL;
+        case KERNEL_STAGE_GREY:
+            return variant->grey_row != NULL;
+        default:
+            return variant->sobel_row != NULL;
+    }
+}
+
+/**
+ * @brief Select the row kernels of the median, greyscale and Sobel stages for a frame geometry.
+ *        An SSE2 selection uses the fixed-geometry instantiation when the frame has one.
+ *
+ * @param spec    Variant spec (see the top of this file); NULL or "" for "auto"
+ * @param width   Frame width
+ * @param height  Frame height
+ * @param kernels Result; width and height are the fixed geometry if any stage uses it, 0 otherwise
+ * @return 1 on success, 0 on an invalid spec (reported to stderr)
+ */
+int StageKernelsSelect(const char *spec, int width, int height, StageKernels *kernels) {
+    KernelIsa caps[KERNEL_STAGE_COUNT];
+    parse_isa("auto", 4, &caps[0]);
+    caps[KERNEL_STAGE_GREY] = caps[KERNEL_STAGE_SOBEL] = caps[KERNEL_STAGE_MEDIAN];
+    int layout = -1; // -1: by the median variant
+
+    // Spec items
+    for (const char *item = spec ? spec : ""; *item; ) {
+        size_t len = strcspn(item, ",");
+        const char *eq = memchr(item, '=', len);
+        KernelIsa isa;
+        if (!eq && len == 6 && strncmp(item, "planar", 6) == 0) {
+            layout = IMAGE_PLANAR;
+        } else if (!eq && len == 11 && strncmp(item, "interleaved", 11) == 0) {
+            layout = IMAGE_INTERLEAVED;
+        } else if (!eq) {
+            if (!parse_isa(item, len, &isa)) {
+                return 0;
+            }
+            for (int s = 0; s < KERNEL_STAGE_COUNT; s++) {
+                caps[s] = isa;
+            }
+        } else {
+            int stage = -1;
+            for (int s = 0; s < KERNEL_STAGE_COUNT; s++) {
+                if (strlen(stage_names[s]) == (size_t)(eq - item) && strncmp(item, stage_names[s], eq - item) == 0) {
+                    stage = s;
+                }
+            }
+            if (stage < 0) {
+                fprintf(stderr, "Unknown kernel stage '%.*s' (median, grey or sobel)\n", (int)(eq - item), item);
+                return 0;
+            }
+            if (!parse_isa(eq + 1, len - (eq + 1 - item), &isa)) {
+                return 0;
+            }
+            caps[stage] = isa;
+        }
+        item += len + (item[len] == ',');
+    }
+
+    // Widest variant of each stage up to its cap
+    int chosen[KERNEL_STAGE_COUNT];
+    for (int s = 0; s < KERNEL_STAGE_COUNT; s++) {
+        chosen[s] = caps[s];
+        while (chosen[s] > KERNEL_ISA_SCALAR && !has_variant(&variants[chosen[s]], s)) {
+            chosen[s]--;
+        }
+    }
+    kernels->width = kernels->height = 0;
+    kernels->median_row = variants[chosen[KERNEL_STAGE_MEDIAN]].median_row;
+    kernels->grey_row = variants[chosen[KERNEL_STAGE_GREY]].grey_row;
+    kernels->sobel_row = variants[chosen[KERNEL_STAGE_SOBEL]].sobel_row;
+    kernels->median_isa = variants[chosen[KERNEL_STAGE_MEDIAN]].name;
+    kernels->grey_isa = variants[chosen[KERNEL_STAGE_GREY]].name;
+    kernels->sobel_isa = variants[chosen[KERNEL_STAGE_SOBEL]].name;
+    kernels->median_planar_row = variants[chosen[KERNEL_STAGE_MEDIAN]].median_planar_row;
+    kernels->grey_planar_row = variants[chosen[KERNEL_STAGE_GREY]].grey_planar_row;
+    if (layout < 0) {
+        layout = chosen[KERNEL_STAGE_MEDIAN] >= KERNEL_ISA_AVX2 ? IMAGE_PLANAR : IMAGE_INTERLEAVED;
+    }
+    kernels->layout = (ImageLayout)layout;
+
+    // Fixed-geometry instantiations of the SSE2 kernels
+    const StageKernels *fixed = StageKernelsFind(width, height);
+    if (fixed->width) {
+        if (chosen[KERNEL_STAGE_MEDIAN] == KERNEL_ISA_SSE2 && strcmp(fixed->median_isa, "sse2") == 0) {
+            kernels->median_row = fixed->median_row;
+            kernels->width = fixed->width;
+        }
+        if (chosen[KERNEL_STAGE_SOBEL] == KERNEL_ISA_SSE2 && strcmp(fixed->sobel_isa, "sse2") == 0) {
+            kernels->sobel_row = fixed->sobel_row;
+            kernels->width = fixed->width;
+        }
+        kernels->height = kernels->width ? fixed->height : 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Log the selected kernel variants, one line.
+ *
+ * @param kernels Kernels from StageKernelsSelect
+ * @param out     Stream to print to
+ */
+void StageKernelsPrint(const StageKernels *kernels, FILE *out) {
+    fprintf(out, "Stage kernels: median %s, grey %s, sobel %s", kernels->median_isa, kernels->grey_isa,
+            kernels->sobel_isa);
+    if (kernels->width) {
+        fprintf(out, " (fixed %dx%d)", kernels->width, kernels->height);
+    }
+    fprintf(out, ", %s rows\n", kernels->layout == IMAGE_PLANAR ? "planar" : "interleaved");
+}
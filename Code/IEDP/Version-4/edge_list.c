@@ -0,0 +1,335 @@
+/**
+ * @file edge_list.c
+ * @brief Sparse edge output: (x, y, magnitude, direction) records of the pixels above a threshold
+ *
+ * File format (little-endian):
+ *   offset  0  char[8]  "IEDPEDGE"
+ *   offset  8  uint32   version (1)
+ *   offset 12  uint32   image width
+ *   offset 16  uint32   image height
+ *   offset 20  uint32   flags, bit 0: records carry a direction byte
+ *   offset 24  uint64   record count
+ *   offset 32  records  uint16 x, uint16 y, uint8 magnitude [, uint8 direction], sorted by y then x
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For memcpy
+#include <math.h> // For sqrt and atan2
+
+#include "iedp.h" // Shared types and stage prototypes
+#include "perf_counters.h" // PERF_STAGE_SOBEL for the worker threads
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+#define EDGE_LIST_VERSION 1
+#define EDGE_LIST_HEADER_SIZE 32
+#define EDGE_LIST_FLAG_DIRECTION 1u
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * @brief Work for one thread: a band of rows and the records found in it
+ */
+typedef struct {
+    const Image *grey;         // Greyscale image
+    int y0, y1;                // Rows y0 ... y1 - 1
+    int threshold;             // Edge threshold, 0 ... 255
+    EdgeList list;             // Records of this band
+    int failed;                // Allocation failed
+} EdgeBand;
+
+// ==============================================================================================
+// A: Record Buffers
+// ==============================================================================================
+/**
+ * @brief Appends one record, growing the buffer geometrically.
+ *
+ * @param list   List to append to
+ * @param record Record to append
+ * @return 1 on success, 0 if the buffer could not grow
+ */
+static int edge_list_push(EdgeList *list, EdgeRecord record) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 4096;
+        EdgeRecord *records = realloc(list->records, capacity * sizeof(EdgeRecord));
+        if (!records) {
+            return 0;
+        }
+        list->records = records;
+        list->capacity = capacity;
+    }
+    list->records[list->count++] = record;
+    return 1;
+}
+
+/**
+ * @brief Frees the records of a list.
+ *
+ * @param list List from SobelEdgeList
+ */
+void FreeEdgeList(EdgeList *list) {
+    free(list->records);
+    list->records = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+// ==============================================================================================
+// B: Sobel Pass - one band of rows
+// ==============================================================================================
+/**
+ * @brief Record of an interior pixel: magnitude as SobelEdgeDetection writes it and gradient direction.
+ *
+ * @param grey Greyscale image
+ * @param x    Column, 1 ... width - 2
+ * @param y    Row, 1 ... height - 2
+ * @return Record
+ */
+static EdgeRecord edge_record(const Image *grey, int x, int y) {
+    int sumX, sumY;
+    SobelGradient(grey, x, y, &sumX, &sumY);
+
+    // Magnitude as SobelEdgeDetection writes it
+    int magnitude = (int)(sqrt((double)(sumX * sumX + sumY * sumY)));
+    if (magnitude > 255) {
+        magnitude = 255;
+    }
+    // Gradient direction in 1/256 turns, 0 = +x, counter-clockwise with y pointing up
+    int direction = (int)lround(atan2((double)sumY, (double)sumX) * (128.0 / M_PI));
+
+    EdgeRecord record = { (uint16_t)x, (uint16_t)y, (uint8_t)magnitude, (uint8_t)(direction & 0xFF) };
+    return record;
+}
+
+/**
+ * @brief Finds the edge pixels of one band. The bit-packed mask row (SobelEdgeMaskRow) selects the
+ *        pixels; magnitude and direction are only computed for those, so flat areas cost one compare
+ *        per pixel.
+ *
+ * @param band Band to process
+ */
+static void edge_band_run(EdgeBand *band) {
+    const Image *grey = band->grey;
+    int stride = EDGE_MASK_STRIDE(grey->width);
+
+    unsigned char *row = malloc((size_t)stride);
+    if (!row) {
+        band->failed = 1;
+    }
+    for (int y = band->y0; y < band->y1 && !band->failed; y++) {
+        SobelEdgeMaskRow(grey, row, y, band->threshold);
+        for (int xb = 0; xb < stride; xb++) {
+            unsigned bits = row[xb];
+            while (bits) {
+                // Leftmost remaining pixel of the byte
+                int b = __builtin_clz(bits) - (int)(8 * sizeof(unsigned) - 8);
+                bits &= ~(0x80u >> b);
+                int x = xb * 8 + b;
+
+                if (!edge_list_push(&band->list, edge_record(grey, x, y))) {
+                    band->failed = 1;
+                    break;
+                }
+            }
+        }
+    }
+    free(row);
+}
+
+/**
+ * @brief ParallelRows worker over band indices: runs bands t0 ... t1 - 1.
+ *
+ * @param ctx EdgeBand array
+ * @param t0  First band
+ * @param t1  One past the last band
+ */
+static void edge_bands(void *ctx, int t0, int t1) {
+    EdgeBand *bands = ctx;
+    for (int t = t0; t < t1; t++) {
+        edge_band_run(&bands[t]);
+    }
+}
+
+// ==============================================================================================
+// C: Sparse Sobel Edge Detection
+// ==============================================================================================
+/**
+ * @brief Sobel edge detection into a list of the pixels with magnitude >= threshold. The interior rows
+ *        are split into one band per thread, each band fills its own buffer, and the buffers are
+ *        concatenated in band order, so the list is sorted by y then x for any thread count.
+ *
+ * @param grey      Input greyscale image, at most 65535 x 65535
+ * @param threshold Edge threshold, 0 ... 255
+ * @param threads   Number of threads (1 = run on the calling thread)
+ * @param list      Output list, free with FreeEdgeList
+ * @return 1 on success, 0 on failure
+ */
+int SobelEdgeList(const Image *grey, int threshold, int threads, EdgeList *list) {
+    int width = grey->width, height = grey->height;
+    memset(list, 0, sizeof(*list));
+    if (width > UINT16_MAX || height > UINT16_MAX) {
+        fprintf(stderr, "Edge list coordinates are 16 bit, image is %dx%d\n", width, height);
+        return 0;
+    }
+    int rows = height - 2;
+    if (rows <= 0) {
+        return 1;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > rows) {
+        threads = rows;
+    }
+
+    EdgeBand *bands = calloc((size_t)threads, sizeof(EdgeBand));
+    if (!bands) {
+        return 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        bands[t].grey = grey;
+        bands[t].y0 = 1 + (int)((long long)rows * t / threads);
+        bands[t].y1 = 1 + (int)((long long)rows * (t + 1) / threads);
+        bands[t].threshold = threshold;
+    }
+
+    // One band per thread: ParallelRows over the band indices
+    ParallelRows(0, threads, threads, edge_bands, bands, PERF_STAGE_SOBEL);
+
+    // Merge the per-thread buffers in row order
+    int ok = 1;
+    size_t total = 0;
+    for (int t = 0; t < threads; t++) {
+        ok = ok && !bands[t].failed;
+        total += bands[t].list.count;
+    }
+    if (ok && total > 0) {
+        list->records = malloc(total * sizeof(EdgeRecord));
+        ok = list->records != NULL;
+    }
+    if (ok) {
+        for (int t = 0; t < threads; t++) {
+            if (bands[t].list.count) {
+                memcpy(list->records + list->count, bands[t].list.records,
+                       bands[t].list.count * sizeof(EdgeRecord));
+            }
+            list->count += bands[t].list.count;
+        }
+        list->capacity = total;
+    }
+
+    for (int t = 0; t < threads; t++) {
+        FreeEdgeList(&bands[t].list);
+    }
+    free(bands);
+    return ok;
+}
+
+/**
+ * @brief SobelEdgeList for the pixels x0 ... x1 - 1, y0 ... y1 - 1 only (clipped to the image),
+ *        appended to a list on the calling thread. Regions appended in row order, and left to right
+ *        within a row, keep the list sorted by y then x.
+ *
+ * @param grey      Input greyscale image, at most 65535 x 65535
+ * @param threshold Edge threshold, 0 ... 255
+ * @param x0        First column
+ * @param y0        First row
+ * @param x1        One past the last column
+ * @param y1        One past the last row
+ * @param list      List to append to (zeroed before the first call), free with FreeEdgeList
+ * @return 1 on success, 0 on failure
+ */
+int SobelEdgeListRegion(const Image *grey, int threshold, int x0, int y0, int x1, int y1, EdgeList *list) {
+    int width = grey->width, height = grey->height;
+    if (width > UINT16_MAX || height > UINT16_MAX) {
+        fprintf(stderr, "Edge list coordinates are 16 bit, image is %dx%d\n", width, height);
+        return 0;
+    }
+    // Border pixels are never edges
+    x0 = x0 < 1 ? 1 : x0;
+    y0 = y0 < 1 ? 1 : y0;
+    x1 = x1 > width - 1 ? width - 1 : x1;
+    y1 = y1 > height - 1 ? height - 1 : y1;
+    int threshold2 = threshold * threshold;
+
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            int sumX, sumY;
+            SobelGradient(grey, x, y, &sumX, &sumY);
+            if (sumX * sumX + sumY * sumY >= threshold2 && !edge_list_push(list, edge_record(grey, x, y))) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// ==============================================================================================
+// D: File Output
+// ==============================================================================================
+/**
+ * @brief Stores a little-endian integer of the given size.
+ *
+ * @param p     Destination
+ * @param value Value to store
+ * @param bytes Number of bytes
+ */
+static void put_le(unsigned char *p, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Writes an edge list in the compact binary format described at the top of this file.
+ *
+ * @param filename       Output file path
+ * @param list           List from SobelEdgeList
+ * @param width          Image width
+ * @param height         Image height
+ * @param with_direction Store the direction byte of each record
+ * @return 1 on success, 0 on failure (same convention as stbi_write_*)
+ */
+int WriteEdgeList(const char *filename, const EdgeList *list, int width, int height, int with_direction) {
+    size_t record_size = with_direction ? 6 : 5;
+    size_t bytes = EDGE_LIST_HEADER_SIZE + list->count * record_size;
+    unsigned char *buffer = malloc(bytes);
+    if (!buffer) {
+        return 0;
+    }
+
+    memcpy(buffer, "IEDPEDGE", 8);
+    put_le(buffer + 8, EDGE_LIST_VERSION, 4);
+    put_le(buffer + 12, (uint32_t)width, 4);
+    put_le(buffer + 16, (uint32_t)height, 4);
+    put_le(buffer + 20, with_direction ? EDGE_LIST_FLAG_DIRECTION : 0, 4);
+    put_le(buffer + 24, list->count, 8);
+
+    unsigned char *p = buffer + EDGE_LIST_HEADER_SIZE;
+    for (size_t i = 0; i < list->count; i++) {
+        const EdgeRecord *r = &list->records[i];
+        put_le(p, r->x, 2);
+        put_le(p + 2, r->y, 2);
+        p[4] = r->magnitude;
+        if (with_direction) {
+            p[5] = r->direction;
+        }
+        p += record_size;
+    }
+
+    FILE *f = fopen(filename, "wb");
+    int ok = f && fwrite(buffer, 1, bytes, f) == bytes;
+    if (f && fclose(f) != 0) {
+        ok = 0;
+    }
+    free(buffer);
+    return ok;
+}
@@ -0,0 +1,285 @@
+/**
+ * @file edge_mask.c
+ * @brief Thresholded Sobel edge detection into a bit-packed 1-bit mask, automatic threshold and PBM output
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <string.h> // For memset
+#include <math.h> // For sqrt
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// Constants
+// ==============================================================================================
+// Rows sampled by AutoEdgeThreshold: every AUTO_THRESHOLD_ROW_STEP-th interior row
+#define AUTO_THRESHOLD_ROW_STEP 4
+
+#if defined(__SSE2__)
+// Reverses the bit order of a byte: movemask puts the leftmost pixel in bit 0, PBM wants it in bit 7
+#define R2(n) (n), (n) + 128, (n) + 64, (n) + 192
+#define R4(n) R2(n), R2((n) + 32), R2((n) + 16), R2((n) + 48)
+#define R6(n) R4(n), R4((n) + 8), R4((n) + 4), R4((n) + 12)
+static const uint8_t reverse_bits[256] = { R6(0), R6(2), R6(1), R6(3) };
+#undef R2
+#undef R4
+#undef R6
+#endif
+
+// ==============================================================================================
+// A: Scalar Sobel Magnitude
+// ==============================================================================================
+/**
+ * @brief Squared Sobel gradient magnitude at an interior pixel (same kernels as SobelEdgeDetection).
+ *
+ * @param grey Greyscale image
+ * @param x    Column, 1 ... width - 2
+ * @param y    Row, 1 ... height - 2
+ * @return sumX * sumX + sumY * sumY
+ */
+static inline int sobel_squared(const Image *grey, int x, int y) {
+    int sumX, sumY;
+    SobelGradient(grey, x, y, &sumX, &sumY);
+    return sumX * sumX + sumY * sumY;
+}
+
+/**
+ * @brief Computes one mask byte (8 pixels starting at x0) with scalar code. Border pixels and pixels
+ *        past the end of the row are 0.
+ *
+ * @param grey      Greyscale image
+ * @param y         Interior row
+ * @param x0        First column of the byte (multiple of 8)
+ * @param threshold2 Squared threshold
+ * @return Mask byte, leftmost pixel in bit 7
+ */
+static uint8_t mask_byte_scalar(const Image *grey, int y, int x0, int threshold2) {
+    uint8_t byte = 0;
+    for (int b = 0; b < 8; b++) {
+        int x = x0 + b;
+        if (x >= 1 && x < grey->width - 1 && sobel_squared(grey, x, y) >= threshold2) {
+            byte |= (uint8_t)(0x80 >> b);
+        }
+    }
+    return byte;
+}
+
+// ==============================================================================================
+// B: Thresholded Sobel Edge Detection - bit-packed mask
+// ==============================================================================================
+/**
+ * @brief Computes one interior row of the mask from SobelEdgeMask. Rows are independent, so callers
+ *        can split an image between threads by rows.
+ *
+ * @param grey      Input greyscale image
+ * @param row       Pointer to the output mask row, EDGE_MASK_STRIDE(width) bytes
+ * @param y         Row, 1 ... height - 2
+ * @param threshold Edge threshold, 0 ... 255
+ */
+void SobelEdgeMaskRow(const Image *grey, unsigned char *row, int y, int threshold) {
+    int width = grey->width;
+    int threshold2 = threshold * threshold;
+    int xb = 0; // First column not yet written
+
+#if defined(__SSE2__)
+    // Vector blocks of 16 pixels need columns x0 - 1 ... x0 + 16; the first block (left border)
+    // and the last partial blocks go through the scalar path
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi32(threshold2 - 1);
+    const unsigned char *up  = ImageRow(grey, y - 1, 0);
+    const unsigned char *mid = ImageRow(grey, y, 0);
+    const unsigned char *dn  = ImageRow(grey, y + 1, 0);
+    for (int b = 0; b < 2 && xb < width; b++, xb += 8) {
+        row[xb / 8] = mask_byte_scalar(grey, y, xb, threshold2);
+    }
+    for (; xb + 16 < width; xb += 16) {
+        __m128i l_up  = _mm_loadu_si128((const __m128i *)(up + xb - 1));
+        __m128i c_up  = _mm_loadu_si128((const __m128i *)(up + xb));
+        __m128i r_up  = _mm_loadu_si128((const __m128i *)(up + xb + 1));
+        __m128i l_mid = _mm_loadu_si128((const __m128i *)(mid + xb - 1));
+        __m128i r_mid = _mm_loadu_si128((const __m128i *)(mid + xb + 1));
+        __m128i l_dn  = _mm_loadu_si128((const __m128i *)(dn + xb - 1));
+        __m128i c_dn  = _mm_loadu_si128((const __m128i *)(dn + xb));
+        __m128i r_dn  = _mm_loadu_si128((const __m128i *)(dn + xb + 1));
+
+        __m128i bits[2];
+        for (int h = 0; h < 2; h++) {
+            // Widen 8 pixels to 16 bits: low half, then high half
+#define WIDEN(v) (h ? _mm_unpackhi_epi8((v), zero) : _mm_unpacklo_epi8((v), zero))
+            __m128i left  = _mm_add_epi16(_mm_add_epi16(WIDEN(l_up), WIDEN(l_dn)),
+                                          _mm_slli_epi16(WIDEN(l_mid), 1));
+            __m128i right = _mm_add_epi16(_mm_add_epi16(WIDEN(r_up), WIDEN(r_dn)),
+                                          _mm_slli_epi16(WIDEN(r_mid), 1));
+            __m128i top   = _mm_add_epi16(_mm_add_epi16(WIDEN(l_up), WIDEN(r_up)),
+                                          _mm_slli_epi16(WIDEN(c_up), 1));
+            __m128i bot   = _mm_add_epi16(_mm_add_epi16(WIDEN(l_dn), WIDEN(r_dn)),
+                                          _mm_slli_epi16(WIDEN(c_dn), 1));
+#undef WIDEN
+            __m128i gx = _mm_sub_epi16(right, left);
+            __m128i gy = _mm_sub_epi16(top, bot);
+
+            // gx * gx + gy * gy in 32 bits: madd of interleaved (gx, gy) pairs with themselves
+            __m128i p0 = _mm_unpacklo_epi16(gx, gy);
+            __m128i p1 = _mm_unpackhi_epi16(gx, gy);
+            __m128i c0 = _mm_cmpgt_epi32(_mm_madd_epi16(p0, p0), limit);
+            __m128i c1 = _mm_cmpgt_epi32(_mm_madd_epi16(p1, p1), limit);
+            bits[h] = _mm_packs_epi32(c0, c1);
+        }
+        int m = _mm_movemask_epi8(_mm_packs_epi16(bits[0], bits[1]));
+        row[xb / 8]     = reverse_bits[m & 0xFF];
+        row[xb / 8 + 1] = reverse_bits[(m >> 8) & 0xFF];
+    }
+#endif
+    for (; xb < width; xb += 8) {
+        row[xb / 8] = mask_byte_scalar(grey, y, xb, threshold2);
+    }
+}
+
+/**
+ * @brief Sobel edge detection straight into a 1-bit mask: a pixel is set when the gradient magnitude
+ *        SobelEdgeDetection would write is >= threshold. Compares squared magnitudes, so no sqrt.
+ *
+ * The mask has EDGE_MASK_STRIDE(width) bytes per row, 8 pixels per byte, leftmost pixel in the most
+ * significant bit and zero padding at the end of each row (the PBM P4 layout). Border pixels are 0.
+ * With SSE2, 16 pixels are compared at once and packed with movemask.
+ *
+ * @param grey      Input greyscale image
+ * @param mask      Pointer to output mask, EDGE_MASK_STRIDE(width) * height bytes
+ * @param threshold Edge threshold, 0 ... 255
+ */
+void SobelEdgeMask(const Image *grey, unsigned char *mask, int threshold) {
+    int height = grey->height;
+    int stride = EDGE_MASK_STRIDE(grey->width);
+
+    // Top and bottom rows are border
+    memset(mask, 0, (size_t)stride);
+    memset(mask + (size_t)(height - 1) * stride, 0, (size_t)stride);
+
+    for (int y = 1; y < height - 1; y++) {
+        SobelEdgeMaskRow(grey, mask + (size_t)y * stride, y, threshold);
+    }
+}
+
+/**
+ * @brief SobelEdgeMask for the pixels x0 ... x1 - 1, y0 ... y1 - 1 only (clipped to the image), one
+ *        pixel at a time; the other bits of the mask are left untouched.
+ *
+ * @param grey      Input greyscale image
+ * @param mask      Mask of the image, EDGE_MASK_STRIDE(width) * height bytes
+ * @param threshold Edge threshold, 0 ... 255
+ * @param x0        First column
+ * @param y0        First row
+ * @param x1        One past the last column
+ * @param y1        One past the last row
+ */
+void SobelEdgeMaskRegion(const Image *grey, unsigned char *mask, int threshold, int x0, int y0, int x1, int y1) {
+    int width = grey->width, height = grey->height;
+    int stride = EDGE_MASK_STRIDE(width);
+    int threshold2 = threshold * threshold;
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > width ? width : x1;
+    y1 = y1 > height ? height : y1;
+
+    for (int y = y0; y < y1; y++) {
+        unsigned char *row = mask + (size_t)y * stride;
+        int interior = y >= 1 && y < height - 1;
+        for (int x = x0; x < x1; x++) {
+            unsigned char bit = (unsigned char)(0x80u >> (x & 7));
+            if (interior && x >= 1 && x < width - 1 && sobel_squared(grey, x, y) >= threshold2) {
+                row[x >> 3] |= bit;
+            } else {
+                row[x >> 3] &= (unsigned char)~bit;
+            }
+        }
+    }
+}
+
+// ==============================================================================================
+// C: Automatic Threshold
+// ==============================================================================================
+/**
+ * @brief Picks an edge threshold with Otsu's method on the histogram of Sobel magnitudes. Only every
+ *        AUTO_THRESHOLD_ROW_STEP-th row is sampled (all rows for small images), so no full magnitude
+ *        plane is needed.
+ *
+ * @param grey Input greyscale image
+ * @return Threshold, 1 ... 255
+ */
+int AutoEdgeThreshold(const Image *grey) {
+    int width = grey->width, height = grey->height;
+    unsigned long histogram[256] = { 0 };
+    unsigned long total = 0;
+    int step = height >= 16 * AUTO_THRESHOLD_ROW_STEP ? AUTO_THRESHOLD_ROW_STEP : 1;
+
+    // Magnitudes as SobelEdgeDetection computes them
+    for (int y = 1; y < height - 1; y += step) {
+        for (int x = 1; x < width - 1; x++) {
+            int magnitude = (int)(sqrt((double)sobel_squared(grey, x, y)));
+            histogram[magnitude > 255 ? 255 : magnitude]++;
+            total++;
+        }
+    }
+    if (total == 0) {
+        return 1;
+    }
+
+    // Otsu: threshold t splits the histogram into [0, t) and [t, 255] with maximum between-class variance
+    double sum_all = 0.0;
+    for (int i = 0; i < 256; i++) {
+        sum_all += (double)i * histogram[i];
+    }
+    double sum_below = 0.0;
+    unsigned long count_below = 0;
+    double best_variance = -1.0;
+    int best = 1;
+    for (int t = 1; t < 256; t++) {
+        count_below += histogram[t - 1];
+        sum_below += (double)(t - 1) * histogram[t - 1];
+        unsigned long count_above = total - count_below;
+        if (count_below == 0 || count_above == 0) {
+            continue;
+        }
+        double mean_below = sum_below / count_below;
+        double mean_above = (sum_all - sum_below) / count_above;
+        double variance = (double)count_below * count_above * (mean_below - mean_above) * (mean_below - mean_above);
+        if (variance > best_variance) {
+            best_variance = variance;
+            best = t;
+        }
+    }
+    return best;
+}
+
+// ==============================================================================================
+// D: PBM Output
+// ==============================================================================================
+/**
+ * @brief Writes a mask from SobelEdgeMask as a binary (P4) PBM. Edge pixels (1) show as black.
+ *
+ * @param filename Output file path
+ * @param mask     Mask data, EDGE_MASK_STRIDE(width) bytes per row
+ * @param width    Image width
+ * @param height   Image height
+ * @return 1 on success, 0 on failure (same convention as stbi_write_*)
+ */
+int WriteEdgeMaskPBM(const char *filename, const unsigned char *mask, int width, int height) {
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        return 0;
+    }
+    // The mask rows are already in P4 layout, so the pixel data is a single write
+    size_t bytes = (size_t)EDGE_MASK_STRIDE(width) * height;
+    int ok = fprintf(f, "P4\n%d %d\n", width, height) > 0 && fwrite(mask, 1, bytes, f) == bytes;
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+    return ok;
+}
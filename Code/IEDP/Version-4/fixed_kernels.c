@@ -0,0 +1,389 @@
+/**
+ * @file fixed_kernels.c
+ * @brief Median, greyscale and Sobel row kernels instantiated for fixed frame geometries (the 320x240
+ *        GUI frames, the 60x60 / 120x120 RTL test frames and common camera sizes), and the registry
+ *        that picks them for a frame or falls back to the generic kernels of iedp_stages.c
+ *
+ * Each FIXED_KERNELS(W, H) expands to wrappers that call the static inline kernel bodies with a
+ * literal width, so the compiler sees constant loop bounds for every geometry.
+ * The outputs are bit-identical to the generic kernels.
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <string.h> // For memcpy
+#include <math.h> // For sqrt
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// The median below selects from the 9 pixels of a 3x3 window with a fixed network
+#if WINDOW_SIZE != 3
+#error "fixed_kernels.c implements WINDOW_SIZE 3 only"
+#endif
+
+// ==============================================================================================
+// A: Median Filter
+// ==============================================================================================
+// The generic MedianFilterRow bubble-sorts the window by brightness; bubble sort is stable, so its
+// median is the 5th smallest (brightness, window index) pair. brightness * 16 + index is a unique
+// 16-bit key with the same order, and the median of the 9 keys names the window pixel to copy.
+#define MEDIAN_KEY_SHIFT 4
+// Columns of brightness kept per chunk of a row
+#define MEDIAN_CHUNK 256
+
+/**
+ * @brief Median of 9 keys (19 compare-exchanges).
+ */
+static inline int median9_key(int *p) {
+#define SORT2(a, b) do { int t = p[a] < p[b] ? p[a] : p[b]; p[b] = p[a] < p[b] ? p[b] : p[a]; p[a] = t; } while (0)
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8); SORT2(0, 1); SORT2(3, 4); SORT2(6, 7);
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8); SORT2(0, 3); SORT2(5, 8); SORT2(4, 7);
+    SORT2(3, 6); SORT2(1, 4); SORT2(2, 5); SORT2(4, 7); SORT2(4, 2); SORT2(6, 4);
+    SORT2(4, 2);
+#undef SORT2
+    return p[4];
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief median9_key on 8 signed 16-bit keys.
+ */
+static inline __m128i median9_key_epi16(__m128i *p) {
+#define SORT2(a, b) do { __m128i t = _mm_min_epi16(p[a], p[b]); p[b] = _mm_max_epi16(p[a], p[b]); p[a] = t; } while (0)
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8); SORT2(0, 1); SORT2(3, 4); SORT2(6, 7);
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8); SORT2(0, 3); SORT2(5, 8); SORT2(4, 7);
+    SORT2(3, 6); SORT2(1, 4); SORT2(2, 5); SORT2(4, 7); SORT2(4, 2); SORT2(6, 4);
+    SORT2(4, 2);
+#undef SORT2
+    return p[4];
+}
+#endif
+
+/**
+ * @brief MedianFilterRow for a frame width known at compile time.
+ *
+ * @param up     Row above (RGB), NULL on the first image row
+ * @param mid    Row being filtered (RGB)
+ * @param dn     Row below (RGB), NULL on the last image row
+ * @param output Output row (RGB)
+ * @param width  Image width (a constant in every instantiation)
+ * @param x0     First column
+ * @param x1     One past the last column
+ */
+static inline void fixed_median_row(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                                    unsigned char *output, const int width, int x0, int x1) {
+    // Rows without a row above / below, and the first and last columns, keep the input pixel
+    int xi0 = x0 > 1 ? x0 : 1;
+    int xi1 = x1 < width - 1 ? x1 : width - 1;
+    if (!up || !dn || xi0 >= xi1) {
+        memcpy(output + x0 * 3, mid + x0 * 3, (size_t)(x1 - x0) * 3);
+        return;
+    }
+    if (x0 < xi0) {
+        memcpy(output + x0 * 3, mid + x0 * 3, 3);
+    }
+    if (xi1 < x1) {
+        memcpy(output + xi1 * 3, mid + xi1 * 3, 3);
+    }
+
+    // Brightness of the three rows, a chunk of columns at a time
+    const unsigned char *rows[3] = { up, mid, dn };
+    int16_t bright[3][MEDIAN_CHUNK + 2];
+    for (int c = xi0; c < xi1; c += MEDIAN_CHUNK) {
+        int n = xi1 - c < MEDIAN_CHUNK ? xi1 - c : MEDIAN_CHUNK;
+        // Columns c - 1 ... c + n
+        for (int r = 0; r < 3; r++) {
+            const unsigned char *p = rows[r] + (c - 1) * 3;
+            for (int i = 0; i < n + 2; i++) {
+                bright[r][i] = (int16_t)(p[i * 3] + p[i * 3 + 1] + p[i * 3 + 2]);
+            }
+        }
+
+        int i = 0;
+#if defined(__SSE2__)
+        for (; i + 8 <= n; i += 8) {
+            __m128i keys[9];
+            for (int k = 0; k < 9; k++) {
+                __m128i b = _mm_loadu_si128((const __m128i *)&bright[k / 3][i + k % 3]);
+                keys[k] = _mm_add_epi16(_mm_slli_epi16(b, MEDIAN_KEY_SHIFT), _mm_set1_epi16((short)k));
+            }
+            int16_t median[8];
+            _mm_storeu_si128((__m128i *)median, median9_key_epi16(keys));
+            for (int j = 0; j < 8; j++) {
+                int k = median[j] & ((1 << MEDIAN_KEY_SHIFT) - 1);
+                memcpy(output + (c + i + j) * 3, rows[k / 3] + (c + i + j + k % 3 - 1) * 3, 3);
+            }
+        }
+#endif
+        // Scalar tail (and the whole chunk without SSE2)
+        for (; i < n; i++) {
+            int keys[9];
+            for (int k = 0; k < 9; k++) {
+                keys[k] = (bright[k / 3][i + k % 3] << MEDIAN_KEY_SHIFT) + k;
+            }
+            int k = median9_key(keys) & ((1 << MEDIAN_KEY_SHIFT) - 1);
+            memcpy(output + (c + i) * 3, rows[k / 3] + (c + i + k % 3 - 1) * 3, 3);
+        }
+    }
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief MedianFilterPlanarRow pixel x from its median key, for the columns left over by the vector
+ *        loop.
+ */
+static inline void planar_median_pixel(const unsigned char *const *const *rows, unsigned char *const *output, int x) {
+    int keys[9];
+    for (int k = 0; k < 9; k++) {
+        const unsigned char *const *row = rows[k / 3];
+        int o = x + k % 3 - 1;
+        keys[k] = ((row[0][o] + row[1][o] + row[2][o]) << MEDIAN_KEY_SHIFT) + k;
+    }
+    int k = median9_key(keys) & ((1 << MEDIAN_KEY_SHIFT) - 1);
+    for (int c = 0; c < 3; c++) {
+        output[c][x] = rows[k / 3][c][x + k % 3 - 1];
+    }
+}
+
+/**
+ * @brief SSE2 MedianFilterPlanarRow for any frame width (the dispatcher's "sse2" planar variant).
+ *        With one plane per channel the brightness of 8 pixels is three 16-bit adds, and the median
+ *        pixel is selected from the window with compare masks instead of a 3-byte copy per pixel.
+ */
+void MedianFilterPlanarRowSSE2(const unsigned char *const *up, const unsigned char *const *mid,
+                               const unsigned char *const *dn, unsigned char *const *output, int width,
+                               int x0, int x1) {
+    // Rows without a row above / below, and the first and last columns, keep the input pixel
+    int xi0 = x0 > 1 ? x0 : 1;
+    int xi1 = x1 < width - 1 ? x1 : width - 1;
+    if (!up || !dn || xi0 >= xi1) {
+        for (int c = 0; c < 3; c++) {
+            memcpy(output[c] + x0, mid[c] + x0, (size_t)(x1 - x0));
+        }
+        return;
+    }
+    for (int c = 0; c < 3; c++) {
+        if (x0 < xi0) {
+            output[c][x0] = mid[c][x0];
+        }
+        if (xi1 < x1) {
+            output[c][xi1] = mid[c][xi1];
+        }
+    }
+
+    const unsigned char *const *rows[3] = { up, mid, dn };
+    const __m128i zero = _mm_setzero_si128();
+    int x = xi0;
+    for (; x + 8 <= xi1; x += 8) {
+        __m128i ch[3][9], keys[9];
+        for (int k = 0; k < 9; k++) {
+            const unsigned char *const *row = rows[k / 3];
+            int o = x + k % 3 - 1;
+            for (int c = 0; c < 3; c++) {
+                ch[c][k] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row[c] + o)), zero);
+            }
+            __m128i b = _mm_add_epi16(_mm_add_epi16(ch[0][k], ch[1][k]), ch[2][k]);
+            keys[k] = _mm_add_epi16(_mm_slli_epi16(b, MEDIAN_KEY_SHIFT), _mm_set1_epi16((short)k));
+        }
+        __m128i index = _mm_and_si128(median9_key_epi16(keys), _mm_set1_epi16((1 << MEDIAN_KEY_SHIFT) - 1));
+        __m128i select[9];
+        for (int k = 0; k < 9; k++) {
+            select[k] = _mm_cmpeq_epi16(index, _mm_set1_epi16((short)k));
+        }
+        for (int c = 0; c < 3; c++) {
+            __m128i v = zero;
+            for (int k = 0; k < 9; k++) {
+                v = _mm_or_si128(v, _mm_and_si128(select[k], ch[c][k]));
+            }
+            _mm_storel_epi64((__m128i *)(output[c] + x), _mm_packus_epi16(v, v));
+        }
+    }
+    for (; x < xi1; x++) {
+        planar_median_pixel(rows, output, x);
+    }
+}
+#endif
+
+// ==============================================================================================
+// B: Greyscale Conversion
+// ==============================================================================================
+/**
+ * @brief ConvertToGreyscaleRow for a frame width known at compile time (same double-precision
+ *        formula, so the same result).
+ *
+ * @param input  Input row (RGB)
+ * @param output Output row (greyscale)
+ * @param width  Image width (a constant in every instantiation)
+ * @param x0     First column
+ * @param x1     One past the last column
+ */
+static inline void fixed_grey_row(const unsigned char *input, unsigned char *output, const int width,
+                                  int x0, int x1) {
+    x1 = x1 < width ? x1 : width;
+    for (int x = x0; x < x1; x++) {
+        output[x] = (uint8_t)(0.299 * input[x * 3] + 0.587 * input[x * 3 + 1] + 0.114 * input[x * 3 + 2]);
+    }
+}
+
+// ==============================================================================================
+// C: Sobel Edge Detection
+// ==============================================================================================
+/**
+ * @brief SobelEdgeRow for a frame width known at compile time. The SSE2 path keeps the gradients in
+ *        16-bit lanes (|gx|, |gy| <= 1020) and takes the magnitude in single precision, which is exact
+ *        for sums of squares clamped to 255² (see conv.c).
+ *
+ * @param up    Row above, NULL on the first image row
+ * @param mid   Row being processed
+ * @param dn    Row below, NULL on the last image row
+ * @param edges Output row
+ * @param width Image width (a constant in every instantiation)
+ * @param x0    First column
+ * @param x1    One past the last column
+ */
+static inline void fixed_sobel_row(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                                   unsigned char *edges, const int width, int x0, int x1) {
+    // Border pixels are 0, as in SobelEdgeRow
+    int xi0 = x0 > 1 ? x0 : 1;
+    int xi1 = x1 < width - 1 ? x1 : width - 1;
+    if (!up || !dn || xi0 >= xi1) {
+        memset(edges + x0, 0, (size_t)(x1 - x0));
+        return;
+    }
+    if (x0 < xi0) {
+        edges[x0] = 0;
+    }
+    if (xi1 < x1) {
+        edges[xi1] = 0;
+    }
+
+    int x = xi0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi32(255 * 255);
+    for (; x + 8 <= xi1; x += 8) {
+        __m128i u[3], m[3], d[3];
+        for (int i = 0; i < 3; i++) {
+            u[i] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(up + x + i - 1)), zero);
+            m[i] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(mid + x + i - 1)), zero);
+            d[i] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(dn + x + i - 1)), zero);
+        }
+        __m128i gx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(u[2], d[2]), _mm_slli_epi16(m[2], 1)),
+                                   _mm_add_epi16(_mm_add_epi16(u[0], d[0]), _mm_slli_epi16(m[0], 1)));
+        __m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(u[0], u[2]), _mm_slli_epi16(u[1], 1)),
+                                   _mm_add_epi16(_mm_add_epi16(d[0], d[2]), _mm_slli_epi16(d[1], 1)));
+        __m128i mag[2];
+        for (int h = 0; h < 2; h++) {
+            __m128i pairs = h ? _mm_unpackhi_epi16(gx, gy) : _mm_unpacklo_epi16(gx, gy);
+            __m128i sq = _mm_madd_epi16(pairs, pairs);
+            __m128i over = _mm_cmpgt_epi32(sq, limit);
+            sq = _mm_or_si128(_mm_and_si128(over, limit), _mm_andnot_si128(over, sq));
+            mag[h] = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(sq)));
+        }
+        __m128i packed = _mm_packs_epi32(mag[0], mag[1]);
+        _mm_storel_epi64((__m128i *)(edges + x), _mm_packus_epi16(packed, packed));
+    }
+#endif
+    // Scalar tail (and the whole row without SSE2)
+    for (; x < xi1; x++) {
+        int gx, gy;
+        SobelGradientRows(up, mid, dn, x, &gx, &gy);
+        int magnitude = (int)(sqrt((double)(gx * gx + gy * gy)));
+        edges[x] = (unsigned char)(magnitude > 255 ? 255 : magnitude);
+    }
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief SSE2 MedianFilterRow for any frame width (the dispatcher's "sse2" variant).
+ */
+void MedianFilterRowSSE2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                         unsigned char *output, int width, int x0, int x1) {
+    fixed_median_row(up, mid, dn, output, width, x0, x1);
+}
+
+/**
+ * @brief SSE2 SobelEdgeRow for any frame width (the dispatcher's "sse2" variant).
+ */
+void SobelEdgeRowSSE2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                      unsigned char *edges, int width, int x0, int x1) {
+    fixed_sobel_row(up, mid, dn, edges, width, x0, x1);
+}
+#endif
+
+// ==============================================================================================
+// D: Instantiations and Registry
+// ==============================================================================================
+// Row kernels with the width of a W x H frame compiled in
+#define FIXED_KERNELS(W, H) \
+    static void median_row_##W##x##H(const unsigned char *up, const unsigned char *mid, const unsigned char *dn, \
+                                     unsigned char *output, int width, int x0, int x1) { \
+        (void)width; \
+        fixed_median_row(up, mid, dn, output, W, x0, x1); \
+    } \
+    static void grey_row_##W##x##H(const unsigned char *input, unsigned char *output, int x0, int x1) { \
+        fixed_grey_row(input, output, W, x0, x1); \
+    } \
+    static void sobel_row_##W##x##H(const unsigned char *up, const unsigned char *mid, const unsigned char *dn, \
+                                    unsigned char *edges, int width, int x0, int x1) { \
+        (void)width; \
+        fixed_sobel_row(up, mid, dn, edges, W, x0, x1); \
+    }
+#if defined(__SSE2__)
+#define FIXED_ISA "sse2"
+#else
+#define FIXED_ISA "scalar"
+#endif
+#define FIXED_ENTRY(W, H) { W, H, median_row_##W##x##H, grey_row_##W##x##H, sobel_row_##W##x##H, \
+                           FIXED_ISA, "scalar", FIXED_ISA, NULL, NULL, IMAGE_INTERLEAVED }
+
+FIXED_KERNELS(60, 60)     // RTL line buffer / Verilator frames
+FIXED_KERNELS(120, 120)   // RTL testbench and golden-measure .mem frames
+FIXED_KERNELS(320, 240)   // GUI frames (Version-3 accepts nothing else)
+FIXED_KERNELS(640, 480)
+FIXED_KERNELS(1280, 720)
+FIXED_KERNELS(1920, 1080)
+
+static const StageKernels fixed_kernels[] = {
+    FIXED_ENTRY(60, 60),
+    FIXED_ENTRY(120, 120),
+    FIXED_ENTRY(320, 240),
+    FIXED_ENTRY(640, 480),
+    FIXED_ENTRY(1280, 720),
+    FIXED_ENTRY(1920, 1080),
+};
+
+static const StageKernels generic_kernels = { 0, 0, MedianFilterRow, ConvertToGreyscaleRow, SobelEdgeRow,
+                                              "scalar", "scalar", "scalar",
+                                              MedianFilterPlanarRow, ConvertToGreyscalePlanarRow, IMAGE_INTERLEAVED };
+
+/**
+ * @brief Row kernels for a frame geometry: the fixed-size instantiation when there is one, the
+ *        generic kernels otherwise.
+ *
+ * @param width  Frame width
+ * @param height Frame height
+ * @return Kernels (width and height 0 for the generic ones), never NULL
+ */
+const StageKernels *StageKernelsFind(int width, int height) {
+    for (size_t i = 0; i < sizeof(fixed_kernels) / sizeof(fixed_kernels[0]); i++) {
+        if (fixed_kernels[i].width == width && fixed_kernels[i].height == height) {
+            return &fixed_kernels[i];
+        }
+    }
+    return &generic_kernels;
+}
+
+/**
+ * @brief The generic row kernels, for any geometry.
+ *
+ * @return Kernels with width and height 0
+ */
+const StageKernels *StageKernelsGeneric(void) {
+    return &generic_kernels;
+}
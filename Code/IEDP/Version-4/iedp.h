@@ -0,0 +1,653 @@
+/**
+ * @file iedp.h
+ * @brief Shared types and stage prototypes for the IEDP pipeline: Median Filter → Greyscale → Sobel Edge Detection
+ */
+#ifndef IEDP_H
+#define IEDP_H
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stddef.h> // For size_t
+#include <stdio.h> // For FILE
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics (interleave helpers)
+#endif
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Defines the window size for the median filter
+#define WINDOW_SIZE 3
+
+/**
+ * @brief Structure representing an RGB pixel
+ */
+typedef struct {
+    uint8_t r; // Red channel
+    uint8_t g; // Green channel
+    uint8_t b; // Blue channel
+} RGB;
+// Macro to compute brightness by summing RGB components
+#define BRIGHTNESS(p) ((p).r + (p).g + (p).b)
+
+// ==============================================================================================
+// Image Descriptors (image.c)
+// ==============================================================================================
+// Row alignment of allocated images: one cache line, the widest vector load
+#define IMAGE_ALIGN 64
+
+// Channel layouts
+typedef enum {
+    IMAGE_INTERLEAVED, // Channels of a pixel adjacent (RGBRGB...)
+    IMAGE_PLANAR       // One plane per channel (RRR... GGG... BBB...)
+} ImageLayout;
+
+// What the 3x3 stencil stages (median, Sobel) see outside the image
+typedef enum {
+    BORDER_COPY,      // Nothing: border pixels are peeled (median copies them through, Sobel writes 0)
+    BORDER_REPLICATE, // Nearest edge pixel (aaa|abc)
+    BORDER_MIRROR,    // Reflection without repeating the edge pixel (cb|abc)
+    BORDER_CONSTANT   // A constant value in every channel
+} BorderMode;
+
+/**
+ * @brief Image or view of one: rows stride bytes apart, planes plane_stride bytes apart
+ */
+typedef struct {
+    unsigned char *data;  // First pixel (of the first plane)
+    int width, height;    // Size in pixels
+    int channels;         // Channels per pixel
+    ImageLayout layout;   // Channel layout
+    size_t stride;        // Bytes from one row to the next
+    size_t plane_stride;  // Bytes from one plane to the next (planar layout)
+    int halo;             // Pixels addressable outside the image on every side (ImageAllocHalo)
+    void *block;          // Allocation the image owns (NULL: wrapped buffer or view)
+} Image;
+
+int ImageAlloc(Image *image, int width, int height, int channels, ImageLayout layout, size_t row_align);
+int ImageAllocHalo(Image *image, int width, int height, int channels, int halo);
+void ImageFillRowHalo(const Image *image, int y, BorderMode mode, int value);
+Image ImageWrap(unsigned char *data, int width, int height, int channels);
+Image ImageView(const Image *image, int x, int y, int width, int height);
+void ImageFree(Image *image);
+int ImageCopy(const Image *src, const Image *dst);
+void DeinterleaveRGBRow(const unsigned char *rgb, unsigned char *r, unsigned char *g, unsigned char *b, int count);
+void InterleaveRGBRow(const unsigned char *r, const unsigned char *g, const unsigned char *b, unsigned char *rgb,
+                      int count);
+
+/**
+ * @brief Row y of an interleaved image, or of plane c of a planar one.
+ *
+ * @param image Image
+ * @param y     Row
+ * @param c     Plane (0 for interleaved images)
+ * @return Row pointer
+ */
+static inline unsigned char *ImageRow(const Image *image, int y, int c) {
+    return image->data + (size_t)c * image->plane_stride + (size_t)y * image->stride;
+}
+
+/**
+ * @brief Index inside 0 ... size - 1 that stands for index i (at most size - 1 outside) under a border mode.
+ *
+ * @param i    Row or column, possibly outside the image
+ * @param size Image height or width
+ * @param mode Border mode (BORDER_MIRROR falls back to the edge pixel when size is 1)
+ * @return Index, or -1 for a constant (BORDER_CONSTANT) or absent (BORDER_COPY) pixel
+ */
+static inline int BorderIndex(int i, int size, BorderMode mode) {
+    if (i >= 0 && i < size) {
+        return i;
+    }
+    if (mode == BORDER_COPY || mode == BORDER_CONSTANT) {
+        return -1;
+    }
+    if (mode == BORDER_MIRROR && size > 1) {
+        i = i < 0 ? -i : 2 * (size - 1) - i;
+    }
+    return i < 0 ? 0 : i >= size ? size - 1 : i;
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Four pixels of 12 packed RGB bytes (bytes 0 ... 11 of v) as 32-bit words R | G << 8 | B << 16.
+ */
+static inline __m128i rgb12_to_words(__m128i v) {
+    // Pixels 0, 1 in the low 64-bit lane, pixels 2, 3 in the high one; then the second pixel of
+    // each lane moves from byte 3 to byte 4
+    __m128i x = _mm_unpacklo_epi64(v, _mm_srli_si128(v, 6));
+    const __m128i low = _mm_set_epi32(0, 0xffffff, 0, 0xffffff);
+    const __m128i high = _mm_set_epi32(0xffffff, 0, 0xffffff, 0);
+    return _mm_or_si128(_mm_and_si128(x, low), _mm_and_si128(_mm_slli_epi64(x, 8), high));
+}
+
+/**
+ * @brief Four pixels of 32-bit words R | G << 8 | B << 16 as 12 packed RGB bytes (bytes 12 ... 15 zero).
+ */
+static inline __m128i words_to_rgb12(__m128i w) {
+    const __m128i low = _mm_set_epi32(0, 0xffffff, 0, 0xffffff);
+    const __m128i high = _mm_set_epi32(0xffffff, 0, 0xffffff, 0);
+    // 6 bytes per 64-bit lane, then the high lane's move to bytes 6 ... 11
+    __m128i x = _mm_or_si128(_mm_and_si128(w, low), _mm_srli_epi64(_mm_and_si128(w, high), 8));
+    return _mm_or_si128(_mm_move_epi64(x), _mm_slli_si128(_mm_unpackhi_epi64(x, _mm_setzero_si128()), 6));
+}
+
+/**
+ * @brief Splits 16 interleaved RGB pixels (48 bytes) into 16 bytes per channel.
+ *
+ * @param rgb 48 bytes of RGB
+ * @param r   Red channel
+ * @param g   Green channel
+ * @param b   Blue channel
+ */
+static inline void DeinterleaveRGB16(const unsigned char *rgb, __m128i *r, __m128i *g, __m128i *b) {
+    __m128i v0 = _mm_loadu_si128((const __m128i *)rgb);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(rgb + 16));
+    __m128i v2 = _mm_loadu_si128((const __m128i *)(rgb + 32));
+    __m128i w[4] = {
+        rgb12_to_words(v0),
+        rgb12_to_words(_mm_or_si128(_mm_srli_si128(v0, 12), _mm_slli_si128(v1, 4))),
+        rgb12_to_words(_mm_or_si128(_mm_srli_si128(v1, 8), _mm_slli_si128(v2, 8))),
+        rgb12_to_words(_mm_srli_si128(v2, 4)),
+    };
+    const __m128i byte = _mm_set1_epi32(0xff);
+    __m128i *out[3] = { r, g, b };
+    for (int c = 0; c < 3; c++) {
+        __m128i lo = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(w[0], 8 * c), byte),
+                                     _mm_and_si128(_mm_srli_epi32(w[1], 8 * c), byte));
+        __m128i hi = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(w[2], 8 * c), byte),
+                                     _mm_and_si128(_mm_srli_epi32(w[3], 8 * c), byte));
+        *out[c] = _mm_packus_epi16(lo, hi);
+    }
+}
+
+/**
+ * @brief Merges 16 bytes per channel into 16 interleaved RGB pixels (48 bytes).
+ *
+ * @param r   Red channel
+ * @param g   Green channel
+ * @param b   Blue channel
+ * @param rgb 48 bytes of RGB
+ */
+static inline void InterleaveRGB16(__m128i r, __m128i g, __m128i b, unsigned char *rgb) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i rg_lo = _mm_unpacklo_epi8(r, g), rg_hi = _mm_unpackhi_epi8(r, g);
+    __m128i b_lo = _mm_unpacklo_epi8(b, zero), b_hi = _mm_unpackhi_epi8(b, zero);
+    __m128i c0 = words_to_rgb12(_mm_unpacklo_epi16(rg_lo, b_lo));
+    __m128i c1 = words_to_rgb12(_mm_unpackhi_epi16(rg_lo, b_lo));
+    __m128i c2 = words_to_rgb12(_mm_unpacklo_epi16(rg_hi, b_hi));
+    __m128i c3 = words_to_rgb12(_mm_unpackhi_epi16(rg_hi, b_hi));
+    _mm_storeu_si128((__m128i *)rgb, _mm_or_si128(c0, _mm_slli_si128(c1, 12)));
+    _mm_storeu_si128((__m128i *)(rgb + 16), _mm_or_si128(_mm_srli_si128(c1, 4), _mm_slli_si128(c2, 8)));
+    _mm_storeu_si128((__m128i *)(rgb + 32), _mm_or_si128(_mm_srli_si128(c2, 8), _mm_slli_si128(c3, 4)));
+}
+#endif
+
+// ==============================================================================================
+// Pipeline Stages (iedp_stages.c)
+// ==============================================================================================
+void MedianFilter(const Image *input, const Image *output);
+void ConvertToGreyscale(const Image *input, const Image *output);
+void SobelEdgeDetection(const Image *grey, const Image *edges);
+void MedianFilterRegion(const Image *input, const Image *output, int x0, int y0, int x1, int y1);
+void ConvertToGreyscaleRegion(const Image *input, const Image *output, int x0, int y0, int x1, int y1);
+void SobelEdgeDetectionRegion(const Image *grey, const Image *edges, int x0, int y0, int x1, int y1);
+void MedianFilterRow(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                     unsigned char *output, int width, int x0, int x1);
+void MedianFilterPlanarRow(const unsigned char *const *up, const unsigned char *const *mid,
+                           const unsigned char *const *dn, unsigned char *const *output, int width, int x0, int x1);
+void ConvertToGreyscaleRow(const unsigned char *input, unsigned char *output, int x0, int x1);
+void ConvertToGreyscalePlanarRow(const unsigned char *const *input, unsigned char *output, int x0, int x1);
+void SobelEdgeRow(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                  unsigned char *edges, int width, int x0, int x1);
+
+/**
+ * @brief Sobel gradients at an interior pixel, from the three rows around it (1 <= x <= width - 2).
+ *
+ *        gx = | -1  0 +1 |      gy = | +1 +2 +1 |
+ *             | -2  0 +2 |           |  0  0  0 |
+ *             | -1  0 +1 |           | -1 -2 -1 |
+ *
+ * @param up  Row above
+ * @param mid Row of the pixel
+ * @param dn  Row below
+ * @param x   Column
+ * @param gx  Horizontal gradient (vertical edges)
+ * @param gy  Vertical gradient (horizontal edges), positive when the row above is brighter
+ */
+static inline void SobelGradientRows(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                                     int x, int *gx, int *gy) {
+    up += x;
+    mid += x;
+    dn += x;
+    *gx = (up[1] + 2 * mid[1] + dn[1]) - (up[-1] + 2 * mid[-1] + dn[-1]);
+    *gy = (up[-1] + 2 * up[0] + up[1]) - (dn[-1] + 2 * dn[0] + dn[1]);
+}
+
+/**
+ * @brief Sobel gradients at an interior pixel (1 <= x <= width - 2, 1 <= y <= height - 2), see
+ *        SobelGradientRows.
+ *
+ * @param grey Greyscale image
+ * @param x    Column
+ * @param y    Row
+ * @param gx   Horizontal gradient (vertical edges)
+ * @param gy   Vertical gradient (horizontal edges), positive when the row above is brighter
+ */
+static inline void SobelGradient(const Image *grey, int x, int y, int *gx, int *gy) {
+    SobelGradientRows(ImageRow(grey, y - 1, 0), ImageRow(grey, y, 0), ImageRow(grey, y + 1, 0), x, gx, gy);
+}
+
+// ==============================================================================================
+// Bit-packed Edge Mask (edge_mask.c)
+// ==============================================================================================
+// Bytes per mask row: 8 pixels per byte, leftmost pixel in the most significant bit (PBM P4 layout)
+#define EDGE_MASK_STRIDE(width) (((width) + 7) / 8)
+// Threshold value asking for AutoEdgeThreshold
+#define EDGE_THRESHOLD_AUTO 256
+
+void SobelEdgeMask(const Image *grey, unsigned char *mask, int threshold);
+void SobelEdgeMaskRow(const Image *grey, unsigned char *row, int y, int threshold);
+void SobelEdgeMaskRegion(const Image *grey, unsigned char *mask, int threshold, int x0, int y0, int x1, int y1);
+int AutoEdgeThreshold(const Image *grey);
+int WriteEdgeMaskPBM(const char *filename, const unsigned char *mask, int width, int height);
+
+// ==============================================================================================
+// Sparse Edge List (edge_list.c)
+// ==============================================================================================
+/**
+ * @brief One edge pixel of an edge list
+ */
+typedef struct {
+    uint16_t x;         // Column
+    uint16_t y;         // Row
+    uint8_t magnitude;  // Gradient magnitude as written by SobelEdgeDetection
+    uint8_t direction;  // Gradient direction in 1/256 turns, 0 = +x, counter-clockwise with y up
+} EdgeRecord;
+
+/**
+ * @brief Growable array of edge records, sorted by y then x
+ */
+typedef struct {
+    EdgeRecord *records; // Records
+    size_t count;        // Records in use
+    size_t capacity;     // Records allocated
+} EdgeList;
+
+int SobelEdgeList(const Image *grey, int threshold, int threads, EdgeList *list);
+int SobelEdgeListRegion(const Image *grey, int threshold, int x0, int y0, int x1, int y1, EdgeList *list);
+int WriteEdgeList(const char *filename, const EdgeList *list, int width, int height, int with_direction);
+void FreeEdgeList(EdgeList *list);
+
+// ==============================================================================================
+// Canny Edge Detection (canny.c)
+// ==============================================================================================
+int CannyEdgeDetection(const Image *grey, const Image *edges, int low, int high, int threads);
+
+// ==============================================================================================
+// Row-band Threads (parallel.c)
+// ==============================================================================================
+// Work on rows y0 ... y1 - 1
+typedef void (*RowRangeFn)(void *ctx, int y0, int y1);
+
+void ParallelRows(int y0, int y1, int threads, RowRangeFn fn, void *ctx, int perf_stage);
+
+// ==============================================================================================
+// Convolution Engine (conv.c)
+// ==============================================================================================
+// Largest kernel side
+#define CONV_MAX_SIZE 5
+
+/**
+ * @brief Integer convolution kernel, 3x3 or 5x5
+ */
+typedef struct {
+    int size;                                   // 3 or 5
+    int weights[CONV_MAX_SIZE * CONV_MAX_SIZE]; // Row by row, size * size entries
+    int shift;                                  // Single-kernel output is sum >> shift
+} ConvKernel;
+
+/**
+ * @brief One non-zero kernel weight at offset (dx, dy) from the output pixel
+ */
+typedef struct {
+    int dx, dy; // Offset
+    int weight; // Weight, never 0
+} ConvTap;
+
+/**
+ * @brief A kernel compiled for execution (ConvPlanCompile)
+ */
+typedef struct {
+    int radius;           // 1 for 3x3, 2 for 5x5
+    int shift;            // Single-kernel output: sum >> shift
+    ConvTap taps[CONV_MAX_SIZE * CONV_MAX_SIZE]; // Non-zero taps, row by row
+    int tap_count;
+    int separable;        // Kernel = column vector x row vector
+    ConvTap row_taps[CONV_MAX_SIZE]; // Separable: non-zero horizontal taps (dy = 0)
+    int row_count;
+    ConvTap col_taps[CONV_MAX_SIZE]; // Separable: non-zero vertical taps (dx = 0)
+    int col_count;
+    int simd;             // 16-bit lanes cannot overflow
+} ConvPlan;
+
+int ConvKernelPreset(const char *name, ConvKernel *kx, ConvKernel *ky);
+int ConvKernelParse(const char *text, ConvKernel *k);
+void ConvPlanCompile(const ConvKernel *k, ConvPlan *plan);
+void ConvolveGradient(const Image *grey, const Image *edges, const ConvKernel *kx, const ConvKernel *ky,
+                      int threads);
+void Convolve(const Image *grey, const Image *output, const ConvKernel *k, int threads);
+void ConvolveRow(const unsigned char *const *rows, unsigned char *dst, int x0, int x1, const ConvPlan *px,
+                 const ConvPlan *py);
+
+// ==============================================================================================
+// Temporal Median Filter (temporal.c)
+// ==============================================================================================
+// Most frames a ring can hold (and the widest temporal median)
+#define FRAME_RING_MAX 5
+
+/**
+ * @brief Preallocated ring of the last depth frames of a stream
+ */
+typedef struct {
+    Image frames[FRAME_RING_MAX];  // depth frames (packed interleaved rows)
+    int depth;                     // Slots (0: not initialised)
+    int count;                     // Frames held, up to depth
+    int next;                      // Slot the next frame is written to
+    int newest;                    // Slot of the newest frame
+} FrameRing;
+
+int FrameRingInit(FrameRing *ring, int depth, int width, int height, int channels);
+Image *FrameRingSlot(FrameRing *ring);
+void FrameRingCommit(FrameRing *ring);
+void FrameRingFree(FrameRing *ring);
+void TemporalMedianFilter(const FrameRing *ring, const Image *output, int threads);
+
+// ==============================================================================================
+// Dirty-tile Incremental Processing (incremental.c)
+// ==============================================================================================
+// Tile side for change detection, in pixels
+#define INCREMENTAL_TILE 32
+
+/**
+ * @brief Stage outputs of the previous frame, patched where the input changed
+ */
+typedef struct {
+    int width, height;           // Frame size
+    int tiles_x, tiles_y;        // Tiles per row / column
+    Image prev_rgb;              // Previous input frame (RGB, packed rows like every frame below)
+    Image filtered_rgb;          // Median filter output (RGB)
+    Image grey;                  // Greyscale output
+    Image edges;                 // Sobel edge image
+    unsigned char *dirty;        // Changed flag per tile, tiles_x * tiles_y
+    size_t dirty_tiles;          // Tiles changed by the last IncrementalDiff
+    int primed;                  // A frame has been processed
+} IncrementalCache;
+
+int IncrementalInit(IncrementalCache *cache, int width, int height);
+void IncrementalFree(IncrementalCache *cache);
+size_t IncrementalDiff(IncrementalCache *cache, const Image *rgb);
+void IncrementalMedian(IncrementalCache *cache);
+void IncrementalGreyscale(IncrementalCache *cache);
+void IncrementalSobel(IncrementalCache *cache);
+
+// ==============================================================================================
+// Region of Interest (roi.c)
+// ==============================================================================================
+/**
+ * @brief 1-bit region-of-interest mask, EDGE_MASK_STRIDE layout (set = inside)
+ */
+typedef struct {
+    int width, height;   // Image size
+    int stride;          // Bytes per row
+    unsigned char *bits; // stride * height bytes
+} RoiMask;
+
+// What the masked stages do with pixels outside the mask
+typedef enum {
+    ROI_OUTSIDE_PASS, // Unfiltered input passed through, no edges
+    ROI_OUTSIDE_KEEP  // Output left untouched
+} RoiOutside;
+
+int RoiInit(RoiMask *roi, int width, int height);
+void RoiFree(RoiMask *roi);
+void RoiAddRect(RoiMask *roi, int x, int y, int w, int h);
+int RoiLoadPBM(RoiMask *roi, const char *filename);
+int RoiDilate(const RoiMask *roi, int radius, RoiMask *out);
+size_t RoiCount(const RoiMask *roi);
+int RoiBounds(const RoiMask *roi, int *x0, int *y0, int *x1, int *y1);
+void RoiMedianFilter(const RoiMask *roi, const Image *input, const Image *output, int outside);
+void RoiConvertToGreyscale(const RoiMask *roi, const Image *input, const Image *output, int outside);
+void RoiSobelEdgeDetection(const RoiMask *roi, const Image *grey, const Image *edges, int outside);
+void RoiSobelEdgeMask(const RoiMask *roi, const Image *grey, unsigned char *mask, int threshold);
+int RoiSobelEdgeList(const RoiMask *roi, const Image *grey, int threshold, EdgeList *list);
+// Canny with hysteresis limited to a mask (canny.c)
+int CannyEdgeDetectionMasked(const Image *grey, const Image *edges, int low, int high, int threads,
+                             const RoiMask *roi, int roi_x, int roi_y);
+void RoiClipImage(const RoiMask *roi, const Image *image);
+
+// ==============================================================================================
+// Fixed-geometry Kernels (fixed_kernels.c)
+// ==============================================================================================
+// Row kernel signatures of MedianFilterRow, ConvertToGreyscaleRow, SobelEdgeRow and the planar
+// MedianFilterPlanarRow / ConvertToGreyscalePlanarRow (one row pointer per channel plane)
+typedef void (*MedianRowFn)(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                            unsigned char *output, int width, int x0, int x1);
+typedef void (*GreyRowFn)(const unsigned char *input, unsigned char *output, int x0, int x1);
+typedef void (*SobelRowFn)(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                           unsigned char *edges, int width, int x0, int x1);
+typedef void (*MedianPlanarRowFn)(const unsigned char *const *up, const unsigned char *const *mid,
+                                  const unsigned char *const *dn, unsigned char *const *output, int width,
+                                  int x0, int x1);
+typedef void (*GreyPlanarRowFn)(const unsigned char *const *input, unsigned char *output, int x0, int x1);
+
+/**
+ * @brief Row kernels of the median, greyscale and Sobel stages
+ */
+typedef struct {
+    int width, height;        // Geometry compiled in (0 x 0: any)
+    MedianRowFn median_row;   // Median filter
+    GreyRowFn grey_row;       // Greyscale conversion
+    SobelRowFn sobel_row;     // Sobel edge detection
+    const char *median_isa;   // Instruction set of each kernel, for logging
+    const char *grey_isa;
+    const char *sobel_isa;
+    MedianPlanarRowFn median_planar_row; // Planar median filter (dispatch.c; NULL in the fixed sets)
+    GreyPlanarRowFn grey_planar_row;     // Planar greyscale conversion
+    ImageLayout layout;       // Layout the stage graph streams the median and greyscale rows in
+} StageKernels;
+
+const StageKernels *StageKernelsFind(int width, int height);
+const StageKernels *StageKernelsGeneric(void);
+#if defined(__SSE2__)
+void MedianFilterRowSSE2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                         unsigned char *output, int width, int x0, int x1);
+void SobelEdgeRowSSE2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                      unsigned char *edges, int width, int x0, int x1);
+void MedianFilterPlanarRowSSE2(const unsigned char *const *up, const unsigned char *const *mid,
+                               const unsigned char *const *dn, unsigned char *const *output, int width,
+                               int x0, int x1);
+#endif
+
+// ==============================================================================================
+// AVX2 / AVX-512 Kernels (kernels_avx.c) and CPU Dispatch (dispatch.c)
+// ==============================================================================================
+/**
+ * @brief Instruction sets with kernel variants, narrowest first
+ */
+typedef enum {
+    KERNEL_ISA_SCALAR, // Generic C
+    KERNEL_ISA_SSE2,   // x86-64 baseline
+    KERNEL_ISA_AVX2,   // Haswell and later
+    KERNEL_ISA_AVX512, // AVX-512 F + BW (Skylake-SP and later)
+    KERNEL_ISA_COUNT
+} KernelIsa;
+
+#if defined(__x86_64__) || defined(__i386__)
+void MedianFilterRowAVX2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                         unsigned char *output, int width, int x0, int x1);
+void ConvertToGreyscaleRowAVX2(const unsigned char *input, unsigned char *output, int x0, int x1);
+void SobelEdgeRowAVX2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                      unsigned char *edges, int width, int x0, int x1);
+void MedianFilterRowAVX512(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                           unsigned char *output, int width, int x0, int x1);
+void SobelEdgeRowAVX512(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                        unsigned char *edges, int width, int x0, int x1);
+void MedianFilterPlanarRowAVX2(const unsigned char *const *up, const unsigned char *const *mid,
+                               const unsigned char *const *dn, unsigned char *const *output, int width,
+                               int x0, int x1);
+void ConvertToGreyscalePlanarRowAVX2(const unsigned char *const *input, unsigned char *output, int x0, int x1);
+void MedianFilterPlanarRowAVX512(const unsigned char *const *up, const unsigned char *const *mid,
+                                 const unsigned char *const *dn, unsigned char *const *output, int width,
+                                 int x0, int x1);
+#endif
+
+int KernelIsaSupported(KernelIsa isa);
+int StageKernelsSelect(const char *spec, int width, int height, StageKernels *kernels);
+void StageKernelsPrint(const StageKernels *kernels, FILE *out);
+
+// ==============================================================================================
+// Demand-driven Stage Graph (stage_graph.c)
+// ==============================================================================================
+/**
+ * @brief Stage outputs of the graph, in pipeline order
+ */
+typedef enum {
+    STAGE_FILTERED, // Median filter output (RGB)
+    STAGE_GREY,     // Greyscale conversion output
+    STAGE_EDGES,    // Sobel edge image
+    STAGE_COUNT
+} StageId;
+// Bit of a stage in an output set
+#define STAGE_BIT(id) (1u << (id))
+
+/**
+ * @brief One stage of the graph
+ */
+typedef struct {
+    Image frame;         // Full frame (packed rows), or ring_rows rows (IMAGE_ALIGN rows); a planar
+                         // ring for the median of a planar graph
+    Image packed;        // Interleaved full frame of a requested planar stage, for the encoders
+    int ring_rows;       // Rows in the ring (0: full frame)
+    int next_row;        // Rows 0 ... next_row - 1 computed
+    int active;          // A requested output depends on it
+    int stored;          // Requested: kept as a full frame
+    int alias;           // Output is the source frame (no median filter)
+    Image window;        // Halo-padded copies of the 3 input rows of the stencil (border modes but COPY)
+    int window_rows[3];  // Input row (-1 ... height) in each window row
+} StageNode;
+
+/**
+ * @brief Source → median → greyscale → Sobel, computed on demand
+ */
+typedef struct {
+    StageNode nodes[STAGE_COUNT]; // Stages
+    Image source;                 // Interleaved RGB source frame (or view)
+    const StageKernels *kernels;  // Row kernels for the frame size
+    BorderMode border;            // What the median and Sobel stencils see outside the image
+    int border_value;             // Value of BORDER_CONSTANT
+    int planar;                   // Median and greyscale run on planar rows (kernels->layout)
+    Image planes;                 // Planar copies of the 3 source rows the median reads (planar graph)
+    int plane_rows[3];            // Source row in each of them
+} StageGraph;
+
+int StageGraphInit(StageGraph *graph, const Image *source, int median, unsigned outputs,
+                   const StageKernels *kernels, BorderMode border, int border_value);
+unsigned char *StageGraphPull(StageGraph *graph, StageId id);
+void StageGraphFree(StageGraph *graph);
+
+// ==============================================================================================
+// Fused Stencil Pipelines (stencil_pipeline.c)
+// ==============================================================================================
+// Most stages in a pipeline
+#define STENCIL_MAX_STAGES 32
+// Default tile of the fused passes: full-width strips (no column halo) of 64 rows, which stay in L2
+// through every fused stage
+#define STENCIL_TILE_W 0
+#define STENCIL_TILE_H 64
+
+// Stage operations
+typedef enum {
+    STENCIL_INVERT,    // 255 - v
+    STENCIL_THRESHOLD, // 255 if v >= param, else 0
+    STENCIL_MEDIAN,    // 3x3 median
+    STENCIL_ERODE,     // 3x3 minimum
+    STENCIL_DILATE,    // 3x3 maximum
+    STENCIL_CONV,      // Single kernel kx
+    STENCIL_GRADIENT   // Magnitude of the kx / ky pair
+} StencilOp;
+
+/**
+ * @brief One stage of a user-defined pipeline on a greyscale image
+ */
+typedef struct {
+    StencilOp op;      // Operation
+    int param;         // Threshold
+    int halo;          // Pixels read on each side (0: pointwise)
+    ConvKernel kx, ky; // Kernels of STENCIL_CONV / STENCIL_GRADIENT, the same size
+    ConvPlan px, py;   // kx and ky compiled once, for the interior rows
+    char name[48];     // Stage text, for printing
+} StencilStage;
+
+/**
+ * @brief Stages applied in order
+ */
+typedef struct {
+    StencilStage stages[STENCIL_MAX_STAGES]; // Stages
+    int count;                               // Stages used
+} StencilPipeline;
+
+/**
+ * @brief Consecutive stages run in one tiled pass
+ */
+typedef struct {
+    int first, count; // Stages first ... first + count - 1
+    int halo;         // Sum of their halos: input pixels read around a tile
+} StencilGroup;
+
+/**
+ * @brief Fused execution plan of a pipeline
+ */
+typedef struct {
+    StencilGroup groups[STENCIL_MAX_STAGES]; // Passes over the frame
+    int group_count;                         // Passes
+    int tile_w, tile_h;                      // Tile size
+} StencilSchedule;
+
+int StencilPipelineAdd(StencilPipeline *pipeline, const char *spec);
+int StencilPipelineParse(StencilPipeline *pipeline, const char *text);
+void StencilSchedulePlan(const StencilPipeline *pipeline, int width, int height, int tile_w, int tile_h,
+                         int fuse, StencilSchedule *schedule);
+void StencilSchedulePrint(const StencilPipeline *pipeline, const StencilSchedule *schedule, FILE *out);
+int StencilPipelineRun(const StencilPipeline *pipeline, const StencilSchedule *schedule, const Image *src,
+                       const Image *dst, int threads);
+long StencilPipelineVerify(const StencilPipeline *pipeline, const Image *src, const Image *fused, int threads);
+
+// ==============================================================================================
+// Auto-tuning (autotune.c)
+// ==============================================================================================
+// Pipeline tuned for when --pipeline is not given: the stencil mix of a typical edge pipeline
+#define AUTOTUNE_PIPELINE "median; gradient sobel; threshold 64; dilate"
+// Default profile file, in the home directory
+#define TUNE_PROFILE_FILE ".iedp_profile"
+
+/**
+ * @brief Tuned settings of one machine, persisted in a profile file
+ */
+typedef struct {
+    int width, height;   // Frame size tuned on
+    int threads;         // Worker threads
+    int tile_w, tile_h;  // Fused pipeline tile (0: image width / height)
+    int fuse;            // Fuse pipeline stages
+    char isa[64];        // Kernel variant spec (dispatch.c), "" for auto
+} TuneProfile;
+
+int Autotune(int width, int height, const StencilPipeline *pipeline, TuneProfile *profile, FILE *log);
+void TuneProfilePrint(const TuneProfile *profile, FILE *out);
+int TuneProfileSave(const char *path, const TuneProfile *profile);
+int TuneProfileLoad(const char *path, TuneProfile *profile);
+
+#endif // IEDP_H
@@ -0,0 +1,386 @@
+/**
+ * @file iedp_stages.c
+ * @brief Pipeline stages: Median Filter → Greyscale → Sobel Edge Detection
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <math.h> // For mathematical operations
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// Region Helper
+// ==============================================================================================
+/**
+ * @brief Clips the region x0 ... x1 - 1, y0 ... y1 - 1 to the image.
+ *
+ * @param x0     First column
+ * @param y0     First row
+ * @param x1     One past the last column
+ * @param y1     One past the last row
+ * @param width  Image width
+ * @param height Image height
+ */
+static void clip_region(int *x0, int *y0, int *x1, int *y1, int width, int height) {
+    *x0 = *x0 < 0 ? 0 : *x0;
+    *y0 = *y0 < 0 ? 0 : *y0;
+    *x1 = *x1 > width ? width : *x1;
+    *y1 = *y1 > height ? height : *y1;
+}
+
+/**
+ * @brief Splits the columns x0 ... x1 - 1 of a row into the peeled border columns and the interior
+ *        ones, where a 3x3 window stays inside the image: xi0 ... xi1 - 1, empty on the first and last
+ *        image rows. The border columns are x0 ... min(x1, xi0) - 1 and max(x0, xi1) ... x1 - 1.
+ *
+ * @param up    Row above (or its planes), NULL on the first image row
+ * @param dn    Row below (or its planes), NULL on the last image row
+ * @param width Image width
+ * @param x0    First column
+ * @param x1    One past the last column
+ * @param xi0   First interior column
+ * @param xi1   One past the last interior column (>= xi0)
+ */
+static void interior_columns(const void *up, const void *dn, int width, int x0, int x1,
+                             int *xi0, int *xi1) {
+    if (!up || !dn) {
+        *xi0 = *xi1 = x1;
+        return;
+    }
+    *xi0 = x0 > 1 ? x0 : 1;
+    *xi1 = x1 < width - 1 ? x1 : width - 1;
+    *xi1 = *xi1 > *xi0 ? *xi1 : *xi0;
+}
+
+// ==============================================================================================
+// A: Median Filter - Applies median filter to an RGB image
+// ==============================================================================================
+/**
+ * @brief Median of a 3x3 window: the pixels sorted in ascending order of brightness with a bubble
+ *        sort, which is stable, so pixels of equal brightness keep their window order.
+ *
+ * @param window The 9 window pixels, row by row (sorted in place)
+ * @return Median pixel (index 4 of the sorted window)
+ */
+static RGB window_median(RGB *window) {
+    // Sort the pixels in ascending order of brightness using bubble sort
+    for (int k = 0; k < WINDOW_SIZE * WINDOW_SIZE - 1; k++) {
+        for (int l = 0; l < WINDOW_SIZE * WINDOW_SIZE - 1 - k; l++) {
+            // Compare brightness of adjacent pixels
+            if (BRIGHTNESS(window[l]) > BRIGHTNESS(window[l + 1])) {
+                // Swap pixels if they're in the wrong order
+                RGB temp = window[l];
+                window[l] = window[l + 1];
+                window[l + 1] = temp;
+            }
+        }
+    }
+
+    // For a 3x3 window (9 pixels), the median is at index 4
+    return window[4];
+}
+
+/**
+ * @brief Applies a 3x3 median filter to an RGB image to reduce noise while preserving edges
+ * 
+ * @param input  Input RGB image, interleaved or planar
+ * @param output Output RGB image of the same size and layout
+ */
+void MedianFilter(const Image *input, const Image *output) {
+    MedianFilterRegion(input, output, 0, 0, input->width, input->height);
+}
+
+/**
+ * @brief MedianFilter for the pixels x0 ... x1 - 1, y0 ... y1 - 1 only (clipped to the image). The
+ *        other output pixels are left as they are.
+ *
+ * @param input  Input RGB image, interleaved or planar
+ * @param output Output RGB image of the same size and layout
+ * @param x0     First column
+ * @param y0     First row
+ * @param x1     One past the last column
+ * @param y1     One past the last row
+ */
+void MedianFilterRegion(const Image *input, const Image *output, int x0, int y0, int x1, int y1) {
+    int width = input->width, height = input->height;
+    clip_region(&x0, &y0, &x1, &y1, width, height);
+
+    // Process each row in the region; the first and last image rows have no row above / below
+    for (int y = y0; y < y1; y++) {
+        if (input->layout == IMAGE_PLANAR) {
+            const unsigned char *rows[3][3];
+            unsigned char *out[3];
+            for (int c = 0; c < 3; c++) {
+                for (int r = 0; r < 3; r++) {
+                    rows[r][c] = y + r - 1 >= 0 && y + r - 1 < height ? ImageRow(input, y + r - 1, c) : NULL;
+                }
+                out[c] = ImageRow(output, y, c);
+            }
+            MedianFilterPlanarRow(y > 0 ? rows[0] : NULL, rows[1], y < height - 1 ? rows[2] : NULL, out, width,
+                                  x0, x1);
+            continue;
+        }
+        const unsigned char *up = y > 0 ? ImageRow(input, y - 1, 0) : NULL;
+        const unsigned char *dn = y < height - 1 ? ImageRow(input, y + 1, 0) : NULL;
+        MedianFilterRow(up, ImageRow(input, y, 0), dn, ImageRow(output, y, 0), width, x0, x1);
+    }
+}
+
+/**
+ * @brief MedianFilter of one row, from row pointers so the rows can live in any buffer.
+ *
+ * @param up     Row above (RGB), NULL on the first image row
+ * @param mid    Row being filtered (RGB)
+ * @param dn     Row below (RGB), NULL on the last image row
+ * @param output Output row (RGB)
+ * @param width  Image width
+ * @param x0     First column
+ * @param x1     One past the last column
+ */
+void MedianFilterRow(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                     unsigned char *output, int width, int x0, int x1) {
+    const unsigned char *rows[3] = { up, mid, dn };
+    int xi0, xi1;
+    interior_columns(up, dn, width, x0, x1, &xi0, &xi1);
+
+    // Edge pixels (no full 3x3 window): copy the original pixel values to the output, so the interior
+    // loop below needs no border tests
+    for (int x = x0; x < (x1 < xi0 ? x1 : xi0); x++) {
+        output[x * 3]     = mid[x * 3];     // Red channel
+        output[x * 3 + 1] = mid[x * 3 + 1]; // Green channel
+        output[x * 3 + 2] = mid[x * 3 + 2]; // Blue channel
+    }
+    for (int x = x0 > xi1 ? x0 : xi1; x < x1; x++) {
+        output[x * 3]     = mid[x * 3];
+        output[x * 3 + 1] = mid[x * 3 + 1];
+        output[x * 3 + 2] = mid[x * 3 + 2];
+    }
+
+    // Process each interior pixel in the row
+    for (int x = xi0; x < xi1; x++) {
+        // Calculate the index of the current pixel
+        int current_idx = x * 3;
+
+        // Array to store the 3x3 window of pixels around the current position
+        RGB window[WINDOW_SIZE * WINDOW_SIZE];
+        int idx = 0;  // Index counter for the window array
+
+        // Collect the 3x3 neighborhood of pixels around the current pixel
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                // Calculate the index of the neighbor pixel in its row
+                int neighbor_idx = (x + dx) * 3;
+                const unsigned char *row = rows[dy + 1];
+
+                // Store RGB values in the window array
+                window[idx].r = row[neighbor_idx];     // Red channel
+                window[idx].g = row[neighbor_idx + 1]; // Green channel
+                window[idx].b = row[neighbor_idx + 2]; // Blue channel
+                idx++;  // Move to next position in window array
+            }
+        }
+
+        // Assign the median pixel to the output
+        RGB median = window_median(window);
+        output[current_idx]     = median.r;  // Red channel of median
+        output[current_idx + 1] = median.g;  // Green channel of median
+        output[current_idx + 2] = median.b;  // Blue channel of median
+    }
+}
+
+/**
+ * @brief MedianFilterRow on planar rows: one row pointer per channel plane (R, G, B), so the window
+ *        is gathered without the 3-byte pixel stride. Same output as MedianFilterRow.
+ *
+ * @param up     Planes of the row above, NULL on the first image row
+ * @param mid    Planes of the row being filtered
+ * @param dn     Planes of the row below, NULL on the last image row
+ * @param output Planes of the output row
+ * @param width  Image width
+ * @param x0     First column
+ * @param x1     One past the last column
+ */
+void MedianFilterPlanarRow(const unsigned char *const *up, const unsigned char *const *mid,
+                           const unsigned char *const *dn, unsigned char *const *output, int width, int x0, int x1) {
+    const unsigned char *const *rows[3] = { up, mid, dn };
+    int xi0, xi1;
+    interior_columns(up, dn, width, x0, x1, &xi0, &xi1);
+
+    // Edge pixels (no full 3x3 window) keep their input value
+    for (int c = 0; c < 3; c++) {
+        for (int x = x0; x < (x1 < xi0 ? x1 : xi0); x++) {
+            output[c][x] = mid[c][x];
+        }
+        for (int x = x0 > xi1 ? x0 : xi1; x < x1; x++) {
+            output[c][x] = mid[c][x];
+        }
+    }
+
+    for (int x = xi0; x < xi1; x++) {
+        // The 3x3 neighborhood, in the same order as MedianFilterRow
+        RGB window[WINDOW_SIZE * WINDOW_SIZE];
+        for (int k = 0; k < WINDOW_SIZE * WINDOW_SIZE; k++) {
+            const unsigned char *const *row = rows[k / 3];
+            window[k].r = row[0][x + k % 3 - 1];
+            window[k].g = row[1][x + k % 3 - 1];
+            window[k].b = row[2][x + k % 3 - 1];
+        }
+        RGB median = window_median(window);
+        output[0][x] = median.r;
+        output[1][x] = median.g;
+        output[2][x] = median.b;
+    }
+}
+
+// ==============================================================================================
+// B: Greyscale Conversion - Converts RGB image to greyscale
+// ==============================================================================================
+/**
+ * @brief Converts an RGB image to greyscale.
+ *
+ * @param input  Input RGB image, interleaved or planar
+ * @param output Output greyscale image of the same size
+ */
+void ConvertToGreyscale(const Image *input, const Image *output) {
+    ConvertToGreyscaleRegion(input, output, 0, 0, input->width, input->height);
+}
+
+/**
+ * @brief ConvertToGreyscale for the pixels x0 ... x1 - 1, y0 ... y1 - 1 only (clipped to the image).
+ *
+ * @param input  Input RGB image, interleaved or planar
+ * @param output Output greyscale image of the same size
+ * @param x0     First column
+ * @param y0     First row
+ * @param x1     One past the last column
+ * @param y1     One past the last row
+ */
+void ConvertToGreyscaleRegion(const Image *input, const Image *output, int x0, int y0, int x1, int y1) {
+    clip_region(&x0, &y0, &x1, &y1, input->width, input->height);
+
+    // Process each row in the region
+    for (int y = y0; y < y1; y++) {
+        if (input->layout == IMAGE_PLANAR) {
+            const unsigned char *planes[3] = { ImageRow(input, y, 0), ImageRow(input, y, 1), ImageRow(input, y, 2) };
+            ConvertToGreyscalePlanarRow(planes, ImageRow(output, y, 0), x0, x1);
+        } else {
+            ConvertToGreyscaleRow(ImageRow(input, y, 0), ImageRow(output, y, 0), x0, x1);
+        }
+    }
+}
+
+/**
+ * @brief ConvertToGreyscale of one row.
+ *
+ * @param input  Input row (RGB)
+ * @param output Output row (greyscale)
+ * @param x0     First column
+ * @param x1     One past the last column
+ */
+void ConvertToGreyscaleRow(const unsigned char *input, unsigned char *output, int x0, int x1) {
+    // Process each pixel in the row
+    for (int x = x0; x < x1; x++) {
+        // Calculate the index of the current pixel in the input RGB row
+        int idx = x * 3;
+        
+        // Extract individual RGB channel values
+        uint8_t r = input[idx];        // Red channel
+        uint8_t g = input[idx + 1];    // Green channel
+        uint8_t b = input[idx + 2];    // Blue channel
+        
+        // Convert RGB to greyscale using standard luminance formula
+        output[x] = (uint8_t)(0.299 * r + 0.587 * g + 0.114 * b);
+    }
+}
+
+/**
+ * @brief ConvertToGreyscaleRow on planar rows (same formula, so the same result).
+ *
+ * @param input  Planes of the input row (R, G, B)
+ * @param output Output row (greyscale)
+ * @param x0     First column
+ * @param x1     One past the last column
+ */
+void ConvertToGreyscalePlanarRow(const unsigned char *const *input, unsigned char *output, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        output[x] = (uint8_t)(0.299 * input[0][x] + 0.587 * input[1][x] + 0.114 * input[2][x]);
+    }
+}
+
+// ==============================================================================================
+// C: Sobel Edge Detection - Detects edges in greyscale image
+// ==============================================================================================
+/**
+ * @brief Applies Sobel edge detection to a greyscale image.
+ *
+ * @param grey  Input greyscale image
+ * @param edges Output edge image of the same size
+ */
+void SobelEdgeDetection(const Image *grey, const Image *edges) {
+    SobelEdgeDetectionRegion(grey, edges, 0, 0, grey->width, grey->height);
+}
+
+/**
+ * @brief SobelEdgeDetection for the pixels x0 ... x1 - 1, y0 ... y1 - 1 only (clipped to the image).
+ *
+ * @param grey   Input greyscale image
+ * @param edges  Output edge image of the same size
+ * @param x0     First column
+ * @param y0     First row
+ * @param x1     One past the last column
+ * @param y1     One past the last row
+ */
+void SobelEdgeDetectionRegion(const Image *grey, const Image *edges, int x0, int y0, int x1, int y1) {
+    int width = grey->width, height = grey->height;
+    clip_region(&x0, &y0, &x1, &y1, width, height);
+
+    // Process each row in the region; the first and last image rows have no row above / below
+    for (int y = y0; y < y1; y++) {
+        const unsigned char *up = y > 0 ? ImageRow(grey, y - 1, 0) : NULL;
+        const unsigned char *dn = y < height - 1 ? ImageRow(grey, y + 1, 0) : NULL;
+        SobelEdgeRow(up, ImageRow(grey, y, 0), dn, ImageRow(edges, y, 0), width, x0, x1);
+    }
+}
+
+/**
+ * @brief SobelEdgeDetection of one row, from row pointers so the rows can live in any buffer.
+ *
+ * @param up    Row above, NULL on the first image row
+ * @param mid   Row being processed
+ * @param dn    Row below, NULL on the last image row
+ * @param edges Output row
+ * @param width Image width
+ * @param x0    First column
+ * @param x1    One past the last column
+ */
+void SobelEdgeRow(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                  unsigned char *edges, int width, int x0, int x1) {
+    int xi0, xi1;
+    interior_columns(up, dn, width, x0, x1, &xi0, &xi1);
+
+    // Set all border pixels to 0 since we can't apply the 3x3 kernel there
+    for (int x = x0; x < (x1 < xi0 ? x1 : xi0); x++) {
+        edges[x] = 0;
+    }
+    for (int x = x0 > xi1 ? x0 : xi1; x < x1; x++) {
+        edges[x] = 0;
+    }
+
+    for (int x = xi0; x < xi1; x++) {
+        // Horizontal and vertical gradients of the 3x3 neighborhood (shared with the Canny stage)
+        int sumX, sumY;
+        SobelGradientRows(up, mid, dn, x, &sumX, &sumY);
+
+        // Compute gradient magnitude
+        int magnitude = (int)(sqrt((double)(sumX * sumX + sumY * sumY)));
+        
+        // Limit the value to the valid range [0, 255] and store in output
+        if (magnitude > 255) {
+            magnitude = 255;
+        }
+        edges[x] = (unsigned char)(magnitude);
+    }
+}
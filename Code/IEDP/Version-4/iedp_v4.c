@@ -0,0 +1,955 @@
+/**
+ * To compile: gcc -O2 -fdiagnostics-color=always iedp_v4.c iedp_stages.c edge_mask.c edge_list.c canny.c conv.c fixed_kernels.c kernels_avx.c dispatch.c autotune.c image.c stencil_pipeline.c temporal.c incremental.c roi.c stage_graph.c parallel.c perf_counters.c -o iedp_v4 -lm -pthread
+ */
+
+/**
+ * @file iedp_v4.c
+ * @brief Image processing pipeline (Linux CLI): Median Filter → Greyscale → Sobel Edge Detection
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For string operations
+
+// ==============================================================================================
+// Single header libraries
+// stb_image.h - https://github.com/nothings/stb/blob/master/stb_image.h
+// stb_image_write.h - https://github.com/nothings/stb/blob/master/stb_image_write.h
+// ==============================================================================================
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h" // Handles image loading
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h" // Handles image saving
+
+// ==============================================================================================
+// Project headers
+// ==============================================================================================
+#include "iedp.h" // Pipeline stages
+#include "perf_counters.h" // Hardware performance counters
+
+// ==============================================================================================
+// Usage
+// ==============================================================================================
+/**
+ * @brief Prints command line usage.
+ *
+ * @param prog Program name (argv[0])
+ */
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <input_image> [<input_image> ...]\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --perf                  Record hardware performance counters per stage (also: IEDP_PERF=1)\n");
+    fprintf(stderr, "  --threshold <N|auto>    Write a 1-bit edge mask (magnitude >= N, 0-255, or Otsu) as PBM\n");
+    fprintf(stderr, "  --edge-list <N|auto>    Write the edge pixels (magnitude >= N) as a sparse binary list\n");
+    fprintf(stderr, "  --direction             Include the gradient direction in the edge list\n");
+    fprintf(stderr, "  --canny <low high|auto> Write Canny edges (thresholds in Sobel magnitude units) as PNG\n");
+    fprintf(stderr, "  --kernel <name|weights> Edge image from a convolution instead of SobelEdgeDetection: sobel, scharr,\n");
+    fprintf(stderr, "                          prewitt, sobel5 (gradient magnitude), sharpen, blur, or 9 / 25 weights\n");
+    fprintf(stderr, "                          \"w0,w1,...[>>shift]\"\n");
+    fprintf(stderr, "  --temporal <3|5>        Inputs are the frames of a static-camera stream: per-pixel median of the\n");
+    fprintf(stderr, "                          last 3 or 5 frames instead of the spatial median filter\n");
+    fprintf(stderr, "  --spatio-temporal <3|5> Temporal median followed by the spatial median filter\n");
+    fprintf(stderr, "  --incremental           Inputs are the frames of a mostly-static stream: recompute only the %dx%d\n",
+            INCREMENTAL_TILE, INCREMENTAL_TILE);
+    fprintf(stderr, "                          tiles that changed since the previous frame\n");
+    fprintf(stderr, "  --outputs <list>        Outputs to compute and write, from filtered,grey,edges (default all);\n");
+    fprintf(stderr, "                          stages only feeding skipped outputs are streamed or skipped\n");
+    fprintf(stderr, "  --roi <x,y,w,h>         Process only this rectangle (repeatable, adds to --roi-mask)\n");
+    fprintf(stderr, "  --roi-mask <file.pbm>   Process only the set pixels of a binary PBM of the image size\n");
+    fprintf(stderr, "  --roi-outside <pass|keep>\n");
+    fprintf(stderr, "                          Outside the ROI: unfiltered input and no edges (default), or left 0\n");
+    fprintf(stderr, "  --pipeline <stages>     Edge image from a user pipeline on the greyscale image, stages separated by\n");
+    fprintf(stderr, "                          ';': invert, threshold <t>, median, erode, dilate, conv <name|weights>,\n");
+    fprintf(stderr, "                          gradient <name>; adjacent stages are fused into one tiled pass\n");
+    fprintf(stderr, "  --pipeline-file <file>  --pipeline with the stages read from a file (one per line, '#' comments)\n");
+    fprintf(stderr, "  --tile <WxH>            Tile of the fused pipeline passes (default: full-width strips of %d rows)\n",
+            STENCIL_TILE_H);
+    fprintf(stderr, "  --no-fuse               Run every pipeline stage as its own full-frame pass\n");
+    fprintf(stderr, "  --verify                Compare the fused pipeline with unfused execution\n");
+    fprintf(stderr, "  --isa <spec>            Kernel instruction sets: auto, scalar, sse2, avx2, avx512, or per stage\n");
+    fprintf(stderr, "                          (median=avx2,sobel=sse2), and planar or interleaved median / greyscale\n");
+    fprintf(stderr, "                          rows; default auto, also: IEDP_ISA=<spec>\n");
+    fprintf(stderr, "  --border <mode>         Outside the image for the median filter and Sobel edges: copy (border\n");
+    fprintf(stderr, "                          pixels unfiltered / no edges, default), replicate, mirror, or a constant\n");
+    fprintf(stderr, "                          0-255\n");
+    fprintf(stderr, "  --threads <N>           Threads for the edge list, Canny, convolution, pipeline and temporal passes\n");
+    fprintf(stderr, "                          (default 1)\n");
+    fprintf(stderr, "  --autotune <WxH>        Benchmark kernel variants, threads, tile and fusion of the pipeline on a\n");
+    fprintf(stderr, "                          WxH frame (default pipeline: %s) and save the fastest to the profile\n",
+            AUTOTUNE_PIPELINE);
+    fprintf(stderr, "  --profile <file|none>   Tuning profile loaded at startup, options override it (default\n");
+    fprintf(stderr, "                          ~/%s, also: IEDP_PROFILE=<file>)\n", TUNE_PROFILE_FILE);
+    fprintf(stderr, "Example: %s --perf input.jpg\n", prog);
+    fprintf(stderr, "         %s --threshold auto input.jpg\n", prog);
+    fprintf(stderr, "         %s --edge-list 64 --direction --threads 4 input.jpg\n", prog);
+    fprintf(stderr, "         %s --canny 40 100 --threads 4 input.jpg\n", prog);
+    fprintf(stderr, "         %s --kernel scharr input.jpg\n", prog);
+    fprintf(stderr, "         %s --temporal 5 frame_000.jpg frame_001.jpg frame_002.jpg ...\n", prog);
+    fprintf(stderr, "         %s --outputs edges input.jpg\n", prog);
+    fprintf(stderr, "         %s --roi 100,50,320,240 --roi-outside keep input.jpg\n", prog);
+    fprintf(stderr, "         %s --incremental frame_000.jpg frame_001.jpg frame_002.jpg ...\n", prog);
+    fprintf(stderr, "         %s --pipeline \"median; gradient sobel; threshold 64; dilate\" --verify input.jpg\n", prog);
+    fprintf(stderr, "         %s --border mirror --outputs edges input.jpg\n", prog);
+    fprintf(stderr, "         %s --autotune 1920x1080\n", prog);
+}
+
+/**
+ * @brief Parses an edge threshold argument.
+ *
+ * @param arg       "auto" or an integer 0 ... 255
+ * @param threshold Parsed threshold, EDGE_THRESHOLD_AUTO for "auto"
+ * @return 1 if valid, 0 otherwise
+ */
+static int parse_threshold(const char *arg, int *threshold) {
+    char *end;
+    long t = strtol(arg, &end, 10);
+    if (strcmp(arg, "auto") == 0) {
+        *threshold = EDGE_THRESHOLD_AUTO;
+        return 1;
+    }
+    if (*arg != '\0' && *end == '\0' && t >= 0 && t <= 255) {
+        *threshold = (int)t;
+        return 1;
+    }
+    fprintf(stderr, "Invalid threshold '%s'\n", arg);
+    return 0;
+}
+
+// ==============================================================================================
+// Pipeline
+// ==============================================================================================
+// Edge output: full uint8 image, bit-packed mask, sparse list, Canny edges or a user stencil pipeline
+typedef enum {
+    EDGE_OUTPUT_IMAGE, EDGE_OUTPUT_MASK, EDGE_OUTPUT_LIST, EDGE_OUTPUT_CANNY, EDGE_OUTPUT_PIPELINE
+} EdgeOutput;
+
+// Most --roi rectangles
+#define ROI_MAX_RECTS 16
+
+/**
+ * @brief Command line settings shared by every frame
+ */
+typedef struct {
+    EdgeOutput edge_output;  // Edge output kind
+    int edge_threshold;      // Mask / list / Canny high threshold: EDGE_THRESHOLD_AUTO = Otsu, otherwise fixed
+    int canny_low;           // Canny low threshold (half the high one with "auto")
+    int edge_direction;      // Include the direction in the edge list
+    int conv_kernels;        // 0 = SobelEdgeDetection, 1 = single kernel, 2 = gradient pair
+    ConvKernel conv_kx;      // Convolution kernel (x gradient)
+    ConvKernel conv_ky;      // Convolution kernel (y gradient)
+    int temporal;            // Temporal median depth (0 = spatial MedianFilter only)
+    int spatial;             // Spatial MedianFilter after the temporal median
+    int incremental;         // Recompute only the tiles that changed since the previous frame
+    int roi_rects[ROI_MAX_RECTS][4]; // --roi rectangles: x, y, width, height
+    int roi_rect_count;      // Number of --roi rectangles
+    const char *roi_mask;    // --roi-mask PBM file, or NULL
+    RoiOutside roi_outside;  // Pixels outside the ROI: passed through or left untouched
+    unsigned outputs;        // STAGE_BIT of each output to write
+    StencilPipeline pipeline; // --pipeline stages
+    int tile_w, tile_h;      // Tile of the fused pipeline passes
+    int fuse;                // Fuse adjacent pipeline stages
+    int verify;              // Compare the fused pipeline with unfused execution
+    const char *isa;         // Kernel variant spec (dispatch.c), NULL for auto
+    BorderMode border;       // What the median and Sobel stencils see outside the image
+    int border_value;        // Constant of BORDER_CONSTANT
+    int threads;             // Worker threads
+} PipelineOptions;
+
+/**
+ * @brief State carried from one frame of a stream to the next
+ */
+typedef struct {
+    FrameRing ring;         // Last frames for the temporal median, allocated on the first frame
+    IncrementalCache cache; // Stage outputs of the previous frame, allocated on the first frame
+} StreamState;
+
+/**
+ * @brief Parses the --outputs list.
+ *
+ * @param arg     Comma-separated list of filtered, grey, edges
+ * @param outputs STAGE_BIT of each listed output
+ * @return 1 if valid, 0 otherwise
+ */
+static int parse_outputs(const char *arg, unsigned *outputs) {
+    static const char *const names[STAGE_COUNT] = { "filtered", "grey", "edges" };
+    *outputs = 0;
+    while (*arg) {
+        size_t len = strcspn(arg, ",");
+        int found = 0;
+        for (int id = 0; id < STAGE_COUNT; id++) {
+            if (strlen(names[id]) == len && strncmp(arg, names[id], len) == 0) {
+                *outputs |= STAGE_BIT(id);
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Invalid output '%.*s' (filtered, grey or edges)\n", (int)len, arg);
+            return 0;
+        }
+        arg += len + (arg[len] == ',');
+    }
+    return *outputs != 0;
+}
+
+/**
+ * @brief Reads the stages of a --pipeline-file.
+ *
+ * @param filename Pipeline file
+ * @param pipeline Pipeline the stages are appended to
+ * @return 1 if valid, 0 otherwise
+ */
+static int load_pipeline_file(const char *filename, StencilPipeline *pipeline) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open pipeline file '%s'\n", filename);
+        return 0;
+    }
+    char text[8192];
+    size_t len = fread(text, 1, sizeof(text) - 1, file);
+    int complete = feof(file) && !ferror(file);
+    fclose(file);
+    if (!complete) {
+        fprintf(stderr, "Failed to read pipeline file '%s' (at most %zu bytes)\n", filename, sizeof(text) - 1);
+        return 0;
+    }
+    text[len] = '\0';
+    return StencilPipelineParse(pipeline, text);
+}
+
+/**
+ * @brief Builds the ROI mask of a frame from the --roi-mask file and the --roi rectangles, and the
+ *        region the median and greyscale stages must cover: the ROI grown by the halo of the edge
+ *        stage's stencil.
+ *
+ * @param opt    Command line settings
+ * @param width  Image width
+ * @param height Image height
+ * @param roi    ROI mask (edge stage region)
+ * @param need   ROI grown by the edge stage halo (median / greyscale region)
+ * @return 1 on success, 0 on failure
+ */
+static int build_roi(const PipelineOptions *opt, int width, int height, RoiMask *roi, RoiMask *need) {
+    if (!RoiInit(roi, width, height)) {
+        return 0;
+    }
+    if (opt->roi_mask && !RoiLoadPBM(roi, opt->roi_mask)) {
+        RoiFree(roi);
+        return 0;
+    }
+    for (int r = 0; r < opt->roi_rect_count; r++) {
+        RoiAddRect(roi, opt->roi_rects[r][0], opt->roi_rects[r][1], opt->roi_rects[r][2], opt->roi_rects[r][3]);
+    }
+
+    // Sobel, the edge mask and the edge list read 3x3 greyscale windows, Canny also compares with the
+    // neighbouring gradients, a convolution reads its kernel size
+    int halo = opt->edge_output == EDGE_OUTPUT_CANNY ? 2 : 1;
+    if (opt->edge_output == EDGE_OUTPUT_IMAGE && opt->conv_kernels) {
+        halo = opt->conv_kx.size / 2;
+    }
+    // A user pipeline reads the halos of all its stages
+    if (opt->edge_output == EDGE_OUTPUT_PIPELINE) {
+        halo = 0;
+        for (int i = 0; i < opt->pipeline.count; i++) {
+            halo += opt->pipeline.stages[i].halo;
+        }
+    }
+    if (!RoiDilate(roi, halo, need)) {
+        RoiFree(roi);
+        return 0;
+    }
+    size_t pixels = (size_t)width * height;
+    printf("ROI: %.1f%% of the image, %.1f%% with the %d-pixel halo\n", 100.0 * RoiCount(roi) / pixels,
+           100.0 * RoiCount(need) / pixels, halo);
+    return 1;
+}
+
+/**
+ * @brief Runs the pipeline on one image and writes its outputs next to the working directory.
+ * 1. Loads an RGB image.
+ * 2. Applies a median filter (spatial, temporal across the frame ring, or both).
+ * 3. Converts to greyscale,
+ * 4. Performs Sobel edge detection.
+ * 5. Outputs all results to files.
+ *
+ * @param infile Input image path
+ * @param opt    Command line settings
+ * @param stream State of the frame sequence (frame ring, incremental cache)
+ * @return 0 on success, 1 on failure
+ */
+static int process_image(const char *infile, const PipelineOptions *opt, StreamState *stream) {
+    char filtered_outfile[256];
+    char grey_outfile[256];
+    char edge_outfile[256];
+    EdgeOutput edge_output = opt->edge_output;
+    int edge_threshold = opt->edge_threshold;
+    int canny_low = opt->canny_low;
+    int threads = opt->threads;
+    FrameRing *ring = &stream->ring;
+    IncrementalCache *cache = &stream->cache;
+
+    // Generate output filenames based on input filename
+    // Find the last dot in the filename to extract the base name
+    const char *last_dot = strrchr(infile, '.');
+    const char *last_slash = strrchr(infile, '/');
+
+    // Figure out the base filename (without directory or extension)
+    const char *base_name;
+    if (last_slash && last_dot > last_slash) {
+        base_name = last_slash + 1;
+    } else if (!last_slash && last_dot) {
+        base_name = infile;
+    } else {
+        base_name = infile;
+    }
+
+    // Length for the base part of the filename (without extension)
+    size_t base_len = last_dot ? (size_t)(last_dot - base_name) : strlen(base_name);
+
+    // Create output filenames
+    snprintf(filtered_outfile, sizeof(filtered_outfile), "%.*s_filtered.jpg", (int)base_len, base_name);
+    snprintf(grey_outfile, sizeof(grey_outfile), "%.*s_greyscale.jpg", (int)base_len, base_name);
+    snprintf(edge_outfile, sizeof(edge_outfile), "%.*s_%s.%s", (int)base_len, base_name,
+             edge_output == EDGE_OUTPUT_PIPELINE ? "pipeline" : "edges",
+             edge_output == EDGE_OUTPUT_IMAGE ? "jpg" : edge_output == EDGE_OUTPUT_MASK ? "pbm" :
+             edge_output == EDGE_OUTPUT_LIST ? "bin" : "png");
+    printf("Processing image: %s\n", infile);
+
+    // Image dimensions
+    int width, height;
+    // color channel count
+    int channels;
+
+    // 1. Load the input image using stb_image library
+    perf_stage_begin(PERF_STAGE_DECODE);
+    unsigned char *img_data = stbi_load(infile, &width, &height, &channels, 3);
+    perf_stage_end(PERF_STAGE_DECODE);
+
+    // Check if image loading was successful
+    if (!img_data) {
+        fprintf(stderr, "Failed to load image '%s'\n", infile);
+        return 1;  // Exit with error code
+    }
+    printf("Loaded image: %dx%d, %d channels\n", width, height, 3);
+
+    // The temporal median needs every frame of the stream at the size of the first one
+    if (opt->temporal && !ring->depth && !FrameRingInit(ring, opt->temporal, width, height, 3)) {
+        fprintf(stderr, "Failed to allocate the frame ring\n");
+        stbi_image_free(img_data);
+        return 1;
+    }
+    if (opt->temporal && (width != ring->frames[0].width || height != ring->frames[0].height)) {
+        fprintf(stderr, "Frame '%s' is %dx%d, the stream is %dx%d\n", infile, width, height,
+                ring->frames[0].width, ring->frames[0].height);
+        stbi_image_free(img_data);
+        return 1;
+    }
+
+    // The incremental cache keeps the stage outputs of the stream and patches them frame by frame
+    if (opt->incremental && !cache->prev_rgb.data && !IncrementalInit(cache, width, height)) {
+        fprintf(stderr, "Failed to allocate the incremental cache\n");
+        stbi_image_free(img_data);
+        return 1;
+    }
+    if (opt->incremental && (width != cache->width || height != cache->height)) {
+        fprintf(stderr, "Frame '%s' is %dx%d, the stream is %dx%d\n", infile, width, height,
+                cache->width, cache->height);
+        stbi_image_free(img_data);
+        return 1;
+    }
+    // Region of interest: the stages cover only the ROI and the halo its edge stencil reaches
+    int use_roi = opt->roi_mask || opt->roi_rect_count;
+    RoiMask roi = { 0 }, need = { 0 };
+    if (use_roi && !build_roi(opt, width, height, &roi, &need)) {
+        stbi_image_free(img_data);
+        return 1;
+    }
+
+    // Outputs asked for on the command line; a stage runs only when a requested output needs it
+    int want_filtered = (opt->outputs & STAGE_BIT(STAGE_FILTERED)) != 0;
+    int want_grey = (opt->outputs & STAGE_BIT(STAGE_GREY)) != 0;
+    int want_edges = (opt->outputs & STAGE_BIT(STAGE_EDGES)) != 0;
+    // The incremental cache must stay complete, so it always runs every cached stage
+    int need_grey = want_grey || want_edges || opt->incremental;
+    // The plain Sobel edge image is computed row by row; the other edge stages read the whole greyscale frame
+    int sobel_rows = edge_output == EDGE_OUTPUT_IMAGE && !opt->conv_kernels;
+    // Without an ROI or the incremental cache the stages run as a demand-driven graph: requested outputs
+    // are full frames, intermediates nobody requested are streamed through a few rows
+    int use_graph = !opt->incremental && !use_roi;
+    int graph_edges = use_graph && want_edges && sobel_rows;
+    // The spatial median runs unless the temporal median replaces it
+    int spatial_median = !opt->temporal || opt->spatial;
+
+    // The cached edge image is the SobelEdgeDetection one; other edge outputs are recomputed in full
+    int cached_edges = opt->incremental && sobel_rows;
+
+    // Allocate memory for each stage of image processing (zeroed: pixels outside an ROI may be left
+    // untouched); the graph and the incremental cache own their own frames
+    // Output of median filter
+    unsigned char *filtered_rgb = opt->incremental ? cache->filtered_rgb.data
+                                : use_graph ? NULL : calloc(width * height * 3, 1);
+    // Output of the temporal median when the spatial filter or the graph reads it
+    unsigned char *temporal_rgb = opt->temporal && (opt->spatial || use_graph) ? malloc(width * height * 3) : NULL;
+    // Output of greyscale conversion
+    unsigned char *grey_image   = opt->incremental ? cache->grey.data
+                                : use_graph || !need_grey ? NULL : calloc(width * height, 1);
+    // Output of Sobel edge detection: uint8 magnitudes, or 1 bit per pixel in edge mask mode
+    // (the edge list allocates its own records)
+    size_t edge_bytes = edge_output == EDGE_OUTPUT_MASK ? (size_t)EDGE_MASK_STRIDE(width) * height
+                      : edge_output == EDGE_OUTPUT_LIST ? 1 : (size_t)width * height;
+    unsigned char *edge_image   = cached_edges ? cache->edges.data
+                                : !want_edges || graph_edges ? NULL : calloc(edge_bytes, 1);
+    EdgeList edge_list = { 0 };
+
+    // Stages the graph keeps as full frames: the requested ones, and the greyscale image when a
+    // whole-frame edge stage reads it
+    StageGraph graph = { 0 };
+    // Widest row kernels the CPU supports (or the --isa ones), fixed-size ones for fixed geometries
+    // (not with a halo window, which the kernels read as a wider frame); the spec was validated in main
+    StageKernels kernels;
+    int fixed = opt->border == BORDER_COPY;
+    StageKernelsSelect(opt->isa, fixed ? width : 0, fixed ? height : 0, &kernels);
+    if (use_graph) {
+        StageKernelsPrint(&kernels, stdout);
+    }
+    unsigned graph_outputs = (want_filtered ? STAGE_BIT(STAGE_FILTERED) : 0) |
+                             (want_grey || (want_edges && !sobel_rows) ? STAGE_BIT(STAGE_GREY) : 0) |
+                             (graph_edges ? STAGE_BIT(STAGE_EDGES) : 0);
+    Image graph_source = ImageWrap(opt->temporal ? temporal_rgb : img_data, width, height, 3);
+    int graph_ok = !use_graph || StageGraphInit(&graph, &graph_source, spatial_median, graph_outputs, &kernels,
+                                                 opt->border, opt->border_value);
+
+    // Check if all memory allocations succeeded
+    if ((!use_graph && !filtered_rgb) || (!use_graph && need_grey && !grey_image) ||
+        (want_edges && !graph_edges && !edge_image) || (opt->temporal && (opt->spatial || use_graph) && !temporal_rgb) ||
+        !graph_ok) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        // Free the original image data
+        stbi_image_free(img_data);
+        // Free processing buffers
+        if (!opt->incremental) {
+            free(filtered_rgb);
+            free(grey_image);
+        }
+        if (!cached_edges) {
+            free(edge_image);
+        }
+        free(temporal_rgb);
+        RoiFree(&roi);
+        RoiFree(&need);
+        // Exit with error code
+        return 1;
+    }
+
+    // Views of the stage buffers for the whole-frame stages (the graph's are set when pulled)
+    Image decoded = ImageWrap(img_data, width, height, 3);
+    Image temporal_view = ImageWrap(temporal_rgb, width, height, 3);
+    Image filtered_view = ImageWrap(filtered_rgb, width, height, 3);
+    Image grey_view = ImageWrap(grey_image, width, height, 1);
+    Image edge_view = ImageWrap(edge_image, width, height, 1);
+
+    // 2. Apply Median Filter to reduce noise in the RGB image
+    perf_stage_begin(PERF_STAGE_MEDIAN);
+    if (opt->temporal) {
+        // The decoded frame goes into the oldest ring slot; the median reads every frame in place
+        ImageCopy(&decoded, FrameRingSlot(ring));
+        FrameRingCommit(ring);
+        TemporalMedianFilter(ring, temporal_rgb ? &temporal_view : &filtered_view, threads);
+    }
+    if (use_graph) {
+        // Only when the filtered image is requested; otherwise it is streamed into the greyscale stage
+        if (want_filtered) {
+            filtered_rgb = StageGraphPull(&graph, STAGE_FILTERED);
+        }
+    } else if (opt->incremental) {
+        // Only the tiles that changed since the previous frame, plus the halo the 3x3 window reaches
+        IncrementalDiff(cache, &decoded);
+        IncrementalMedian(cache);
+    } else if (spatial_median) {
+        RoiMedianFilter(&need, opt->temporal ? &temporal_view : &decoded, &filtered_view, opt->roi_outside);
+    }
+    perf_stage_end(PERF_STAGE_MEDIAN);
+    if (opt->incremental) {
+        size_t tiles = (size_t)cache->tiles_x * cache->tiles_y;
+        printf("Changed tiles: %zu of %zu (%.1f%%)\n", cache->dirty_tiles, tiles,
+               100.0 * cache->dirty_tiles / tiles);
+    }
+
+    // Save the filtered RGB image
+    perf_stage_begin(PERF_STAGE_ENCODE);
+    if (want_filtered) {
+        if (!stbi_write_jpg(filtered_outfile, width, height, 3, filtered_rgb, 90)) {
+            fprintf(stderr, "Failed to write filtered RGB image\n");
+        } else {
+            printf("Filtered RGB image saved to '%s'\n", filtered_outfile);
+        }
+    }
+    perf_stage_end(PERF_STAGE_ENCODE);
+
+    // 3. Convert the filtered RGB image to greyscale
+    perf_stage_begin(PERF_STAGE_GREYSCALE);
+    if (use_graph) {
+        // Only as a full frame when it is requested or a whole-frame edge stage reads it
+        if (graph_outputs & STAGE_BIT(STAGE_GREY)) {
+            grey_image = StageGraphPull(&graph, STAGE_GREY);
+            grey_view = ImageWrap(grey_image, width, height, 1);
+        }
+    } else if (opt->incremental) {
+        IncrementalGreyscale(cache);
+    } else if (need_grey) {
+        RoiConvertToGreyscale(&need, &filtered_view, &grey_view, opt->roi_outside);
+    }
+    perf_stage_end(PERF_STAGE_GREYSCALE);
+
+    // 4. Apply Sobel Edge Detection to detect edges in the greyscale image (or run the user pipeline)
+    PerfStage edge_stage = edge_output == EDGE_OUTPUT_PIPELINE ? PERF_STAGE_PIPELINE : PERF_STAGE_SOBEL;
+    perf_stage_begin(edge_stage);
+    int edge_ok = 1;
+    // With an ROI the whole-image edge stages run on the bounding box of the region they read (the
+    // ROI grown by their halo), the greyscale stage's region
+    int box_x0 = 0, box_y0 = 0, box_x1 = width, box_y1 = height;
+    int roi_empty = use_roi && !RoiBounds(&need, &box_x0, &box_y0, &box_x1, &box_y1);
+    Image grey_box = grey_view, edge_box = edge_view;
+    if (want_edges && use_roi) {
+        grey_box = ImageView(&grey_view, box_x0, box_y0, box_x1 - box_x0, box_y1 - box_y0);
+        edge_box = ImageView(&edge_view, box_x0, box_y0, box_x1 - box_x0, box_y1 - box_y0);
+    }
+    if (want_edges && !roi_empty && edge_output != EDGE_OUTPUT_IMAGE && edge_output != EDGE_OUTPUT_PIPELINE &&
+        edge_threshold == EDGE_THRESHOLD_AUTO) {
+        edge_threshold = AutoEdgeThreshold(&grey_box);
+        canny_low = edge_threshold / 2;
+    }
+    if (cached_edges) {
+        IncrementalSobel(cache);
+    } else if (!want_edges) {
+        // Nothing downstream: the edge stage is skipped
+    } else if (roi_empty) {
+        // Nothing inside the ROI: the (zeroed) edge output stays empty
+    } else if (graph_edges) {
+        edge_image = StageGraphPull(&graph, STAGE_EDGES);
+    } else if (edge_output == EDGE_OUTPUT_IMAGE && opt->conv_kernels == 2) {
+        ConvolveGradient(&grey_box, &edge_box, &opt->conv_kx, &opt->conv_ky, threads);
+    } else if (edge_output == EDGE_OUTPUT_IMAGE && opt->conv_kernels == 1) {
+        Convolve(&grey_box, &edge_box, &opt->conv_kx, threads);
+    } else if (edge_output == EDGE_OUTPUT_IMAGE) {
+        RoiSobelEdgeDetection(&roi, &grey_view, &edge_view, opt->roi_outside);
+    } else if (edge_output == EDGE_OUTPUT_MASK && use_roi) {
+        RoiSobelEdgeMask(&roi, &grey_view, edge_image, edge_threshold);
+    } else if (edge_output == EDGE_OUTPUT_MASK) {
+        SobelEdgeMask(&grey_view, edge_image, edge_threshold);
+    } else if (edge_output == EDGE_OUTPUT_LIST && use_roi) {
+        edge_ok = RoiSobelEdgeList(&roi, &grey_view, edge_threshold, &edge_list);
+    } else if (edge_output == EDGE_OUTPUT_LIST) {
+        edge_ok = SobelEdgeList(&grey_view, edge_threshold, threads, &edge_list);
+    } else if (edge_output == EDGE_OUTPUT_PIPELINE) {
+        StencilSchedule schedule;
+        StencilSchedulePlan(&opt->pipeline, grey_box.width, grey_box.height, opt->tile_w, opt->tile_h, opt->fuse,
+                            &schedule);
+        StencilSchedulePrint(&opt->pipeline, &schedule, stdout);
+        edge_ok = StencilPipelineRun(&opt->pipeline, &schedule, &grey_box, &edge_box, threads);
+        if (edge_ok && opt->verify) {
+            long differ = StencilPipelineVerify(&opt->pipeline, &grey_box, &edge_box, threads);
+            printf("Verify: %ld pixels differ from unfused execution\n", differ);
+            edge_ok = differ == 0;
+        }
+    } else if (use_roi) {
+        // Hysteresis only follows ROI pixels, so edges outside the ROI cannot promote weak pixels inside it
+        edge_ok = CannyEdgeDetectionMasked(&grey_box, &edge_box, canny_low, edge_threshold, threads, &roi,
+                                           box_x0, box_y0);
+    } else {
+        edge_ok = CannyEdgeDetection(&grey_view, &edge_view, canny_low, edge_threshold, threads);
+    }
+    // The convolutions and the user pipeline cover the whole bounding box; keep only their ROI output
+    if (want_edges && use_roi && !roi_empty && (edge_output == EDGE_OUTPUT_PIPELINE || opt->conv_kernels)) {
+        RoiClipImage(&roi, &edge_view);
+    }
+    perf_stage_end(edge_stage);
+
+    // 5. Save the greyscale and edge images to files using stb_image_write
+    perf_stage_begin(PERF_STAGE_ENCODE);
+    if (want_grey) {
+        if (!stbi_write_jpg(grey_outfile, width, height, 1, grey_image, 90)) {
+            fprintf(stderr, "Failed to write greyscale image\n");
+        } else {
+            printf("Greyscale image saved to '%s'\n", grey_outfile);
+        }
+    }
+
+    // Save the edge-detected image to a file
+    if (!want_edges) {
+        // Not requested
+    } else if (edge_output == EDGE_OUTPUT_IMAGE) {
+        if (!stbi_write_jpg(edge_outfile, width, height, 1, edge_image, 90)) {
+            fprintf(stderr, "Failed to write edge image\n");
+        } else {
+            printf("Edge-detected image saved to '%s'\n", edge_outfile);
+        }
+    } else if (edge_output == EDGE_OUTPUT_MASK) {
+        if (!WriteEdgeMaskPBM(edge_outfile, edge_image, width, height)) {
+            fprintf(stderr, "Failed to write edge mask\n");
+        } else {
+            printf("Edge mask (threshold %d, %zu bytes) saved to '%s'\n", edge_threshold, edge_bytes, edge_outfile);
+        }
+    } else if (edge_output == EDGE_OUTPUT_LIST) {
+        if (!edge_ok || !WriteEdgeList(edge_outfile, &edge_list, width, height, opt->edge_direction)) {
+            fprintf(stderr, "Failed to write edge list\n");
+        } else {
+            printf("Edge list (threshold %d, %zu edge pixels, %.2f%% of the image) saved to '%s'\n",
+                   edge_threshold, edge_list.count, 100.0 * edge_list.count / ((double)width * height),
+                   edge_outfile);
+        }
+    } else if (edge_output == EDGE_OUTPUT_PIPELINE) {
+        if (!edge_ok || !stbi_write_png(edge_outfile, width, height, 1, edge_image, width)) {
+            fprintf(stderr, "Failed to write pipeline image\n");
+        } else {
+            printf("Pipeline image saved to '%s'\n", edge_outfile);
+        }
+    } else {
+        if (!edge_ok || !stbi_write_png(edge_outfile, width, height, 1, edge_image, width)) {
+            fprintf(stderr, "Failed to write Canny edge image\n");
+        } else {
+            printf("Canny edges (thresholds %d / %d) saved to '%s'\n", canny_low, edge_threshold, edge_outfile);
+        }
+    }
+    perf_stage_end(PERF_STAGE_ENCODE);
+
+    // Clean up: Free all allocated memory
+    stbi_image_free(img_data);   // Free the original image
+    if (!opt->incremental && !use_graph) {
+        free(filtered_rgb);      // Free the filtered RGB image
+        free(grey_image);        // Free the greyscale image
+    }
+    if (!cached_edges && !graph_edges) {
+        free(edge_image);        // Free the edge-detected image
+    }
+    StageGraphFree(&graph);      // Free the graph frames and rings
+    free(temporal_rgb);          // Free the temporal median image
+    RoiFree(&roi);               // Free the ROI masks
+    RoiFree(&need);
+    FreeEdgeList(&edge_list);    // Free the edge list
+
+    return 0;
+}
+
+/**
+ * @brief Path of the tuning profile: --profile, IEDP_PROFILE or ~/TUNE_PROFILE_FILE. Scanned before the
+ *        other options, which override the profile.
+ *
+ * @param argc  Number of command line arguments
+ * @param argv  Array of command line argument strings
+ * @param buf   Storage for the default path
+ * @param size  Size of buf
+ * @param given Set to 1 when the path was named (--profile, IEDP_PROFILE), 0 for the default
+ * @return Path, or NULL for no profile ("none", or no home directory)
+ */
+static const char *profile_path(int argc, char *argv[], char *buf, size_t size, int *given) {
+    const char *path = getenv("IEDP_PROFILE");
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            path = argv[++i];
+        }
+    }
+    *given = path != NULL;
+    if (!path && getenv("HOME")) {
+        snprintf(buf, size, "%s/%s", getenv("HOME"), TUNE_PROFILE_FILE);
+        path = buf;
+    }
+    return path && strcmp(path, "none") != 0 ? path : NULL;
+}
+
+/**
+ * @brief Loads the tuning profile into the settings. A missing default profile is not an error.
+ *
+ * @param path    Profile path
+ * @param given   The path was named explicitly
+ * @param opt     Settings to update
+ * @param profile Storage for the profile (opt->isa points into it)
+ * @return 1 on success, 0 on failure
+ */
+static int load_profile(const char *path, int given, PipelineOptions *opt, TuneProfile *profile) {
+    int loaded = TuneProfileLoad(path, profile);
+    if (loaded < 0 && given) {
+        fprintf(stderr, "Profile '%s' not found\n", path);
+    }
+    if (loaded <= 0) {
+        return loaded < 0 && !given;
+    }
+    // A profile tuned on another machine may name instruction sets this CPU lacks
+    StageKernels kernels;
+    if (profile->isa[0] && !StageKernelsSelect(profile->isa, 0, 0, &kernels)) {
+        fprintf(stderr, "Profile '%s': ignoring its kernel variants\n", path);
+        profile->isa[0] = '\0';
+    }
+    opt->threads = profile->threads;
+    opt->tile_w = profile->tile_w;
+    opt->tile_h = profile->tile_h;
+    opt->fuse = profile->fuse;
+    opt->isa = profile->isa[0] ? profile->isa : NULL;
+    printf("Profile '%s': ", path);
+    TuneProfilePrint(profile, stdout);
+    return 1;
+}
+
+/**
+ * @brief --autotune: benchmarks the configurations on a synthetic frame and saves the fastest.
+ *
+ * @param path     Profile to write, or NULL to only print the result
+ * @param pipeline --pipeline stages (none: AUTOTUNE_PIPELINE)
+ * @param width    Frame width
+ * @param height   Frame height
+ * @return 0 on success, 1 on failure
+ */
+static int run_autotune(const char *path, const StencilPipeline *pipeline, int width, int height) {
+    StencilPipeline fallback = { 0 };
+    if (pipeline->count == 0) {
+        StencilPipelineParse(&fallback, AUTOTUNE_PIPELINE);
+        pipeline = &fallback;
+    }
+    printf("Autotuning on %dx%d frames\n", width, height);
+    TuneProfile profile;
+    if (!Autotune(width, height, pipeline, &profile, stdout)) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        return 1;
+    }
+    printf("Fastest: ");
+    TuneProfilePrint(&profile, stdout);
+    if (path) {
+        if (!TuneProfileSave(path, &profile)) {
+            return 1;
+        }
+        printf("Profile saved to '%s'\n", path);
+    }
+    return 0;
+}
+
+// ==============================================================================================
+// Main Function
+// ==============================================================================================
+/**
+ * @brief Entry point of the image processing program. Parses the options and runs the pipeline on
+ *        each input image in order; with --temporal the inputs are the frames of one stream.
+ *
+ * @param argc Number of command line arguments
+ * @param argv Array of command line argument strings
+ * @return 0 on success, 1 on failure
+ */
+int main(int argc, char *argv[]) {
+    // Input images, in command line order
+    const char **infiles = calloc((size_t)argc, sizeof(char *));
+    int infile_count = 0;
+
+    // Performance counters are opt-in: command line flag or environment variable
+    const char *perf_env = getenv("IEDP_PERF");
+    int use_perf = perf_env && strcmp(perf_env, "0") != 0;
+
+    PipelineOptions opt = { 0 };
+    opt.edge_output = EDGE_OUTPUT_IMAGE;
+    opt.threads = 1;
+    opt.outputs = STAGE_BIT(STAGE_FILTERED) | STAGE_BIT(STAGE_GREY) | STAGE_BIT(STAGE_EDGES);
+    opt.tile_w = STENCIL_TILE_W;
+    opt.tile_h = STENCIL_TILE_H;
+    opt.fuse = 1;
+
+    if (!infiles) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        return 1;
+    }
+
+    // Tuned settings from the profile, unless this run writes it; IEDP_ISA and the options override them
+    char default_profile[512];
+    int profile_given;
+    const char *profile_file = profile_path(argc, argv, default_profile, sizeof(default_profile), &profile_given);
+    int autotune = 0, autotune_w = 0, autotune_h = 0;
+    for (int i = 1; i < argc; i++) {
+        autotune |= strcmp(argv[i], "--autotune") == 0;
+    }
+    TuneProfile profile;
+    if (!autotune && profile_file && !load_profile(profile_file, profile_given, &opt, &profile)) {
+        free(infiles);
+        return 1;
+    }
+    // Kernel variants: environment variable, overridden by --isa
+    if (getenv("IEDP_ISA")) {
+        opt.isa = getenv("IEDP_ISA");
+    }
+
+    // Process command line arguments
+    int usage_error = 0;
+    for (int i = 1; i < argc && !usage_error; i++) {
+        if (strcmp(argv[i], "--perf") == 0) {
+            use_perf = 1;
+        } else if ((strcmp(argv[i], "--threshold") == 0 || strcmp(argv[i], "--edge-list") == 0) && i + 1 < argc) {
+            opt.edge_output = strcmp(argv[i], "--threshold") == 0 ? EDGE_OUTPUT_MASK : EDGE_OUTPUT_LIST;
+            usage_error = !parse_threshold(argv[++i], &opt.edge_threshold);
+        } else if (strcmp(argv[i], "--canny") == 0 && i + 1 < argc) {
+            opt.edge_output = EDGE_OUTPUT_CANNY;
+            if (strcmp(argv[i + 1], "auto") == 0) {
+                opt.edge_threshold = EDGE_THRESHOLD_AUTO;
+                i++;
+            } else if (i + 2 >= argc || !parse_threshold(argv[i + 1], &opt.canny_low) ||
+                       !parse_threshold(argv[i + 2], &opt.edge_threshold) ||
+                       opt.canny_low == EDGE_THRESHOLD_AUTO || opt.edge_threshold == EDGE_THRESHOLD_AUTO) {
+                usage_error = 1;
+            } else {
+                i += 2;
+            }
+        } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            i++;
+            opt.conv_kernels = ConvKernelPreset(argv[i], &opt.conv_kx, &opt.conv_ky);
+            if (!opt.conv_kernels) {
+                opt.conv_kernels = ConvKernelParse(argv[i], &opt.conv_kx);
+            }
+            if (!opt.conv_kernels) {
+                fprintf(stderr, "Invalid kernel '%s'\n", argv[i]);
+                usage_error = 1;
+            }
+        } else if ((strcmp(argv[i], "--temporal") == 0 || strcmp(argv[i], "--spatio-temporal") == 0) &&
+                   i + 1 < argc) {
+            opt.spatial = strcmp(argv[i], "--spatio-temporal") == 0;
+            opt.temporal = atoi(argv[++i]);
+            if (opt.temporal != 3 && opt.temporal != 5) {
+                fprintf(stderr, "Invalid temporal median depth '%s' (3 or 5)\n", argv[i]);
+                usage_error = 1;
+            }
+        } else if (strcmp(argv[i], "--roi") == 0 && i + 1 < argc) {
+            int *rect = opt.roi_rects[opt.roi_rect_count];
+            char tail;
+            i++;
+            if (opt.roi_rect_count == ROI_MAX_RECTS ||
+                sscanf(argv[i], "%d,%d,%d,%d%c", &rect[0], &rect[1], &rect[2], &rect[3], &tail) != 4 ||
+                rect[2] <= 0 || rect[3] <= 0) {
+                fprintf(stderr, "Invalid ROI '%s' (x,y,width,height, at most %d)\n", argv[i], ROI_MAX_RECTS);
+                usage_error = 1;
+            } else {
+                opt.roi_rect_count++;
+            }
+        } else if (strcmp(argv[i], "--roi-mask") == 0 && i + 1 < argc) {
+            opt.roi_mask = argv[++i];
+        } else if (strcmp(argv[i], "--roi-outside") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "pass") == 0) {
+                opt.roi_outside = ROI_OUTSIDE_PASS;
+            } else if (strcmp(argv[i], "keep") == 0) {
+                opt.roi_outside = ROI_OUTSIDE_KEEP;
+            } else {
+                fprintf(stderr, "Invalid ROI outside mode '%s' (pass or keep)\n", argv[i]);
+                usage_error = 1;
+            }
+        } else if (strcmp(argv[i], "--outputs") == 0 && i + 1 < argc) {
+            usage_error = !parse_outputs(argv[++i], &opt.outputs);
+        } else if ((strcmp(argv[i], "--pipeline") == 0 || strcmp(argv[i], "--pipeline-file") == 0) &&
+                   i + 1 < argc) {
+            opt.edge_output = EDGE_OUTPUT_PIPELINE;
+            usage_error = strcmp(argv[i], "--pipeline") == 0 ? !StencilPipelineParse(&opt.pipeline, argv[i + 1])
+                                                             : !load_pipeline_file(argv[i + 1], &opt.pipeline);
+            i++;
+        } else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc) {
+            char tail;
+            i++;
+            if (sscanf(argv[i], "%dx%d%c", &opt.tile_w, &opt.tile_h, &tail) != 2 || opt.tile_w < 1 || opt.tile_h < 1) {
+                fprintf(stderr, "Invalid tile size '%s' (WxH)\n", argv[i]);
+                usage_error = 1;
+            }
+        } else if (strcmp(argv[i], "--no-fuse") == 0) {
+            opt.fuse = 0;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            opt.verify = 1;
+        } else if (strcmp(argv[i], "--isa") == 0 && i + 1 < argc) {
+            opt.isa = argv[++i];
+        } else if (strcmp(argv[i], "--border") == 0 && i + 1 < argc) {
+            char *end;
+            i++;
+            opt.border_value = (int)strtol(argv[i], &end, 10);
+            if (strcmp(argv[i], "copy") == 0) {
+                opt.border = BORDER_COPY;
+            } else if (strcmp(argv[i], "replicate") == 0) {
+                opt.border = BORDER_REPLICATE;
+            } else if (strcmp(argv[i], "mirror") == 0) {
+                opt.border = BORDER_MIRROR;
+            } else if (*argv[i] != '\0' && *end == '\0' && opt.border_value >= 0 && opt.border_value <= 255) {
+                opt.border = BORDER_CONSTANT;
+            } else {
+                fprintf(stderr, "Invalid border mode '%s' (copy, replicate, mirror or 0-255)\n", argv[i]);
+                usage_error = 1;
+            }
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            i++; // Read by profile_path
+        } else if (strcmp(argv[i], "--autotune") == 0 && i + 1 < argc) {
+            char tail;
+            i++;
+            if (sscanf(argv[i], "%dx%d%c", &autotune_w, &autotune_h, &tail) != 2 || autotune_w < 1 || autotune_h < 1) {
+                fprintf(stderr, "Invalid autotune frame size '%s' (WxH)\n", argv[i]);
+                usage_error = 1;
+            }
+        } else if (strcmp(argv[i], "--incremental") == 0) {
+            opt.incremental = 1;
+        } else if (strcmp(argv[i], "--direction") == 0) {
+            opt.edge_direction = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opt.threads = atoi(argv[++i]);
+            if (opt.threads < 1) {
+                fprintf(stderr, "Invalid thread count '%s'\n", argv[i]);
+                usage_error = 1;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+            usage_error = 1;
+        } else {
+            infiles[infile_count++] = argv[i];
+        }
+    }
+    if (opt.incremental && opt.temporal) {
+        fprintf(stderr, "--incremental cannot be combined with --temporal / --spatio-temporal\n");
+        usage_error = 1;
+    }
+    if (opt.incremental && (opt.roi_mask || opt.roi_rect_count)) {
+        fprintf(stderr, "--incremental cannot be combined with --roi / --roi-mask\n");
+        usage_error = 1;
+    }
+    // The ROI and incremental paths filter regions with the peeled border of BORDER_COPY
+    if (opt.border != BORDER_COPY && (opt.incremental || opt.roi_mask || opt.roi_rect_count)) {
+        fprintf(stderr, "--border cannot be combined with --incremental / --roi / --roi-mask\n");
+        usage_error = 1;
+    }
+    StageKernels kernels;
+    if (!StageKernelsSelect(opt.isa, 0, 0, &kernels)) {
+        usage_error = 1;
+    }
+    if (autotune && infile_count > 0) {
+        fprintf(stderr, "--autotune takes no input images\n");
+        usage_error = 1;
+    }
+    if (usage_error || (infile_count == 0 && !autotune)) {
+        print_usage(argv[0]);
+        free(infiles);
+        return 1;
+    }
+    if (autotune) {
+        free(infiles);
+        return run_autotune(profile_file, &opt.pipeline, autotune_w, autotune_h);
+    }
+    if (use_perf) {
+        perf_init();
+    }
+
+    // Inputs are processed in order as the frames of one stream
+    StreamState stream = { 0 };
+    int status = 0;
+    for (int f = 0; f < infile_count && status == 0; f++) {
+        status = process_image(infiles[f], &opt, &stream);
+    }
+
+    // Print the counters collected for each stage
+    perf_report(stdout);
+    perf_shutdown();
+
+    // Clean up: Free all allocated memory
+    FrameRingFree(&stream.ring);
+    IncrementalFree(&stream.cache);
+    free(infiles);
+
+    return status;
+}
@@ -0,0 +1,247 @@
+/**
+ * @file image.c
+ * @brief Image descriptors: allocation with aligned rows (and optionally a halo around the image),
+ *        wrapping of packed buffers, zero-copy sub-views, and layout conversion between interleaved
+ *        and planar RGB (SSE2).
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For memcpy and memset
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// A: Descriptors
+// ==============================================================================================
+/**
+ * @brief Allocates an image whose first row starts on an IMAGE_ALIGN boundary and whose rows are
+ *        row_align bytes apart: IMAGE_ALIGN to start every row on a cache line, 1 for packed rows
+ *        that the encoders and the whole-frame stages read directly.
+ *
+ * @param image     Image to initialise
+ * @param width     Width in pixels
+ * @param height    Height in pixels
+ * @param channels  Channels per pixel
+ * @param layout    Channel layout
+ * @param row_align Row stride alignment in bytes (a power of two)
+ * @return 1 on success, 0 on failure (image zeroed)
+ */
+int ImageAlloc(Image *image, int width, int height, int channels, ImageLayout layout, size_t row_align) {
+    memset(image, 0, sizeof(*image));
+    if (width <= 0 || height <= 0 || channels <= 0 || row_align == 0) {
+        return 0;
+    }
+    size_t row_bytes = (size_t)width * (layout == IMAGE_PLANAR ? 1 : channels);
+    image->stride = (row_bytes + row_align - 1) & ~(row_align - 1);
+    // Planes start on a boundary as well
+    size_t plane_bytes = (image->stride * height + IMAGE_ALIGN - 1) & ~(size_t)(IMAGE_ALIGN - 1);
+    size_t bytes = layout == IMAGE_PLANAR ? plane_bytes * channels : plane_bytes;
+    image->block = aligned_alloc(IMAGE_ALIGN, bytes);
+    if (!image->block) {
+        return 0;
+    }
+    image->data = image->block;
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->layout = layout;
+    image->plane_stride = layout == IMAGE_PLANAR ? plane_bytes : 0;
+    return 1;
+}
+
+/**
+ * @brief Allocates an interleaved image with halo pixels addressable outside it on every side, for
+ *        stencils that read across the border without testing for it. Row 0, column 0 and every row
+ *        start after it lie on an IMAGE_ALIGN boundary; the halo is not initialised.
+ *
+ * @param image    Image to initialise (data points at pixel 0, 0)
+ * @param width    Width in pixels
+ * @param height   Height in pixels
+ * @param channels Channels per pixel
+ * @param halo     Halo width in pixels
+ * @return 1 on success, 0 on failure (image zeroed)
+ */
+int ImageAllocHalo(Image *image, int width, int height, int channels, int halo) {
+    memset(image, 0, sizeof(*image));
+    if (width <= 0 || height <= 0 || channels <= 0 || halo < 0) {
+        return 0;
+    }
+    size_t left = ((size_t)halo * channels + IMAGE_ALIGN - 1) & ~(size_t)(IMAGE_ALIGN - 1);
+    image->stride = (left + (size_t)(width + halo) * channels + IMAGE_ALIGN - 1) & ~(size_t)(IMAGE_ALIGN - 1);
+    image->block = aligned_alloc(IMAGE_ALIGN, image->stride * (height + 2 * (size_t)halo));
+    if (!image->block) {
+        return 0;
+    }
+    image->data = (unsigned char *)image->block + (size_t)halo * image->stride + left;
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->layout = IMAGE_INTERLEAVED;
+    image->halo = halo;
+    return 1;
+}
+
+/**
+ * @brief Fills the halo pixels left and right of row y of an image from ImageAllocHalo.
+ *
+ * @param image Image
+ * @param y     Row, its pixels already set
+ * @param mode  Border mode (BORDER_COPY fills the constant)
+ * @param value Constant of BORDER_CONSTANT, in every channel
+ */
+void ImageFillRowHalo(const Image *image, int y, BorderMode mode, int value) {
+    unsigned char *row = ImageRow(image, y, 0);
+    int channels = image->channels;
+    for (int k = 1; k <= image->halo; k++) {
+        int xs[2] = { -k, image->width - 1 + k };
+        for (int i = 0; i < 2; i++) {
+            int src = BorderIndex(xs[i], image->width, mode);
+            if (src < 0) {
+                memset(row + xs[i] * channels, value, channels);
+            } else {
+                memcpy(row + xs[i] * channels, row + src * channels, channels);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Describes a packed interleaved buffer (rows width * channels bytes apart) without copying it.
+ *
+ * @param data     Buffer, owned by the caller
+ * @param width    Width in pixels
+ * @param height   Height in pixels
+ * @param channels Channels per pixel
+ * @return Image
+ */
+Image ImageWrap(unsigned char *data, int width, int height, int channels) {
+    Image image = { 0 };
+    image.data = data;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.layout = IMAGE_INTERLEAVED;
+    image.stride = (size_t)width * channels;
+    return image;
+}
+
+/**
+ * @brief Zero-copy view of a rectangle of an image (it must lie inside the image). The view shares
+ *        the pixels and must not outlive the image.
+ *
+ * @param image  Image
+ * @param x      Left column
+ * @param y      Top row
+ * @param width  Width in pixels
+ * @param height Height in pixels
+ * @return View
+ */
+Image ImageView(const Image *image, int x, int y, int width, int height) {
+    Image view = *image;
+    view.data = image->data + (size_t)y * image->stride + (size_t)x * (image->layout == IMAGE_PLANAR ? 1 : image->channels);
+    view.width = width;
+    view.height = height;
+    view.block = NULL;
+    return view;
+}
+
+/**
+ * @brief Frees an allocated image (wrapped buffers and views are left alone).
+ *
+ * @param image Image
+ */
+void ImageFree(Image *image) {
+    free(image->block);
+    memset(image, 0, sizeof(*image));
+}
+
+// ==============================================================================================
+// B: Layout Conversion
+// ==============================================================================================
+/**
+ * @brief Splits count interleaved RGB pixels into three channel rows.
+ *
+ * @param rgb   Interleaved pixels, count * 3 bytes
+ * @param r     Red row
+ * @param g     Green row
+ * @param b     Blue row
+ * @param count Pixels
+ */
+void DeinterleaveRGBRow(const unsigned char *rgb, unsigned char *r, unsigned char *g, unsigned char *b, int count) {
+    int x = 0;
+#if defined(__SSE2__)
+    for (; x + 16 <= count; x += 16) {
+        __m128i vr, vg, vb;
+        DeinterleaveRGB16(rgb + x * 3, &vr, &vg, &vb);
+        _mm_storeu_si128((__m128i *)(r + x), vr);
+        _mm_storeu_si128((__m128i *)(g + x), vg);
+        _mm_storeu_si128((__m128i *)(b + x), vb);
+    }
+#endif
+    for (; x < count; x++) {
+        r[x] = rgb[x * 3];
+        g[x] = rgb[x * 3 + 1];
+        b[x] = rgb[x * 3 + 2];
+    }
+}
+
+/**
+ * @brief Merges three channel rows into count interleaved RGB pixels.
+ *
+ * @param r     Red row
+ * @param g     Green row
+ * @param b     Blue row
+ * @param rgb   Interleaved pixels, count * 3 bytes
+ * @param count Pixels
+ */
+void InterleaveRGBRow(const unsigned char *r, const unsigned char *g, const unsigned char *b, unsigned char *rgb,
+                      int count) {
+    int x = 0;
+#if defined(__SSE2__)
+    for (; x + 16 <= count; x += 16) {
+        InterleaveRGB16(_mm_loadu_si128((const __m128i *)(r + x)), _mm_loadu_si128((const __m128i *)(g + x)),
+                        _mm_loadu_si128((const __m128i *)(b + x)), rgb + x * 3);
+    }
+#endif
+    for (; x < count; x++) {
+        rgb[x * 3] = r[x];
+        rgb[x * 3 + 1] = g[x];
+        rgb[x * 3 + 2] = b[x];
+    }
+}
+
+/**
+ * @brief Copies the pixels of one image into another of the same size and channel count, converting
+ *        between the layouts; strides may differ. The images may not overlap.
+ *
+ * @param src Source image
+ * @param dst Destination image
+ * @return 1 on success, 0 if the sizes or channel counts differ, or a layout change has other than 3
+ *         channels
+ */
+int ImageCopy(const Image *src, const Image *dst) {
+    if (src->width != dst->width || src->height != dst->height || src->channels != dst->channels ||
+        (src->layout != dst->layout && src->channels != 3)) {
+        return 0;
+    }
+    for (int y = 0; y < src->height; y++) {
+        if (src->layout == dst->layout) {
+            int planes = src->layout == IMAGE_PLANAR ? src->channels : 1;
+            size_t row_bytes = (size_t)src->width * (src->layout == IMAGE_PLANAR ? 1 : src->channels);
+            for (int c = 0; c < planes; c++) {
+                memcpy(ImageRow(dst, y, c), ImageRow(src, y, c), row_bytes);
+            }
+        } else if (src->layout == IMAGE_INTERLEAVED) {
+            DeinterleaveRGBRow(ImageRow(src, y, 0), ImageRow(dst, y, 0), ImageRow(dst, y, 1), ImageRow(dst, y, 2),
+                               src->width);
+        } else {
+            InterleaveRGBRow(ImageRow(src, y, 0), ImageRow(src, y, 1), ImageRow(src, y, 2), ImageRow(dst, y, 0),
+                             src->width);
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file incremental.c
+ * @brief Dirty-tile incremental processing for mostly-static frame sequences: the frame is compared
+ *        with the previous one tile by tile, and median, greyscale and Sobel are recomputed only on
+ *        the changed tiles plus the halo their 3x3 windows reach
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For memcpy and memcmp
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Pixels around a changed tile whose median / greyscale output depends on it (3x3 median window)
+#define MEDIAN_HALO 1
+// Pixels around a changed tile whose Sobel output depends on it (median window + Sobel window)
+#define SOBEL_HALO 2
+
+// Region stage run on each run of changed tiles
+typedef void (*RegionFn)(IncrementalCache *cache, int x0, int y0, int x1, int y1);
+
+// ==============================================================================================
+// A: Cache
+// ==============================================================================================
+/**
+ * @brief Allocates the cached stage outputs for width x height frames.
+ *
+ * @param cache  Cache to initialise
+ * @param width  Frame width
+ * @param height Frame height
+ * @return 1 on success, 0 on failure
+ */
+int IncrementalInit(IncrementalCache *cache, int width, int height) {
+    memset(cache, 0, sizeof(*cache));
+    cache->width = width;
+    cache->height = height;
+    cache->tiles_x = (width + INCREMENTAL_TILE - 1) / INCREMENTAL_TILE;
+    cache->tiles_y = (height + INCREMENTAL_TILE - 1) / INCREMENTAL_TILE;
+    // Packed rows: the encoders write the cached frames as they are
+    int ok = ImageAlloc(&cache->prev_rgb, width, height, 3, IMAGE_INTERLEAVED, 1);
+    ok = ok && ImageAlloc(&cache->filtered_rgb, width, height, 3, IMAGE_INTERLEAVED, 1);
+    ok = ok && ImageAlloc(&cache->grey, width, height, 1, IMAGE_INTERLEAVED, 1);
+    ok = ok && ImageAlloc(&cache->edges, width, height, 1, IMAGE_INTERLEAVED, 1);
+    cache->dirty = ok ? calloc((size_t)cache->tiles_x * cache->tiles_y, 1) : NULL;
+    if (!cache->dirty) {
+        IncrementalFree(cache);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Frees the cached stage outputs.
+ *
+ * @param cache Cache from IncrementalInit
+ */
+void IncrementalFree(IncrementalCache *cache) {
+    ImageFree(&cache->prev_rgb);
+    ImageFree(&cache->filtered_rgb);
+    ImageFree(&cache->grey);
+    ImageFree(&cache->edges);
+    free(cache->dirty);
+    memset(cache, 0, sizeof(*cache));
+}
+
+// ==============================================================================================
+// B: Change Detection
+// ==============================================================================================
+/**
+ * @brief Whether two byte spans differ. Stops at the first differing 16-byte block.
+ *
+ * @param a     First span
+ * @param b     Second span
+ * @param bytes Span length
+ * @return 1 if any byte differs, 0 otherwise
+ */
+static int span_differs(const unsigned char *a, const unsigned char *b, size_t bytes) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) {
+            return 1;
+        }
+    }
+#endif
+    return memcmp(a + i, b + i, bytes - i) != 0;
+}
+
+/**
+ * @brief Marks the tiles where rgb differs from the previous frame and copies those tiles into the
+ *        previous frame, which then equals rgb. Every tile is marked on the first frame.
+ *
+ * @param cache Cache from IncrementalInit
+ * @param rgb   New interleaved RGB frame of the cache's size
+ * @return Number of changed tiles
+ */
+size_t IncrementalDiff(IncrementalCache *cache, const Image *rgb) {
+    int width = cache->width;
+    size_t row_bytes = (size_t)width * 3;
+    size_t tile_bytes = (size_t)INCREMENTAL_TILE * 3;
+
+    if (!cache->primed) {
+        ImageCopy(rgb, &cache->prev_rgb);
+        memset(cache->dirty, 1, (size_t)cache->tiles_x * cache->tiles_y);
+        cache->dirty_tiles = (size_t)cache->tiles_x * cache->tiles_y;
+        cache->primed = 1;
+        return cache->dirty_tiles;
+    }
+
+    cache->dirty_tiles = 0;
+    for (int ty = 0; ty < cache->tiles_y; ty++) {
+        unsigned char *dirty = cache->dirty + (size_t)ty * cache->tiles_x;
+        int y0 = ty * INCREMENTAL_TILE;
+        int y1 = y0 + INCREMENTAL_TILE < cache->height ? y0 + INCREMENTAL_TILE : cache->height;
+        memset(dirty, 0, (size_t)cache->tiles_x);
+
+        // Row by row across the tile row, skipping tiles already known to differ
+        for (int y = y0; y < y1; y++) {
+            const unsigned char *now = ImageRow(rgb, y, 0);
+            const unsigned char *prev = ImageRow(&cache->prev_rgb, y, 0);
+            for (int tx = 0; tx < cache->tiles_x; tx++) {
+                size_t offset = (size_t)tx * tile_bytes;
+                size_t bytes = offset + tile_bytes <= row_bytes ? tile_bytes : row_bytes - offset;
+                if (!dirty[tx]) {
+                    dirty[tx] = (unsigned char)span_differs(now + offset, prev + offset, bytes);
+                }
+            }
+        }
+
+        // Bring the previous frame up to date on the changed tiles only
+        for (int tx = 0; tx < cache->tiles_x; tx++) {
+            if (!dirty[tx]) {
+                continue;
+            }
+            cache->dirty_tiles++;
+            size_t offset = (size_t)tx * tile_bytes;
+            size_t bytes = offset + tile_bytes <= row_bytes ? tile_bytes : row_bytes - offset;
+            for (int y = y0; y < y1; y++) {
+                memcpy(ImageRow(&cache->prev_rgb, y, 0) + offset, ImageRow(rgb, y, 0) + offset, bytes);
+            }
+        }
+    }
+    return cache->dirty_tiles;
+}
+
+// ==============================================================================================
+// C: Region Passes
+// ==============================================================================================
+/**
+ * @brief Calls fn on each horizontal run of changed tiles, grown by halo pixels on every side.
+ *
+ * @param cache Cache after IncrementalDiff
+ * @param halo  Pixels added around each run
+ * @param fn    Region stage
+ */
+static void for_each_dirty_run(IncrementalCache *cache, int halo, RegionFn fn) {
+    for (int ty = 0; ty < cache->tiles_y; ty++) {
+        const unsigned char *dirty = cache->dirty + (size_t)ty * cache->tiles_x;
+        for (int tx = 0; tx < cache->tiles_x; tx++) {
+            if (!dirty[tx]) {
+                continue;
+            }
+            int run_end = tx;
+            while (run_end + 1 < cache->tiles_x && dirty[run_end + 1]) {
+                run_end++;
+            }
+            fn(cache, tx * INCREMENTAL_TILE - halo, ty * INCREMENTAL_TILE - halo,
+               (run_end + 1) * INCREMENTAL_TILE + halo, (ty + 1) * INCREMENTAL_TILE + halo);
+            tx = run_end;
+        }
+    }
+}
+
+/**
+ * @brief RegionFn: median filter of the current frame.
+ */
+static void median_region(IncrementalCache *cache, int x0, int y0, int x1, int y1) {
+    MedianFilterRegion(&cache->prev_rgb, &cache->filtered_rgb, x0, y0, x1, y1);
+}
+
+/**
+ * @brief RegionFn: greyscale of the filtered frame.
+ */
+static void greyscale_region(IncrementalCache *cache, int x0, int y0, int x1, int y1) {
+    ConvertToGreyscaleRegion(&cache->filtered_rgb, &cache->grey, x0, y0, x1, y1);
+}
+
+/**
+ * @brief RegionFn: Sobel edges of the greyscale frame.
+ */
+static void sobel_region(IncrementalCache *cache, int x0, int y0, int x1, int y1) {
+    SobelEdgeDetectionRegion(&cache->grey, &cache->edges, x0, y0, x1, y1);
+}
+
+// ==============================================================================================
+// D: Incremental Stages
+// ==============================================================================================
+/**
+ * @brief Patches cache->filtered_rgb: MedianFilter on the changed tiles plus a 1-pixel halo. Call
+ *        after IncrementalDiff.
+ *
+ * @param cache Cache after IncrementalDiff
+ */
+void IncrementalMedian(IncrementalCache *cache) {
+    for_each_dirty_run(cache, MEDIAN_HALO, median_region);
+}
+
+/**
+ * @brief Patches cache->grey: ConvertToGreyscale wherever IncrementalMedian wrote.
+ *
+ * @param cache Cache after IncrementalMedian
+ */
+void IncrementalGreyscale(IncrementalCache *cache) {
+    for_each_dirty_run(cache, MEDIAN_HALO, greyscale_region);
+}
+
+/**
+ * @brief Patches cache->edges: SobelEdgeDetection on the changed tiles plus a 2-pixel halo, which
+ *        covers every pixel whose 3x3 Sobel window saw a new greyscale value. The result equals
+ *        SobelEdgeDetection of the full frame.
+ *
+ * @param cache Cache after IncrementalGreyscale
+ */
+void IncrementalSobel(IncrementalCache *cache) {
+    for_each_dirty_run(cache, SOBEL_HALO, sobel_region);
+}
@@ -0,0 +1,478 @@
+/**
+ * @file kernels_avx.c
+ * @brief AVX2 and AVX-512 variants of the median, greyscale and Sobel row kernels. They are compiled
+ *        with per-function target attributes, so the binary still runs on CPUs without them; the
+ *        dispatcher (dispatch.c) only calls a variant the CPU supports. Bit-identical to the generic
+ *        kernels of iedp_stages.c.
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <string.h> // For memcpy
+#include <math.h> // For sqrt
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // AVX2 / AVX-512 intrinsics
+#endif
+
+#include "iedp.h" // Shared types and stage prototypes
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// ==============================================================================================
+// Constants and Helpers
+// ==============================================================================================
+// Columns of brightness kept per chunk of a median row
+#define AVX_MEDIAN_CHUNK 256
+// Median keys: brightness * 16 + window index (see fixed_kernels.c)
+#define AVX_KEY_SHIFT 4
+
+// 19 compare-exchanges selecting the median of p[0 ... 8] into p[4]
+#define MEDIAN9_NETWORK(SORT2) \
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8); SORT2(0, 1); SORT2(3, 4); SORT2(6, 7); \
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8); SORT2(0, 3); SORT2(5, 8); SORT2(4, 7); \
+    SORT2(3, 6); SORT2(1, 4); SORT2(2, 5); SORT2(4, 7); SORT2(4, 2); SORT2(6, 4); \
+    SORT2(4, 2)
+
+/**
+ * @brief Median of 9 keys.
+ */
+static inline int median9_key(int *p) {
+#define SORT2(a, b) do { int t = p[a] < p[b] ? p[a] : p[b]; p[b] = p[a] < p[b] ? p[b] : p[a]; p[a] = t; } while (0)
+    MEDIAN9_NETWORK(SORT2);
+#undef SORT2
+    return p[4];
+}
+
+/**
+ * @brief Copies the window pixel named by a median key to the output pixel x.
+ */
+static inline void copy_median_pixel(const unsigned char *const *rows, unsigned char *output, int x, int key) {
+    int k = key & ((1 << AVX_KEY_SHIFT) - 1);
+    memcpy(output + x * 3, rows[k / 3] + (x + k % 3 - 1) * 3, 3);
+}
+
+/**
+ * @brief Copies the border pixels of a median row and returns the interior columns xi0 ... xi1 - 1.
+ *
+ * @return 1 if there are interior columns
+ */
+static int median_borders(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                          unsigned char *output, int width, int x0, int x1, int *xi0, int *xi1) {
+    *xi0 = x0 > 1 ? x0 : 1;
+    *xi1 = x1 < width - 1 ? x1 : width - 1;
+    if (!up || !dn || *xi0 >= *xi1) {
+        memcpy(output + x0 * 3, mid + x0 * 3, (size_t)(x1 - x0) * 3);
+        return 0;
+    }
+    if (x0 < *xi0) {
+        memcpy(output + x0 * 3, mid + x0 * 3, 3);
+    }
+    if (*xi1 < x1) {
+        memcpy(output + *xi1 * 3, mid + *xi1 * 3, 3);
+    }
+    return 1;
+}
+
+/**
+ * @brief Copies the border pixels of a planar median row and returns the interior columns xi0 ... xi1 - 1.
+ *
+ * @return 1 if there are interior columns
+ */
+static int planar_median_borders(const unsigned char *const *up, const unsigned char *const *mid,
+                                 const unsigned char *const *dn, unsigned char *const *output, int width, int x0,
+                                 int x1, int *xi0, int *xi1) {
+    *xi0 = x0 > 1 ? x0 : 1;
+    *xi1 = x1 < width - 1 ? x1 : width - 1;
+    for (int c = 0; c < 3; c++) {
+        if (!up || !dn || *xi0 >= *xi1) {
+            memcpy(output[c] + x0, mid[c] + x0, (size_t)(x1 - x0));
+            continue;
+        }
+        if (x0 < *xi0) {
+            output[c][x0] = mid[c][x0];
+        }
+        if (*xi1 < x1) {
+            output[c][*xi1] = mid[c][*xi1];
+        }
+    }
+    return up && dn && *xi0 < *xi1;
+}
+
+/**
+ * @brief Scalar MedianFilterPlanarRow pixel, from its median key.
+ */
+static inline void planar_median_pixel(const unsigned char *const *const *rows, unsigned char *const *output, int x) {
+    int keys[9];
+    for (int k = 0; k < 9; k++) {
+        const unsigned char *const *row = rows[k / 3];
+        int o = x + k % 3 - 1;
+        keys[k] = ((row[0][o] + row[1][o] + row[2][o]) << AVX_KEY_SHIFT) + k;
+    }
+    int k = median9_key(keys) & ((1 << AVX_KEY_SHIFT) - 1);
+    for (int c = 0; c < 3; c++) {
+        output[c][x] = rows[k / 3][c][x + k % 3 - 1];
+    }
+}
+
+/**
+ * @brief Zeroes the border pixels of a Sobel row and returns the interior columns xi0 ... xi1 - 1.
+ *
+ * @return 1 if there are interior columns
+ */
+static int sobel_borders(const unsigned char *up, const unsigned char *dn, unsigned char *edges, int width,
+                         int x0, int x1, int *xi0, int *xi1) {
+    *xi0 = x0 > 1 ? x0 : 1;
+    *xi1 = x1 < width - 1 ? x1 : width - 1;
+    if (!up || !dn || *xi0 >= *xi1) {
+        memset(edges + x0, 0, (size_t)(x1 - x0));
+        return 0;
+    }
+    if (x0 < *xi0) {
+        edges[x0] = 0;
+    }
+    if (*xi1 < x1) {
+        edges[*xi1] = 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Scalar SobelEdgeRow pixel.
+ */
+static inline unsigned char sobel_pixel(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                                        int x) {
+    int gx, gy;
+    SobelGradientRows(up, mid, dn, x, &gx, &gy);
+    int magnitude = (int)(sqrt((double)(gx * gx + gy * gy)));
+    return (unsigned char)(magnitude > 255 ? 255 : magnitude);
+}
+
+// ==============================================================================================
+// A: AVX2
+// ==============================================================================================
+/**
+ * @brief MedianFilterRow with 16 median keys per step.
+ */
+__attribute__((target("avx2")))
+void MedianFilterRowAVX2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                         unsigned char *output, int width, int x0, int x1) {
+    int xi0, xi1;
+    if (!median_borders(up, mid, dn, output, width, x0, x1, &xi0, &xi1)) {
+        return;
+    }
+    const unsigned char *rows[3] = { up, mid, dn };
+    int16_t bright[3][AVX_MEDIAN_CHUNK + 2];
+    for (int c = xi0; c < xi1; c += AVX_MEDIAN_CHUNK) {
+        int n = xi1 - c < AVX_MEDIAN_CHUNK ? xi1 - c : AVX_MEDIAN_CHUNK;
+        // Brightness of columns c - 1 ... c + n
+        for (int r = 0; r < 3; r++) {
+            const unsigned char *p = rows[r] + (c - 1) * 3;
+            for (int i = 0; i < n + 2; i++) {
+                bright[r][i] = (int16_t)(p[i * 3] + p[i * 3 + 1] + p[i * 3 + 2]);
+            }
+        }
+        int i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i p[9];
+            for (int k = 0; k < 9; k++) {
+                __m256i b = _mm256_loadu_si256((const __m256i *)&bright[k / 3][i + k % 3]);
+                p[k] = _mm256_add_epi16(_mm256_slli_epi16(b, AVX_KEY_SHIFT), _mm256_set1_epi16((short)k));
+            }
+#define SORT2(a, b) do { __m256i t = _mm256_min_epi16(p[a], p[b]); p[b] = _mm256_max_epi16(p[a], p[b]); p[a] = t; } while (0)
+            MEDIAN9_NETWORK(SORT2);
+#undef SORT2
+            int16_t keys[16];
+            _mm256_storeu_si256((__m256i *)keys, p[4]);
+            for (int j = 0; j < 16; j++) {
+                copy_median_pixel(rows, output, c + i + j, keys[j]);
+            }
+        }
+        for (; i < n; i++) {
+            int keys[9];
+            for (int k = 0; k < 9; k++) {
+                keys[k] = (bright[k / 3][i + k % 3] << AVX_KEY_SHIFT) + k;
+            }
+            copy_median_pixel(rows, output, c + i, median9_key(keys));
+        }
+    }
+}
+
+/**
+ * @brief Greyscale of 16 pixels given as channel vectors, converted 4 at a time in double precision
+ *        with the same products and additions in the same order as the generic kernel (no FMA), so
+ *        the same result.
+ */
+__attribute__((target("avx2")))
+static inline __m128i grey16_avx2(__m128i r, __m128i g, __m128i b) {
+    const __m256d wr = _mm256_set1_pd(0.299), wg = _mm256_set1_pd(0.587), wb = _mm256_set1_pd(0.114);
+    __m128i grey[4];
+    for (int k = 0; k < 4; k++) {
+        __m256d sum = _mm256_add_pd(_mm256_mul_pd(wr, _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(r))),
+                                    _mm256_mul_pd(wg, _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(g))));
+        sum = _mm256_add_pd(sum, _mm256_mul_pd(wb, _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(b))));
+        grey[k] = _mm256_cvttpd_epi32(sum);
+        r = _mm_srli_si128(r, 4);
+        g = _mm_srli_si128(g, 4);
+        b = _mm_srli_si128(b, 4);
+    }
+    return _mm_packus_epi16(_mm_packs_epi32(grey[0], grey[1]), _mm_packs_epi32(grey[2], grey[3]));
+}
+
+/**
+ * @brief ConvertToGreyscaleRow with 16 pixels per step: the pixels are split into channel vectors
+ *        (DeinterleaveRGB16), then converted by grey16_avx2.
+ */
+__attribute__((target("avx2")))
+void ConvertToGreyscaleRowAVX2(const unsigned char *input, unsigned char *output, int x0, int x1) {
+    int x = x0;
+#if defined(__SSE2__)
+    for (; x + 16 <= x1; x += 16) {
+        __m128i r, g, b;
+        DeinterleaveRGB16(input + x * 3, &r, &g, &b);
+        _mm_storeu_si128((__m128i *)(output + x), grey16_avx2(r, g, b));
+    }
+#endif
+    for (; x < x1; x++) {
+        output[x] = (uint8_t)(0.299 * input[x * 3] + 0.587 * input[x * 3 + 1] + 0.114 * input[x * 3 + 2]);
+    }
+}
+
+/**
+ * @brief MedianFilterPlanarRow with 16 pixels per step. The planes give the brightness without
+ *        gathers, and the median pixel is blended from the window by its key, so the whole step
+ *        stays in vector registers.
+ */
+__attribute__((target("avx2")))
+void MedianFilterPlanarRowAVX2(const unsigned char *const *up, const unsigned char *const *mid,
+                               const unsigned char *const *dn, unsigned char *const *output, int width,
+                               int x0, int x1) {
+    int xi0, xi1;
+    if (!planar_median_borders(up, mid, dn, output, width, x0, x1, &xi0, &xi1)) {
+        return;
+    }
+    const unsigned char *const *rows[3] = { up, mid, dn };
+    int x = xi0;
+    for (; x + 16 <= xi1; x += 16) {
+        __m256i ch[3][9], p[9];
+        for (int k = 0; k < 9; k++) {
+            const unsigned char *const *row = rows[k / 3];
+            int o = x + k % 3 - 1;
+            for (int c = 0; c < 3; c++) {
+                ch[c][k] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(row[c] + o)));
+            }
+            __m256i b = _mm256_add_epi16(_mm256_add_epi16(ch[0][k], ch[1][k]), ch[2][k]);
+            p[k] = _mm256_add_epi16(_mm256_slli_epi16(b, AVX_KEY_SHIFT), _mm256_set1_epi16((short)k));
+        }
+#define SORT2(a, b) do { __m256i t = _mm256_min_epi16(p[a], p[b]); p[b] = _mm256_max_epi16(p[a], p[b]); p[a] = t; } while (0)
+        MEDIAN9_NETWORK(SORT2);
+#undef SORT2
+        __m256i index = _mm256_and_si256(p[4], _mm256_set1_epi16((1 << AVX_KEY_SHIFT) - 1));
+        for (int c = 0; c < 3; c++) {
+            __m256i v = ch[c][0];
+            for (int k = 1; k < 9; k++) {
+                v = _mm256_blendv_epi8(v, ch[c][k], _mm256_cmpeq_epi16(index, _mm256_set1_epi16((short)k)));
+            }
+            // packus works per 128-bit lane; the permute puts the 16 bytes in order
+            __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+            _mm_storeu_si128((__m128i *)(output[c] + x), _mm256_castsi256_si128(bytes));
+        }
+    }
+    for (; x < xi1; x++) {
+        planar_median_pixel(rows, output, x);
+    }
+}
+
+/**
+ * @brief ConvertToGreyscalePlanarRow with 16 pixels per step (grey16_avx2 straight from the planes).
+ */
+__attribute__((target("avx2")))
+void ConvertToGreyscalePlanarRowAVX2(const unsigned char *const *input, unsigned char *output, int x0, int x1) {
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m128i r = _mm_loadu_si128((const __m128i *)(input[0] + x));
+        __m128i g = _mm_loadu_si128((const __m128i *)(input[1] + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(input[2] + x));
+        _mm_storeu_si128((__m128i *)(output + x), grey16_avx2(r, g, b));
+    }
+    for (; x < x1; x++) {
+        output[x] = (uint8_t)(0.299 * input[0][x] + 0.587 * input[1][x] + 0.114 * input[2][x]);
+    }
+}
+
+/**
+ * @brief SobelEdgeRow with 16 pixels per step: 16-bit gradients, single-precision magnitude (exact
+ *        after clamping the sum of squares to 255²).
+ */
+__attribute__((target("avx2")))
+void SobelEdgeRowAVX2(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                      unsigned char *edges, int width, int x0, int x1) {
+    int xi0, xi1;
+    if (!sobel_borders(up, dn, edges, width, x0, x1, &xi0, &xi1)) {
+        return;
+    }
+    const __m256i limit = _mm256_set1_epi32(255 * 255);
+    int x = xi0;
+    for (; x + 16 <= xi1; x += 16) {
+        __m256i u[3], m[3], d[3];
+        for (int i = 0; i < 3; i++) {
+            u[i] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(up + x + i - 1)));
+            m[i] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(mid + x + i - 1)));
+            d[i] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(dn + x + i - 1)));
+        }
+        __m256i gx = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(u[2], d[2]), _mm256_slli_epi16(m[2], 1)),
+                                      _mm256_add_epi16(_mm256_add_epi16(u[0], d[0]), _mm256_slli_epi16(m[0], 1)));
+        __m256i gy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(u[0], u[2]), _mm256_slli_epi16(u[1], 1)),
+                                      _mm256_add_epi16(_mm256_add_epi16(d[0], d[2]), _mm256_slli_epi16(d[1], 1)));
+        __m256i mag[2];
+        for (int h = 0; h < 2; h++) {
+            __m256i x32 = _mm256_cvtepi16_epi32(h ? _mm256_extracti128_si256(gx, 1) : _mm256_castsi256_si128(gx));
+            __m256i y32 = _mm256_cvtepi16_epi32(h ? _mm256_extracti128_si256(gy, 1) : _mm256_castsi256_si128(gy));
+            __m256i sq = _mm256_add_epi32(_mm256_mullo_epi32(x32, x32), _mm256_mullo_epi32(y32, y32));
+            sq = _mm256_min_epi32(sq, limit);
+            mag[h] = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(sq)));
+        }
+        // packs / packus work per 128-bit lane; the permutes put the pixels back in order
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(mag[0], mag[1]), 0xD8);
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128((__m128i *)(edges + x), _mm256_castsi256_si128(bytes));
+    }
+    for (; x < xi1; x++) {
+        edges[x] = sobel_pixel(up, mid, dn, x);
+    }
+}
+
+// ==============================================================================================
+// B: AVX-512 (F + BW)
+// ==============================================================================================
+/**
+ * @brief MedianFilterRow with 32 median keys per step.
+ */
+__attribute__((target("avx512f,avx512bw")))
+void MedianFilterRowAVX512(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                           unsigned char *output, int width, int x0, int x1) {
+    int xi0, xi1;
+    if (!median_borders(up, mid, dn, output, width, x0, x1, &xi0, &xi1)) {
+        return;
+    }
+    const unsigned char *rows[3] = { up, mid, dn };
+    int16_t bright[3][AVX_MEDIAN_CHUNK + 2];
+    for (int c = xi0; c < xi1; c += AVX_MEDIAN_CHUNK) {
+        int n = xi1 - c < AVX_MEDIAN_CHUNK ? xi1 - c : AVX_MEDIAN_CHUNK;
+        // Brightness of columns c - 1 ... c + n
+        for (int r = 0; r < 3; r++) {
+            const unsigned char *p = rows[r] + (c - 1) * 3;
+            for (int i = 0; i < n + 2; i++) {
+                bright[r][i] = (int16_t)(p[i * 3] + p[i * 3 + 1] + p[i * 3 + 2]);
+            }
+        }
+        int i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m512i p[9];
+            for (int k = 0; k < 9; k++) {
+                __m512i b = _mm512_loadu_si512((const void *)&bright[k / 3][i + k % 3]);
+                p[k] = _mm512_add_epi16(_mm512_slli_epi16(b, AVX_KEY_SHIFT), _mm512_set1_epi16((short)k));
+            }
+#define SORT2(a, b) do { __m512i t = _mm512_min_epi16(p[a], p[b]); p[b] = _mm512_max_epi16(p[a], p[b]); p[a] = t; } while (0)
+            MEDIAN9_NETWORK(SORT2);
+#undef SORT2
+            int16_t keys[32];
+            _mm512_storeu_si512((void *)keys, p[4]);
+            for (int j = 0; j < 32; j++) {
+                copy_median_pixel(rows, output, c + i + j, keys[j]);
+            }
+        }
+        for (; i < n; i++) {
+            int keys[9];
+            for (int k = 0; k < 9; k++) {
+                keys[k] = (bright[k / 3][i + k % 3] << AVX_KEY_SHIFT) + k;
+            }
+            copy_median_pixel(rows, output, c + i, median9_key(keys));
+        }
+    }
+}
+
+/**
+ * @brief MedianFilterPlanarRow with 32 pixels per step; the window pixel is picked with mask blends.
+ */
+__attribute__((target("avx512f,avx512bw")))
+void MedianFilterPlanarRowAVX512(const unsigned char *const *up, const unsigned char *const *mid,
+                                 const unsigned char *const *dn, unsigned char *const *output, int width,
+                                 int x0, int x1) {
+    int xi0, xi1;
+    if (!planar_median_borders(up, mid, dn, output, width, x0, x1, &xi0, &xi1)) {
+        return;
+    }
+    const unsigned char *const *rows[3] = { up, mid, dn };
+    int x = xi0;
+    for (; x + 32 <= xi1; x += 32) {
+        __m512i ch[3][9], p[9];
+        for (int k = 0; k < 9; k++) {
+            const unsigned char *const *row = rows[k / 3];
+            int o = x + k % 3 - 1;
+            for (int c = 0; c < 3; c++) {
+                ch[c][k] = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(row[c] + o)));
+            }
+            __m512i b = _mm512_add_epi16(_mm512_add_epi16(ch[0][k], ch[1][k]), ch[2][k]);
+            p[k] = _mm512_add_epi16(_mm512_slli_epi16(b, AVX_KEY_SHIFT), _mm512_set1_epi16((short)k));
+        }
+#define SORT2(a, b) do { __m512i t = _mm512_min_epi16(p[a], p[b]); p[b] = _mm512_max_epi16(p[a], p[b]); p[a] = t; } while (0)
+        MEDIAN9_NETWORK(SORT2);
+#undef SORT2
+        __m512i index = _mm512_and_si512(p[4], _mm512_set1_epi16((1 << AVX_KEY_SHIFT) - 1));
+        __mmask32 select[9];
+        for (int k = 1; k < 9; k++) {
+            select[k] = _mm512_cmpeq_epi16_mask(index, _mm512_set1_epi16((short)k));
+        }
+        for (int c = 0; c < 3; c++) {
+            __m512i v = ch[c][0];
+            for (int k = 1; k < 9; k++) {
+                v = _mm512_mask_blend_epi16(select[k], v, ch[c][k]);
+            }
+            _mm256_storeu_si256((__m256i *)(output[c] + x), _mm512_cvtepi16_epi8(v));
+        }
+    }
+    for (; x < xi1; x++) {
+        planar_median_pixel(rows, output, x);
+    }
+}
+
+/**
+ * @brief SobelEdgeRow with 32 pixels per step.
+ */
+__attribute__((target("avx512f,avx512bw")))
+void SobelEdgeRowAVX512(const unsigned char *up, const unsigned char *mid, const unsigned char *dn,
+                        unsigned char *edges, int width, int x0, int x1) {
+    int xi0, xi1;
+    if (!sobel_borders(up, dn, edges, width, x0, x1, &xi0, &xi1)) {
+        return;
+    }
+    const __m512i limit = _mm512_set1_epi32(255 * 255);
+    int x = xi0;
+    for (; x + 32 <= xi1; x += 32) {
+        __m512i u[3], m[3], d[3];
+        for (int i = 0; i < 3; i++) {
+            u[i] = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(up + x + i - 1)));
+            m[i] = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(mid + x + i - 1)));
+            d[i] = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(dn + x + i - 1)));
+        }
+        __m512i gx = _mm512_sub_epi16(_mm512_add_epi16(_mm512_add_epi16(u[2], d[2]), _mm512_slli_epi16(m[2], 1)),
+                                      _mm512_add_epi16(_mm512_add_epi16(u[0], d[0]), _mm512_slli_epi16(m[0], 1)));
+        __m512i gy = _mm512_sub_epi16(_mm512_add_epi16(_mm512_add_epi16(u[0], u[2]), _mm512_slli_epi16(u[1], 1)),
+                                      _mm512_add_epi16(_mm512_add_epi16(d[0], d[2]), _mm512_slli_epi16(d[1], 1)));
+        for (int h = 0; h < 2; h++) {
+            __m512i x32 = _mm512_cvtepi16_epi32(h ? _mm512_extracti64x4_epi64(gx, 1) : _mm512_castsi512_si256(gx));
+            __m512i y32 = _mm512_cvtepi16_epi32(h ? _mm512_extracti64x4_epi64(gy, 1) : _mm512_castsi512_si256(gy));
+            __m512i sq = _mm512_add_epi32(_mm512_mullo_epi32(x32, x32), _mm512_mullo_epi32(y32, y32));
+            sq = _mm512_min_epi32(sq, limit);
+            __m512i mag = _mm512_cvttps_epi32(_mm512_sqrt_ps(_mm512_cvtepi32_ps(sq)));
+            _mm_storeu_si128((__m128i *)(edges + x + 16 * h), _mm512_cvtepi32_epi8(mag));
+        }
+    }
+    for (; x < xi1; x++) {
+        edges[x] = sobel_pixel(up, mid, dn, x);
+    }
+}
+
+#endif
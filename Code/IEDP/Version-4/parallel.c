@@ -0,0 +1,108 @@
+/**
+ * @file parallel.c
+ * @brief Row-band parallelism for the pipeline stages (POSIX threads)
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdlib.h> // For memory allocation
+#include <pthread.h> // For worker threads
+
+#include "iedp.h" // Shared types and stage prototypes
+#include "perf_counters.h" // Per-thread counters for the worker threads
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+/**
+ * @brief One band of rows handed to a worker thread
+ */
+typedef struct {
+    RowRangeFn fn;  // Work function
+    void *ctx;      // Work context
+    int y0, y1;     // Rows y0 ... y1 - 1
+    int index;      // Worker index, the thread's row in the perf report
+    int perf_stage; // PerfStage to record on the worker thread, or -1
+} RowBand;
+
+// ==============================================================================================
+// A: Worker
+// ==============================================================================================
+/**
+ * @brief Thread entry: runs one band, bracketed by the perf stage if one was given.
+ *
+ * @param arg RowBand to run
+ * @return NULL
+ */
+static void *row_band_worker(void *arg) {
+    RowBand *band = arg;
+    if (band->perf_stage >= 0) {
+        perf_thread_worker(band->index);
+        perf_stage_begin((PerfStage)band->perf_stage);
+    }
+    band->fn(band->ctx, band->y0, band->y1);
+    if (band->perf_stage >= 0) {
+        perf_stage_end((PerfStage)band->perf_stage);
+    }
+    return NULL;
+}
+
+// ==============================================================================================
+// B: Parallel Rows
+// ==============================================================================================
+/**
+ * @brief Splits rows y0 ... y1 - 1 into one contiguous band per thread and calls fn(ctx, band_y0,
+ *        band_y1) for each band. With one thread (or when a thread cannot be started) the band runs on
+ *        the calling thread. Returns when every band is done.
+ *
+ * @param y0         First row
+ * @param y1         One past the last row
+ * @param threads    Number of threads
+ * @param fn         Work function
+ * @param ctx        Work context
+ * @param perf_stage PerfStage the worker threads record (-1: none); the calling thread is not recorded
+ */
+void ParallelRows(int y0, int y1, int threads, RowRangeFn fn, void *ctx, int perf_stage) {
+    int rows = y1 - y0;
+    if (rows <= 0) {
+        return;
+    }
+    if (threads > rows) {
+        threads = rows;
+    }
+    if (threads <= 1) {
+        fn(ctx, y0, y1);
+        return;
+    }
+
+    RowBand *bands = calloc((size_t)threads, sizeof(RowBand));
+    pthread_t *ids = calloc((size_t)threads, sizeof(pthread_t));
+    int *started = calloc((size_t)threads, sizeof(int));
+    if (!bands || !ids || !started) {
+        free(bands);
+        free(ids);
+        free(started);
+        fn(ctx, y0, y1);
+        return;
+    }
+    for (int t = 0; t < threads; t++) {
+        bands[t].fn = fn;
+        bands[t].ctx = ctx;
+        bands[t].y0 = y0 + (int)((long long)rows * t / threads);
+        bands[t].y1 = y0 + (int)((long long)rows * (t + 1) / threads);
+        bands[t].index = t;
+        bands[t].perf_stage = perf_stage;
+        started[t] = pthread_create(&ids[t], NULL, row_band_worker, &bands[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(ids[t], NULL);
+        } else {
+            fn(ctx, bands[t].y0, bands[t].y1);
+        }
+    }
+    free(bands);
+    free(ids);
+    free(started);
+}
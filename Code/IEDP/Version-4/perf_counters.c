@@ -0,0 +1,408 @@
+/**
+ * @file perf_counters.c
+ * @brief Opt-in hardware performance counters (Linux perf_event_open) per pipeline stage and per thread
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#define _GNU_SOURCE // For syscall()
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For string operations
+#include <errno.h> // For errno
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For syscall, read and close
+#include <pthread.h> // For the thread exit hook and the report table lock
+#include <sys/syscall.h> // For __NR_perf_event_open
+#include <linux/perf_event.h> // For perf_event_attr
+
+#include "perf_counters.h"
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Names printed in the report
+static const char *stage_names[PERF_STAGE_COUNT] = { "decode", "median", "greyscale", "sobel", "pipeline", "encode" };
+
+/**
+ * @brief Accumulated counts for one (thread, stage) pair
+ */
+typedef struct {
+    uint64_t values[PERF_EVENT_COUNT]; // Scaled event counts
+    double wall_ms;                    // Wall-clock time in milliseconds
+    unsigned long calls;               // Number of begin/end pairs
+} PerfTotals;
+
+/**
+ * @brief Counter state of a single thread. Freed with its counters when the thread exits; the results go
+ *        to the report row the thread is bound to.
+ */
+typedef struct {
+    int row;                                              // Report row: 0 for the main thread, 1 + worker index
+    int fds[PERF_EVENT_COUNT];                            // One perf fd per event, -1 if unavailable
+    uint64_t start[PERF_STAGE_COUNT][PERF_EVENT_COUNT][3]; // value, time enabled, time running at begin
+    struct timespec start_time[PERF_STAGE_COUNT];         // Wall-clock time at begin
+} PerfThread;
+
+/**
+ * @brief Global counter state
+ */
+static struct {
+    int enabled;                                               // Set by perf_init()
+    int event_ok[PERF_EVENT_COUNT];                            // Event opens; probed by perf_init() only
+    PerfTotals (*rows)[PERF_STAGE_COUNT];                      // Results per report row and stage
+    int row_count;                                             // Allocated entries in rows
+    pthread_mutex_t lock;                                      // Guards rows and row_count
+    pthread_key_t exit_key;                                    // Frees a thread's counters when it exits
+} g_perf = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// Counter state of the calling thread (NULL until its first perf_stage_begin)
+static __thread PerfThread *t_perf = NULL;
+
+// ==============================================================================================
+// Event Setup
+// ==============================================================================================
+/**
+ * @brief Fills a perf_event_attr for one of the recorded events.
+ *
+ * @param event Event to describe
+ * @param attr  Attribute structure to fill
+ */
+static void describe_event(PerfEvent event, struct perf_event_attr *attr) {
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    // Count user space only so perf_event_paranoid <= 2 is enough
+    attr->exclude_kernel = 1;
+    attr->exclude_hv = 1;
+    // Needed to scale counts when the kernel multiplexes counters
+    attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event) {
+        case PERF_EVENT_CYCLES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_EVENT_INSTRUCTIONS:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_EVENT_L1D_MISSES:
+            attr->type = PERF_TYPE_HW_CACHE;
+            attr->config = PERF_COUNT_HW_CACHE_L1D |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_EVENT_LLC_MISSES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PERF_EVENT_BRANCH_MISSES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Opens a counter for the calling thread on any CPU.
+ *
+ * @param event Event to open
+ * @return File descriptor, or -1 on failure (errno is set)
+ */
+static int open_event(PerfEvent event) {
+    struct perf_event_attr attr;
+    describe_event(event, &attr);
+    // pid = 0, cpu = -1: follow the calling thread wherever it runs
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * @brief Reads a counter together with its enabled/running times.
+ *
+ * @param fd  Counter file descriptor
+ * @param out Receives value, time enabled and time running
+ */
+static void read_event(int fd, uint64_t out[3]) {
+    if (fd < 0 || read(fd, out, 3 * sizeof(uint64_t)) != 3 * sizeof(uint64_t)) {
+        out[0] = out[1] = out[2] = 0;
+    }
+}
+
+/**
+ * @brief Closes a thread's counters and frees its state when it exits, so the workers that ParallelRows
+ *        starts on every call do not leak fds. Its results are already in its report row.
+ *
+ * @param arg PerfThread of the exiting thread
+ */
+static void close_thread(void *arg) {
+    PerfThread *thread = arg;
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (thread->fds[e] >= 0) close(thread->fds[e]);
+    }
+    free(thread);
+}
+
+/**
+ * @brief Makes sure report row `row` exists.
+ *
+ * @param row Report row
+ * @return 1 on success, 0 on allocation failure
+ */
+static int reserve_row(int row) {
+    int ok = 1;
+    pthread_mutex_lock(&g_perf.lock);
+    if (row >= g_perf.row_count) {
+        int count = g_perf.row_count ? g_perf.row_count : 8;
+        while (count <= row) count *= 2;
+        PerfTotals (*rows)[PERF_STAGE_COUNT] = realloc(g_perf.rows, (size_t)count * sizeof(*rows));
+        if (rows) {
+            memset(rows + g_perf.row_count, 0, (size_t)(count - g_perf.row_count) * sizeof(*rows));
+            g_perf.rows = rows;
+            g_perf.row_count = count;
+        } else {
+            ok = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_perf.lock);
+    return ok;
+}
+
+/**
+ * @brief Returns the counter state of the calling thread, creating it on first use.
+ *
+ * @param row Report row for a new thread state
+ * @return Thread state, or NULL on allocation failure
+ */
+static PerfThread *current_thread(int row) {
+    if (t_perf) return t_perf;
+    if (!reserve_row(row)) return NULL;
+
+    PerfThread *thread = calloc(1, sizeof(PerfThread));
+    if (!thread) return NULL;
+    thread->row = row;
+
+    // Open the events perf_init() found; the others stay at -1
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        thread->fds[e] = g_perf.event_ok[e] ? open_event((PerfEvent)e) : -1;
+    }
+
+    pthread_setspecific(g_perf.exit_key, thread);
+    t_perf = thread;
+    return thread;
+}
+
+// ==============================================================================================
+// Public Interface
+// ==============================================================================================
+/**
+ * @brief Enables stage instrumentation.
+ *
+ * @return 1 if hardware counters are available, 0 if only wall-clock time will be recorded
+ */
+int perf_init(void) {
+    if (pthread_key_create(&g_perf.exit_key, close_thread) != 0) {
+        fprintf(stderr, "perf: cannot track worker threads, counters disabled\n");
+        return 0;
+    }
+
+    // Probe every event on the calling thread, before any worker starts: event_ok is read-only afterwards,
+    // and problems are reported once, up front
+    int err = 0;
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        int fd = open_event((PerfEvent)e);
+        g_perf.event_ok[e] = fd >= 0;
+        if (fd >= 0) {
+            close(fd);
+        } else if (e == PERF_EVENT_CYCLES) {
+            err = errno;
+        }
+    }
+    g_perf.enabled = 1;
+
+    if (!g_perf.event_ok[PERF_EVENT_CYCLES]) {
+        fprintf(stderr, "perf: hardware counters unavailable (%s), recording wall time only\n", strerror(err));
+        // Permission errors are usually the paranoid setting; ENOENT means no PMU (e.g. inside a VM)
+        if (err == EACCES || err == EPERM) {
+            fprintf(stderr, "perf: check /proc/sys/kernel/perf_event_paranoid (must be <= 2)\n");
+        }
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Reports whether perf_init() has been called.
+ *
+ * @return 1 if enabled, 0 otherwise
+ */
+int perf_enabled(void) {
+    return g_perf.enabled;
+}
+
+/**
+ * @brief Binds the calling thread to the report row of worker `worker` (0 ... threads - 1 of a
+ *        ParallelRows call). Workers with the same index share a row across calls, so the report has one
+ *        row per worker however many threads the stages started. Call before the thread's first
+ *        perf_stage_begin; threads that never call it report on the main row.
+ *
+ * @param worker Worker index
+ */
+void perf_thread_worker(int worker) {
+    if (!g_perf.enabled || t_perf || worker < 0) return;
+    current_thread(1 + worker);
+}
+
+/**
+ * @brief Starts measuring a stage on the calling thread.
+ *
+ * @param stage Stage that is about to run
+ */
+void perf_stage_begin(PerfStage stage) {
+    if (!g_perf.enabled) return;
+    PerfThread *thread = current_thread(0);
+    if (!thread) return;
+
+    clock_gettime(CLOCK_MONOTONIC, &thread->start_time[stage]);
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        read_event(thread->fds[e], thread->start[stage][e]);
+    }
+}
+
+/**
+ * @brief Stops measuring a stage on the calling thread and adds the deltas to its totals.
+ *
+ * @param stage Stage that has just finished
+ */
+void perf_stage_end(PerfStage stage) {
+    if (!g_perf.enabled) return;
+    PerfThread *thread = t_perf;
+    if (!thread) return;
+
+    // Read the counters first so the bookkeeping below is not counted
+    uint64_t now[PERF_EVENT_COUNT][3];
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        read_event(thread->fds[e], now[e]);
+    }
+    struct timespec end_time;
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    uint64_t values[PERF_EVENT_COUNT];
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        uint64_t value = now[e][0] - thread->start[stage][e][0];
+        uint64_t enabled = now[e][1] - thread->start[stage][e][1];
+        uint64_t running = now[e][2] - thread->start[stage][e][2];
+        // Scale up if the counter was multiplexed for part of the interval
+        if (running > 0 && running < enabled) {
+            value = (uint64_t)((double)value * (double)enabled / (double)running);
+        }
+        values[e] = value;
+    }
+
+    // Workers of concurrent ParallelRows calls can share a row
+    pthread_mutex_lock(&g_perf.lock);
+    PerfTotals *totals = &g_perf.rows[thread->row][stage];
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        totals->values[e] += values[e];
+    }
+    totals->wall_ms += (end_time.tv_sec - thread->start_time[stage].tv_sec) * 1000.0 +
+                       (end_time.tv_nsec - thread->start_time[stage].tv_nsec) / 1e6;
+    totals->calls++;
+    pthread_mutex_unlock(&g_perf.lock);
+}
+
+/**
+ * @brief Prints one row of the report.
+ *
+ * @param out    Output stream
+ * @param stage  Stage name
+ * @param thread Thread label
+ * @param t      Totals to print
+ */
+static void print_row(FILE *out, const char *stage, const char *thread, const PerfTotals *t) {
+    fprintf(out, "%-10s %-8s %6lu %10.3f", stage, thread, t->calls, t->wall_ms);
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (g_perf.event_ok[e]) {
+            fprintf(out, " %14llu", (unsigned long long)t->values[e]);
+        } else {
+            fprintf(out, " %14s", "n/a");
+        }
+        // IPC goes right after instructions
+        if (e == PERF_EVENT_INSTRUCTIONS) {
+            if (g_perf.event_ok[PERF_EVENT_CYCLES] && g_perf.event_ok[PERF_EVENT_INSTRUCTIONS] &&
+                t->values[PERF_EVENT_CYCLES] > 0) {
+                fprintf(out, " %6.2f", (double)t->values[PERF_EVENT_INSTRUCTIONS] / t->values[PERF_EVENT_CYCLES]);
+            } else {
+                fprintf(out, " %6s", "n/a");
+            }
+        }
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * @brief Prints the per-stage table of recorded counters, one row for the main thread and one per worker
+ *        index. Call after every worker thread has been joined.
+ *
+ * @param out Output stream
+ */
+void perf_report(FILE *out) {
+    if (!g_perf.enabled) return;
+
+    fprintf(out, "------ Performance Counters ------\n");
+    fprintf(out, "%-10s %-8s %6s %10s %14s %14s %6s %14s %14s %14s\n",
+            "Stage", "Thread", "Calls", "Wall(ms)", "Cycles", "Instructions", "IPC",
+            "L1D-misses", "LLC-misses", "Branch-misses");
+
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) {
+        PerfTotals sum;
+        memset(&sum, 0, sizeof(sum));
+        int active = 0;
+
+        // One row per thread or worker index that ran this stage
+        for (int r = 0; r < g_perf.row_count; r++) {
+            const PerfTotals *totals = &g_perf.rows[r][s];
+            if (totals->calls == 0) continue;
+            char label[16];
+            if (r == 0) {
+                snprintf(label, sizeof(label), "main");
+            } else {
+                snprintf(label, sizeof(label), "w%d", r - 1);
+            }
+            print_row(out, stage_names[s], label, totals);
+
+            for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+                sum.values[e] += totals->values[e];
+            }
+            // Workers run concurrently, so the stage wall time is the slowest row
+            if (totals->wall_ms > sum.wall_ms) sum.wall_ms = totals->wall_ms;
+            sum.calls += totals->calls;
+            active++;
+        }
+
+        // Summary row when the stage ran on more than one thread
+        if (active > 1) {
+            print_row(out, stage_names[s], "all", &sum);
+        }
+    }
+    fprintf(out, "----------------------------------\n");
+}
+
+/**
+ * @brief Closes the calling thread's counters and frees the report. Call after every worker thread has
+ *        been joined (their counters are closed when they exit).
+ */
+void perf_shutdown(void) {
+    if (!g_perf.enabled) return;
+    if (t_perf) close_thread(t_perf);
+    free(g_perf.rows);
+    g_perf.rows = NULL;
+    g_perf.row_count = 0;
+    pthread_setspecific(g_perf.exit_key, NULL);
+    pthread_key_delete(g_perf.exit_key);
+    t_perf = NULL;
+    g_perf.enabled = 0;
+}
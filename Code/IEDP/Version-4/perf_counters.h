@@ -0,0 +1,63 @@
+/**
+ * @file perf_counters.h
+ * @brief Opt-in hardware performance counters (Linux perf_event_open) per pipeline stage and per thread
+ *
+ * Usage:
+ *   perf_init();                         // once, before any stage runs
+ *   perf_stage_begin(PERF_STAGE_MEDIAN); // on the thread that does the work
+ *   MedianFilter(...);
+ *   perf_stage_end(PERF_STAGE_MEDIAN);
+ *   perf_report(stdout);                 // once, after all stages
+ *
+ * When perf_init() has not been called (or counters are unavailable) begin/end only record wall time
+ * or do nothing, so the calls can stay in the code permanently.
+ *
+ * The report has one row for the main thread and one per worker index of ParallelRows (perf_thread_worker),
+ * so workers that ParallelRows starts afresh on every call add to the same rows; a worker's counters are
+ * closed when it exits.
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h> // For FILE
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+/**
+ * @brief Pipeline stages that can be measured
+ */
+typedef enum {
+    PERF_STAGE_DECODE,    // Image loading (stbi_load)
+    PERF_STAGE_MEDIAN,    // MedianFilter
+    PERF_STAGE_GREYSCALE, // ConvertToGreyscale
+    PERF_STAGE_SOBEL,     // SobelEdgeDetection
+    PERF_STAGE_PIPELINE,  // StencilPipelineRun (--pipeline)
+    PERF_STAGE_ENCODE,    // Image saving (stbi_write_*)
+    PERF_STAGE_COUNT
+} PerfStage;
+
+/**
+ * @brief Hardware events recorded for every stage
+ */
+typedef enum {
+    PERF_EVENT_CYCLES,        // CPU cycles
+    PERF_EVENT_INSTRUCTIONS,  // Retired instructions
+    PERF_EVENT_L1D_MISSES,    // L1 data cache read misses
+    PERF_EVENT_LLC_MISSES,    // Last level cache misses
+    PERF_EVENT_BRANCH_MISSES, // Branch mispredictions
+    PERF_EVENT_COUNT
+} PerfEvent;
+
+// ==============================================================================================
+// Functions
+// ==============================================================================================
+int perf_init(void);
+int perf_enabled(void);
+void perf_thread_worker(int worker);
+void perf_stage_begin(PerfStage stage);
+void perf_stage_end(PerfStage stage);
+void perf_report(FILE *out);
+void perf_shutdown(void);
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,477 @@
+/**
+ * @file roi.c
+ * @brief Region-of-interest processing: a 1-bit mask built from rectangles or a PBM file, grown by
+ *        each stage's stencil halo, drives the stages over the runs of set pixels of every row
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For memset and memcpy
+#include <ctype.h> // For isspace
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+/**
+ * @brief Image buffers of the stage being driven over the mask runs
+ */
+typedef struct {
+    const RoiMask *roi;    // Mask (gives the image size)
+    const Image *input;    // Stage input
+    const Image *output;   // Stage output
+    unsigned char *mask;   // Edge mask output (RoiSobelEdgeMask)
+    EdgeList *list;        // Edge list output (RoiSobelEdgeList)
+    int threshold;         // Edge threshold of the edge mask and list
+    int *failed;           // Set when the edge list cannot grow
+} RoiStage;
+
+// Stage work on pixels x0 ... x1 - 1 of row y
+typedef void (*RoiRunFn)(const RoiStage *stage, int x0, int x1, int y);
+
+// ==============================================================================================
+// A: Mask
+// ==============================================================================================
+/**
+ * @brief Allocates an empty mask for a width x height image.
+ *
+ * @param roi    Mask to initialise
+ * @param width  Image width
+ * @param height Image height
+ * @return 1 on success, 0 on failure
+ */
+int RoiInit(RoiMask *roi, int width, int height) {
+    roi->width = width;
+    roi->height = height;
+    roi->stride = EDGE_MASK_STRIDE(width);
+    roi->bits = calloc((size_t)roi->stride * height, 1);
+    return roi->bits != NULL;
+}
+
+/**
+ * @brief Frees a mask.
+ *
+ * @param roi Mask from RoiInit
+ */
+void RoiFree(RoiMask *roi) {
+    free(roi->bits);
+    memset(roi, 0, sizeof(*roi));
+}
+
+/**
+ * @brief Sets pixels x0 ... x1 - 1 of a mask row: partial bytes bit by bit, whole bytes at once.
+ *
+ * @param row Mask row
+ * @param x0  First column
+ * @param x1  One past the last column
+ */
+static void set_span(unsigned char *row, int x0, int x1) {
+    for (; x0 < x1 && (x0 & 7); x0++) {
+        row[x0 >> 3] |= (unsigned char)(0x80u >> (x0 & 7));
+    }
+    if (x1 - x0 >= 8) {
+        memset(row + (x0 >> 3), 0xFF, (size_t)((x1 - x0) >> 3));
+        x0 += (x1 - x0) & ~7;
+    }
+    for (; x0 < x1; x0++) {
+        row[x0 >> 3] |= (unsigned char)(0x80u >> (x0 & 7));
+    }
+}
+
+/**
+ * @brief Adds a rectangle to a mask (clipped to the image).
+ *
+ * @param roi Mask from RoiInit
+ * @param x   Left column
+ * @param y   Top row
+ * @param w   Width
+ * @param h   Height
+ */
+void RoiAddRect(RoiMask *roi, int x, int y, int w, int h) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > roi->width ? roi->width : x + w;
+    int y1 = y + h > roi->height ? roi->height : y + h;
+    for (int row = y0; row < y1; row++) {
+        set_span(roi->bits + (size_t)row * roi->stride, x0, x1);
+    }
+}
+
+/**
+ * @brief Reads the next header number of a PBM file, skipping whitespace and comments.
+ *
+ * @param f File
+ * @return Number, or -1 on error
+ */
+static int pbm_header_int(FILE *f) {
+    int c = fgetc(f);
+    while (c == '#' || isspace(c)) {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = fgetc(f);
+            }
+        }
+        c = fgetc(f);
+    }
+    int value = -1;
+    while (c >= '0' && c <= '9') {
+        value = (value < 0 ? 0 : value * 10) + (c - '0');
+        c = fgetc(f);
+    }
+    return value;
+}
+
+/**
+ * @brief Loads a binary (P4) PBM as the mask, set (black) pixels inside. The file must have the size
+ *        the mask was initialised with; WriteEdgeMaskPBM output can be used directly.
+ *
+ * @param roi      Mask from RoiInit
+ * @param filename PBM file path
+ * @return 1 on success, 0 on failure
+ */
+int RoiLoadPBM(RoiMask *roi, const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Failed to open ROI mask '%s'\n", filename);
+        return 0;
+    }
+    int ok = fgetc(f) == 'P' && fgetc(f) == '4';
+    int width = ok ? pbm_header_int(f) : -1;
+    int height = ok ? pbm_header_int(f) : -1;
+    if (!ok || width < 0 || height < 0) {
+        fprintf(stderr, "ROI mask '%s' is not a binary (P4) PBM\n", filename);
+        fclose(f);
+        return 0;
+    }
+    if (width != roi->width || height != roi->height) {
+        fprintf(stderr, "ROI mask '%s' is %dx%d, the image is %dx%d\n", filename, width, height, roi->width,
+                roi->height);
+        fclose(f);
+        return 0;
+    }
+    // A single whitespace byte ends the header (consumed by pbm_header_int); the rows follow
+    size_t bytes = (size_t)roi->stride * roi->height;
+    ok = fread(roi->bits, 1, bytes, f) == bytes;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "ROI mask '%s' is truncated\n", filename);
+        return 0;
+    }
+    // Clear the padding bits after the last pixel of each row
+    if (roi->width & 7) {
+        unsigned char keep = (unsigned char)(0xFF00u >> (roi->width & 7));
+        for (int y = 0; y < roi->height; y++) {
+            roi->bits[(size_t)y * roi->stride + roi->stride - 1] &= keep;
+        }
+    }
+    return 1;
+}
+
+// ==============================================================================================
+// B: Runs and Dilation
+// ==============================================================================================
+/**
+ * @brief Finds the next run of set pixels of a mask row at or after column x. Clear and full bytes
+ *        are skipped whole, so sparse masks cost little.
+ *
+ * @param row   Mask row
+ * @param width Image width
+ * @param x     First column to look at
+ * @param x0    First column of the run
+ * @param x1    One past the last column of the run
+ * @return 1 if a run was found, 0 otherwise
+ */
+static int next_run(const unsigned char *row, int width, int x, int *x0, int *x1) {
+    while (x < width) {
+        if ((x & 7) == 0 && row[x >> 3] == 0) {
+            x += 8;
+        } else if (row[x >> 3] & (0x80u >> (x & 7))) {
+            break;
+        } else {
+            x++;
+        }
+    }
+    if (x >= width) {
+        return 0;
+    }
+    *x0 = x;
+    while (x < width) {
+        if ((x & 7) == 0 && row[x >> 3] == 0xFF) {
+            x += 8;
+        } else if (row[x >> 3] & (0x80u >> (x & 7))) {
+            x++;
+        } else {
+            break;
+        }
+    }
+    *x1 = x < width ? x : width;
+    return 1;
+}
+
+/**
+ * @brief Grows a mask by radius pixels in every direction (square dilation): the region a stage
+ *        with a (2 * radius + 1)^2 stencil must cover so the mask pixels see correct inputs.
+ *
+ * @param roi    Mask
+ * @param radius Halo in pixels
+ * @param out    Grown mask, initialised here (free with RoiFree)
+ * @return 1 on success, 0 on failure
+ */
+int RoiDilate(const RoiMask *roi, int radius, RoiMask *out) {
+    if (!RoiInit(out, roi->width, roi->height)) {
+        return 0;
+    }
+    for (int y = 0; y < roi->height; y++) {
+        const unsigned char *row = roi->bits + (size_t)y * roi->stride;
+        int x0, x1, x = 0;
+        while (next_run(row, roi->width, x, &x0, &x1)) {
+            int gx0 = x0 - radius < 0 ? 0 : x0 - radius;
+            int gx1 = x1 + radius > roi->width ? roi->width : x1 + radius;
+            for (int gy = y - radius; gy <= y + radius; gy++) {
+                if (gy >= 0 && gy < roi->height) {
+                    set_span(out->bits + (size_t)gy * out->stride, gx0, gx1);
+                }
+            }
+            x = x1;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Number of set pixels of a mask.
+ *
+ * @param roi Mask
+ * @return Pixel count
+ */
+size_t RoiCount(const RoiMask *roi) {
+    size_t count = 0;
+    for (size_t i = 0; i < (size_t)roi->stride * roi->height; i++) {
+        count += (size_t)__builtin_popcount(roi->bits[i]);
+    }
+    return count;
+}
+
+/**
+ * @brief Bounding box of the set pixels of a mask.
+ *
+ * @param roi Mask
+ * @param x0  First column
+ * @param y0  First row
+ * @param x1  One past the last column
+ * @param y1  One past the last row
+ * @return 1 if the mask has set pixels, 0 if it is empty (the box is then 0 x 0)
+ */
+int RoiBounds(const RoiMask *roi, int *x0, int *y0, int *x1, int *y1) {
+    *x0 = roi->width;
+    *y0 = roi->height;
+    *x1 = 0;
+    *y1 = 0;
+    for (int y = 0; y < roi->height; y++) {
+        const unsigned char *row = roi->bits + (size_t)y * roi->stride;
+        int r0, r1, x = 0;
+        while (next_run(row, roi->width, x, &r0, &r1)) {
+            *x0 = r0 < *x0 ? r0 : *x0;
+            *x1 = r1 > *x1 ? r1 : *x1;
+            *y0 = y < *y0 ? y : *y0;
+            *y1 = y + 1;
+            x = r1;
+        }
+    }
+    if (*x1 == 0) {
+        *x0 = *y0 = 0;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Calls inside for every run of set pixels and outside (when given) for every gap, row by row.
+ *
+ * @param stage   Stage buffers and mask
+ * @param inside  Work on set pixels
+ * @param outside Work on clear pixels, or NULL to leave them untouched
+ */
+static void roi_apply(const RoiStage *stage, RoiRunFn inside, RoiRunFn outside) {
+    const RoiMask *roi = stage->roi;
+    for (int y = 0; y < roi->height; y++) {
+        const unsigned char *row = roi->bits + (size_t)y * roi->stride;
+        int x0, x1, x = 0;
+        while (next_run(row, roi->width, x, &x0, &x1)) {
+            if (outside && x0 > x) {
+                outside(stage, x, x0, y);
+            }
+            inside(stage, x0, x1, y);
+            x = x1;
+        }
+        if (outside && x < roi->width) {
+            outside(stage, x, roi->width, y);
+        }
+    }
+}
+
+// ==============================================================================================
+// C: Stage Runs
+// ==============================================================================================
+/**
+ * @brief RoiRunFn: median filter.
+ */
+static void median_run(const RoiStage *stage, int x0, int x1, int y) {
+    MedianFilterRegion(stage->input, stage->output, x0, y, x1, y + 1);
+}
+
+/**
+ * @brief RoiRunFn: RGB input copied to the output (same layout), plane by plane when planar.
+ */
+static void copy_rgb_run(const RoiStage *stage, int x0, int x1, int y) {
+    int planar = stage->input->layout == IMAGE_PLANAR;
+    int bpp = planar ? 1 : 3;
+    for (int c = 0; c < (planar ? 3 : 1); c++) {
+        memcpy(ImageRow(stage->output, y, c) + (size_t)x0 * bpp, ImageRow(stage->input, y, c) + (size_t)x0 * bpp,
+               (size_t)(x1 - x0) * bpp);
+    }
+}
+
+/**
+ * @brief RoiRunFn: greyscale conversion.
+ */
+static void greyscale_run(const RoiStage *stage, int x0, int x1, int y) {
+    ConvertToGreyscaleRegion(stage->input, stage->output, x0, y, x1, y + 1);
+}
+
+/**
+ * @brief RoiRunFn: Sobel edge detection.
+ */
+static void sobel_run(const RoiStage *stage, int x0, int x1, int y) {
+    SobelEdgeDetectionRegion(stage->input, stage->output, x0, y, x1, y + 1);
+}
+
+/**
+ * @brief RoiRunFn: thresholded Sobel into the edge mask.
+ */
+static void edge_mask_run(const RoiStage *stage, int x0, int x1, int y) {
+    SobelEdgeMaskRegion(stage->input, stage->mask, stage->threshold, x0, y, x1, y + 1);
+}
+
+/**
+ * @brief RoiRunFn: Sobel edge pixels appended to the edge list.
+ */
+static void edge_list_run(const RoiStage *stage, int x0, int x1, int y) {
+    if (!*stage->failed && !SobelEdgeListRegion(stage->input, stage->threshold, x0, y, x1, y + 1, stage->list)) {
+        *stage->failed = 1;
+    }
+}
+
+/**
+ * @brief RoiRunFn: output cleared to 0.
+ */
+static void zero_run(const RoiStage *stage, int x0, int x1, int y) {
+    memset(ImageRow(stage->output, y, 0) + x0, 0, (size_t)(x1 - x0));
+}
+
+// ==============================================================================================
+// D: Masked Stages
+// ==============================================================================================
+/**
+ * @brief MedianFilter on the set pixels of a mask. Outside the mask the output is the unfiltered
+ *        input (ROI_OUTSIDE_PASS) or left untouched (ROI_OUTSIDE_KEEP).
+ *
+ * @param roi     Mask, normally the ROI grown by the halo of the later stages
+ * @param input   Input RGB image of the mask's size, interleaved or planar
+ * @param output  Output RGB image of the same size and layout
+ * @param outside RoiOutside
+ */
+void RoiMedianFilter(const RoiMask *roi, const Image *input, const Image *output, int outside) {
+    RoiStage stage = { roi, input, output };
+    roi_apply(&stage, median_run, outside == ROI_OUTSIDE_PASS ? copy_rgb_run : NULL);
+}
+
+/**
+ * @brief ConvertToGreyscale on the set pixels of a mask. Outside the mask the output is the greyscale
+ *        of the input as well (ROI_OUTSIDE_PASS, the input is the passed-through image there) or left
+ *        untouched (ROI_OUTSIDE_KEEP).
+ *
+ * @param roi     Mask
+ * @param input   Input RGB image of the mask's size, interleaved or planar
+ * @param output  Output greyscale image of the same size
+ * @param outside RoiOutside
+ */
+void RoiConvertToGreyscale(const RoiMask *roi, const Image *input, const Image *output, int outside) {
+    RoiStage stage = { roi, input, output };
+    roi_apply(&stage, greyscale_run, outside == ROI_OUTSIDE_PASS ? greyscale_run : NULL);
+}
+
+/**
+ * @brief SobelEdgeDetection on the set pixels of a mask. Outside the mask there are no edges
+ *        (ROI_OUTSIDE_PASS: 0) or the output is left untouched (ROI_OUTSIDE_KEEP). The greyscale
+ *        image must be valid on the mask grown by 1.
+ *
+ * @param roi     Mask
+ * @param grey    Input greyscale image of the mask's size
+ * @param edges   Output edge image of the same size
+ * @param outside RoiOutside
+ */
+void RoiSobelEdgeDetection(const RoiMask *roi, const Image *grey, const Image *edges, int outside) {
+    RoiStage stage = { roi, grey, edges };
+    roi_apply(&stage, sobel_run, outside == ROI_OUTSIDE_PASS ? zero_run : NULL);
+}
+
+/**
+ * @brief SobelEdgeMask on the set pixels of a mask; the other bits of the edge mask are cleared. The
+ *        greyscale image must be valid on the mask grown by 1.
+ *
+ * @param roi       Mask
+ * @param grey      Input greyscale image of the mask's size
+ * @param mask      Output edge mask, EDGE_MASK_STRIDE(width) * height bytes
+ * @param threshold Edge threshold, 0 ... 255
+ */
+void RoiSobelEdgeMask(const RoiMask *roi, const Image *grey, unsigned char *mask, int threshold) {
+    memset(mask, 0, (size_t)roi->stride * roi->height);
+    RoiStage stage = { roi, grey, NULL, mask, NULL, threshold, NULL };
+    roi_apply(&stage, edge_mask_run, NULL);
+}
+
+/**
+ * @brief SobelEdgeList of the set pixels of a mask, sorted by y then x. Runs on the calling thread;
+ *        the greyscale image must be valid on the mask grown by 1.
+ *
+ * @param roi       Mask
+ * @param grey      Input greyscale image of the mask's size, at most 65535 x 65535
+ * @param threshold Edge threshold, 0 ... 255
+ * @param list      Output list, free with FreeEdgeList
+ * @return 1 on success, 0 on failure
+ */
+int RoiSobelEdgeList(const RoiMask *roi, const Image *grey, int threshold, EdgeList *list) {
+    memset(list, 0, sizeof(*list));
+    int failed = 0;
+    RoiStage stage = { roi, grey, NULL, NULL, list, threshold, &failed };
+    roi_apply(&stage, edge_list_run, NULL);
+    return !failed;
+}
+
+// ==============================================================================================
+// E: Clipping Outputs
+// ==============================================================================================
+/**
+ * @brief Clears the pixels of an 8-bit image outside a mask.
+ *
+ * @param roi   Mask
+ * @param image 8-bit image of the mask's size
+ */
+void RoiClipImage(const RoiMask *roi, const Image *image) {
+    RoiStage stage = { roi, NULL, image };
+    for (int y = 0; y < roi->height; y++) {
+        const unsigned char *row = roi->bits + (size_t)y * roi->stride;
+        int x0, x1, x = 0;
+        while (next_run(row, roi->width, x, &x0, &x1)) {
+            zero_run(&stage, x, x0, y);
+            x = x1;
+        }
+        zero_run(&stage, x, roi->width, y);
+    }
+}
@@ -0,0 +1,360 @@
+/**
+ * @file stage_graph.c
+ * @brief Demand-driven stage graph: source → median → greyscale → Sobel. Outputs are pulled row by
+ *        row; a stage runs only when a requested output depends on it, and an intermediate nobody
+ *        requested is kept in a ring of the few rows its consumer's stencil reads instead of a frame.
+ *        Border modes other than BORDER_COPY copy the stencil input rows into a halo-padded window,
+ *        so the median and Sobel kernels compute the border pixels as well. With planar kernels
+ *        (StageKernels.layout) the source rows are split into planes once, and the median and
+ *        greyscale stages work on planar rows.
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <string.h> // For memset
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// Constants
+// ==============================================================================================
+// Input of each stage (-1: the source frame) and the rows of it each output row reads above and below
+static const int stage_input[STAGE_COUNT] = { -1, STAGE_FILTERED, STAGE_GREY };
+static const int stage_halo[STAGE_COUNT] = { 1, 0, 1 };
+static const int stage_channels[STAGE_COUNT] = { 3, 1, 1 };
+
+// ==============================================================================================
+// A: Rows
+// ==============================================================================================
+/**
+ * @brief Row y of a stage output, in its frame or its ring.
+ *
+ * @param graph Graph
+ * @param id    Stage
+ * @param y     Row, already computed and still in the ring
+ * @return Row pointer
+ */
+static unsigned char *stage_row(const StageGraph *graph, int id, int y) {
+    const StageNode *node = &graph->nodes[id];
+    if (node->alias) {
+        return ImageRow(&graph->source, y, 0);
+    }
+    return ImageRow(&node->frame, node->ring_rows ? y % node->ring_rows : y, 0);
+}
+
+/**
+ * @brief Row y of a stage's input, or NULL outside the image (the stages treat that as a border).
+ */
+static const unsigned char *input_row(const StageGraph *graph, int id, int y) {
+    if (y < 0 || y >= graph->source.height) {
+        return NULL;
+    }
+    int input = stage_input[id];
+    return input < 0 ? ImageRow(&graph->source, y, 0) : stage_row(graph, input, y);
+}
+
+/**
+ * @brief The three planes of row y of a planar image.
+ */
+static void plane_row(const Image *image, int y, unsigned char **planes) {
+    for (int c = 0; c < 3; c++) {
+        planes[c] = ImageRow(image, y, c);
+    }
+}
+
+/**
+ * @brief Source row y split into planes (kept for the next two rows), or NULL outside the image.
+ *
+ * @param graph Planar graph
+ * @param y     Row
+ * @param rows  The planes of the row
+ * @return rows, or NULL outside the image
+ */
+static const unsigned char *const *source_planes(StageGraph *graph, int y, unsigned char **rows) {
+    if (y < 0 || y >= graph->source.height) {
+        return NULL;
+    }
+    int slot = y % 3;
+    plane_row(&graph->planes, slot, rows);
+    if (graph->plane_rows[slot] != y) {
+        DeinterleaveRGBRow(ImageRow(&graph->source, y, 0), rows[0], rows[1], rows[2], graph->source.width);
+        graph->plane_rows[slot] = y;
+    }
+    return (const unsigned char *const *)rows;
+}
+
+/**
+ * @brief Computes row r of a stage of a planar graph: the median from the source planes (and into
+ *        its interleaved frame when requested), the greyscale from the median planes.
+ *
+ * @param graph Planar graph
+ * @param id    STAGE_FILTERED or STAGE_GREY
+ * @param r     Row
+ */
+static void planar_row(StageGraph *graph, int id, int r) {
+    StageNode *node = &graph->nodes[id];
+    const StageNode *filtered = &graph->nodes[STAGE_FILTERED];
+    int width = graph->source.width;
+    unsigned char *rows[4][3];
+    plane_row(&filtered->frame, r % filtered->ring_rows, rows[3]);
+    if (id == STAGE_GREY && filtered->packed.data) {
+        graph->kernels->grey_row(ImageRow(&filtered->packed, r, 0), stage_row(graph, id, r), 0, width);
+        return;
+    }
+    if (id == STAGE_GREY) {
+        graph->kernels->grey_planar_row((const unsigned char *const *)rows[3], stage_row(graph, id, r), 0, width);
+        return;
+    }
+    const unsigned char *const *up = source_planes(graph, r - 1, rows[0]);
+    const unsigned char *const *mid = source_planes(graph, r, rows[1]);
+    const unsigned char *const *dn = source_planes(graph, r + 1, rows[2]);
+    graph->kernels->median_planar_row(up, mid, dn, rows[3], width, 0, width);
+    if (node->packed.data) {
+        InterleaveRGBRow(rows[3][0], rows[3][1], rows[3][2], ImageRow(&node->packed, r, 0), width);
+    }
+}
+
+/**
+ * @brief Input row y (-1 ... height, mapped by the border mode) of a stencil stage in its halo window,
+ *        copied there and its halo filled unless it already is.
+ *
+ * @param graph Graph
+ * @param id    Stencil stage
+ * @param y     Row
+ * @return Window row
+ */
+static const unsigned char *window_row(StageGraph *graph, int id, int y) {
+    StageNode *node = &graph->nodes[id];
+    int slot = (y + 3) % 3;
+    unsigned char *row = ImageRow(&node->window, slot, 0);
+    if (node->window_rows[slot] != y) {
+        int src = BorderIndex(y, graph->source.height, graph->border);
+        size_t bytes = (size_t)graph->source.width * node->window.channels;
+        if (src < 0) {
+            memset(row, graph->border_value, bytes);
+        } else {
+            memcpy(row, input_row(graph, id, src), bytes);
+        }
+        ImageFillRowHalo(&node->window, slot, graph->border, graph->border_value);
+        node->window_rows[slot] = y;
+    }
+    return row;
+}
+
+/**
+ * @brief Computes row r of a stencil stage from its halo window: the interior columns straight into
+ *        the output, the first and last through the scratch row with the window shifted one pixel to
+ *        the left, so the kernels see the halo as an image column and compute them as interior pixels.
+ *
+ * @param graph Graph
+ * @param id    STAGE_FILTERED or STAGE_EDGES
+ * @param r     Row
+ * @param out   Output row
+ */
+static void stencil_row(StageGraph *graph, int id, int r, unsigned char *out) {
+    StageNode *node = &graph->nodes[id];
+    int width = graph->source.width;
+    int in = node->window.channels;
+    int ch = stage_channels[id];
+    const unsigned char *up = window_row(graph, id, r - 1);
+    const unsigned char *mid = window_row(graph, id, r);
+    const unsigned char *dn = window_row(graph, id, r + 1);
+    // Spans the halo as well: column x of the shifted window is scratch + x * ch
+    unsigned char *scratch = ImageRow(&node->window, 3, 0) - in;
+    int cols[2] = { 0, width - 1 };
+    for (int i = 0; i < (width > 1 ? 2 : 1); i++) {
+        int x = cols[i] + 1;
+        if (id == STAGE_FILTERED) {
+            graph->kernels->median_row(up - in, mid - in, dn - in, scratch, width + 2, x, x + 1);
+        } else {
+            graph->kernels->sobel_row(up - in, mid - in, dn - in, scratch, width + 2, x, x + 1);
+        }
+        memcpy(out + cols[i] * ch, scratch + x * ch, ch);
+    }
+    if (width <= 2) {
+        return;
+    }
+    if (id == STAGE_FILTERED) {
+        graph->kernels->median_row(up, mid, dn, out, width, 1, width - 1);
+    } else {
+        graph->kernels->sobel_row(up, mid, dn, out, width, 1, width - 1);
+    }
+}
+
+/**
+ * @brief Computes the rows of a stage up to and including row y, first pulling the input rows their
+ *        stencil reads.
+ *
+ * @param graph Graph
+ * @param id    Stage
+ * @param y     Last row wanted
+ */
+static void pull_rows(StageGraph *graph, int id, int y) {
+    StageNode *node = &graph->nodes[id];
+    int width = graph->source.width;
+    int height = graph->source.height;
+    if (node->alias) {
+        node->next_row = height;
+        return;
+    }
+    for (int r = node->next_row; r <= y; r++) {
+        int input = stage_input[id];
+        if (input >= 0) {
+            int last = r + stage_halo[id];
+            pull_rows(graph, input, last < height ? last : height - 1);
+        }
+        if (node->window.data) {
+            stencil_row(graph, id, r, stage_row(graph, id, r));
+            continue;
+        }
+        if (graph->planar && id != STAGE_EDGES) {
+            planar_row(graph, id, r);
+            continue;
+        }
+        const unsigned char *up = input_row(graph, id, r - 1);
+        const unsigned char *mid = input_row(graph, id, r);
+        const unsigned char *dn = input_row(graph, id, r + 1);
+        unsigned char *out = stage_row(graph, id, r);
+        if (id == STAGE_FILTERED) {
+            graph->kernels->median_row(up, mid, dn, out, width, 0, width);
+        } else if (id == STAGE_GREY) {
+            graph->kernels->grey_row(mid, out, 0, width);
+        } else {
+            graph->kernels->sobel_row(up, mid, dn, out, width, 0, width);
+        }
+    }
+    if (y + 1 > node->next_row) {
+        node->next_row = y + 1;
+    }
+}
+
+// ==============================================================================================
+// B: Graph
+// ==============================================================================================
+/**
+ * @brief Sets up the graph for the outputs a caller will pull. The requested stages get a full frame;
+ *        the stages they depend on get a ring of rows (2 * halo + 1 of their consumer); the others are
+ *        not allocated and never run.
+ *
+ * @param graph        Graph to initialise
+ * @param source       Interleaved RGB source frame (decoded image or temporal median) or a view of one,
+ *                     read when rows are pulled
+ * @param median       Run the median filter (0: the filtered output is the source itself)
+ * @param outputs      STAGE_BIT of every stage that will be pulled
+ * @param kernels      Row kernels (StageKernelsFind, or NULL for the generic ones); not fixed-geometry
+ *                     ones unless the border mode is BORDER_COPY
+ * @param border       What the median and Sobel stencils see outside the image
+ * @param border_value Value of BORDER_CONSTANT (0 ... 255)
+ * @return 1 on success, 0 on failure
+ */
+int StageGraphInit(StageGraph *graph, const Image *source, int median, unsigned outputs,
+                   const StageKernels *kernels, BorderMode border, int border_value) {
+    memset(graph, 0, sizeof(*graph));
+    if (source->layout != IMAGE_INTERLEAVED || source->channels != 3) {
+        return 0;
+    }
+    graph->source = *source;
+    graph->kernels = kernels ? kernels : StageKernelsGeneric();
+    graph->border = border;
+    graph->border_value = border_value;
+    // Planar rows need the border copied (no halo windows) and a median to run them through
+    graph->planar = graph->kernels->layout == IMAGE_PLANAR && border == BORDER_COPY && median &&
+                    graph->kernels->median_planar_row && graph->kernels->grey_planar_row;
+
+    // Walk back from the last stage: a stage is active when it is requested or an active stage reads it
+    for (int id = STAGE_COUNT - 1; id >= 0; id--) {
+        StageNode *node = &graph->nodes[id];
+        node->active = node->active || (outputs & STAGE_BIT(id)) != 0;
+        node->stored = (outputs & STAGE_BIT(id)) != 0;
+        if (!node->active) {
+            continue;
+        }
+        if (stage_input[id] >= 0) {
+            StageNode *input = &graph->nodes[stage_input[id]];
+            int rows = 2 * stage_halo[id] + 1;
+            input->active = 1;
+            input->ring_rows = rows > input->ring_rows ? rows : input->ring_rows;
+        }
+    }
+
+    for (int id = 0; id < STAGE_COUNT; id++) {
+        StageNode *node = &graph->nodes[id];
+        node->alias = id == STAGE_FILTERED && !median;
+        if (!node->active || node->alias) {
+            continue;
+        }
+        if (node->stored) {
+            node->ring_rows = 0;
+        }
+        if (graph->planar && id == STAGE_FILTERED) {
+            // Planar ring of the rows the greyscale reads; a requested frame is interleaved for the
+            // encoders, and the greyscale reads that (pulled first, the median runs ahead of it)
+            node->ring_rows = node->ring_rows ? node->ring_rows : 1;
+            if (!ImageAlloc(&node->frame, source->width, node->ring_rows, 3, IMAGE_PLANAR, IMAGE_ALIGN) ||
+                (node->stored && !ImageAlloc(&node->packed, source->width, source->height, 3,
+                                             IMAGE_INTERLEAVED, 1)) ||
+                !ImageAlloc(&graph->planes, source->width, 3, 3, IMAGE_PLANAR, IMAGE_ALIGN)) {
+                StageGraphFree(graph);
+                return 0;
+            }
+            graph->plane_rows[0] = graph->plane_rows[1] = graph->plane_rows[2] = -1;
+            continue;
+        }
+        // Requested frames are packed for the encoders and whole-frame stages; ring rows start on
+        // cache lines
+        int rows = node->ring_rows ? node->ring_rows : source->height;
+        if (!ImageAlloc(&node->frame, source->width, rows, stage_channels[id], IMAGE_INTERLEAVED,
+                        node->ring_rows ? IMAGE_ALIGN : 1)) {
+            StageGraphFree(graph);
+            return 0;
+        }
+        // Three input rows of the stencil and a scratch row, one pixel of halo each
+        if (border != BORDER_COPY && stage_halo[id]) {
+            int input = stage_input[id];
+            if (!ImageAllocHalo(&node->window, source->width, 4, input < 0 ? 3 : stage_channels[input], 1)) {
+                StageGraphFree(graph);
+                return 0;
+            }
+            node->window_rows[0] = node->window_rows[1] = node->window_rows[2] = -2;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Computes a requested stage over the whole frame (and, row by row, every stage it depends on
+ *        that has not run yet).
+ *
+ * @param graph Graph from StageGraphInit
+ * @param id    Stage requested in StageGraphInit
+ * @return Full frame of the stage (packed rows; the source's rows for an unfiltered output), owned by
+ *         the graph; NULL if the stage was not requested
+ */
+unsigned char *StageGraphPull(StageGraph *graph, StageId id) {
+    StageNode *node = &graph->nodes[id];
+    if (!node->stored || graph->source.height <= 0) {
+        return NULL;
+    }
+    pull_rows(graph, id, graph->source.height - 1);
+    if (node->alias) {
+        return graph->source.data;
+    }
+    return node->packed.data ? node->packed.data : node->frame.data;
+}
+
+/**
+ * @brief Frees the frames, rings and halo windows of a graph.
+ *
+ * @param graph Graph from StageGraphInit
+ */
+void StageGraphFree(StageGraph *graph) {
+    for (int id = 0; id < STAGE_COUNT; id++) {
+        ImageFree(&graph->nodes[id].frame);
+        ImageFree(&graph->nodes[id].window);
+        ImageFree(&graph->nodes[id].packed);
+    }
+    ImageFree(&graph->planes);
+    memset(graph, 0, sizeof(*graph));
+}
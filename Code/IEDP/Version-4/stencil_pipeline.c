@@ -0,0 +1,564 @@
+/**
+ * @file stencil_pipeline.c
+ * @brief User-defined pipelines of pointwise and 3x3 / 5x5 stencil stages on a greyscale image, with a
+ *        scheduler that fuses adjacent stages into tiled loops: each tile runs every stage of a fused
+ *        group in a small buffer, over the tile grown by the halo the later stages still need
+ *
+ * Pipeline text: one stage per line or ';'-separated, '#' starts a comment
+ *   invert                 255 - v
+ *   threshold <t>          255 if v >= t, else 0
+ *   median                 3x3 median
+ *   erode / dilate         3x3 minimum / maximum
+ *   conv <preset|weights>  3x3 / 5x5 kernel, clamp(sum >> shift, 0, 255) (ConvKernelPreset / ConvKernelParse)
+ *   gradient <preset>      Gradient magnitude of a kernel pair (sobel, scharr, prewitt, sobel5)
+ * Pixels outside the image read the nearest edge pixel, so a fused run equals the unfused one.
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For string operations
+#include <ctype.h> // For isspace
+#include <math.h> // For sqrt
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#include "iedp.h" // Shared types and stage prototypes
+#include "perf_counters.h" // PERF_STAGE_PIPELINE for the worker threads
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Largest work a fused group may do per tile, relative to the tile: (tile grown by the halo) / tile
+#define STENCIL_MAX_RECOMPUTE 1.15
+
+/**
+ * @brief Pixels of a plane held in a buffer: pixel (x, y) of the image is at
+ *        data[(y - y0) * stride + (x - x0)]
+ */
+typedef struct {
+    unsigned char *data; // Buffer
+    int stride;          // Bytes per buffer row
+    int x0, y0;          // Image coordinates of the first buffer pixel
+} PlaneView;
+
+/**
+ * @brief Work shared by the tile workers of one group
+ */
+typedef struct {
+    const StencilPipeline *pipeline; // Stages
+    const StencilGroup *group;       // Group being run
+    const Image *src;                // Group input frame
+    const Image *dst;                // Group output frame
+    int width, height;               // Image size
+    int tile_w, tile_h;              // Tile size
+    int tiles_x;                     // Tiles per row
+    int failed;                      // A worker could not allocate its buffers (atomic: set by any worker)
+} StencilJob;
+
+// ==============================================================================================
+// A: Building a Pipeline
+// ==============================================================================================
+/**
+ * @brief Appends one stage given as text, e.g. "median", "threshold 40", "conv blur".
+ *
+ * @param pipeline Pipeline (zero-initialised before the first stage)
+ * @param spec     Stage text: operation name and arguments
+ * @return 1 on success, 0 on an unknown or malformed stage
+ */
+int StencilPipelineAdd(StencilPipeline *pipeline, const char *spec) {
+    char op[32] = "", arg[256] = "";
+    char tail;
+    int fields = sscanf(spec, " %31s %255s %c", op, arg, &tail);
+    if (fields < 1 || fields > 2 || pipeline->count == STENCIL_MAX_STAGES) {
+        fprintf(stderr, "Invalid pipeline stage '%s'\n", spec);
+        return 0;
+    }
+    StencilStage *stage = &pipeline->stages[pipeline->count];
+    memset(stage, 0, sizeof(*stage));
+
+    int ok = 1;
+    if (strcmp(op, "invert") == 0 && fields == 1) {
+        stage->op = STENCIL_INVERT;
+    } else if (strcmp(op, "threshold") == 0 && fields == 2) {
+        char *end;
+        long t = strtol(arg, &end, 10);
+        stage->op = STENCIL_THRESHOLD;
+        stage->param = (int)t;
+        ok = *end == '\0' && t >= 0 && t <= 256;
+    } else if ((strcmp(op, "median") == 0 || strcmp(op, "erode") == 0 || strcmp(op, "dilate") == 0) &&
+               fields == 1) {
+        stage->op = op[0] == 'm' ? STENCIL_MEDIAN : op[0] == 'e' ? STENCIL_ERODE : STENCIL_DILATE;
+        stage->halo = 1;
+    } else if (strcmp(op, "conv") == 0 && fields == 2) {
+        int kernels = ConvKernelPreset(arg, &stage->kx, &stage->ky);
+        stage->op = STENCIL_CONV;
+        ok = kernels == 1 || (kernels == 0 && ConvKernelParse(arg, &stage->kx));
+        stage->halo = stage->kx.size / 2;
+    } else if (strcmp(op, "gradient") == 0 && fields == 2) {
+        stage->op = STENCIL_GRADIENT;
+        // The stage reads one window for both kernels, so a pair must be the same size
+        ok = ConvKernelPreset(arg, &stage->kx, &stage->ky) == 2 && stage->ky.size == stage->kx.size;
+        stage->halo = stage->kx.size / 2;
+    } else {
+        ok = 0;
+    }
+    if (ok && (stage->op == STENCIL_CONV || stage->op == STENCIL_GRADIENT)) {
+        ConvPlanCompile(&stage->kx, &stage->px);
+    }
+    if (ok && stage->op == STENCIL_GRADIENT) {
+        ConvPlanCompile(&stage->ky, &stage->py);
+    }
+    if (!ok) {
+        fprintf(stderr, "Invalid pipeline stage '%s'\n", spec);
+        return 0;
+    }
+    snprintf(stage->name, sizeof(stage->name), "%s%s%s", op, fields == 2 ? " " : "", fields == 2 ? arg : "");
+    pipeline->count++;
+    return 1;
+}
+
+/**
+ * @brief Appends the stages of a pipeline text (see the top of this file).
+ *
+ * @param pipeline Pipeline
+ * @param text     Stages separated by newlines or ';'
+ * @return 1 on success, 0 on the first invalid stage
+ */
+int StencilPipelineParse(StencilPipeline *pipeline, const char *text) {
+    while (*text) {
+        size_t len = strcspn(text, ";\n");
+        size_t used = strcspn(text, "#");
+        char line[320];
+        snprintf(line, sizeof(line), "%.*s", (int)(used < len ? used : len), text);
+        // Skip blank lines and comments
+        const char *p = line;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p && !StencilPipelineAdd(pipeline, p)) {
+            return 0;
+        }
+        text += len + (text[len] != '\0');
+    }
+    return pipeline->count > 0;
+}
+
+// ==============================================================================================
+// B: Scheduling
+// ==============================================================================================
+/**
+ * @brief Groups the stages for fused execution. Pointwise stages always join the current group; a
+ *        stencil stage joins while the halo the group accumulates keeps the recomputed border of a
+ *        tile under STENCIL_MAX_RECOMPUTE. With fuse = 0 every stage is its own group over the whole
+ *        frame (unfused execution).
+ *
+ * @param pipeline Pipeline
+ * @param width    Image width
+ * @param height   Image height
+ * @param tile_w   Tile width (0: image width)
+ * @param tile_h   Tile height (0: image height)
+ * @param fuse     Fuse stages
+ * @param schedule Schedule
+ */
+void StencilSchedulePlan(const StencilPipeline *pipeline, int width, int height, int tile_w, int tile_h,
+                         int fuse, StencilSchedule *schedule) {
+    memset(schedule, 0, sizeof(*schedule));
+    schedule->tile_w = fuse && tile_w > 0 && tile_w < width ? tile_w : width;
+    schedule->tile_h = fuse && tile_h > 0 && tile_h < height ? tile_h : height;
+    double tile_area = (double)schedule->tile_w * schedule->tile_h;
+    // A tile spanning the image width (height) has no column (row) halo to recompute
+    int grow_x = schedule->tile_w < width;
+    int grow_y = schedule->tile_h < height;
+
+    for (int i = 0; i < pipeline->count; i++) {
+        int halo = pipeline->stages[i].halo;
+        if (fuse && schedule->group_count > 0) {
+            StencilGroup *group = &schedule->groups[schedule->group_count - 1];
+            int h = group->halo + halo;
+            double grown = (double)(schedule->tile_w + 2 * h * grow_x) * (schedule->tile_h + 2 * h * grow_y);
+            if (halo == 0 || grown <= STENCIL_MAX_RECOMPUTE * tile_area) {
+                group->count++;
+                group->halo = h;
+                continue;
+            }
+        }
+        StencilGroup *group = &schedule->groups[schedule->group_count++];
+        group->first = i;
+        group->count = 1;
+        group->halo = halo;
+    }
+}
+
+/**
+ * @brief Prints a schedule: the stages of each group and its halo.
+ *
+ * @param pipeline Pipeline
+ * @param schedule Schedule from StencilSchedulePlan
+ * @param out      Output stream
+ */
+void StencilSchedulePrint(const StencilPipeline *pipeline, const StencilSchedule *schedule, FILE *out) {
+    fprintf(out, "Pipeline: %d stages in %d pass%s, tile %dx%d\n", pipeline->count, schedule->group_count,
+            schedule->group_count == 1 ? "" : "es", schedule->tile_w, schedule->tile_h);
+    for (int g = 0; g < schedule->group_count; g++) {
+        const StencilGroup *group = &schedule->groups[g];
+        fprintf(out, "  pass %d (halo %d):", g + 1, group->halo);
+        for (int i = group->first; i < group->first + group->count; i++) {
+            fprintf(out, "%s %s", i > group->first ? " →" : "", pipeline->stages[i].name);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+// ==============================================================================================
+// C: Stage Kernels
+// ==============================================================================================
+/**
+ * @brief Clamps a coordinate to 0 ... size - 1.
+ */
+static inline int clamp_coord(int v, int size) {
+    return v < 0 ? 0 : v >= size ? size - 1 : v;
+}
+
+/**
+ * @brief Clamps a value to 0 ... 255.
+ */
+static inline unsigned char clamp_u8(int v) {
+    return (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+/**
+ * @brief Median of 9 values with a min / max network (19 compare-exchanges, no branches).
+ */
+static inline unsigned char median9(unsigned char p0, unsigned char p1, unsigned char p2, unsigned char p3,
+                                    unsigned char p4, unsigned char p5, unsigned char p6, unsigned char p7,
+                                    unsigned char p8) {
+#define SORT2(a, b) do { unsigned char t = a < b ? a : b; b = a < b ? b : a; a = t; } while (0)
+    SORT2(p1, p2); SORT2(p4, p5); SORT2(p7, p8); SORT2(p0, p1); SORT2(p3, p4); SORT2(p6, p7);
+    SORT2(p1, p2); SORT2(p4, p5); SORT2(p7, p8); SORT2(p0, p3); SORT2(p5, p8); SORT2(p4, p7);
+    SORT2(p3, p6); SORT2(p1, p4); SORT2(p2, p5); SORT2(p4, p7); SORT2(p4, p2); SORT2(p6, p4);
+    SORT2(p4, p2);
+#undef SORT2
+    return p4;
+}
+
+/**
+ * @brief One output pixel of a stage, from the input rows of its window and the window columns.
+ *
+ * @param stage Stage
+ * @param rows  Input rows y - halo ... y + halo, indexed by image column
+ * @param cols  Image columns x - halo ... x + halo (clamped to the image)
+ * @return Output pixel
+ */
+static unsigned char stage_pixel(const StencilStage *stage, const unsigned char *const *rows, const int *cols) {
+    int h = stage->halo;
+    int size = 2 * h + 1;
+    unsigned char v = rows[h][cols[h]];
+    switch (stage->op) {
+    case STENCIL_INVERT:
+        return (unsigned char)(255 - v);
+    case STENCIL_THRESHOLD:
+        return v >= stage->param ? 255 : 0;
+    case STENCIL_MEDIAN:
+        return median9(rows[0][cols[0]], rows[0][cols[1]], rows[0][cols[2]], rows[1][cols[0]], rows[1][cols[1]],
+                       rows[1][cols[2]], rows[2][cols[0]], rows[2][cols[1]], rows[2][cols[2]]);
+    case STENCIL_ERODE:
+    case STENCIL_DILATE: {
+        unsigned char lo = 255, hi = 0;
+        for (int k = 0; k < 9; k++) {
+            unsigned char p = rows[k / 3][cols[k % 3]];
+            lo = p < lo ? p : lo;
+            hi = p > hi ? p : hi;
+        }
+        return stage->op == STENCIL_ERODE ? lo : hi;
+    }
+    case STENCIL_CONV:
+    case STENCIL_GRADIENT: {
+        int gx = 0, gy = 0;
+        for (int k = 0; k < size * size; k++) {
+            int p = rows[k / size][cols[k % size]];
+            gx += stage->kx.weights[k] * p;
+            gy += stage->ky.weights[k] * p;
+        }
+        if (stage->op == STENCIL_CONV) {
+            return clamp_u8(gx >> stage->kx.shift);
+        }
+        // As ConvolveGradient: floor(sqrt(gx² + gy²)) clamped to 255
+        int m = gx * gx + gy * gy;
+        return (unsigned char)(int)sqrt((double)(m < 255 * 255 ? m : 255 * 255));
+    }
+    }
+    return v;
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Compare-exchange on 16 bytes: a = min, b = max.
+ */
+static inline void sort2_epu8(__m128i *a, __m128i *b) {
+    __m128i t = _mm_min_epu8(*a, *b);
+    *b = _mm_max_epu8(*a, *b);
+    *a = t;
+}
+
+/**
+ * @brief median9 on 16 bytes.
+ */
+static inline __m128i median9_epu8(__m128i *p) {
+    sort2_epu8(&p[1], &p[2]); sort2_epu8(&p[4], &p[5]); sort2_epu8(&p[7], &p[8]);
+    sort2_epu8(&p[0], &p[1]); sort2_epu8(&p[3], &p[4]); sort2_epu8(&p[6], &p[7]);
+    sort2_epu8(&p[1], &p[2]); sort2_epu8(&p[4], &p[5]); sort2_epu8(&p[7], &p[8]);
+    sort2_epu8(&p[0], &p[3]); sort2_epu8(&p[5], &p[8]); sort2_epu8(&p[4], &p[7]);
+    sort2_epu8(&p[3], &p[6]); sort2_epu8(&p[1], &p[4]); sort2_epu8(&p[2], &p[5]);
+    sort2_epu8(&p[4], &p[7]); sort2_epu8(&p[4], &p[2]); sort2_epu8(&p[6], &p[4]);
+    sort2_epu8(&p[4], &p[2]);
+    return p[4];
+}
+#endif
+
+/**
+ * @brief Pixels x0 ... x1 - 1 of one output row, all with their whole window inside the image: SSE2
+ *        min / max networks for the 3x3 stages, ConvolveRow for the kernels.
+ *
+ * @param stage Stage
+ * @param rows  Input rows y - halo ... y + halo, indexed by image column
+ * @param dst   Output row, indexed by image column
+ * @param x0    First column (>= halo)
+ * @param x1    One past the last column (<= width - halo)
+ */
+static void stage_interior(const StencilStage *stage, const unsigned char *const *rows, unsigned char *dst,
+                           int x0, int x1) {
+    int x = x0;
+    if (stage->op == STENCIL_CONV || stage->op == STENCIL_GRADIENT) {
+        ConvolveRow(rows, dst, x0, x1, &stage->px, stage->op == STENCIL_GRADIENT ? &stage->py : NULL);
+        return;
+    }
+    if (stage->op == STENCIL_INVERT || stage->op == STENCIL_THRESHOLD) {
+        const unsigned char *src = rows[0];
+        if (stage->op == STENCIL_INVERT) {
+            for (; x < x1; x++) {
+                dst[x] = (unsigned char)(255 - src[x]);
+            }
+        } else {
+            for (; x < x1; x++) {
+                dst[x] = src[x] >= stage->param ? 255 : 0;
+            }
+        }
+        return;
+    }
+#if defined(__SSE2__)
+    for (; x + 16 <= x1; x += 16) {
+        __m128i p[9];
+        for (int k = 0; k < 9; k++) {
+            p[k] = _mm_loadu_si128((const __m128i *)(rows[k / 3] + x + k % 3 - 1));
+        }
+        __m128i v = p[0];
+        if (stage->op == STENCIL_MEDIAN) {
+            v = median9_epu8(p);
+        } else {
+            for (int k = 1; k < 9; k++) {
+                v = stage->op == STENCIL_ERODE ? _mm_min_epu8(v, p[k]) : _mm_max_epu8(v, p[k]);
+            }
+        }
+        _mm_storeu_si128((__m128i *)(dst + x), v);
+    }
+#endif
+    // Scalar tail (and the whole row without SSE2)
+    for (; x < x1; x++) {
+        const int cols[3] = { x - 1, x, x + 1 };
+        dst[x] = stage_pixel(stage, rows, cols);
+    }
+}
+
+/**
+ * @brief Runs one stage on the pixels x0 ... x1 - 1, y0 ... y1 - 1. Neighbours outside the image
+ *        read the nearest edge pixel; all other neighbours must be in the input view.
+ *
+ * @param stage  Stage
+ * @param in     Input view
+ * @param out    Output view
+ * @param x0     First column
+ * @param y0     First row
+ * @param x1     One past the last column
+ * @param y1     One past the last row
+ * @param width  Image width
+ * @param height Image height
+ */
+static void run_stage(const StencilStage *stage, PlaneView in, PlaneView out, int x0, int y0, int x1, int y1,
+                      int width, int height) {
+    int h = stage->halo;
+    int size = 2 * h + 1;
+    // Columns whose window stays inside the image
+    int xi0 = x0 > h ? x0 : h < x1 ? h : x1;
+    int xi1 = x1 < width - h ? x1 : width - h;
+    xi1 = xi1 > xi0 ? xi1 : xi0;
+
+    for (int y = y0; y < y1; y++) {
+        // Input rows y - h ... y + h (clamped to the image), indexed by image column
+        const unsigned char *rows[CONV_MAX_SIZE];
+        for (int k = 0; k < size; k++) {
+            rows[k] = in.data + (size_t)(clamp_coord(y + k - h, height) - in.y0) * in.stride - in.x0;
+        }
+        unsigned char *dst = out.data + (size_t)(y - out.y0) * out.stride - out.x0;
+
+        stage_interior(stage, rows, dst, xi0, xi1);
+        // Left and right edge columns, with clamped window columns
+        const int edge_cols[2][2] = { { x0, xi0 }, { xi1, x1 } };
+        for (int e = 0; e < 2; e++) {
+            for (int x = edge_cols[e][0]; x < edge_cols[e][1]; x++) {
+                int cols[CONV_MAX_SIZE];
+                for (int k = 0; k < size; k++) {
+                    cols[k] = clamp_coord(x + k - h, width);
+                }
+                dst[x] = stage_pixel(stage, rows, cols);
+            }
+        }
+    }
+}
+
+// ==============================================================================================
+// D: Fused Execution
+// ==============================================================================================
+/**
+ * @brief Row-band worker: runs a fused group on tile rows t0 ... t1 - 1. Stage i of the group covers
+ *        the tile grown by the halo of stages i + 1 ... last, in two ping-pong tile buffers; the first
+ *        stage reads the group input frame and the last one writes the group output frame.
+ *
+ * @param ctx StencilJob
+ * @param t0  First tile row
+ * @param t1  One past the last tile row
+ */
+static void fused_tile_rows(void *ctx, int t0, int t1) {
+    StencilJob *job = ctx;
+    const StencilGroup *group = job->group;
+    int width = job->width, height = job->height;
+    int max_w = job->tile_w + 2 * group->halo;
+    int max_h = job->tile_h + 2 * group->halo;
+    unsigned char *buffers[2] = { NULL, NULL };
+    if (group->count > 1) {
+        buffers[0] = malloc((size_t)max_w * max_h);
+        buffers[1] = malloc((size_t)max_w * max_h);
+        if (!buffers[0] || !buffers[1]) {
+            free(buffers[0]);
+            free(buffers[1]);
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    for (int t = t0 * job->tiles_x; t < t1 * job->tiles_x; t++) {
+        int tx0 = (t % job->tiles_x) * job->tile_w;
+        int ty0 = (t / job->tiles_x) * job->tile_h;
+        int tx1 = tx0 + job->tile_w < width ? tx0 + job->tile_w : width;
+        int ty1 = ty0 + job->tile_h < height ? ty0 + job->tile_h : height;
+
+        PlaneView in = { job->src->data, (int)job->src->stride, 0, 0 };
+        int halo = group->halo;
+        for (int i = 0; i < group->count; i++) {
+            const StencilStage *stage = &job->pipeline->stages[group->first + i];
+            halo -= stage->halo;
+            // Region of this stage: the tile grown by the halo still needed downstream
+            int x0 = tx0 - halo > 0 ? tx0 - halo : 0;
+            int y0 = ty0 - halo > 0 ? ty0 - halo : 0;
+            int x1 = tx1 + halo < width ? tx1 + halo : width;
+            int y1 = ty1 + halo < height ? ty1 + halo : height;
+            PlaneView out = { job->dst->data, (int)job->dst->stride, 0, 0 };
+            if (i < group->count - 1) {
+                out.data = buffers[i & 1];
+                out.stride = x1 - x0;
+                out.x0 = x0;
+                out.y0 = y0;
+            }
+            run_stage(stage, in, out, x0, y0, x1, y1, width, height);
+            in = out;
+        }
+    }
+    free(buffers[0]);
+    free(buffers[1]);
+}
+
+/**
+ * @brief Runs a pipeline with a schedule. Each group is one pass over the frame, tiled and split
+ *        across threads by tile rows; groups hand over through full frames.
+ *
+ * @param pipeline Pipeline
+ * @param schedule Schedule from StencilSchedulePlan
+ * @param src      Input greyscale image
+ * @param dst      Output image of the same size (may not alias src)
+ * @param threads  Number of threads (1 = run on the calling thread)
+ * @return 1 on success, 0 on failure
+ */
+int StencilPipelineRun(const StencilPipeline *pipeline, const StencilSchedule *schedule, const Image *src,
+                       const Image *dst, int threads) {
+    int width = src->width, height = src->height;
+    if (pipeline->count == 0 || width <= 0 || height <= 0) {
+        return ImageCopy(src, dst);
+    }
+    // Frames between passes; the last pass writes dst
+    Image frames[2] = { { 0 }, { 0 } };
+    if (schedule->group_count > 1) {
+        if (!ImageAlloc(&frames[0], width, height, 1, IMAGE_INTERLEAVED, 1) ||
+            (schedule->group_count > 2 && !ImageAlloc(&frames[1], width, height, 1, IMAGE_INTERLEAVED, 1))) {
+            ImageFree(&frames[0]);
+            return 0;
+        }
+    }
+
+    StencilJob job = { 0 };
+    job.pipeline = pipeline;
+    job.width = width;
+    job.height = height;
+    job.tile_w = schedule->tile_w;
+    job.tile_h = schedule->tile_h;
+    job.tiles_x = (width + job.tile_w - 1) / job.tile_w;
+    int tiles_y = (height + job.tile_h - 1) / job.tile_h;
+
+    const Image *in = src;
+    for (int g = 0; g < schedule->group_count && !__atomic_load_n(&job.failed, __ATOMIC_RELAXED); g++) {
+        job.group = &schedule->groups[g];
+        job.src = in;
+        job.dst = g == schedule->group_count - 1 ? dst : &frames[g & 1];
+        ParallelRows(0, tiles_y, threads, fused_tile_rows, &job, threads > 1 ? PERF_STAGE_PIPELINE : -1);
+        in = job.dst;
+    }
+    ImageFree(&frames[0]);
+    ImageFree(&frames[1]);
+    return !__atomic_load_n(&job.failed, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Runs a pipeline fused and unfused (every stage a full-frame pass) and counts the pixels
+ *        where the two differ.
+ *
+ * @param pipeline Pipeline
+ * @param src      Input greyscale image
+ * @param fused    Output of the fused run
+ * @param threads  Number of threads
+ * @return Number of differing pixels, or -1 on failure
+ */
+long StencilPipelineVerify(const StencilPipeline *pipeline, const Image *src, const Image *fused, int threads) {
+    int width = src->width, height = src->height;
+    StencilSchedule unfused;
+    StencilSchedulePlan(pipeline, width, height, 0, 0, 0, &unfused);
+    Image reference;
+    if (!ImageAlloc(&reference, width, height, 1, IMAGE_INTERLEAVED, 1)) {
+        return -1;
+    }
+    if (!StencilPipelineRun(pipeline, &unfused, src, &reference, threads)) {
+        ImageFree(&reference);
+        return -1;
+    }
+    long differ = 0;
+    for (int y = 0; y < height; y++) {
+        const unsigned char *a = ImageRow(fused, y, 0), *b = ImageRow(&reference, y, 0);
+        for (int x = 0; x < width; x++) {
+            differ += a[x] != b[x];
+        }
+    }
+    ImageFree(&reference);
+    return differ;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file temporal.c
+ * @brief Temporal median filter for video: the last 3 or 5 frames in a preallocated ring, per-pixel
+ *        median across frames with min / max networks
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <string.h> // For memcpy
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#include "iedp.h" // Shared types and stage prototypes
+#include "perf_counters.h" // PERF_STAGE_MEDIAN for the worker threads
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+/**
+ * @brief Work shared by the row bands: the frames to take the median of and the output
+ */
+typedef struct {
+    const Image *frames[FRAME_RING_MAX]; // Frames, any order (the median does not care)
+    int count;                           // 1, 3 or 5 frames
+    const Image *output;                 // Output frame, same size and layout
+} TemporalJob;
+
+// ==============================================================================================
+// A: Frame Ring
+// ==============================================================================================
+/**
+ * @brief Allocates a ring of depth frames. The frames are allocated once, with packed rows so they can
+ *        go straight to the encoders; pushing a frame overwrites the oldest slot, so history is never
+ *        moved or copied.
+ *
+ * @param ring     Ring to initialise
+ * @param depth    Frames kept, 1 ... FRAME_RING_MAX
+ * @param width    Frame width
+ * @param height   Frame height
+ * @param channels Bytes per pixel
+ * @return 1 on success, 0 on failure
+ */
+int FrameRingInit(FrameRing *ring, int depth, int width, int height, int channels) {
+    memset(ring, 0, sizeof(*ring));
+    if (depth < 1 || depth > FRAME_RING_MAX) {
+        return 0;
+    }
+    for (int k = 0; k < depth; k++) {
+        if (!ImageAlloc(&ring->frames[k], width, height, channels, IMAGE_INTERLEAVED, 1)) {
+            FrameRingFree(ring);
+            return 0;
+        }
+    }
+    ring->depth = depth;
+    return 1;
+}
+
+/**
+ * @brief Slot the next frame is written to: the oldest frame once the ring is full. Call
+ *        FrameRingCommit when the frame is complete.
+ *
+ * @param ring Ring from FrameRingInit
+ * @return Frame of the slot
+ */
+Image *FrameRingSlot(FrameRing *ring) {
+    return &ring->frames[ring->next];
+}
+
+/**
+ * @brief Makes the frame written to FrameRingSlot the newest frame of the ring.
+ *
+ * @param ring Ring from FrameRingInit
+ */
+void FrameRingCommit(FrameRing *ring) {
+    ring->newest = ring->next;
+    ring->next = (ring->next + 1) % ring->depth;
+    if (ring->count < ring->depth) {
+        ring->count++;
+    }
+}
+
+/**
+ * @brief Frees the frames of a ring.
+ *
+ * @param ring Ring from FrameRingInit
+ */
+void FrameRingFree(FrameRing *ring) {
+    for (int k = 0; k < FRAME_RING_MAX; k++) {
+        ImageFree(&ring->frames[k]);
+    }
+    memset(ring, 0, sizeof(*ring));
+}
+
+// ==============================================================================================
+// B: Median Networks
+// ==============================================================================================
+/**
+ * @brief Median of three bytes: max(min(a, b), min(max(a, b), c)).
+ */
+static inline uint8_t median3_u8(uint8_t a, uint8_t b, uint8_t c) {
+    uint8_t lo = a < b ? a : b;
+    uint8_t hi = a < b ? b : a;
+    uint8_t m = hi < c ? hi : c;
+    return lo > m ? lo : m;
+}
+
+/**
+ * @brief Median of five bytes. The larger of the two pair minima and the smaller of the two pair
+ *        maxima bracket the median of a, b, c, d with e, so the result is their median with e.
+ */
+static inline uint8_t median5_u8(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e) {
+    uint8_t min_ab = a < b ? a : b, max_ab = a < b ? b : a;
+    uint8_t min_cd = c < d ? c : d, max_cd = c < d ? d : c;
+    uint8_t f = min_ab > min_cd ? min_ab : min_cd;
+    uint8_t g = max_ab < max_cd ? max_ab : max_cd;
+    return median3_u8(e, f, g);
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief median3_u8 on 16 bytes.
+ */
+static inline __m128i median3_epu8(__m128i a, __m128i b, __m128i c) {
+    __m128i lo = _mm_min_epu8(a, b);
+    __m128i hi = _mm_max_epu8(a, b);
+    return _mm_max_epu8(lo, _mm_min_epu8(hi, c));
+}
+
+/**
+ * @brief median5_u8 on 16 bytes (10 min / max instructions).
+ */
+static inline __m128i median5_epu8(__m128i a, __m128i b, __m128i c, __m128i d, __m128i e) {
+    __m128i f = _mm_max_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+    __m128i g = _mm_min_epu8(_mm_max_epu8(a, b), _mm_max_epu8(c, d));
+    return median3_epu8(e, f, g);
+}
+#endif
+
+// ==============================================================================================
+// C: Temporal Median - one band of rows
+// ==============================================================================================
+/**
+ * @brief Median across the frames of a job for one row of one plane (the whole row of an interleaved
+ *        frame). Every byte (channel) is filtered on its own, so the row is treated as a flat byte array.
+ *
+ * @param f     Row of each frame
+ * @param count 1, 3 or 5 frames
+ * @param out   Output row
+ * @param bytes Bytes in the row
+ */
+static void temporal_row(const unsigned char *const *f, int count, unsigned char *out, size_t bytes) {
+    size_t i = 0;
+
+    if (count == 1) {
+        memcpy(out, f[0], bytes);
+        return;
+    }
+#if defined(__SSE2__)
+    if (count == 3) {
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(f[0] + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(f[1] + i));
+            __m128i c = _mm_loadu_si128((const __m128i *)(f[2] + i));
+            _mm_storeu_si128((__m128i *)(out + i), median3_epu8(a, b, c));
+        }
+    } else {
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(f[0] + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(f[1] + i));
+            __m128i c = _mm_loadu_si128((const __m128i *)(f[2] + i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(f[3] + i));
+            __m128i e = _mm_loadu_si128((const __m128i *)(f[4] + i));
+            _mm_storeu_si128((__m128i *)(out + i), median5_epu8(a, b, c, d, e));
+        }
+    }
+#endif
+    // Scalar tail (and the whole row without SSE2)
+    if (count == 3) {
+        for (; i < bytes; i++) {
+            out[i] = median3_u8(f[0][i], f[1][i], f[2][i]);
+        }
+    } else {
+        for (; i < bytes; i++) {
+            out[i] = median5_u8(f[0][i], f[1][i], f[2][i], f[3][i], f[4][i]);
+        }
+    }
+}
+
+/**
+ * @brief Median across the frames of a job for rows y0 ... y1 - 1, plane by plane.
+ *
+ * @param ctx TemporalJob
+ * @param y0  First row
+ * @param y1  One past the last row
+ */
+static void temporal_rows(void *ctx, int y0, int y1) {
+    const TemporalJob *job = ctx;
+    const Image *out = job->output;
+    int planes = out->layout == IMAGE_PLANAR ? out->channels : 1;
+    size_t row_bytes = (size_t)out->width * (out->layout == IMAGE_PLANAR ? 1 : out->channels);
+    for (int y = y0; y < y1; y++) {
+        for (int c = 0; c < planes; c++) {
+            const unsigned char *rows[FRAME_RING_MAX];
+            for (int k = 0; k < job->count; k++) {
+                rows[k] = ImageRow(job->frames[k], y, c);
+            }
+            temporal_row(rows, job->count, ImageRow(out, y, c), row_bytes);
+        }
+    }
+}
+
+// ==============================================================================================
+// D: Temporal Median Filter
+// ==============================================================================================
+/**
+ * @brief Per-pixel, per-channel median of the frames in the ring, read in place from their slots.
+ *        Until the ring is full the median is taken over the newest 3 frames (while at least 3 are
+ *        held) or the newest frame is passed through, so the first frames of a stream are not blurred
+ *        by a partial history.
+ *
+ * @param ring    Ring holding the newest frame (FrameRingCommit done)
+ * @param output  Output frame of the ring's frame size and layout
+ * @param threads Number of threads (1 = run on the calling thread)
+ */
+void TemporalMedianFilter(const FrameRing *ring, const Image *output, int threads) {
+    if (ring->count == 0) {
+        return;
+    }
+    TemporalJob job;
+    job.count = ring->count >= 5 ? 5 : ring->count >= 3 ? 3 : 1;
+    for (int k = 0; k < job.count; k++) {
+        int slot = (ring->newest - k + ring->depth) % ring->depth;
+        job.frames[k] = &ring->frames[slot];
+    }
+    job.output = output;
+
+    ParallelRows(0, output->height, threads, temporal_rows, &job, threads > 1 ? PERF_STAGE_MEDIAN : -1);
+}
@@ -0,0 +1,782 @@
+/**
+ * To compile: gcc -O2 -fdiagnostics-color=always test_kernels.c iedp_stages.c fixed_kernels.c kernels_avx.c dispatch.c image.c stage_graph.c conv.c stencil_pipeline.c parallel.c perf_counters.c -o test_kernels -lm -pthread
+ */
+
+/**
+ * @file test_kernels.c
+ * @brief Comparison harness for the row kernel variants: every variant runs on random frames and its
+ *        output is compared with the generic MedianFilterRow / ConvertToGreyscaleRow / SobelEdgeRow,
+ *        on interleaved and (the planar median and greyscale variants) on planar rows.
+ *        Prints one line per check and exits with 1 on any mismatch.
+ *
+ * Usage: ./test_kernels [seed]
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For memset
+#include <math.h> // For sqrt
+
+#include "iedp.h" // Shared types and stage prototypes
+
+// ==============================================================================================
+// Constants
+// ==============================================================================================
+// Written to the output before a kernel runs; columns outside its range must keep it
+#define SENTINEL 0xA5
+
+// Geometries of fixed_kernels.c
+static const int fixed_sizes[][2] = { { 60, 60 }, { 120, 120 }, { 320, 240 }, { 640, 480 }, { 1280, 720 },
+                                      { 1920, 1080 } };
+
+// Odd widths on both sides of the 16 / 32 / 64-pixel vector steps, and frames of one or two rows
+static const int odd_sizes[][2] = { { 1, 1 }, { 3, 1 }, { 1, 4 }, { 5, 2 }, { 15, 9 }, { 17, 3 }, { 31, 7 },
+                                    { 33, 5 }, { 63, 4 }, { 65, 11 }, { 127, 6 }, { 129, 3 }, { 321, 13 },
+                                    { 1921, 3 } };
+
+// --border modes checked, with the value of BORDER_CONSTANT
+static const BorderMode border_modes[] = { BORDER_COPY, BORDER_REPLICATE, BORDER_MIRROR, BORDER_CONSTANT };
+static const char *border_names[] = { "copy", "replicate", "mirror", "constant" };
+#define BORDER_VALUE 77
+
+// Convolution presets of conv.c
+static const char *conv_presets[] = { "sobel", "scharr", "prewitt", "sobel5", "sharpen", "blur" };
+
+// Stencil pipelines run fused against their unfused execution
+static const char *pipelines[] = { "median; gradient sobel; threshold 64; dilate",
+                                   "conv blur; gradient sobel5; erode",
+                                   "invert; median; conv sharpen; dilate; gradient prewitt; threshold 20",
+                                   "conv 1,0,-1,2,0,-2,1,0,-1; median; conv 1,4,6,4,1,4,16,24,16,4,6,24,36,24,6,"
+                                   "4,16,24,16,4,1,4,6,4,1>>8; gradient scharr" };
+
+// Frames of the pipeline check: the odd-width frames, which fit one tile, and frames large enough to
+// fuse several stencil stages into one pass
+static const int pipeline_sizes[][2] = { { 1, 1 }, { 3, 1 }, { 1, 4 }, { 5, 2 }, { 17, 3 }, { 33, 5 }, { 65, 11 },
+                                         { 129, 3 }, { 257, 131 }, { 641, 97 } };
+
+// Tiles of the fused runs (0: the image size), odd ones cutting through every stencil's halo
+static const int pipeline_tiles[][2] = { { 0, 64 }, { 0, 17 }, { 61, 29 }, { 33, 17 }, { 7, 5 }, { 1, 1 } };
+
+// --isa values, indexed by KernelIsa
+static const char *isa_names[KERNEL_ISA_COUNT] = { "scalar", "sse2", "avx2", "avx512" };
+
+// ==============================================================================================
+// A: Frames and Reference
+// ==============================================================================================
+/**
+ * @brief Random frame with runs of repeated pixels, so the median sees ties and Sobel sees flat areas
+ *        next to full-scale steps.
+ *
+ * @param width    Frame width
+ * @param height   Frame height
+ * @param channels Bytes per pixel
+ * @return Frame (free with free), NULL on allocation failure
+ */
+static unsigned char *random_frame(int width, int height, int channels) {
+    size_t size = (size_t)width * height * channels;
+    unsigned char *frame = malloc(size);
+    for (size_t i = 0; frame && i < size; i++) {
+        frame[i] = i >= (size_t)channels && rand() % 4 == 0 ? frame[i - channels] : (unsigned char)rand();
+    }
+    return frame;
+}
+
+/**
+ * @brief Runs a median row kernel on the columns x0 ... x1 - 1 of every row of an RGB frame.
+ *
+ * @param fn     Kernel
+ * @param src    Input frame
+ * @param dst    Output frame
+ * @param width  Frame width
+ * @param height Frame height
+ * @param x0     First column
+ * @param x1     One past the last column
+ */
+static void run_median(MedianRowFn fn, const unsigned char *src, unsigned char *dst, int width, int height,
+                       int x0, int x1) {
+    size_t stride = (size_t)width * 3;
+    for (int y = 0; y < height; y++) {
+        fn(y > 0 ? src + (y - 1) * stride : NULL, src + y * stride, y + 1 < height ? src + (y + 1) * stride : NULL,
+           dst + y * stride, width, x0, x1);
+    }
+}
+
+/**
+ * @brief Runs a greyscale row kernel on the columns x0 ... x1 - 1 of every row (see run_median).
+ */
+static void run_grey(GreyRowFn fn, const unsigned char *src, unsigned char *dst, int width, int height,
+                     int x0, int x1) {
+    for (int y = 0; y < height; y++) {
+        fn(src + (size_t)y * width * 3, dst + (size_t)y * width, x0, x1);
+    }
+}
+
+/**
+ * @brief Runs a Sobel row kernel on the columns x0 ... x1 - 1 of every row of a greyscale frame (see
+ *        run_median).
+ */
+static void run_sobel(SobelRowFn fn, const unsigned char *src, unsigned char *dst, int width, int height,
+                      int x0, int x1) {
+    for (int y = 0; y < height; y++) {
+        fn(y > 0 ? src + (size_t)(y - 1) * width : NULL, src + (size_t)y * width,
+           y + 1 < height ? src + (size_t)(y + 1) * width : NULL, dst + (size_t)y * width, width, x0, x1);
+    }
+}
+
+/**
+ * @brief Runs a planar median row kernel on the columns x0 ... x1 - 1 of every row of a planar RGB
+ *        image (see run_median).
+ */
+static void run_median_planar(MedianPlanarRowFn fn, const Image *src, const Image *dst, int x0, int x1) {
+    int height = src->height;
+    for (int y = 0; y < height; y++) {
+        const unsigned char *rows[3][3];
+        unsigned char *out[3];
+        for (int c = 0; c < 3; c++) {
+            for (int k = 0; k < 3; k++) {
+                int r = y - 1 + k < 0 ? 0 : y - 1 + k >= height ? height - 1 : y - 1 + k;
+                rows[k][c] = ImageRow(src, r, c);
+            }
+            out[c] = ImageRow(dst, y, c);
+        }
+        fn(y > 0 ? rows[0] : NULL, rows[1], y + 1 < height ? rows[2] : NULL, out, src->width, x0, x1);
+    }
+}
+
+/**
+ * @brief Runs a planar greyscale row kernel on the columns x0 ... x1 - 1 of every row (see run_median).
+ */
+static void run_grey_planar(GreyPlanarRowFn fn, const Image *src, unsigned char *dst, int x0, int x1) {
+    for (int y = 0; y < src->height; y++) {
+        const unsigned char *rows[3] = { ImageRow(src, y, 0), ImageRow(src, y, 1), ImageRow(src, y, 2) };
+        fn(rows, dst + (size_t)y * src->width, x0, x1);
+    }
+}
+
+/**
+ * @brief Compares the columns x0 ... x1 - 1 of an output with the reference and checks that the other
+ *        columns still hold SENTINEL. Prints the first difference.
+ *
+ * @param what      Check name
+ * @param out       Output frame
+ * @param ref       Reference frame
+ * @param width     Frame width
+ * @param height    Frame height
+ * @param channels  Bytes per pixel
+ * @param x0        First column written
+ * @param x1        One past the last column written
+ * @return Number of differing bytes
+ */
+static long compare_span(const char *what, const unsigned char *out, const unsigned char *ref, int width,
+                         int height, int channels, int x0, int x1) {
+    long differ = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                size_t i = ((size_t)y * width + x) * channels + c;
+                int expected = x >= x0 && x < x1 ? ref[i] : SENTINEL;
+                if (out[i] != expected && differ++ == 0) {
+                    printf("  %s: (%d, %d) channel %d is %d, expected %d\n", what, x, y, c, out[i], expected);
+                }
+            }
+        }
+    }
+    return differ;
+}
+
+/**
+ * @brief Runs the median, greyscale and Sobel kernels of a set on one frame, over all columns and over
+ *        a random odd span, and compares them with the generic kernels.
+ *
+ * @param label   Printed name of the kernel set
+ * @param kernels Kernels under test
+ * @param width   Frame width
+ * @param height  Frame height
+ * @return Number of differing bytes
+ */
+static long check_kernels(const char *label, const StageKernels *kernels, int width, int height) {
+    size_t pixels = (size_t)width * height;
+    unsigned char *src = random_frame(width, height, 3);
+    unsigned char *filtered = malloc(pixels * 3), *grey = malloc(pixels), *edges = malloc(pixels);
+    unsigned char *out = malloc(pixels * 3);
+    // Planar copies of the input and the median output, and the planar kernels' output
+    Image planar_src, planar_filtered, planar_out;
+    int planar_ok = ImageAlloc(&planar_src, width, height, 3, IMAGE_PLANAR, IMAGE_ALIGN);
+    planar_ok = ImageAlloc(&planar_filtered, width, height, 3, IMAGE_PLANAR, IMAGE_ALIGN) && planar_ok;
+    planar_ok = ImageAlloc(&planar_out, width, height, 3, IMAGE_PLANAR, IMAGE_ALIGN) && planar_ok;
+    if (!src || !filtered || !grey || !edges || !out || !planar_ok) {
+        printf("  %s: out of memory\n", label);
+        free(src); free(filtered); free(grey); free(edges); free(out);
+        ImageFree(&planar_src); ImageFree(&planar_filtered); ImageFree(&planar_out);
+        return 1;
+    }
+    run_median(MedianFilterRow, src, filtered, width, height, 0, width);
+    run_grey(ConvertToGreyscaleRow, filtered, grey, width, height, 0, width);
+    run_sobel(SobelEdgeRow, grey, edges, width, height, 0, width);
+    Image src_view = ImageWrap(src, width, height, 3);
+    Image filtered_view = ImageWrap(filtered, width, height, 3);
+    Image out_view = ImageWrap(out, width, height, 3);
+    ImageCopy(&src_view, &planar_src);
+    ImageCopy(&filtered_view, &planar_filtered);
+
+    // All columns, then a span starting and ending at odd columns (peeled borders, vector tails)
+    int spans[2][2] = { { 0, width }, { 0, width } };
+    if (width > 2) {
+        spans[1][0] = 1 + 2 * (rand() % ((width - 1) / 2));
+        spans[1][1] = spans[1][0] + 1 + 2 * (rand() % ((width - spans[1][0] + 1) / 2));
+        spans[1][1] = spans[1][1] > width ? width : spans[1][1];
+    }
+    long differ = 0;
+    for (int s = 0; s < 2; s++) {
+        int x0 = spans[s][0], x1 = spans[s][1];
+        memset(out, SENTINEL, pixels * 3);
+        run_median(kernels->median_row, src, out, width, height, x0, x1);
+        differ += compare_span("median", out, filtered, width, height, 3, x0, x1);
+        memset(out, SENTINEL, pixels);
+        run_grey(kernels->grey_row, filtered, out, width, height, x0, x1);
+        differ += compare_span("grey", out, grey, width, height, 1, x0, x1);
+        memset(out, SENTINEL, pixels);
+        run_sobel(kernels->sobel_row, grey, out, width, height, x0, x1);
+        differ += compare_span("sobel", out, edges, width, height, 1, x0, x1);
+        if (kernels->median_planar_row) {
+            memset(planar_out.data, SENTINEL, planar_out.plane_stride * 3);
+            run_median_planar(kernels->median_planar_row, &planar_src, &planar_out, x0, x1);
+            ImageCopy(&planar_out, &out_view);
+            differ += compare_span("median planar", out, filtered, width, height, 3, x0, x1);
+        }
+        if (kernels->grey_planar_row) {
+            memset(out, SENTINEL, pixels);
+            run_grey_planar(kernels->grey_planar_row, &planar_filtered, out, x0, x1);
+            differ += compare_span("grey planar", out, grey, width, height, 1, x0, x1);
+        }
+    }
+    printf("%-28s %4dx%-4d columns %d ... %d: %s\n", label, width, height, spans[1][0], spans[1][1] - 1,
+           differ ? "FAIL" : "ok");
+
+    free(src);
+    free(filtered);
+    free(grey);
+    free(edges);
+    free(out);
+    ImageFree(&planar_src);
+    ImageFree(&planar_filtered);
+    ImageFree(&planar_out);
+    return differ;
+}
+
+// ==============================================================================================
+// B: Fixed-geometry Kernels
+// ==============================================================================================
+/**
+ * @brief The kernels of fixed_kernels.c against the generic ones, on a frame of their own size.
+ *
+ * @return Number of failures
+ */
+static long check_fixed(void) {
+    long failures = 0;
+    for (size_t i = 0; i < sizeof(fixed_sizes) / sizeof(fixed_sizes[0]); i++) {
+        int width = fixed_sizes[i][0], height = fixed_sizes[i][1];
+        const StageKernels *kernels = StageKernelsFind(width, height);
+        if (kernels->width != width || kernels->height != height) {
+            printf("fixed %dx%d: not registered\n", width, height);
+            failures++;
+            continue;
+        }
+        failures += check_kernels("fixed", kernels, width, height) != 0;
+    }
+    return failures;
+}
+
+// ==============================================================================================
+// C: Instruction Set Variants
+// ==============================================================================================
+/**
+ * @brief The kernels StageKernelsSelect picks for each instruction set the CPU supports against the
+ *        generic ones, on odd-width frames and on the fixed geometries (where the SSE2 selection uses
+ *        the fixed-geometry kernels).
+ *
+ * @return Number of failures
+ */
+static long check_isa(void) {
+    long failures = 0;
+    for (int isa = 0; isa < KERNEL_ISA_COUNT; isa++) {
+        if (!KernelIsaSupported((KernelIsa)isa)) {
+            printf("isa %s: not supported by this CPU, skipped\n", isa_names[isa]);
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(odd_sizes) / sizeof(odd_sizes[0]); i++) {
+            StageKernels kernels;
+            StageKernelsSelect(isa_names[isa], 0, 0, &kernels);
+            char label[64];
+            snprintf(label, sizeof(label), "isa %s (%s/%s/%s)", isa_names[isa], kernels.median_isa, kernels.grey_isa,
+                     kernels.sobel_isa);
+            failures += check_kernels(label, &kernels, odd_sizes[i][0], odd_sizes[i][1]) != 0;
+        }
+        for (size_t i = 0; i < sizeof(fixed_sizes) / sizeof(fixed_sizes[0]); i++) {
+            StageKernels kernels;
+            StageKernelsSelect(isa_names[isa], fixed_sizes[i][0], fixed_sizes[i][1], &kernels);
+            char label[64];
+            snprintf(label, sizeof(label), "isa %s%s", isa_names[isa], kernels.width ? " fixed" : "");
+            failures += check_kernels(label, &kernels, fixed_sizes[i][0], fixed_sizes[i][1]) != 0;
+        }
+    }
+    return failures;
+}
+
+// ==============================================================================================
+// D: Border Modes
+// ==============================================================================================
+/**
+ * @brief Copy of a frame with one pixel of border around it, filled as the border mode says.
+ *
+ * @param src      Frame
+ * @param width    Frame width
+ * @param height   Frame height
+ * @param channels Bytes per pixel
+ * @param mode     Border mode other than BORDER_COPY
+ * @return (width + 2) x (height + 2) frame (free with free), NULL on allocation failure
+ */
+static unsigned char *pad_frame(const unsigned char *src, int width, int height, int channels, BorderMode mode) {
+    unsigned char *padded = malloc((size_t)(width + 2) * (height + 2) * channels);
+    for (int y = -1; padded && y <= height; y++) {
+        for (int x = -1; x <= width; x++) {
+            int sx = BorderIndex(x, width, mode), sy = BorderIndex(y, height, mode);
+            for (int c = 0; c < channels; c++) {
+                padded[((size_t)(y + 1) * (width + 2) + x + 1) * channels + c] =
+                    sx < 0 || sy < 0 ? BORDER_VALUE : src[((size_t)sy * width + sx) * channels + c];
+            }
+        }
+    }
+    return padded;
+}
+
+/**
+ * @brief Reference median and Sobel outputs of a frame under a border mode. BORDER_COPY runs the
+ *        generic kernels as they are; the other modes run them on the padded frame, where every
+ *        image pixel is an interior pixel, and crop the result.
+ *
+ * @param src      RGB frame
+ * @param width    Frame width
+ * @param height   Frame height
+ * @param mode     Border mode
+ * @param filtered Median filter output (width x height x 3)
+ * @param edges    Sobel output of its greyscale image (width x height)
+ * @return 1 on success, 0 on allocation failure
+ */
+static int border_reference(const unsigned char *src, int width, int height, BorderMode mode,
+                            unsigned char *filtered, unsigned char *edges) {
+    unsigned char *grey = malloc((size_t)width * height);
+    if (!grey) {
+        return 0;
+    }
+    if (mode == BORDER_COPY) {
+        run_median(MedianFilterRow, src, filtered, width, height, 0, width);
+        run_grey(ConvertToGreyscaleRow, filtered, grey, width, height, 0, width);
+        run_sobel(SobelEdgeRow, grey, edges, width, height, 0, width);
+        free(grey);
+        return 1;
+    }
+
+    int pw = width + 2, ph = height + 2;
+    unsigned char *padded = pad_frame(src, width, height, 3, mode);
+    unsigned char *out = malloc((size_t)pw * ph * 3);
+    int ok = padded && out;
+    if (ok) {
+        run_median(MedianFilterRow, padded, out, pw, ph, 1, pw - 1);
+        for (int y = 0; y < height; y++) {
+            memcpy(filtered + (size_t)y * width * 3, out + ((size_t)(y + 1) * pw + 1) * 3, (size_t)width * 3);
+        }
+        run_grey(ConvertToGreyscaleRow, filtered, grey, width, height, 0, width);
+        free(padded);
+        padded = pad_frame(grey, width, height, 1, mode);
+        ok = padded != NULL;
+    }
+    if (ok) {
+        run_sobel(SobelEdgeRow, padded, out, pw, ph, 1, pw - 1);
+        for (int y = 0; y < height; y++) {
+            memcpy(edges + (size_t)y * width, out + (size_t)(y + 1) * pw + 1, (size_t)width);
+        }
+    }
+    free(padded);
+    free(out);
+    free(grey);
+    return ok;
+}
+
+/**
+ * @brief The stage graph under every border mode and with the kernels of every supported instruction
+ *        set on interleaved and planar rows, pulling all outputs (full frames) or only the edges
+ *        (median and greyscale streamed through row rings), against border_reference on the odd-width
+ *        frames.
+ *
+ * @return Number of failures
+ */
+static long check_border(void) {
+    long failures = 0;
+    for (size_t m = 0; m < sizeof(border_modes) / sizeof(border_modes[0]); m++) {
+        for (int isa = 0; isa < KERNEL_ISA_COUNT * 2; isa++) {
+            if (!KernelIsaSupported((KernelIsa)(isa / 2))) {
+                continue;
+            }
+            StageKernels kernels;
+            StageKernelsSelect(isa_names[isa / 2], 0, 0, &kernels);
+            kernels.layout = isa % 2 ? IMAGE_PLANAR : IMAGE_INTERLEAVED;
+            long differ = 0;
+            for (size_t i = 0; i < sizeof(odd_sizes) / sizeof(odd_sizes[0]); i++) {
+                int width = odd_sizes[i][0], height = odd_sizes[i][1];
+                size_t pixels = (size_t)width * height;
+                unsigned char *src = random_frame(width, height, 3);
+                unsigned char *filtered = malloc(pixels * 3), *edges = malloc(pixels);
+                if (!src || !filtered || !edges || !border_reference(src, width, height, border_modes[m], filtered, edges)) {
+                    printf("  out of memory\n");
+                    differ++;
+                }
+                unsigned outputs[2] = { STAGE_BIT(STAGE_FILTERED) | STAGE_BIT(STAGE_GREY) | STAGE_BIT(STAGE_EDGES),
+                                        STAGE_BIT(STAGE_EDGES) };
+                for (int o = 0; o < 2 && !differ; o++) {
+                    Image source = ImageWrap(src, width, height, 3);
+                    StageGraph graph;
+                    if (!StageGraphInit(&graph, &source, 1, outputs[o], &kernels, border_modes[m], BORDER_VALUE)) {
+                        printf("  %dx%d: StageGraphInit failed\n", width, height);
+                        differ++;
+                        break;
+                    }
+                    unsigned char *f = StageGraphPull(&graph, STAGE_FILTERED);
+                    unsigned char *e = StageGraphPull(&graph, STAGE_EDGES);
+                    if (f) {
+                        differ += compare_span("median", f, filtered, width, height, 3, 0, width);
+                    }
+                    differ += compare_span("sobel", e, edges, width, height, 1, 0, width);
+                    StageGraphFree(&graph);
+                }
+                free(src);
+                free(filtered);
+                free(edges);
+            }
+            printf("border %-9s isa %-6s %-11s %2zu frames: %s\n", border_names[m], isa_names[isa / 2],
+                   isa % 2 ? "planar" : "interleaved", sizeof(odd_sizes) / sizeof(odd_sizes[0]),
+                   differ ? "FAIL" : "ok");
+            failures += differ != 0;
+        }
+    }
+    return failures;
+}
+
+// ==============================================================================================
+// E: Convolution Engine
+// ==============================================================================================
+/**
+ * @brief Random kernel of one of three kinds: small weights with zeros (the SSE2 add / shift paths),
+ *        an outer product of two small vectors (the separable path), or one weight too wide for
+ *        16-bit lanes (the scalar path).
+ *
+ * @param k    Kernel to fill
+ * @param size 3 or 5
+ * @param kind 0, 1 or 2
+ */
+static void random_kernel(ConvKernel *k, int size, int kind) {
+    int col[CONV_MAX_SIZE], row[CONV_MAX_SIZE];
+    for (int i = 0; i < size; i++) {
+        col[i] = rand() % 7 - 3;
+        row[i] = rand() % 7 - 3;
+    }
+    col[size / 2] = row[size / 2] = 1 + rand() % 3;
+    memset(k, 0, sizeof(*k));
+    k->size = size;
+    k->shift = rand() % 5;
+    for (int i = 0; i < size * size; i++) {
+        k->weights[i] = kind == 1 ? col[i / size] * row[i % size] : rand() % 3 == 0 ? 0 : rand() % 9 - 4;
+    }
+    if (kind == 2) {
+        k->weights[rand() % (size * size)] = rand() % 2 ? 300 : -300;
+    }
+}
+
+/**
+ * @brief Kernel sum at an interior pixel, straight from the weights.
+ */
+static int conv_sum(const ConvKernel *k, const unsigned char *grey, int width, int x, int y) {
+    int r = k->size / 2, sum = 0;
+    for (int j = 0; j < k->size; j++) {
+        for (int i = 0; i < k->size; i++) {
+            sum += k->weights[j * k->size + i] * grey[(size_t)(y + j - r) * width + x + i - r];
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Reference Convolve (ky NULL) or ConvolveGradient: clamp(sum >> shift, 0, 255) or the clamped
+ *        magnitude inside, and outside the kernel radius the input pixel or 0.
+ *
+ * @param grey   Input frame
+ * @param out    Output frame
+ * @param width  Frame width
+ * @param height Frame height
+ * @param kx     First kernel
+ * @param ky     Second kernel of a gradient pair, NULL for a single kernel
+ */
+static void conv_reference(const unsigned char *grey, unsigned char *out, int width, int height,
+                           const ConvKernel *kx, const ConvKernel *ky) {
+    int r = kx->size / 2;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t i = (size_t)y * width + x;
+            if (x < r || y < r || x >= width - r || y >= height - r) {
+                out[i] = ky ? 0 : grey[i];
+                continue;
+            }
+            int v;
+            if (ky) {
+                long long gx = conv_sum(kx, grey, width, x, y), gy = conv_sum(ky, grey, width, x, y);
+                v = (int)sqrt((double)(gx * gx + gy * gy));
+            } else {
+                v = conv_sum(kx, grey, width, x, y) >> kx->shift;
+                v = v < 0 ? 0 : v;
+            }
+            out[i] = (unsigned char)(v > 255 ? 255 : v);
+        }
+    }
+}
+
+/**
+ * @brief Convolve / ConvolveGradient with 1 and 3 threads, and ConvolveRow on an odd span of the
+ *        middle row, against conv_reference on the odd-width frames.
+ *
+ * @param label Printed name of the kernel
+ * @param kx    First kernel
+ * @param ky    Second kernel of a gradient pair, NULL for a single kernel
+ * @return Number of differing bytes
+ */
+static long check_conv_kernel(const char *label, const ConvKernel *kx, const ConvKernel *ky) {
+    ConvPlan px, py;
+    ConvPlanCompile(kx, &px);
+    if (ky) {
+        ConvPlanCompile(ky, &py);
+    }
+    int r = kx->size / 2;
+    long differ = 0;
+    for (size_t i = 0; i < sizeof(odd_sizes) / sizeof(odd_sizes[0]); i++) {
+        int width = odd_sizes[i][0], height = odd_sizes[i][1];
+        size_t pixels = (size_t)width * height;
+        unsigned char *grey = random_frame(width, height, 1);
+        unsigned char *ref = malloc(pixels), *out = malloc(pixels);
+        if (!grey || !ref || !out) {
+            printf("  out of memory\n");
+            free(grey); free(ref); free(out);
+            return differ + 1;
+        }
+        conv_reference(grey, ref, width, height, kx, ky);
+        Image grey_view = ImageWrap(grey, width, height, 1), out_view = ImageWrap(out, width, height, 1);
+        for (int threads = 1; threads <= 3; threads += 2) {
+            memset(out, SENTINEL, pixels);
+            if (ky) {
+                ConvolveGradient(&grey_view, &out_view, kx, ky, threads);
+            } else {
+                Convolve(&grey_view, &out_view, kx, threads);
+            }
+            differ += compare_span(threads > 1 ? "threaded" : "frame", out, ref, width, height, 1, 0, width);
+        }
+        // The rows of the middle output row and an odd span of its interior columns
+        int y = height / 2;
+        if (y >= r && y < height - r && width > 2 * r) {
+            const unsigned char *rows[CONV_MAX_SIZE];
+            for (int j = 0; j < kx->size; j++) {
+                rows[j] = grey + (size_t)(y - r + j) * width;
+            }
+            int x0 = r + rand() % (width - 2 * r), x1 = x0 + 1 + rand() % (width - r - x0);
+            memset(out, SENTINEL, (size_t)width);
+            ConvolveRow(rows, out, x0, x1, &px, ky ? &py : NULL);
+            differ += compare_span("row", out, ref + (size_t)y * width, width, 1, 1, x0, x1);
+        }
+        free(grey);
+        free(ref);
+        free(out);
+    }
+    printf("conv %-30s %2zu frames: %s\n", label, sizeof(odd_sizes) / sizeof(odd_sizes[0]), differ ? "FAIL" : "ok");
+    return differ;
+}
+
+/**
+ * @brief The convolution engine: every preset, random single kernels and gradient pairs of each size
+ *        and kind, and ConvolveGradient with the sobel preset against SobelEdgeRow.
+ *
+ * @return Number of failures
+ */
+static long check_conv(void) {
+    long failures = 0;
+    ConvKernel kx, ky;
+    for (size_t i = 0; i < sizeof(conv_presets) / sizeof(conv_presets[0]); i++) {
+        int count = ConvKernelPreset(conv_presets[i], &kx, &ky);
+        failures += check_conv_kernel(conv_presets[i], &kx, count == 2 ? &ky : NULL) != 0;
+    }
+    static const char *kinds[] = { "small", "separable", "wide" };
+    for (int size = 3; size <= 5; size += 2) {
+        for (int kind = 0; kind < 3; kind++) {
+            char label[48];
+            random_kernel(&kx, size, kind);
+            snprintf(label, sizeof(label), "random %dx%d %s", size, size, kinds[kind]);
+            failures += check_conv_kernel(label, &kx, NULL) != 0;
+            random_kernel(&ky, size, kind);
+            snprintf(label, sizeof(label), "random %dx%d %s pair", size, size, kinds[kind]);
+            failures += check_conv_kernel(label, &kx, &ky) != 0;
+        }
+    }
+
+    // The sobel preset is SobelEdgeDetection
+    ConvKernelPreset("sobel", &kx, &ky);
+    long differ = 0;
+    for (size_t i = 0; i < sizeof(odd_sizes) / sizeof(odd_sizes[0]); i++) {
+        int width = odd_sizes[i][0], height = odd_sizes[i][1];
+        size_t pixels = (size_t)width * height;
+        unsigned char *grey = random_frame(width, height, 1);
+        unsigned char *ref = malloc(pixels), *out = malloc(pixels);
+        if (grey && ref && out) {
+            run_sobel(SobelEdgeRow, grey, ref, width, height, 0, width);
+            Image grey_view = ImageWrap(grey, width, height, 1), out_view = ImageWrap(out, width, height, 1);
+            ConvolveGradient(&grey_view, &out_view, &kx, &ky, 3);
+            differ += compare_span("sobel", out, ref, width, height, 1, 0, width);
+        } else {
+            differ++;
+        }
+        free(grey);
+        free(ref);
+        free(out);
+    }
+    printf("conv %-30s %2zu frames: %s\n", "sobel = SobelEdgeRow", sizeof(odd_sizes) / sizeof(odd_sizes[0]),
+           differ ? "FAIL" : "ok");
+    failures += differ != 0;
+    return failures;
+}
+
+// ==============================================================================================
+// F: Fused Stencil Pipelines
+// ==============================================================================================
+/**
+ * @brief Runs a pipeline with a tile and thread count and compares it with its unfused execution
+ *        (StencilPipelineVerify) or, when ref is given, with ref.
+ *
+ * @param pipeline Pipeline
+ * @param grey     Input frame
+ * @param ref      Expected output, NULL to compare with the unfused run
+ * @param width    Frame width
+ * @param height   Frame height
+ * @param tile     Tile size
+ * @param threads  Number of threads
+ * @param fused    Raised to the most stencil stages the schedule put in one tiled pass
+ * @return Number of differing bytes
+ */
+static long run_pipeline(const StencilPipeline *pipeline, unsigned char *grey, const unsigned char *ref,
+                         int width, int height, const int *tile, int threads, int *fused) {
+    StencilSchedule schedule;
+    StencilSchedulePlan(pipeline, width, height, tile[0], tile[1], 1, &schedule);
+    for (int g = 0; g < schedule.group_count; g++) {
+        const StencilGroup *group = &schedule.groups[g];
+        int stencils = 0;
+        for (int i = group->first; i < group->first + group->count; i++) {
+            stencils += pipeline->stages[i].halo > 0;
+        }
+        int tiled = schedule.tile_w < width || schedule.tile_h < height;
+        *fused = tiled && stencils > *fused ? stencils : *fused;
+    }
+    unsigned char *out = malloc((size_t)width * height);
+    Image grey_view = ImageWrap(grey, width, height, 1), out_view = ImageWrap(out, width, height, 1);
+    if (!out || !StencilPipelineRun(pipeline, &schedule, &grey_view, &out_view, threads)) {
+        printf("  StencilPipelineRun failed\n");
+        free(out);
+        return 1;
+    }
+    long differ;
+    if (ref) {
+        differ = compare_span("pipeline", out, ref, width, height, 1, 0, width);
+    } else {
+        differ = StencilPipelineVerify(pipeline, &grey_view, &out_view, threads);
+        if (differ) {
+            printf("  tile %dx%d, %d threads: %ld pixels differ from the unfused run\n", tile[0], tile[1], threads,
+                   differ);
+        }
+    }
+    free(out);
+    return differ != 0;
+}
+
+/**
+ * @brief The fused stencil pipeline: "gradient sobel" against SobelEdgeRow on the frame padded with its
+ *        edge pixels (the pipeline's border), and multi-stage pipelines against their unfused
+ *        execution, with every tile and 1 and 3 threads.
+ *
+ * @return Number of failures
+ */
+static long check_pipeline(void) {
+    long failures = 0;
+    size_t count = sizeof(pipelines) / sizeof(pipelines[0]);
+    for (size_t p = 0; p <= count; p++) {
+        static StencilPipeline pipeline;
+        memset(&pipeline, 0, sizeof(pipeline));
+        const char *text = p < count ? pipelines[p] : "gradient sobel";
+        if (!StencilPipelineParse(&pipeline, text)) {
+            printf("pipeline '%s': invalid\n", text);
+            failures++;
+            continue;
+        }
+        long differ = 0;
+        int fused = 0;
+        for (size_t i = 0; i < sizeof(pipeline_sizes) / sizeof(pipeline_sizes[0]); i++) {
+            int width = pipeline_sizes[i][0], height = pipeline_sizes[i][1];
+            unsigned char *grey = random_frame(width, height, 1);
+            unsigned char *ref = NULL;
+            if (grey && p == count) {
+                // Replicate-padded SobelEdgeRow, cropped
+                unsigned char *padded = pad_frame(grey, width, height, 1, BORDER_REPLICATE);
+                unsigned char *edges = malloc((size_t)(width + 2) * (height + 2));
+                ref = malloc((size_t)width * height);
+                if (padded && edges && ref) {
+                    run_sobel(SobelEdgeRow, padded, edges, width + 2, height + 2, 1, width + 1);
+                    for (int y = 0; y < height; y++) {
+                        memcpy(ref + (size_t)y * width, edges + (size_t)(y + 1) * (width + 2) + 1, (size_t)width);
+                    }
+                } else {
+                    free(ref);
+                    ref = NULL;
+                    differ++;
+                }
+                free(padded);
+                free(edges);
+            }
+            for (size_t t = 0; grey && t < sizeof(pipeline_tiles) / sizeof(pipeline_tiles[0]); t++) {
+                for (int threads = 1; threads <= 3; threads += 2) {
+                    differ += run_pipeline(&pipeline, grey, ref, width, height, pipeline_tiles[t], threads, &fused);
+                }
+            }
+            differ += grey == NULL;
+            free(grey);
+            free(ref);
+        }
+        printf("pipeline %s%.40s%s, %zu frames, up to %d stencils per tiled pass: %s\n",
+               p == count ? "= SobelEdgeRow: " : "", text, strlen(text) > 40 ? "..." : "",
+               sizeof(pipeline_sizes) / sizeof(pipeline_sizes[0]), fused, differ ? "FAIL" : "ok");
+        failures += differ != 0;
+    }
+    return failures;
+}
+
+// ==============================================================================================
+// Main
+// ==============================================================================================
+int main(int argc, char *argv[]) {
+    srand(argc > 1 ? (unsigned)atoi(argv[1]) : 1);
+
+    long failures = 0;
+    failures += check_fixed();
+    failures += check_isa();
+    failures += check_border();
+    failures += check_conv();
+    failures += check_pipeline();
+
+    printf("%ld failed\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,572 @@
+/**
+ * @file rtl_model.c
+ * @brief Cycle-accurate C model of the RTL pipeline (rgb_to_gray → median_filter → sobel_edge) used by tb_system
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For string operations
+#include <ctype.h> // For isxdigit / isspace
+
+#include "rtl_model.h"
+
+// ==============================================================================================
+// A: rgb_to_gray - 3-cycle-per-pixel FSM (grayscale_converter.v)
+// ==============================================================================================
+/**
+ * @brief Applies the rst branch of rgb_to_gray.
+ *
+ * @param gray        Module registers
+ * @param mem         Image memory loaded by $readmemh
+ * @param total_bytes TOTAL_BYTES parameter
+ */
+void rtl_gray_reset(RtlGray *gray, const uint16_t *mem, size_t total_bytes) {
+    gray->mem = mem;
+    gray->total_bytes = total_bytes;
+    gray->state = 0;
+    gray->addr = 0;
+    gray->r = gray->g = gray->b = 0;
+    gray->gray_out = 0;
+    gray->gray_valid = 0;
+}
+
+/**
+ * @brief One rising clock edge of rgb_to_gray.
+ *
+ * Note that in state 2 the RTL computes gray_out from the *registered* b, i.e. the blue value of the
+ * previous pixel (0 for the first one), because b is updated with a non-blocking assignment in the same
+ * cycle. The model reproduces that so its output matches the simulator bit for bit.
+ *
+ * @param gray Module registers
+ */
+void rtl_gray_clock(RtlGray *gray) {
+    gray->gray_valid = 0;
+    if (gray->addr >= gray->total_bytes) return;
+
+    uint16_t data = gray->mem[gray->addr];
+    switch (gray->state) {
+        case 0:
+            gray->r = data;
+            gray->addr++;
+            gray->state = 1;
+            break;
+        case 1:
+            gray->g = data;
+            gray->addr++;
+            gray->state = 2;
+            break;
+        case 2: {
+            // Right-hand side uses the old register values (non-blocking semantics)
+            if ((gray->r | gray->g | gray->b) & RTL_X) {
+                gray->gray_out = RTL_X;
+            } else {
+                gray->gray_out = (uint16_t)(((gray->r * 77 + gray->g * 150 + gray->b * 29) >> 8) & 0xFF);
+            }
+            gray->b = data;
+            gray->addr++;
+            gray->gray_valid = 1;
+            gray->state = 0;
+            break;
+        }
+    }
+}
+
+// ==============================================================================================
+// B: median_filter - line buffers and 3x3 window sort (median_filter.v)
+// ==============================================================================================
+/**
+ * @brief Allocates the line buffers of a median_filter instance.
+ *
+ * @param median      Module registers
+ * @param W           Line width parameter
+ * @param H           Frame height parameter
+ * @param pipe_stages PIPE_STAGES parameter (0..RTL_MEDIAN_MAX_STAGES)
+ * @return 0 on success, -1 on allocation failure or invalid parameters
+ */
+int rtl_median_init(RtlMedian *median, int W, int H, int pipe_stages) {
+    median->line_buf1 = NULL;
+    median->line_buf2 = NULL;
+    if (pipe_stages < 0 || pipe_stages > RTL_MEDIAN_MAX_STAGES) return -1;
+    median->W = W;
+    median->H = H;
+    median->pipe_stages = pipe_stages;
+    median->line_buf1 = (uint16_t *)calloc(W, sizeof(uint16_t));
+    median->line_buf2 = (uint16_t *)calloc(W, sizeof(uint16_t));
+    if (!median->line_buf1 || !median->line_buf2) {
+        rtl_median_free(median);
+        return -1;
+    }
+    rtl_median_reset(median);
+    return 0;
+}
+
+/**
+ * @brief Applies the rst branch of median_filter.
+ *
+ * @param median Module registers
+ */
+void rtl_median_reset(RtlMedian *median) {
+    memset(median->line_buf1, 0, median->W * sizeof(uint16_t));
+    memset(median->line_buf2, 0, median->W * sizeof(uint16_t));
+    median->col = 0;
+    median->row = 0;
+    for (int s = 0; s < RTL_MEDIAN_MAX_STAGES; s++) {
+        median->pipe_value[s] = 0;
+        median->pipe_valid[s] = 0;
+    }
+    median->pixel_out = 0;
+    median->pixel_out_valid = 0;
+}
+
+// Compare-exchange used by the median network
+#define CMP_SWAP(a, b) do { if ((a) > (b)) { uint16_t t_ = (a); (a) = (b); (b) = t_; } } while (0)
+
+/**
+ * @brief Median of 9 values.
+ *
+ * The RTL sorts the whole window with an exchange sort and picks window[4]; any correct sort gives the
+ * same element, so the model uses the 19 compare-exchange median network instead.
+ *
+ * @param w Window (modified)
+ * @return Median value
+ */
+static uint16_t median9(uint16_t w[9]) {
+    CMP_SWAP(w[1], w[2]); CMP_SWAP(w[4], w[5]); CMP_SWAP(w[7], w[8]);
+    CMP_SWAP(w[0], w[1]); CMP_SWAP(w[3], w[4]); CMP_SWAP(w[6], w[7]);
+    CMP_SWAP(w[1], w[2]); CMP_SWAP(w[4], w[5]); CMP_SWAP(w[7], w[8]);
+    CMP_SWAP(w[0], w[3]); CMP_SWAP(w[5], w[8]); CMP_SWAP(w[4], w[7]);
+    CMP_SWAP(w[3], w[6]); CMP_SWAP(w[1], w[4]); CMP_SWAP(w[2], w[5]);
+    CMP_SWAP(w[4], w[7]); CMP_SWAP(w[4], w[2]); CMP_SWAP(w[6], w[4]);
+    CMP_SWAP(w[4], w[2]);
+    return w[4];
+}
+
+/**
+ * @brief One rising clock edge of median_filter.
+ *
+ * The window is read from the line buffers before they are written, exactly like the RTL. Because
+ * line_buf1[col-1] and line_buf1[col-2] were already overwritten earlier in the same row, the window is
+ * { P[r-1][c-2], P[r-1][c-1], P[r-2][c], P[r][c-2], P[r][c-1], P[r-1][c], P[r][c] x3 }.
+ *
+ * The RTL registers the median network PIPE_STAGES times and delays valid, the median/pass-through select
+ * and the pass-through pixel alongside it. The model computes the selected result when the pixel enters
+ * and delays it through pipe_value / pipe_valid instead, which gives the same output on every edge.
+ *
+ * @param median      Module registers
+ * @param pixel_valid Input valid
+ * @param pixel_in    Input pixel
+ */
+void rtl_median_clock(RtlMedian *median, int pixel_valid, uint16_t pixel_in) {
+    long row = median->row;
+    long col = median->col;
+    uint16_t *lb1 = median->line_buf1;
+    uint16_t *lb2 = median->line_buf2;
+
+    // Result entering the pipeline on this edge (only meaningful when pixel_valid is set)
+    uint16_t result = pixel_in;
+    if (pixel_valid && row >= 2 && col >= 2) {
+        uint16_t window[9] = {
+            lb2[col - 2], lb2[col - 1], lb2[col],
+            lb1[col - 2], lb1[col - 1], lb1[col],
+            pixel_in, pixel_in, pixel_in
+        };
+        // Unknown inputs make the comparisons unknown
+        uint16_t any_x = 0;
+        for (int i = 0; i < 9; i++) any_x |= window[i] & RTL_X;
+        result = any_x ? RTL_X : median9(window);
+    }
+
+    // Output register takes the oldest pipeline entry (or the new result without pipelining)
+    int stages = median->pipe_stages;
+    int out_valid = stages ? median->pipe_valid[stages - 1] : pixel_valid;
+    uint16_t out_value = stages ? median->pipe_value[stages - 1] : result;
+    median->pixel_out_valid = out_valid;
+    if (out_valid) median->pixel_out = out_value;
+
+    // Advance the pipeline
+    for (int s = stages - 1; s > 0; s--) {
+        median->pipe_value[s] = median->pipe_value[s - 1];
+        median->pipe_valid[s] = median->pipe_valid[s - 1];
+    }
+    if (stages) {
+        median->pipe_value[0] = result;
+        median->pipe_valid[0] = pixel_valid;
+    }
+
+    if (!pixel_valid) return;
+
+    lb2[col] = lb1[col];
+    lb1[col] = pixel_in;
+
+    if (col == median->W - 1) {
+        median->col = 0;
+        median->row = (row == median->H - 1) ? 0 : row + 1; // Next frame starts at row 0
+    } else {
+        median->col = col + 1;
+    }
+}
+
+/**
+ * @brief Releases the line buffers of a median_filter instance.
+ *
+ * @param median Module registers
+ */
+void rtl_median_free(RtlMedian *median) {
+    free(median->line_buf1);
+    free(median->line_buf2);
+    median->line_buf1 = NULL;
+    median->line_buf2 = NULL;
+}
+
+// ==============================================================================================
+// C: sobel_edge - 3x3 gradients on the filtered stream (sobel_edge.v)
+// ==============================================================================================
+/**
+ * @brief Allocates the line buffer rows of a sobel_edge instance.
+ *
+ * @param sobel Module registers
+ * @param W     Line width parameter
+ * @param H     Frame height parameter
+ * @return 0 on success, -1 on allocation failure
+ */
+int rtl_sobel_init(RtlSobel *sobel, int W, int H) {
+    sobel->W = W;
+    sobel->H = H;
+    sobel->line_buf1 = (uint16_t *)calloc(W, sizeof(uint16_t));
+    sobel->line_buf2 = (uint16_t *)calloc(W, sizeof(uint16_t));
+    if (!sobel->line_buf1 || !sobel->line_buf2) {
+        rtl_sobel_free(sobel);
+        return -1;
+    }
+    rtl_sobel_reset(sobel);
+    return 0;
+}
+
+/**
+ * @brief Applies the rst branch of sobel_edge (the line buffer itself is not reset).
+ *
+ * @param sobel Module registers
+ */
+void rtl_sobel_reset(RtlSobel *sobel) {
+    sobel->col = 0;
+    sobel->row = 0;
+    sobel->flush = 0;
+    sobel->t2 = sobel->t1 = sobel->m2 = sobel->m1 = sobel->b2 = sobel->b1 = 0;
+    sobel->s1_valid = sobel->s1_use = sobel->s1_x = 0;
+    sobel->s1_gx = sobel->s1_gy = 0;
+    sobel->s2_valid = sobel->s2_use = sobel->s2_x = 0;
+    sobel->s2_mag2 = 0;
+    sobel->edge_out = 0;
+    sobel->edge_valid = 0;
+}
+
+/**
+ * @brief floor(sqrt(v)) for v < 65536, one result bit per step like isqrt16 in sobel_edge.v.
+ *
+ * @param v Value
+ * @return Integer square root
+ */
+static uint16_t isqrt16(uint32_t v) {
+    uint32_t rem = v;
+    uint32_t root = 0;
+    for (int b = 7; b >= 0; b--) {
+        uint32_t trial = (root << (b + 1)) + (1u << (2 * b));
+        if (rem >= trial) {
+            rem -= trial;
+            root |= 1u << b;
+        }
+    }
+    return (uint16_t)root;
+}
+
+/**
+ * @brief One rising clock edge of sobel_edge.
+ *
+ * Input (r, c) completes the window centred on (r-1, c-1), which is output pixel (r*W + c) - (W + 1).
+ * Column c comes from the line buffer and pixel_in, columns c-1 and c-2 from the window registers.
+ *
+ * @param sobel       Module registers
+ * @param pixel_valid Input valid
+ * @param pixel_in    Input pixel (filtered stream)
+ */
+void rtl_sobel_clock(RtlSobel *sobel, int pixel_valid, uint16_t pixel_in) {
+    long row = sobel->row;
+    long col = sobel->col;
+    uint16_t *lb1 = sobel->line_buf1;
+    uint16_t *lb2 = sobel->line_buf2;
+
+    // Combinational gradients from the registers before this edge
+    uint16_t t0 = lb2[col], m0 = lb1[col], b0 = pixel_in;
+    int x = (t0 | m0 | b0 | sobel->t2 | sobel->t1 | sobel->m2 | sobel->b2 | sobel->b1) & RTL_X;
+    int gx = (t0 + 2 * m0 + b0) - (sobel->t2 + 2 * sobel->m2 + sobel->b2);
+    int gy = (sobel->t2 + 2 * sobel->t1 + t0) - (sobel->b2 + 2 * sobel->b1 + b0);
+    int emit_pos = row >= 1 && (row > 1 || col >= 1);
+    int use_sobel = row >= 2 && col >= 2;
+    // pixel_ready: an input that would emit waits while the previous frames' zeros still own the output
+    int take = pixel_valid && (sobel->flush == 0 || !emit_pos);
+    int emit = take && emit_pos;
+
+    // Stage 3: square root and clamp
+    sobel->edge_valid = sobel->s2_valid;
+    if (sobel->s2_valid) {
+        if (!sobel->s2_use) {
+            sobel->edge_out = 0;
+        } else if (sobel->s2_x) {
+            sobel->edge_out = RTL_X;
+        } else if (sobel->s2_mag2 >= 255 * 255) {
+            sobel->edge_out = 255;
+        } else {
+            sobel->edge_out = isqrt16((uint32_t)sobel->s2_mag2);
+        }
+    }
+
+    // Stage 2: squared magnitude
+    sobel->s2_valid = sobel->s1_valid;
+    sobel->s2_use = sobel->s1_use;
+    sobel->s2_x = sobel->s1_x;
+    sobel->s2_mag2 = (long)sobel->s1_gx * sobel->s1_gx + (long)sobel->s1_gy * sobel->s1_gy;
+
+    // Stage 1: gradients
+    sobel->s1_valid = emit || sobel->flush > 0;
+    sobel->s1_use = emit && use_sobel;
+    sobel->s1_x = x;
+    sobel->s1_gx = gx;
+    sobel->s1_gy = gy;
+
+    if (sobel->flush > 0) sobel->flush--;
+    if (!take) return;
+
+    sobel->t2 = sobel->t1; sobel->t1 = t0;
+    sobel->m2 = sobel->m1; sobel->m1 = m0;
+    sobel->b2 = sobel->b1; sobel->b1 = b0;
+    lb2[col] = lb1[col];
+    lb1[col] = pixel_in;
+
+    if (col == sobel->W - 1) {
+        sobel->col = 0;
+        if (row == sobel->H - 1) {
+            sobel->row = 0;
+            // A one-row frame owes W zeros, after any still owed
+            sobel->flush += sobel->W + (sobel->H > 1);
+        } else {
+            sobel->row = row + 1;
+        }
+    } else {
+        sobel->col = col + 1;
+    }
+}
+
+/**
+ * @brief Releases the line buffer rows of a sobel_edge instance.
+ *
+ * @param sobel Module registers
+ */
+void rtl_sobel_free(RtlSobel *sobel) {
+    free(sobel->line_buf1);
+    free(sobel->line_buf2);
+    sobel->line_buf1 = NULL;
+    sobel->line_buf2 = NULL;
+}
+
+// ==============================================================================================
+// D: tb_system - clock generation, output collection and timing variables (tb.v)
+// ==============================================================================================
+/**
+ * @brief Runs the whole tb_system simulation.
+ *
+ * The testbench monitors sample gray_valid / pixel_out_valid / edge_valid at each rising edge before
+ * the DUT registers update, so the model samples first and clocks the modules afterwards.
+ *
+ * @param mem         Byte-wide RGB memory, W*H*3 words (RTL_X where not loaded)
+ * @param W           Image width
+ * @param H           Image height
+ * @param pipe_stages PIPE_STAGES parameter of median_filter
+ * @param output      Receives W*H filtered pixels
+ * @param edges       Receives W*H edge pixels
+ * @param metrics     Receives the timing results
+ * @return 0 on success, -1 if the pipeline stops before producing W*H pixels of both streams
+ */
+int rtl_system_run(const uint16_t *mem, int W, int H, int pipe_stages, uint16_t *output, uint16_t *edges,
+                   RtlMetrics *metrics) {
+    long total_pixels = (long)W * H;
+    RtlGray gray;
+    RtlMedian median;
+    RtlSobel sobel;
+
+    memset(metrics, 0, sizeof(*metrics));
+    rtl_gray_reset(&gray, mem, (size_t)total_pixels * 3);
+    if (rtl_median_init(&median, W, H, pipe_stages) != 0) return -1;
+    if (rtl_sobel_init(&sobel, W, H) != 0) {
+        rtl_median_free(&median);
+        return -1;
+    }
+
+    int first_gray_seen = 0;
+    int first_output_seen = 0;
+    int first_edge_seen = 0;
+    metrics->input_cycle_start = RTL_RESET_RELEASE_NS;
+
+    // First rising edge with reset released; the pipeline drains within a few cycles of the last read
+    long time = RTL_RESET_RELEASE_NS + RTL_CLK_PERIOD_NS / 2;
+    long time_limit = time + (total_pixels * 3 + 16 + pipe_stages + W) * RTL_CLK_PERIOD_NS;
+
+    while (metrics->output_count < total_pixels || metrics->edge_count < total_pixels) {
+        if (time > time_limit) {
+            rtl_median_free(&median);
+            rtl_sobel_free(&sobel);
+            return -1;
+        }
+
+        // Track grayscale output timing
+        if (gray.gray_valid) {
+            if (!first_gray_seen) {
+                metrics->gray_first_output = time;
+                first_gray_seen = 1;
+            }
+            metrics->gray_pixel_count++;
+            metrics->gray_last_output = time;
+        }
+
+        // Only collect if output is truly valid (not X)
+        if (median.pixel_out_valid && metrics->output_count < total_pixels && !(median.pixel_out & RTL_X)) {
+            output[metrics->output_count] = median.pixel_out;
+            if (!first_output_seen) {
+                metrics->filt_first_output = time;
+                first_output_seen = 1;
+            }
+            metrics->filt_last_output = time;
+            metrics->output_count++;
+        }
+
+        // Edge stream from sobel_edge
+        if (sobel.edge_valid && metrics->edge_count < total_pixels && !(sobel.edge_out & RTL_X)) {
+            edges[metrics->edge_count] = sobel.edge_out;
+            if (!first_edge_seen) {
+                metrics->edge_first_output = time;
+                first_edge_seen = 1;
+            }
+            metrics->edge_last_output = time;
+            metrics->edge_count++;
+        }
+
+        // Rising edge: each module sees the registers of the one before it from before this edge
+        rtl_sobel_clock(&sobel, median.pixel_out_valid, median.pixel_out);
+        rtl_median_clock(&median, gray.gray_valid, gray.gray_out);
+        rtl_gray_clock(&gray);
+
+        time += RTL_CLK_PERIOD_NS;
+    }
+    rtl_median_free(&median);
+    rtl_sobel_free(&sobel);
+
+    // wait (output_index == TOTAL_PIXELS && edge_index == TOTAL_PIXELS); repeat (3) @(posedge clk);
+    long last_output = metrics->filt_last_output > metrics->edge_last_output ?
+                       metrics->filt_last_output : metrics->edge_last_output;
+    metrics->finish_time = last_output + 3 * RTL_CLK_PERIOD_NS;
+
+    // Same integer arithmetic as the testbench
+    metrics->latency_ns = metrics->filt_first_output - metrics->input_cycle_start;
+    metrics->latency_cycles = metrics->latency_ns / RTL_CLK_PERIOD_NS;
+    metrics->total_ns = metrics->filt_last_output - metrics->input_cycle_start;
+    metrics->total_cycles = metrics->total_ns / RTL_CLK_PERIOD_NS;
+    metrics->throughput_px_per_cycle = metrics->total_cycles > 0 ? (double)total_pixels / metrics->total_cycles : 0;
+    metrics->throughput_px_per_ns = metrics->total_ns > 0 ? (double)total_pixels / metrics->total_ns : 0;
+    metrics->gray_module_ns = metrics->gray_last_output - metrics->gray_first_output;
+    metrics->gray_module_cycles = metrics->gray_module_ns / RTL_CLK_PERIOD_NS;
+    metrics->median_module_ns = metrics->filt_last_output - metrics->filt_first_output;
+    metrics->median_module_cycles = metrics->median_module_ns / RTL_CLK_PERIOD_NS;
+    metrics->sobel_module_ns = metrics->edge_last_output - metrics->edge_first_output;
+    metrics->sobel_module_cycles = metrics->sobel_module_ns / RTL_CLK_PERIOD_NS;
+    return 0;
+}
+
+// ==============================================================================================
+// E: Memory files - $readmemh / $writememh
+// ==============================================================================================
+/**
+ * @brief Loads a hex memory file the way $readmemh does.
+ *
+ * Whitespace separated hex words, '@addr' directives and // or block comments are supported.
+ * Words that are not in the file are left as RTL_X.
+ *
+ * @param filename Memory file
+ * @param mem      Destination memory
+ * @param words    Size of the destination memory
+ * @return Number of words loaded, or -1 if the file cannot be opened
+ */
+long rtl_readmemh(const char *filename, uint16_t *mem, size_t words) {
+    FILE *f = fopen(filename, "r");
+    if (!f) return -1;
+
+    for (size_t i = 0; i < words; i++) mem[i] = RTL_X;
+
+    size_t addr = 0;
+    long loaded = 0;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        if (isspace(c)) continue;
+
+        // Comments
+        if (c == '/') {
+            int next = fgetc(f);
+            if (next == '/') {
+                while ((c = fgetc(f)) != EOF && c != '\n') {}
+            } else if (next == '*') {
+                int prev = 0;
+                while ((c = fgetc(f)) != EOF && !(prev == '*' && c == '/')) prev = c;
+            }
+            continue;
+        }
+
+        // Address directive or data word
+        int is_addr = (c == '@');
+        if (is_addr) c = fgetc(f);
+        unsigned long value = 0;
+        int digits = 0;
+        while (c != EOF && (isxdigit(c) || c == '_')) {
+            if (c != '_') {
+                value = value * 16 + (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+                digits++;
+            }
+            c = fgetc(f);
+        }
+        if (digits == 0) continue;
+
+        if (is_addr) {
+            addr = value;
+        } else {
+            if (addr < words) {
+                mem[addr] = (uint16_t)(value & 0xFF);
+                loaded++;
+            }
+            addr++;
+        }
+    }
+    fclose(f);
+    return loaded;
+}
+
+/**
+ * @brief Writes a memory the way $writememh does (two lowercase hex digits per line, 'xx' for X).
+ *
+ * @param filename Output file
+ * @param mem      Memory contents
+ * @param words    Number of words to write
+ * @return 0 on success, -1 on failure
+ */
+int rtl_writememh(const char *filename, const uint16_t *mem, size_t words) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return -1;
+    for (size_t i = 0; i < words; i++) {
+        if (mem[i] & RTL_X) {
+            fputs("xx\n", f);
+        } else {
+            fprintf(f, "%02x\n", mem[i]);
+        }
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file rtl_model.h
+ * @brief Cycle-accurate C model of the RTL pipeline (rgb_to_gray → median_filter → sobel_edge) used by tb_system
+ *
+ * Every structure below mirrors the registers of one Verilog module and every *_clock() call is one
+ * rising clock edge: outputs read before the call are the register values the next module sees at
+ * that edge, exactly like non-blocking assignments in the simulator.
+ *
+ * Pixel values are stored in 16 bits so an unknown ('X') value can be tracked: RTL_X is set when a
+ * value depends on a memory word that $readmemh never loaded.
+ */
+#ifndef RTL_MODEL_H
+#define RTL_MODEL_H
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stddef.h> // For size_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==============================================================================================
+// Constants and Structures
+// ==============================================================================================
+// Flag bit marking an unknown (X) 8-bit value
+#define RTL_X 0x100
+// Clock period used by tb_system (always #5 clk = ~clk)
+#define RTL_CLK_PERIOD_NS 10
+// Time at which tb_system releases reset (#20 rst = 0)
+#define RTL_RESET_RELEASE_NS 20
+// Largest PIPE_STAGES value of median_filter (one register per compare-exchange layer boundary)
+#define RTL_MEDIAN_MAX_STAGES 8
+// Default PIPE_STAGES value of median_filter
+#define RTL_MEDIAN_PIPE_STAGES 2
+
+/**
+ * @brief Registers of rgb_to_gray (grayscale_converter.v): 3-state FSM reading R, G, B on separate cycles
+ */
+typedef struct {
+    const uint16_t *mem;  // Byte-wide image memory (RTL_X for words not loaded)
+    size_t total_bytes;   // TOTAL_BYTES parameter
+    int state;            // FSM state: 0 = R, 1 = G, 2 = B
+    size_t addr;          // Next memory address
+    uint16_t r, g, b;     // Colour registers
+    uint16_t gray_out;    // Output register
+    int gray_valid;       // Output valid register
+} RtlGray;
+
+/**
+ * @brief Registers of median_filter (median_filter.v): two line buffers and a pipelined 3x3 median network
+ */
+typedef struct {
+    int W, H;             // Frame size parameters
+    int pipe_stages;      // PIPE_STAGES parameter
+    uint16_t *line_buf1;  // Previous row (partially overwritten by the current row)
+    uint16_t *line_buf2;  // Row before the previous one
+    long col, row;        // Position of the next input pixel
+    // Results inside the median pipeline; stage 0 is the newest
+    uint16_t pipe_value[RTL_MEDIAN_MAX_STAGES];
+    int pipe_valid[RTL_MEDIAN_MAX_STAGES];
+    uint16_t pixel_out;   // Output register
+    int pixel_out_valid;  // Output valid register
+} RtlMedian;
+
+/**
+ * @brief Registers of sobel_edge (sobel_edge.v): two rows of the filtered stream, 3x3 window and 3-stage magnitude
+ */
+typedef struct {
+    int W, H;             // Frame size parameters
+    uint16_t *line_buf1;  // Row r-1 (low byte of sobel_edge's line buffer)
+    uint16_t *line_buf2;  // Row r-2 (high byte)
+    long col, row;        // Position of the next input pixel
+    long flush;           // Border zeros still owed for the previous frames
+    uint16_t t2, t1, m2, m1, b2, b1; // Window columns c-2 and c-1
+    int s1_valid, s1_use, s1_x;      // Stage 1: gradients
+    int s1_gx, s1_gy;
+    int s2_valid, s2_use, s2_x;      // Stage 2: squared magnitude
+    long s2_mag2;
+    uint16_t edge_out;    // Output register
+    int edge_valid;       // Output valid register
+} RtlSobel;
+
+/**
+ * @brief Timing results, computed the same way as tb_system's timing variables
+ */
+typedef struct {
+    long input_cycle_start;       // Reset release time (ns)
+    long gray_first_output;       // Time first gray_valid was sampled (ns)
+    long gray_last_output;        // Time last gray_valid was sampled (ns)
+    long filt_first_output;       // Time first filtered pixel was sampled (ns)
+    long filt_last_output;        // Time last filtered pixel was sampled (ns)
+    long finish_time;             // Time $finish is called (ns)
+    long gray_pixel_count;        // Number of greyscale pixels seen
+    long output_count;            // Number of filtered pixels collected
+    long latency_cycles;          // Input to first output (cycles)
+    long latency_ns;              // Input to first output (ns)
+    long total_cycles;            // Input to last output (cycles)
+    long total_ns;                // Input to last output (ns)
+    double throughput_px_per_cycle;
+    double throughput_px_per_ns;
+    long gray_module_cycles;
+    long gray_module_ns;
+    long median_module_cycles;
+    long median_module_ns;
+    long edge_first_output;       // Time first edge pixel was sampled (ns)
+    long edge_last_output;        // Time last edge pixel was sampled (ns)
+    long edge_count;              // Number of edge pixels collected
+    long sobel_module_cycles;
+    long sobel_module_ns;
+} RtlMetrics;
+
+// ==============================================================================================
+// rgb_to_gray
+// ==============================================================================================
+void rtl_gray_reset(RtlGray *gray, const uint16_t *mem, size_t total_bytes);
+void rtl_gray_clock(RtlGray *gray);
+
+// ==============================================================================================
+// median_filter
+// ==============================================================================================
+int rtl_median_init(RtlMedian *median, int W, int H, int pipe_stages);
+void rtl_median_reset(RtlMedian *median);
+void rtl_median_clock(RtlMedian *median, int pixel_valid, uint16_t pixel_in);
+void rtl_median_free(RtlMedian *median);
+
+// ==============================================================================================
+// sobel_edge
+// ==============================================================================================
+int rtl_sobel_init(RtlSobel *sobel, int W, int H);
+void rtl_sobel_reset(RtlSobel *sobel);
+void rtl_sobel_clock(RtlSobel *sobel, int pixel_valid, uint16_t pixel_in);
+void rtl_sobel_free(RtlSobel *sobel);
+
+// ==============================================================================================
+// tb_system
+// ==============================================================================================
+int rtl_system_run(const uint16_t *mem, int W, int H, int pipe_stages, uint16_t *output, uint16_t *edges,
+                   RtlMetrics *metrics);
+
+// ==============================================================================================
+// Memory files
+// ==============================================================================================
+long rtl_readmemh(const char *filename, uint16_t *mem, size_t words);
+int rtl_writememh(const char *filename, const uint16_t *mem, size_t words);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RTL_MODEL_H
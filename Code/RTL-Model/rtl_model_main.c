@@ -0,0 +1,180 @@
+/**
+ * To compile: gcc -O2 -fdiagnostics-color=always rtl_model_main.c rtl_model.c -o rtl_model
+ */
+
+/**
+ * @file rtl_model_main.c
+ * @brief Golden-vector generator: runs the cycle-accurate model of tb_system and writes filtered.mem / edges.mem
+ *
+ * Prints the same messages and pipeline metrics as tb_system in xsim, so the two logs can be diffed.
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <stdint.h> // Defines integer types
+#include <stdio.h> // For I/O operations
+#include <stdlib.h> // For memory allocation
+#include <string.h> // For string operations
+#include <time.h> // For timing operations
+
+#include "rtl_model.h"
+
+// xsim prints %0t in picoseconds (time resolution 1 ps, timescale 1 ns)
+#define PS_PER_NS 1000
+
+/**
+ * @brief Prints command line usage.
+ *
+ * @param prog Program name (argv[0])
+ */
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-W width] [-H height] [-P pipe_stages] [-i input_image.mem] [-o filtered.mem] [-e edges.mem]\n", prog);
+    fprintf(stderr, "Defaults match tb_system: 60x60, PIPE_STAGES=%d, input_image.mem, filtered.mem, edges.mem\n",
+            RTL_MEDIAN_PIPE_STAGES);
+}
+
+/**
+ * @brief Formats a memory word like %02x, or 'xx' for X.
+ *
+ * @param value Word
+ * @param buf   Output buffer (at least 4 bytes)
+ * @return buf
+ */
+static const char *hex8(uint16_t value, char *buf) {
+    if (value & RTL_X) {
+        strcpy(buf, "xx");
+    } else {
+        snprintf(buf, 4, "%02x", value & 0xFF);
+    }
+    return buf;
+}
+
+// ==============================================================================================
+// Main Function
+// ==============================================================================================
+/**
+ * @brief Entry point of the RTL model.
+ *
+ * @param argc Number of command line arguments
+ * @param argv Array of command line argument strings
+ * @return 0 on success, 1 on failure
+ */
+int main(int argc, char *argv[]) {
+    int W = 60, H = 60;
+    int pipe_stages = RTL_MEDIAN_PIPE_STAGES;
+    const char *infile = "input_image.mem";
+    const char *outfile = "filtered.mem";
+    const char *edgefile = "edges.mem";
+
+    // Process command line arguments
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-W") == 0) {
+            W = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-H") == 0) {
+            H = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-P") == 0) {
+            pipe_stages = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-i") == 0) {
+            infile = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+            outfile = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-e") == 0) {
+            edgefile = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (W < 1 || H < 1 || pipe_stages < 0 || pipe_stages > RTL_MEDIAN_MAX_STAGES) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    long total_pixels = (long)W * H;
+    size_t total_bytes = (size_t)total_pixels * 3;
+    uint16_t *mem = malloc(total_bytes * sizeof(uint16_t));
+    uint16_t *output = malloc(total_pixels * sizeof(uint16_t));
+    uint16_t *edges = malloc(total_pixels * sizeof(uint16_t));
+    if (!mem || !output || !edges) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        free(mem);
+        free(output);
+        free(edges);
+        return 1;
+    }
+
+    // rgb_to_gray's initial block
+    printf("Loading RGB image from '%s'\n", infile);
+    long loaded = rtl_readmemh(infile, mem, total_bytes);
+    if (loaded < 0) {
+        fprintf(stderr, "Failed to open '%s'\n", infile);
+        free(mem);
+        free(output);
+        free(edges);
+        return 1;
+    }
+    if ((size_t)loaded < total_bytes) {
+        fprintf(stderr, "Warning: '%s' has %ld of %zu words, the rest are X\n", infile, loaded, total_bytes);
+    }
+    char a[4], b[4], c[4];
+    printf("mem[0]=%s, mem[1]=%s, mem[2]=%s\n", hex8(mem[0], a), hex8(mem[1], b), hex8(mem[2], c));
+    printf("Starting testbench...\n");
+
+    // Run the model
+    RtlMetrics m;
+    clock_t start = clock();
+    int status = rtl_system_run(mem, W, H, pipe_stages, output, edges, &m);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (status != 0) {
+        fprintf(stderr, "Pipeline stalled: %ld filtered and %ld edge pixels of %ld produced (tb_system would hang)\n",
+                m.output_count, m.edge_count, total_pixels);
+        free(mem);
+        free(output);
+        free(edges);
+        return 1;
+    }
+
+    printf("First grayscale pixel at time %ld ns\n", m.gray_first_output * PS_PER_NS);
+    printf("First filtered pixel (index 0): %s at time %ld ns\n", hex8(output[0], a), m.filt_first_output * PS_PER_NS);
+    printf("Last filtered pixel (index %ld): %s at time %ld ns\n", total_pixels - 1,
+           hex8(output[total_pixels - 1], a), m.filt_last_output * PS_PER_NS);
+
+    if (rtl_writememh(outfile, output, total_pixels) != 0) {
+        fprintf(stderr, "Failed to write '%s'\n", outfile);
+        free(mem);
+        free(output);
+        free(edges);
+        return 1;
+    }
+    printf("Filtered output written to %s\n", outfile);
+    printf("Total output pixels: %ld\n", m.output_count);
+    if (rtl_writememh(edgefile, edges, total_pixels) != 0) {
+        fprintf(stderr, "Failed to write '%s'\n", edgefile);
+        free(mem);
+        free(output);
+        free(edges);
+        return 1;
+    }
+    printf("Edge output written to %s\n", edgefile);
+
+    printf("------ Pipeline Metrics ------\n");
+    printf("Latency (input to first output): %ld cycles, %ld ns\n", m.latency_cycles, m.latency_ns);
+    printf("Total time (input to last output): %ld cycles, %ld ns\n", m.total_cycles, m.total_ns);
+    printf("Throughput: %0.4f pixels/clock, %0.4f pixels/ns\n", m.throughput_px_per_cycle, m.throughput_px_per_ns);
+    printf("------ Module-specific Metrics ------\n");
+    printf("Grayscale module: %ld cycles, %ld ns for %ld pixels\n", m.gray_module_cycles, m.gray_module_ns, m.gray_pixel_count);
+    printf("Median filter module: %ld cycles, %ld ns for %ld pixels\n", m.median_module_cycles, m.median_module_ns, m.output_count);
+    printf("Sobel edge module: %ld cycles, %ld ns for %ld pixels\n", m.sobel_module_cycles, m.sobel_module_ns, m.edge_count);
+    printf("-----------------------------\n");
+    printf("$finish called at time : %ld ns\n", m.finish_time);
+
+    // Model speed (not part of the simulator log)
+    fprintf(stderr, "Model: %ld pixels in %.3f s (%.2f Mpixels/s)\n", total_pixels, seconds,
+            seconds > 0 ? total_pixels / seconds / 1e6 : 0.0);
+
+    free(mem);
+    free(output);
+    free(edges);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Builds the Verilator testbench for frames up to a maximum size; the frame size itself is set at run
+# time (cfg_width / cfg_height), so one build runs every frame that fits.
+# Usage: ./build.sh [max_width] [max_height] [threads] [pipe_stages]
+#   ./build.sh                     # frames up to 1920x1080 on 4 threads
+#   ./build.sh 1920 1080 8         # ... on 8 threads
+#   ./build.sh 1920 1080 8 0       # ... with the unpipelined median network
+# Run:   ./obj_dir_<max_width>x<max_height>/vl_pipeline [--system | --median] [--image file | --random seed [--size WxH]]
+# Verilator's default lint warnings are fatal; none are waived here.
+set -e
+
+MAX_W=${1:-1920}
+MAX_H=${2:-1080}
+THREADS=${3:-4}
+PIPE_STAGES=${4:-2}
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+SRC="$HERE/../Verilog Modules/Verilog_modules2/Verilog_modules2.srcs/sources_1/new"
+
+verilator --cc --exe --build -j 0 -O3 \
+    --threads "$THREADS" \
+    --x-assign fast --x-initial fast \
+    --top-module vl_pipeline -GMAX_W="$MAX_W" -GMAX_H="$MAX_H" -GPIPE_STAGES="$PIPE_STAGES" \
+    -CFLAGS "-O2 -DVL_MAX_W=$MAX_W -DVL_MAX_H=$MAX_H -DVL_PIPE_STAGES=$PIPE_STAGES -I$HERE/../RTL-Model -I$HERE/../IEDP/Version-4" \
+    --Mdir "$HERE/obj_dir_${MAX_W}x${MAX_H}" -o vl_pipeline \
+    "$SRC/median9.v" "$SRC/line_buffer.v" "$SRC/median_filter.v" "$SRC/grayscale_converter.v" "$SRC/bram.v" "$HERE/vl_pipeline.v" \
+    "$HERE/tb_pipeline.cpp" "$HERE/../RTL-Model/rtl_model.c"
+
+echo "Built $HERE/obj_dir_${MAX_W}x${MAX_H}/vl_pipeline"
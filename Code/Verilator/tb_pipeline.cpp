@@ -0,0 +1,288 @@
+/**
+ * To build: ./build.sh [max_width] [max_height] [threads] [pipe_stages]   (see build.sh)
+ */
+
+/**
+ * @file tb_pipeline.cpp
+ * @brief Verilator testbench for rgb_to_gray / median_filter / bram_rgb with throughput reporting
+ *
+ * Streams an image (or a random frame) of any size up to the one the model was built for through
+ * vl_pipeline, with the frame size driven on cfg_width / cfg_height, runs the cycle-accurate C model
+ * (Code/RTL-Model) on a second thread, compares the two outputs pixel by pixel and reports
+ * pixels/cycle and simulated seconds per wall-clock second.
+ */
+
+// ==============================================================================================
+// Standard libraries
+// ==============================================================================================
+#include <cstdint> // Defines integer types
+#include <cstdio> // For I/O operations
+#include <cstdlib> // For memory allocation
+#include <cstring> // For string operations
+#include <chrono> // For wall-clock timing
+#include <memory> // For std::unique_ptr
+#include <thread> // For running the golden model in parallel
+#include <vector> // For pixel buffers
+
+// ==============================================================================================
+// Verilator model and project headers
+// ==============================================================================================
+#include "verilated.h"
+#include "Vvl_pipeline.h"
+#include "rtl_model.h"
+
+// stb_image.h - https://github.com/nothings/stb/blob/master/stb_image.h
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Largest frame the verilated model holds (-GMAX_W / -GMAX_H in build.sh)
+#ifndef VL_MAX_W
+#define VL_MAX_W 1920
+#endif
+#ifndef VL_MAX_H
+#define VL_MAX_H 1080
+#endif
+// median_filter PIPE_STAGES baked into the verilated model (-GPIPE_STAGES in build.sh)
+#ifndef VL_PIPE_STAGES
+#define VL_PIPE_STAGES RTL_MEDIAN_PIPE_STAGES
+#endif
+
+// Same clock as tb_system
+#define CLK_PERIOD_NS 10
+// Mismatches printed before giving up on listing them
+#define MAX_REPORTED_MISMATCHES 10
+
+/**
+ * @brief Prints command line usage.
+ *
+ * @param prog Program name (argv[0])
+ */
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--system | --median] [--image file | --random seed] [--size WxH]\n", prog);
+    fprintf(stderr, "  --system   rgb_to_gray -> median_filter (default, 1/3 pixel per clock)\n");
+    fprintf(stderr, "  --median   bram_rgb -> median_filter (1 pixel per clock)\n");
+    fprintf(stderr, "  --image    Input image, up to %dx%d (rebuild with ./build.sh W H for larger ones)\n", VL_MAX_W, VL_MAX_H);
+    fprintf(stderr, "  --random   Random frame with the given seed (default: --random 1)\n");
+    fprintf(stderr, "  --size     Size of the random frame (default: 60x60, the frame of tb_system)\n");
+}
+
+/**
+ * @brief Writes bytes as a $readmemh file (two hex digits per line).
+ *
+ * @param filename Output file
+ * @param data     Bytes to write
+ * @return true on success
+ */
+static bool write_mem(const char *filename, const std::vector<uint8_t> &data) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
+    for (uint8_t value : data) fprintf(f, "%02x\n", value);
+    return fclose(f) == 0;
+}
+
+// ==============================================================================================
+// Golden model
+// ==============================================================================================
+/**
+ * @brief Runs the C model for the selected mode.
+ *
+ * @param median_only true for mode 1 (greyscale stream straight into median_filter)
+ * @param width       Frame width
+ * @param height      Frame height
+ * @param rgb         RGB bytes of the frame
+ * @param gray        Greyscale frame (mode 1 input)
+ * @param expected    Receives W*H expected pixels (RTL_X where unknown)
+ */
+static void run_golden(bool median_only, int width, int height, const std::vector<uint8_t> &rgb,
+                       const std::vector<uint8_t> &gray, std::vector<uint16_t> &expected) {
+    const long total_pixels = (long)width * height;
+
+    if (!median_only) {
+        std::vector<uint16_t> mem(rgb.begin(), rgb.end());
+        std::vector<uint16_t> edges(total_pixels); // vl_pipeline has no sobel_edge
+        RtlMetrics metrics;
+        rtl_system_run(mem.data(), width, height, VL_PIPE_STAGES, expected.data(), edges.data(), &metrics);
+        return;
+    }
+
+    // One pixel per clock; outputs appear VL_PIPE_STAGES + 1 edges after their input, so keep
+    // clocking with pixel_valid low until the pipeline has drained
+    RtlMedian median;
+    if (rtl_median_init(&median, width, height, VL_PIPE_STAGES) != 0) return;
+    long in = 0, out = 0;
+    while (out < total_pixels) {
+        int valid = in < total_pixels;
+        rtl_median_clock(&median, valid, valid ? gray[in] : 0);
+        if (valid) in++;
+        if (median.pixel_out_valid) expected[out++] = median.pixel_out;
+    }
+    rtl_median_free(&median);
+}
+
+// ==============================================================================================
+// Main Function
+// ==============================================================================================
+/**
+ * @brief Entry point of the Verilator testbench.
+ *
+ * @param argc Number of command line arguments
+ * @param argv Array of command line argument strings
+ * @return 0 if the RTL matches the model, 1 otherwise
+ */
+int main(int argc, char *argv[]) {
+    bool median_only = false;
+    const char *image_file = nullptr;
+    unsigned seed = 1;
+    int width = 60, height = 60;
+
+    // Process command line arguments (Verilator's own +args are passed through)
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--system") == 0) {
+            median_only = false;
+        } else if (strcmp(argv[i], "--median") == 0) {
+            median_only = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "--image") == 0) {
+            image_file = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--random") == 0) {
+            seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--size") == 0) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 1 || height < 1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (argv[i][0] != '+') {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 1. Build the input frame; an image brings its own size
+    unsigned char *img = nullptr;
+    if (image_file) {
+        int channels;
+        img = stbi_load(image_file, &width, &height, &channels, 3);
+        if (!img) {
+            fprintf(stderr, "Failed to load image '%s'\n", image_file);
+            return 1;
+        }
+    }
+    if (width > VL_MAX_W || height > VL_MAX_H) {
+        fprintf(stderr, "Frame is %dx%d but the model holds at most %dx%d: ./build.sh %d %d\n",
+                width, height, VL_MAX_W, VL_MAX_H, width, height);
+        stbi_image_free(img);
+        return 1;
+    }
+
+    const long total_pixels = (long)width * height;
+    std::vector<uint8_t> rgb(total_pixels * 3);
+    std::vector<uint8_t> gray(total_pixels);
+
+    if (img) {
+        memcpy(rgb.data(), img, rgb.size());
+        stbi_image_free(img);
+    } else {
+        srand(seed);
+        for (auto &value : rgb) value = (uint8_t)(rand() & 0xFF);
+    }
+    // Greyscale frame for mode 1, using the RTL weights
+    for (long i = 0; i < total_pixels; i++) {
+        gray[i] = (uint8_t)((rgb[i * 3] * 77 + rgb[i * 3 + 1] * 150 + rgb[i * 3 + 2] * 29) >> 8);
+    }
+
+    // 2. Memory files read by $readmemh in the initial blocks
+    if (!write_mem("vl_input_rgb.mem", rgb) || !write_mem("vl_input_gray.mem", gray)) {
+        fprintf(stderr, "Failed to write memory files\n");
+        return 1;
+    }
+
+    // 3. Golden model runs on its own thread while the RTL simulates
+    std::vector<uint16_t> expected(total_pixels, RTL_X);
+    std::thread golden(run_golden, median_only, width, height, std::cref(rgb), std::cref(gray), std::ref(expected));
+
+    // 4. RTL simulation
+    const std::unique_ptr<VerilatedContext> context{new VerilatedContext};
+    context->commandArgs(argc, argv);
+    const std::unique_ptr<Vvl_pipeline> top{new Vvl_pipeline{context.get()}};
+
+    printf("Simulating %dx%d frame (model built for up to %dx%d), mode %s, %d Verilator thread(s)\n",
+           width, height, VL_MAX_W, VL_MAX_H,
+           median_only ? "median (bram_rgb -> median_filter)" : "system (rgb_to_gray -> median_filter)",
+           (int)context->threads());
+
+    std::vector<uint8_t> output;
+    output.reserve(total_pixels);
+    long cycle = 0;
+    long first_output_cycle = -1;
+    long last_output_cycle = -1;
+    // Generous bound: the system path needs 3 cycles per pixel
+    const long cycle_limit = total_pixels * 3 + 64;
+
+    top->mode = median_only ? 1 : 0;
+    top->cfg_width = (uint16_t)width;
+    top->cfg_height = (uint16_t)height;
+    top->rst = 1;
+    top->clk = 0;
+
+    auto wall_start = std::chrono::steady_clock::now();
+    while ((long)output.size() < total_pixels && cycle < cycle_limit && !context->gotFinish()) {
+        // Hold reset for two cycles, like tb_system's #20
+        if (cycle == 2) top->rst = 0;
+
+        top->clk = 0;
+        top->eval();
+        context->timeInc(CLK_PERIOD_NS / 2);
+        top->clk = 1;
+        top->eval();
+        context->timeInc(CLK_PERIOD_NS / 2);
+
+        // Registered outputs after this edge
+        if (!top->rst && top->pixel_out_valid) {
+            if (first_output_cycle < 0) first_output_cycle = cycle;
+            last_output_cycle = cycle;
+            output.push_back(top->pixel_out);
+        }
+        cycle++;
+    }
+    auto wall_end = std::chrono::steady_clock::now();
+    top->final();
+    golden.join();
+
+    // 5. Compare against the golden model
+    long mismatches = 0;
+    long unknown = 0;
+    for (long i = 0; i < (long)output.size(); i++) {
+        if (expected[i] & RTL_X) {
+            unknown++;
+            continue;
+        }
+        if (output[i] != expected[i]) {
+            if (mismatches < MAX_REPORTED_MISMATCHES) {
+                printf("Mismatch at pixel %ld (x=%ld, y=%ld): RTL %02x, model %02x\n",
+                       i, i % width, i / width, output[i], expected[i]);
+            }
+            mismatches++;
+        }
+    }
+
+    // 6. Throughput report
+    double wall_seconds = std::chrono::duration<double>(wall_end - wall_start).count();
+    long active_cycles = last_output_cycle - 2 + 1; // From reset release to the last output
+    double simulated_seconds = (double)cycle * CLK_PERIOD_NS * 1e-9;
+
+    printf("------ Co-simulation Results ------\n");
+    printf("Output pixels: %zu of %ld\n", output.size(), total_pixels);
+    printf("Mismatches: %ld (%ld pixels unknown in the model)\n", mismatches, unknown);
+    if (first_output_cycle >= 0) {
+        printf("Latency (reset release to first output): %ld cycles\n", first_output_cycle - 2 + 1);
+        printf("Throughput: %0.4f pixels/clock over %ld cycles\n", (double)output.size() / active_cycles, active_cycles);
+    }
+    printf("Wall time: %.3f s, %.3f Mcycles/s, %.3f Mpixels/s\n", wall_seconds,
+           cycle / wall_seconds / 1e6, output.size() / wall_seconds / 1e6);
+    printf("Simulated time: %.6f s at %d ns/clock (%.6f simulated s per wall s)\n",
+           simulated_seconds, CLK_PERIOD_NS, simulated_seconds / wall_seconds);
+    printf("-----------------------------------\n");
+
+    bool pass = mismatches == 0 && (long)output.size() == total_pixels;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
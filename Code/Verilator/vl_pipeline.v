@@ -0,0 +1,71 @@
+`timescale 1ns / 1ps
+
+// Verilator top level for tb_pipeline.cpp
+//   mode = 0: rgb_to_gray (loads RGB_MEM_FILE) -> median_filter, same wiring as tb_system
+//   mode = 1: bram_rgb (greyscale frame in GRAY_MEM_FILE) -> median_filter at one pixel per clock
+// Built once for frames up to MAX_W x MAX_H; the frame size comes from cfg_width / cfg_height.
+module vl_pipeline #(
+    parameter MAX_W = 1920,
+    parameter MAX_H = 1080,
+    parameter PIPE_STAGES = 2,
+    parameter RGB_MEM_FILE = "vl_input_rgb.mem",
+    parameter GRAY_MEM_FILE = "vl_input_gray.mem"
+)(
+    input wire clk,
+    input wire rst,
+    input wire mode,
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height,
+    output wire [7:0] pixel_out,
+    output wire pixel_out_valid
+);
+
+    localparam MAX_PIXELS = MAX_W * MAX_H;
+    localparam ADDR_WIDTH = $clog2(MAX_PIXELS);
+
+    wire [31:0] frame_pixels = {16'd0, cfg_width} * {16'd0, cfg_height};
+
+    // RGB -> Grayscale (held in reset in mode 1). It reads on past the frame into the unused part of its
+    // memory; median_filter starts a new frame there, after the pixels the testbench collects
+    wire [7:0] sys_gray;
+    wire sys_gray_valid;
+
+    rgb_to_gray #(.MEM_FILE(RGB_MEM_FILE), .TOTAL_BYTES(MAX_PIXELS*3))
+        gray_inst (.clk(clk), .rst(rst | mode), .gray_out(sys_gray), .gray_valid(sys_gray_valid));
+
+    // BRAM (holds the greyscale frame) read one address per clock in mode 1
+    reg [31:0] rd_addr;
+    reg rd_valid;
+    wire [7:0] bram_gray;
+
+    bram_rgb #(8, ADDR_WIDTH, GRAY_MEM_FILE) bram_inst (
+        .clk(clk),
+        .addr(rd_addr[ADDR_WIDTH-1:0]),
+        .data_out(bram_gray)
+    );
+
+    // data_out is registered, so valid is registered alongside it
+    always @(posedge clk) begin
+        if (rst || !mode) begin
+            rd_addr <= 0;
+            rd_valid <= 0;
+        end else begin
+            rd_valid <= (rd_addr < frame_pixels);
+            if (rd_addr < frame_pixels)
+                rd_addr <= rd_addr + 1;
+        end
+    end
+
+    // Median Filter
+    median_filter #(.MAX_W(MAX_W), .PIPE_STAGES(PIPE_STAGES)) filter_inst (
+        .clk(clk),
+        .rst(rst),
+        .pixel_in(mode ? bram_gray : sys_gray),
+        .pixel_valid(mode ? rd_valid : sys_gray_valid),
+        .pixel_out(pixel_out),
+        .pixel_out_valid(pixel_out_valid),
+        .cfg_width(cfg_width),
+        .cfg_height(cfg_height)
+    );
+
+endmodule
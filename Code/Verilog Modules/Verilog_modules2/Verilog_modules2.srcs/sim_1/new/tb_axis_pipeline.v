@@ -0,0 +1,186 @@
+`timescale 1ns / 1ps
+
+// AXI4-Stream pipeline axis_bram_rgb -> axis_rgb_to_gray -> axis_median_filter -> axis_sobel_edge
+// under random backpressure. Each pass holds tready low at the sink for a share of the clocks and
+// reports the sustained throughput; every pass must deliver the same pixels as a plain median_filter
+// and sobel_edge fed at full rate, with tuser on the first pixel and tlast at the end of each line.
+// Prints PASS, or stops with $fatal on a mismatch or a timeout.
+module tb_axis_pipeline;
+
+    parameter W = 60;
+    parameter H = 60;
+    parameter TOTAL_PIXELS = W * H;
+    parameter SEED = 1;
+    parameter TIMEOUT = 16 * TOTAL_PIXELS; // Clocks, reference run and all four passes
+
+    reg clk = 0, rst = 1, ref_rst = 1;
+    always #5 clk = ~clk; // 10ns clock period
+
+    reg [23:0] frame   [0:TOTAL_PIXELS-1];
+    reg [7:0]  gray    [0:TOTAL_PIXELS-1];
+    reg [7:0]  ref_out [0:TOTAL_PIXELS-1];
+
+    integer seed;
+    integer i, pass;
+    integer ref_in_index = 0, ref_count = 0;
+    integer out_count = 0;
+    integer ready_clocks = 0; // Clocks tready was high from the first output to the last
+    integer errors = 0, total_errors = 0;
+    integer start_time = 0, last_time = 0;
+    integer ready_pct = 100;
+
+    // Reference: median_filter -> sobel_edge at one pixel per clock, no flow control
+    reg [7:0] ref_in = 0;
+    reg ref_valid = 0;
+    wire [7:0] ref_med, ref_pix;
+    wire ref_med_valid, ref_pix_valid;
+
+    median_filter #(.MAX_W(W)) ref_inst (
+        .clk(clk), .rst(ref_rst),
+        .pixel_in(ref_in), .pixel_valid(ref_valid),
+        .pixel_out(ref_med), .pixel_out_valid(ref_med_valid),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0])
+    );
+
+    sobel_edge #(.MAX_W(W)) ref_sobel_inst (
+        .clk(clk), .rst(ref_rst),
+        .pixel_in(ref_med), .pixel_valid(ref_med_valid), .pixel_ready(),
+        .edge_out(ref_pix), .edge_valid(ref_pix_valid), .m_ready(1'b1),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0])
+    );
+
+    // DUT chain
+    wire [23:0] rgb_tdata;
+    wire rgb_tvalid, rgb_tready, rgb_tlast, rgb_tuser;
+    wire [7:0] gray_tdata;
+    wire gray_tvalid, gray_tready, gray_tlast, gray_tuser;
+    wire [7:0] filt_tdata;
+    wire filt_tvalid, filt_tready, filt_tlast, filt_tuser;
+    wire [7:0] edge_tdata;
+    wire edge_tvalid, edge_tlast, edge_tuser;
+    reg edge_tready = 1;
+
+    axis_bram_rgb #(.MAX_PIXELS(TOTAL_PIXELS), .MEM_FILE("rgb_image.mem")) src_inst (
+        .clk(clk), .rst(rst),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0]),
+        .m_axis_tdata(rgb_tdata), .m_axis_tvalid(rgb_tvalid), .m_axis_tready(rgb_tready),
+        .m_axis_tlast(rgb_tlast), .m_axis_tuser(rgb_tuser)
+    );
+
+    axis_rgb_to_gray gray_inst (
+        .clk(clk), .rst(rst),
+        .s_axis_tdata(rgb_tdata), .s_axis_tvalid(rgb_tvalid), .s_axis_tready(rgb_tready),
+        .s_axis_tlast(rgb_tlast), .s_axis_tuser(rgb_tuser),
+        .m_axis_tdata(gray_tdata), .m_axis_tvalid(gray_tvalid), .m_axis_tready(gray_tready),
+        .m_axis_tlast(gray_tlast), .m_axis_tuser(gray_tuser)
+    );
+
+    axis_median_filter #(.MAX_W(W)) filter_inst (
+        .clk(clk), .rst(rst),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0]),
+        .s_axis_tdata(gray_tdata), .s_axis_tvalid(gray_tvalid), .s_axis_tready(gray_tready),
+        .s_axis_tlast(gray_tlast), .s_axis_tuser(gray_tuser),
+        .m_axis_tdata(filt_tdata), .m_axis_tvalid(filt_tvalid), .m_axis_tready(filt_tready),
+        .m_axis_tlast(filt_tlast), .m_axis_tuser(filt_tuser)
+    );
+
+    axis_sobel_edge #(.MAX_W(W)) sobel_inst (
+        .clk(clk), .rst(rst),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0]),
+        .s_axis_tdata(filt_tdata), .s_axis_tvalid(filt_tvalid), .s_axis_tready(filt_tready),
+        .s_axis_tlast(filt_tlast), .s_axis_tuser(filt_tuser),
+        .m_axis_tdata(edge_tdata), .m_axis_tvalid(edge_tvalid), .m_axis_tready(edge_tready),
+        .m_axis_tlast(edge_tlast), .m_axis_tuser(edge_tuser)
+    );
+
+    // Main simulation control
+    initial begin
+        $display("Starting AXI4-Stream pipeline testbench...");
+        seed = SEED;
+        for (i = 0; i < TOTAL_PIXELS; i = i + 1) begin
+            frame[i] = $random(seed);
+            gray[i] = (frame[i][23:16] * 77 + frame[i][15:8] * 150 + frame[i][7:0] * 29) >> 8;
+        end
+
+        // Replace whatever $readmemh loaded with the random frame
+        #1;
+        for (i = 0; i < TOTAL_PIXELS; i = i + 1)
+            src_inst.reader_inst.bram_inst.mem[i] = frame[i];
+
+        // Reference run
+        #19 ref_rst = 0;
+        for (ref_in_index = 0; ref_in_index < TOTAL_PIXELS; ref_in_index = ref_in_index + 1) begin
+            @(negedge clk);
+            ref_in = gray[ref_in_index];
+            ref_valid = 1;
+        end
+        @(negedge clk) ref_valid = 0;
+        wait (ref_count == TOTAL_PIXELS);
+
+        $display("------ AXI4-Stream Pipeline Metrics ------");
+        for (pass = 0; pass < 4; pass = pass + 1) begin
+            ready_pct = 100 - 25 * pass;
+            out_count = 0;
+            ready_clocks = 0;
+            errors = 0;
+            rst = 1;
+            repeat (2) @(posedge clk);
+            @(negedge clk) rst = 0;
+            start_time = $time;
+
+            wait (out_count == TOTAL_PIXELS);
+            repeat (3) @(posedge clk);
+
+            $display("tready %0d%%: %0d cycles, %0.4f pixels/clock, %0.4f pixels/ready clock, %0d mismatches",
+                     ready_pct, (last_time - start_time) / 10,
+                     (1.0 * TOTAL_PIXELS) / ((last_time - start_time) / 10), (1.0 * TOTAL_PIXELS) / ready_clocks,
+                     errors);
+            total_errors = total_errors + errors;
+        end
+        $display("------------------------------------------");
+
+        if (total_errors == 0)
+            $display("PASS");
+        else
+            $fatal(1, "FAIL (%0d mismatches)", total_errors);
+        $finish;
+    end
+
+    // A stalled pipeline must fail instead of hanging
+    initial begin
+        #(TIMEOUT * 10);
+        $fatal(1, "FAIL: timed out after %0d clocks (reference %0d, pass %0d %0d of %0d pixels)", TIMEOUT,
+               ref_count, pass, out_count, TOTAL_PIXELS);
+    end
+
+    // Collect reference outputs
+    always @(posedge clk) begin
+        if (!ref_rst && ref_pix_valid && ref_count < TOTAL_PIXELS) begin
+            ref_out[ref_count] = ref_pix;
+            ref_count = ref_count + 1;
+        end
+    end
+
+    // Sink: ready on ready_pct percent of the clocks
+    always @(negedge clk) begin
+        edge_tready <= ($unsigned($random(seed)) % 100) < ready_pct;
+    end
+
+    // Check every beat: data, start of frame and end of line
+    always @(posedge clk) begin
+        if (!rst && edge_tready && (out_count > 0 || edge_tvalid) && out_count < TOTAL_PIXELS)
+            ready_clocks = ready_clocks + 1;
+        if (!rst && edge_tvalid && edge_tready && out_count < TOTAL_PIXELS) begin
+            if (edge_tdata !== ref_out[out_count] || edge_tuser !== (out_count == 0) ||
+                edge_tlast !== (out_count % W == W - 1)) begin
+                if (errors < 10)
+                    $display("Mismatch at pixel %0d: %02x tuser %b tlast %b, expected %02x", out_count,
+                             edge_tdata, edge_tuser, edge_tlast, ref_out[out_count]);
+                errors = errors + 1;
+            end
+            last_time = $time;
+            out_count = out_count + 1;
+        end
+    end
+
+endmodule
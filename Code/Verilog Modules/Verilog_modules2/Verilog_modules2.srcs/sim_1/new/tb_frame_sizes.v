@@ -0,0 +1,267 @@
+`timescale 1ns / 1ps
+
+// Runs frames of different sizes back to back, without reset and without waiting for the outputs to
+// drain, through one median_filter and one sobel_edge (built for MAX_W). median_filter streams the
+// random frames at one pixel per clock; sobel_edge streams the expected median output the same way
+// but honours pixel_ready, which drops while the zeros owed for a wider frame are still leaving. The
+// next size is put on cfg_width / cfg_height while the current frame is still streaming; it must only
+// take effect at the next frame. Outputs are checked against behavioural models of both modules, and
+// every frame must produce exactly width x height pixels of each stream. Prints PASS, or stops with
+// $fatal on a mismatch, a missing frame or a timeout.
+module tb_frame_sizes;
+
+    parameter MAX_W = 64;
+    parameter FRAMES = 7;
+    parameter MAX_PIXELS = 2048; // All frames together
+    parameter SEED = 1;
+    parameter TIMEOUT = 20 * MAX_PIXELS; // Clocks
+
+    reg clk = 0, rst = 1;
+    always #5 clk = ~clk; // 10ns clock period
+
+    // Frame sizes and the first pixel of each frame in the concatenated streams
+    integer widths  [0:FRAMES-1];
+    integer heights [0:FRAMES-1];
+    integer starts  [0:FRAMES];
+
+    reg [7:0] frame    [0:MAX_PIXELS-1];
+    reg [7:0] filt_ref [0:MAX_PIXELS-1];
+    reg [7:0] edge_ref [0:MAX_PIXELS-1];
+
+    integer seed;
+    integer f, i, r, c, fw, fh, base;
+    integer mf, mi, sf, si;
+    integer filt_count = 0, edge_count = 0;
+    integer filt_frame = 0, edge_frame = 0;
+    integer frame_filt = 0, frame_edge = 0;
+    integer stalls = 0;
+    integer frame_stalls [0:FRAMES-1]; // sobel_edge input stall clocks of each frame
+    integer errors = 0;
+    reg [7:0] win [0:8];
+    reg [7:0] t;
+    integer gx, gy, mag;
+
+    // median_filter input: the random frames
+    reg [15:0] m_cfg_width, m_cfg_height;
+    reg [7:0] m_pixel = 0;
+    reg m_valid = 0;
+    wire [7:0] filt_out;
+    wire filt_valid;
+
+    // sobel_edge input: the expected median_filter output
+    reg [15:0] s_cfg_width, s_cfg_height;
+    reg [7:0] s_pixel = 0;
+    reg s_valid = 0;
+    wire s_ready;
+    wire [7:0] edge_out;
+    wire edge_valid;
+
+    median_filter #(.MAX_W(MAX_W)) filter_inst (
+        .clk(clk), .rst(rst),
+        .pixel_in(m_pixel), .pixel_valid(m_valid),
+        .pixel_out(filt_out), .pixel_out_valid(filt_valid),
+        .cfg_width(m_cfg_width), .cfg_height(m_cfg_height)
+    );
+
+    sobel_edge #(.MAX_W(MAX_W)) sobel_inst (
+        .clk(clk), .rst(rst),
+        .pixel_in(s_pixel), .pixel_valid(s_valid), .pixel_ready(s_ready),
+        .edge_out(edge_out), .edge_valid(edge_valid), .m_ready(1'b1),
+        .cfg_width(s_cfg_width), .cfg_height(s_cfg_height)
+    );
+
+    // Median of the 9 window entries
+    task median9_ref;
+        output [7:0] med;
+        integer a, b;
+        begin
+            for (a = 0; a < 9; a = a + 1)
+                for (b = a + 1; b < 9; b = b + 1)
+                    if (win[a] > win[b]) begin
+                        t = win[a];
+                        win[a] = win[b];
+                        win[b] = t;
+                    end
+            med = win[4];
+        end
+    endtask
+
+    // Expected median_filter and sobel_edge outputs of the fw x fh frame starting at frame[base]
+    task build_reference;
+        begin
+            for (r = 0; r < fh; r = r + 1)
+                for (c = 0; c < fw; c = c + 1) begin
+                    if (r >= 2 && c >= 2) begin
+                        win[0] = frame[base + (r-1)*fw + c-2];
+                        win[1] = frame[base + (r-1)*fw + c-1];
+                        win[2] = frame[base + (r-2)*fw + c];
+                        win[3] = frame[base + r*fw + c-2];
+                        win[4] = frame[base + r*fw + c-1];
+                        win[5] = frame[base + (r-1)*fw + c];
+                        win[6] = frame[base + r*fw + c];
+                        win[7] = frame[base + r*fw + c];
+                        win[8] = frame[base + r*fw + c];
+                        median9_ref(filt_ref[base + r*fw + c]);
+                    end else begin
+                        filt_ref[base + r*fw + c] = frame[base + r*fw + c];
+                    end
+                end
+            for (r = 0; r < fh; r = r + 1)
+                for (c = 0; c < fw; c = c + 1) begin
+                    if (r == 0 || c == 0 || r == fh - 1 || c == fw - 1) begin
+                        edge_ref[base + r*fw + c] = 0;
+                    end else begin
+                        gx = filt_ref[base + (r-1)*fw + c+1] + 2 * filt_ref[base + r*fw + c+1]
+                           + filt_ref[base + (r+1)*fw + c+1] - filt_ref[base + (r-1)*fw + c-1]
+                           - 2 * filt_ref[base + r*fw + c-1] - filt_ref[base + (r+1)*fw + c-1];
+                        gy = filt_ref[base + (r-1)*fw + c-1] + 2 * filt_ref[base + (r-1)*fw + c]
+                           + filt_ref[base + (r-1)*fw + c+1] - filt_ref[base + (r+1)*fw + c-1]
+                           - 2 * filt_ref[base + (r+1)*fw + c] - filt_ref[base + (r+1)*fw + c+1];
+                        mag = 0;
+                        while ((mag + 1) * (mag + 1) <= gx * gx + gy * gy && mag < 255)
+                            mag = mag + 1;
+                        edge_ref[base + r*fw + c] = mag;
+                    end
+                end
+        end
+    endtask
+
+    // Main simulation control
+    initial begin
+        $display("Starting frame size testbench...");
+        seed = SEED;
+        // Narrower frames after wider ones, and one-row frames, which owe sobel_edge no W + 1 zeros
+        widths[0] = 64; heights[0] = 8;
+        widths[1] = 17; heights[1] = 5;
+        widths[2] = 40; heights[2] = 12;
+        widths[3] = 2;  heights[3] = 1;
+        widths[4] = 3;  heights[4] = 16;
+        widths[5] = 23; heights[5] = 1;
+        widths[6] = 5;  heights[6] = 3;
+
+        starts[0] = 0;
+        for (f = 0; f < FRAMES; f = f + 1) begin
+            fw = widths[f];
+            fh = heights[f];
+            base = starts[f];
+            starts[f + 1] = base + fw * fh;
+            frame_stalls[f] = 0;
+            for (i = 0; i < fw * fh; i = i + 1)
+                frame[base + i] = $random(seed);
+            build_reference;
+        end
+
+        m_cfg_width = widths[0];
+        m_cfg_height = heights[0];
+        s_cfg_width = widths[0];
+        s_cfg_height = heights[0];
+        #20 rst = 0;
+
+        fork
+            // median_filter: every frame right after the previous one, one pixel per clock
+            begin
+                for (mf = 0; mf < FRAMES; mf = mf + 1)
+                    for (mi = 0; mi < widths[mf] * heights[mf]; mi = mi + 1) begin
+                        @(negedge clk);
+                        m_pixel = frame[starts[mf] + mi];
+                        m_valid = 1;
+                        // Announce the next frame's size half way through this one
+                        if (mi == widths[mf] * heights[mf] / 2 && mf + 1 < FRAMES) begin
+                            m_cfg_width = widths[mf + 1];
+                            m_cfg_height = heights[mf + 1];
+                        end
+                    end
+                @(negedge clk) m_valid = 0;
+            end
+            // sobel_edge: the same, holding each pixel until pixel_ready takes it
+            begin
+                for (sf = 0; sf < FRAMES; sf = sf + 1)
+                    for (si = 0; si < widths[sf] * heights[sf]; si = si + 1) begin
+                        @(negedge clk);
+                        s_pixel = filt_ref[starts[sf] + si];
+                        s_valid = 1;
+                        if (si == widths[sf] * heights[sf] / 2 && sf + 1 < FRAMES) begin
+                            s_cfg_width = widths[sf + 1];
+                            s_cfg_height = heights[sf + 1];
+                        end
+                        @(posedge clk);
+                        while (!s_ready) begin
+                            stalls = stalls + 1;
+                            frame_stalls[sf] = frame_stalls[sf] + 1;
+                            @(posedge clk);
+                        end
+                    end
+                @(negedge clk) s_valid = 0;
+            end
+        join
+
+        // sobel_edge owes at most MAX_W + 1 zeros, plus its three pipeline stages
+        repeat (MAX_W + 8) @(posedge clk);
+
+        $display("sobel_edge input stalls: %0d clocks", stalls);
+        if (filt_frame != FRAMES || edge_frame != FRAMES)
+            $display("Only %0d median_filter and %0d sobel_edge frames complete (%0d and %0d of %0d pixels)",
+                     filt_frame, edge_frame, filt_count, edge_count, starts[FRAMES]);
+        if (errors == 0 && filt_frame == FRAMES && edge_frame == FRAMES)
+            $display("PASS");
+        else
+            $fatal(1, "FAIL (%0d mismatches, %0d and %0d of %0d frames)", errors, filt_frame, edge_frame, FRAMES);
+        $finish;
+    end
+
+    // A pixel_ready that never returns must fail instead of hanging
+    initial begin
+        #(TIMEOUT * 10);
+        $fatal(1, "FAIL: timed out after %0d clocks (%0d and %0d of %0d pixels)", TIMEOUT, filt_count, edge_count,
+               starts[FRAMES]);
+    end
+
+    // Check outputs; a dropped or extra pixel shows up as a short frame count or an extra pixel
+    always @(posedge clk) begin
+        if (filt_valid) begin
+            if (filt_count >= starts[FRAMES]) begin
+                if (errors < 10)
+                    $display("Extra median_filter pixel: %02x", filt_out);
+                errors = errors + 1;
+            end else begin
+                if (filt_out !== filt_ref[filt_count]) begin
+                    if (errors < 10)
+                        $display("Frame %0d filtered pixel %0d: %02x, expected %02x", filt_frame,
+                                 filt_count - starts[filt_frame], filt_out, filt_ref[filt_count]);
+                    errors = errors + 1;
+                end
+                filt_count = filt_count + 1;
+                frame_filt = frame_filt + 1;
+                if (filt_count == starts[filt_frame + 1]) begin
+                    $display("median_filter frame %0d (%0dx%0d): %0d pixels", filt_frame, widths[filt_frame],
+                             heights[filt_frame], frame_filt);
+                    filt_frame = filt_frame + 1;
+                    frame_filt = 0;
+                end
+            end
+        end
+        if (edge_valid) begin
+            if (edge_count >= starts[FRAMES]) begin
+                if (errors < 10)
+                    $display("Extra sobel_edge pixel: %02x", edge_out);
+                errors = errors + 1;
+            end else begin
+                if (edge_out !== edge_ref[edge_count]) begin
+                    if (errors < 10)
+                        $display("Frame %0d edge pixel %0d: %02x, expected %02x", edge_frame,
+                                 edge_count - starts[edge_frame], edge_out, edge_ref[edge_count]);
+                    errors = errors + 1;
+                end
+                edge_count = edge_count + 1;
+                frame_edge = frame_edge + 1;
+                if (edge_count == starts[edge_frame + 1]) begin
+                    $display("sobel_edge frame %0d (%0dx%0d): %0d pixels, %0d input stall clocks", edge_frame,
+                             widths[edge_frame], heights[edge_frame], frame_edge, frame_stalls[edge_frame]);
+                    edge_frame = edge_frame + 1;
+                    frame_edge = 0;
+                end
+            end
+        end
+    end
+
+endmodule
@@ -0,0 +1,135 @@
+`timescale 1ns / 1ps
+
+// Checks bram_rgb_reader -> rgb_to_gray_pipe on a random RRGGBB frame: first at full rate (reports
+// pixels/clock), then with a randomly stalling consumer (no pixel may be lost or repeated; reports
+// pixels per clock and per ready clock). The reader's pixels and first / line-end flags and the grey
+// values are checked against the frame. Prints PASS, or stops with $fatal on a mismatch or a timeout.
+module tb_gray_stream;
+
+    parameter W = 60;
+    parameter H = 60;
+    parameter TOTAL_PIXELS = W * H;
+    parameter SEED = 1;
+    parameter TIMEOUT = 16 * TOTAL_PIXELS; // Clocks, both passes
+
+    reg clk = 0, rst = 1;
+    always #5 clk = ~clk; // 10ns clock period
+
+    reg [23:0] frame    [0:TOTAL_PIXELS-1];
+    reg [7:0]  expected [0:TOTAL_PIXELS-1];
+
+    integer seed;
+    integer i, pass;
+    integer out_count = 0;
+    integer rgb_count = 0;    // Reader beats accepted in this pass
+    integer ready_clocks = 0; // Clocks the consumer was ready from the first output to the last
+    integer errors = 0;
+    integer start_time = 0, first_time = 0, last_time = 0;
+    reg stall_mode = 0;
+
+    // DUTs
+    wire [23:0] rgb;
+    wire rgb_valid, rgb_ready;
+    wire rgb_first, rgb_line_end;
+    wire [7:0] gray;
+    wire gray_valid;
+    reg gray_ready = 1;
+
+    bram_rgb_reader #(.MAX_PIXELS(TOTAL_PIXELS), .MEM_FILE("rgb_image.mem")) reader_inst (
+        .clk(clk), .rst(rst),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0]),
+        .m_rgb(rgb), .m_valid(rgb_valid), .m_ready(rgb_ready),
+        .m_first(rgb_first), .m_line_end(rgb_line_end)
+    );
+
+    rgb_to_gray_pipe gray_inst (
+        .clk(clk), .rst(rst),
+        .s_rgb(rgb), .s_valid(rgb_valid), .s_ready(rgb_ready),
+        .m_gray(gray), .m_valid(gray_valid), .m_ready(gray_ready)
+    );
+
+    // Main simulation control
+    initial begin
+        $display("Starting RGB stream testbench...");
+        seed = SEED;
+        for (i = 0; i < TOTAL_PIXELS; i = i + 1) begin
+            frame[i] = $random(seed);
+            expected[i] = (frame[i][23:16] * 77 + frame[i][15:8] * 150 + frame[i][7:0] * 29) >> 8;
+        end
+
+        // Replace whatever $readmemh loaded with the random frame
+        #1;
+        for (i = 0; i < TOTAL_PIXELS; i = i + 1)
+            reader_inst.bram_inst.mem[i] = frame[i];
+
+        for (pass = 0; pass < 2; pass = pass + 1) begin
+            stall_mode = pass;
+            out_count = 0;
+            rgb_count = 0;
+            ready_clocks = 0;
+            rst = 1;
+            repeat (2) @(posedge clk);
+            @(negedge clk) rst = 0;
+            start_time = $time;
+
+            wait (out_count == TOTAL_PIXELS);
+            repeat (3) @(posedge clk);
+
+            $display("%s: %0d pixels, latency %0d cycles, %0d cycles, %0.4f pixels/clock, %0.4f pixels/ready clock",
+                     stall_mode ? "Random stalls" : "Full rate", out_count,
+                     (first_time - start_time) / 10, (last_time - start_time) / 10,
+                     (1.0 * TOTAL_PIXELS) / ((last_time - start_time) / 10), (1.0 * TOTAL_PIXELS) / ready_clocks);
+        end
+
+        if (errors == 0)
+            $display("PASS");
+        else
+            $fatal(1, "FAIL (%0d mismatches)", errors);
+        $finish;
+    end
+
+    // A stream that stops short of TOTAL_PIXELS must fail instead of hanging
+    initial begin
+        #(TIMEOUT * 10);
+        $fatal(1, "FAIL: timed out after %0d clocks (pass %0d, %0d of %0d pixels)", TIMEOUT, pass, out_count,
+               TOTAL_PIXELS);
+    end
+
+    // Consumer: always ready, or ready on about half of the clocks
+    always @(negedge clk) begin
+        gray_ready <= stall_mode ? $random(seed) : 1'b1;
+    end
+
+    // Check the reader's beats: pixel, start of frame and end of line. It repeats the frame, so the
+    // beats after the first frame must start it over
+    always @(posedge clk) begin
+        if (!rst && rgb_valid && rgb_ready) begin
+            if (rgb !== frame[rgb_count % TOTAL_PIXELS] || rgb_first !== (rgb_count % TOTAL_PIXELS == 0) ||
+                rgb_line_end !== (rgb_count % W == W - 1)) begin
+                if (errors < 10)
+                    $display("Reader mismatch at beat %0d: %06x first %b line end %b, expected %06x",
+                             rgb_count, rgb, rgb_first, rgb_line_end, frame[rgb_count % TOTAL_PIXELS]);
+                errors = errors + 1;
+            end
+            rgb_count = rgb_count + 1;
+        end
+    end
+
+    // Collect and check outputs
+    always @(posedge clk) begin
+        if (!rst && gray_ready && (out_count > 0 || gray_valid) && out_count < TOTAL_PIXELS)
+            ready_clocks = ready_clocks + 1;
+        if (!rst && gray_valid && gray_ready && out_count < TOTAL_PIXELS) begin
+            if (gray !== expected[out_count]) begin
+                if (errors < 10)
+                    $display("Mismatch at pixel %0d: %02x, expected %02x", out_count, gray, expected[out_count]);
+                errors = errors + 1;
+            end
+            if (out_count == 0)
+                first_time = $time;
+            last_time = $time;
+            out_count = out_count + 1;
+        end
+    end
+
+endmodule
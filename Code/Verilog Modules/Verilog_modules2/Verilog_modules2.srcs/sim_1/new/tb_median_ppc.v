@@ -0,0 +1,205 @@
+`timescale 1ns / 1ps
+
+// Checks median_filter_ppc (PPC = 2 and 4) and the 1-PPC median_filter against a behavioural model of
+// the median_filter window on a random frame and reports the pixel rate of each. Prints PASS, or stops
+// with $fatal on a mismatch or a timeout.
+module tb_median_ppc;
+
+    parameter W = 60;
+    parameter H = 60;
+    parameter TOTAL_PIXELS = W * H;
+    parameter SEED = 1;
+    parameter TIMEOUT = 4 * TOTAL_PIXELS; // Clocks
+
+    reg clk = 0, rst = 1;
+    always #5 clk = ~clk; // 10ns clock period
+
+    reg [7:0] frame    [0:TOTAL_PIXELS-1];
+    reg [7:0] expected [0:TOTAL_PIXELS-1];
+    reg [7:0] ref_out  [0:TOTAL_PIXELS-1];
+    reg [7:0] ppc2_out [0:TOTAL_PIXELS-1];
+    reg [7:0] ppc4_out [0:TOTAL_PIXELS-1];
+
+    integer seed;
+    integer i, r, c, a, b, ri, p2i, p4i, j2, j4;
+    integer errors1 = 0, errors2 = 0, errors4 = 0;
+    reg [7:0] win [0:8];
+    reg [7:0] t;
+    integer ref_count = 0, ppc2_count = 0, ppc4_count = 0;
+    integer start_time = 0;
+    integer ref_last = 0, ppc2_last = 0, ppc4_last = 0;
+
+    // DUTs
+    reg [7:0] ref_in = 0;
+    reg ref_valid = 0;
+    wire [7:0] ref_pix;
+    wire ref_pix_valid;
+
+    median_filter #(.MAX_W(W)) ref_inst (
+        .clk(clk), .rst(rst),
+        .pixel_in(ref_in), .pixel_valid(ref_valid),
+        .pixel_out(ref_pix), .pixel_out_valid(ref_pix_valid),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0])
+    );
+
+    reg [15:0] ppc2_in = 0;
+    reg ppc2_valid = 0;
+    wire [15:0] ppc2_pix;
+    wire ppc2_pix_valid;
+
+    median_filter_ppc #(.MAX_W(W), .PPC(2)) ppc2_inst (
+        .clk(clk), .rst(rst),
+        .pixel_in(ppc2_in), .pixel_valid(ppc2_valid),
+        .pixel_out(ppc2_pix), .pixel_out_valid(ppc2_pix_valid),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0])
+    );
+
+    reg [31:0] ppc4_in = 0;
+    reg ppc4_valid = 0;
+    wire [31:0] ppc4_pix;
+    wire ppc4_pix_valid;
+
+    median_filter_ppc #(.MAX_W(W), .PPC(4)) ppc4_inst (
+        .clk(clk), .rst(rst),
+        .pixel_in(ppc4_in), .pixel_valid(ppc4_valid),
+        .pixel_out(ppc4_pix), .pixel_out_valid(ppc4_pix_valid),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0])
+    );
+
+    // Main simulation control
+    initial begin
+        $display("Starting PPC median filter testbench...");
+        seed = SEED;
+        for (i = 0; i < TOTAL_PIXELS; i = i + 1)
+            frame[i] = $random(seed);
+
+        // Expected output: median of the median_filter window, pass-through in the first two rows / columns
+        for (r = 0; r < H; r = r + 1)
+            for (c = 0; c < W; c = c + 1) begin
+                if (r >= 2 && c >= 2) begin
+                    win[0] = frame[(r-1)*W + c-2];
+                    win[1] = frame[(r-1)*W + c-1];
+                    win[2] = frame[(r-2)*W + c];
+                    win[3] = frame[r*W + c-2];
+                    win[4] = frame[r*W + c-1];
+                    win[5] = frame[(r-1)*W + c];
+                    win[6] = frame[r*W + c];
+                    win[7] = frame[r*W + c];
+                    win[8] = frame[r*W + c];
+                    for (a = 0; a < 9; a = a + 1)
+                        for (b = a + 1; b < 9; b = b + 1)
+                            if (win[a] > win[b]) begin
+                                t = win[a];
+                                win[a] = win[b];
+                                win[b] = t;
+                            end
+                    expected[r*W + c] = win[4];
+                end else begin
+                    expected[r*W + c] = frame[r*W + c];
+                end
+            end
+
+        #20 rst = 0;
+        start_time = $time;
+
+        // Feed all three filters at full rate
+        fork
+            begin
+                for (ri = 0; ri < TOTAL_PIXELS; ri = ri + 1) begin
+                    @(negedge clk);
+                    ref_in = frame[ri];
+                    ref_valid = 1;
+                end
+                @(negedge clk) ref_valid = 0;
+            end
+            begin
+                for (p2i = 0; p2i < TOTAL_PIXELS / 2; p2i = p2i + 1) begin
+                    @(negedge clk);
+                    ppc2_in = {frame[p2i*2+1], frame[p2i*2]};
+                    ppc2_valid = 1;
+                end
+                @(negedge clk) ppc2_valid = 0;
+            end
+            begin
+                for (p4i = 0; p4i < TOTAL_PIXELS / 4; p4i = p4i + 1) begin
+                    @(negedge clk);
+                    ppc4_in = {frame[p4i*4+3], frame[p4i*4+2], frame[p4i*4+1], frame[p4i*4]};
+                    ppc4_valid = 1;
+                end
+                @(negedge clk) ppc4_valid = 0;
+            end
+        join
+
+        wait (ref_count == TOTAL_PIXELS && ppc2_count == TOTAL_PIXELS && ppc4_count == TOTAL_PIXELS);
+        repeat (3) @(posedge clk);
+
+        // Compare all three against the model
+        for (i = 0; i < TOTAL_PIXELS; i = i + 1) begin
+            if (ref_out[i] !== expected[i]) begin
+                if (errors1 < 10)
+                    $display("PPC=1 mismatch at pixel %0d: %02x, expected %02x", i, ref_out[i], expected[i]);
+                errors1 = errors1 + 1;
+            end
+            if (ppc2_out[i] !== expected[i]) begin
+                if (errors2 < 10)
+                    $display("PPC=2 mismatch at pixel %0d: %02x, expected %02x", i, ppc2_out[i], expected[i]);
+                errors2 = errors2 + 1;
+            end
+            if (ppc4_out[i] !== expected[i]) begin
+                if (errors4 < 10)
+                    $display("PPC=4 mismatch at pixel %0d: %02x, expected %02x", i, ppc4_out[i], expected[i]);
+                errors4 = errors4 + 1;
+            end
+        end
+
+        $display("------ PPC Median Filter Metrics ------");
+        $display("PPC=1: %0d cycles, %0.4f pixels/clock, %0d mismatches", (ref_last - start_time)/10,
+                 (1.0 * TOTAL_PIXELS) / ((ref_last - start_time)/10), errors1);
+        $display("PPC=2: %0d cycles, %0.4f pixels/clock, %0d mismatches", (ppc2_last - start_time)/10,
+                 (1.0 * TOTAL_PIXELS) / ((ppc2_last - start_time)/10), errors2);
+        $display("PPC=4: %0d cycles, %0.4f pixels/clock, %0d mismatches", (ppc4_last - start_time)/10,
+                 (1.0 * TOTAL_PIXELS) / ((ppc4_last - start_time)/10), errors4);
+        $display("---------------------------------------");
+        if (errors1 == 0 && errors2 == 0 && errors4 == 0)
+            $display("PASS");
+        else
+            $fatal(1, "FAIL (%0d / %0d / %0d mismatches at PPC=1 / 2 / 4)", errors1, errors2, errors4);
+
+        $finish;
+    end
+
+    // A filter that stops short of TOTAL_PIXELS outputs must fail instead of hanging
+    initial begin
+        #(TIMEOUT * 10);
+        $fatal(1, "FAIL: timed out after %0d clocks (%0d / %0d / %0d of %0d pixels at PPC=1 / 2 / 4)", TIMEOUT,
+               ref_count, ppc2_count, ppc4_count, TOTAL_PIXELS);
+    end
+
+    // Collect outputs; not in reset, where the first clock edge samples them before resetting them
+    always @(posedge clk) begin
+        if (!rst && ref_pix_valid && ref_count < TOTAL_PIXELS) begin
+            ref_out[ref_count] = ref_pix;
+            ref_count = ref_count + 1;
+            ref_last = $time;
+        end
+    end
+
+    always @(posedge clk) begin
+        if (!rst && ppc2_pix_valid && ppc2_count < TOTAL_PIXELS) begin
+            for (j2 = 0; j2 < 2; j2 = j2 + 1)
+                ppc2_out[ppc2_count + j2] = ppc2_pix[8*j2 +: 8];
+            ppc2_count = ppc2_count + 2;
+            ppc2_last = $time;
+        end
+    end
+
+    always @(posedge clk) begin
+        if (!rst && ppc4_pix_valid && ppc4_count < TOTAL_PIXELS) begin
+            for (j4 = 0; j4 < 4; j4 = j4 + 1)
+                ppc4_out[ppc4_count + j4] = ppc4_pix[8*j4 +: 8];
+            ppc4_count = ppc4_count + 4;
+            ppc4_last = $time;
+        end
+    end
+
+endmodule
@@ -0,0 +1,184 @@
+`timescale 1ns / 1ps
+
+// Streams FRAMES random RGB frames through frame_pingpong -> axis_rgb_to_gray -> axis_median_filter.
+// A loader writes the frames into the ping-pong memory at one pixel per clock while the previous frame
+// is being filtered. Reports idle cycles between frames at the ping-pong output, cycles per frame and
+// the sustained frame rate at the 10 ns clock, and checks every filtered pixel, tuser and tlast against
+// a behavioural model. Prints PASS, or stops with $fatal on a mismatch, an idle cycle between frames, a
+// missing frame or a timeout.
+module tb_pingpong;
+
+    parameter W = 60;
+    parameter H = 60;
+    parameter TOTAL_PIXELS = W * H;
+    parameter FRAMES = 4;
+    parameter SEED = 1;
+    parameter TIMEOUT = 4 * FRAMES * TOTAL_PIXELS; // Clocks
+
+    reg clk = 0, rst = 1;
+    always #5 clk = ~clk; // 10ns clock period
+
+    reg [23:0] frames   [0:FRAMES*TOTAL_PIXELS-1];
+    reg [7:0]  gray     [0:TOTAL_PIXELS-1];
+    reg [7:0]  expected [0:FRAMES*TOTAL_PIXELS-1];
+    reg [7:0]  win [0:8];
+    reg [7:0]  t;
+
+    integer seed;
+    integer f, i, r, c, a, b;
+    integer load_index = 0;
+    integer out_count = 0;
+    integer errors = 0;
+    integer sent_frames = 0;
+    integer idle_cycles = 0;
+    integer first_out_time = 0, last_out_time = 0;
+    reg streaming = 0;
+
+    // Loader -> frame_pingpong
+    reg [23:0] load_data = 0;
+    reg load_valid = 0;
+    wire load_ready;
+
+    wire [23:0] rgb_tdata;
+    wire rgb_tvalid, rgb_tready, rgb_tlast, rgb_tuser;
+    wire [7:0] gray_tdata;
+    wire gray_tvalid, gray_tready, gray_tlast, gray_tuser;
+    wire [7:0] filt_tdata;
+    wire filt_tvalid, filt_tlast, filt_tuser;
+    wire frame_loaded, frame_sent;
+
+    frame_pingpong #(.DATA_WIDTH(24), .MAX_PIXELS(TOTAL_PIXELS)) pingpong_inst (
+        .clk(clk), .rst(rst),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0]),
+        .s_axis_tdata(load_data), .s_axis_tvalid(load_valid), .s_axis_tready(load_ready),
+        .m_axis_tdata(rgb_tdata), .m_axis_tvalid(rgb_tvalid), .m_axis_tready(rgb_tready),
+        .m_axis_tlast(rgb_tlast), .m_axis_tuser(rgb_tuser),
+        .frame_loaded(frame_loaded), .frame_sent(frame_sent)
+    );
+
+    axis_rgb_to_gray gray_inst (
+        .clk(clk), .rst(rst),
+        .s_axis_tdata(rgb_tdata), .s_axis_tvalid(rgb_tvalid), .s_axis_tready(rgb_tready),
+        .s_axis_tlast(rgb_tlast), .s_axis_tuser(rgb_tuser),
+        .m_axis_tdata(gray_tdata), .m_axis_tvalid(gray_tvalid), .m_axis_tready(gray_tready),
+        .m_axis_tlast(gray_tlast), .m_axis_tuser(gray_tuser)
+    );
+
+    axis_median_filter #(.MAX_W(W)) filter_inst (
+        .clk(clk), .rst(rst),
+        .cfg_width(W[15:0]), .cfg_height(H[15:0]),
+        .s_axis_tdata(gray_tdata), .s_axis_tvalid(gray_tvalid), .s_axis_tready(gray_tready),
+        .s_axis_tlast(gray_tlast), .s_axis_tuser(gray_tuser),
+        .m_axis_tdata(filt_tdata), .m_axis_tvalid(filt_tvalid), .m_axis_tready(1'b1),
+        .m_axis_tlast(filt_tlast), .m_axis_tuser(filt_tuser)
+    );
+
+    // Main simulation control
+    initial begin
+        $display("Starting ping-pong frame buffer testbench...");
+        seed = SEED;
+
+        // Random frames and their expected median_filter output
+        for (f = 0; f < FRAMES; f = f + 1) begin
+            for (i = 0; i < TOTAL_PIXELS; i = i + 1) begin
+                frames[f*TOTAL_PIXELS + i] = $random(seed);
+                gray[i] = (frames[f*TOTAL_PIXELS + i][23:16] * 77 + frames[f*TOTAL_PIXELS + i][15:8] * 150 +
+                           frames[f*TOTAL_PIXELS + i][7:0] * 29) >> 8;
+            end
+            for (r = 0; r < H; r = r + 1)
+                for (c = 0; c < W; c = c + 1) begin
+                    if (r >= 2 && c >= 2) begin
+                        win[0] = gray[(r-1)*W + c-2];
+                        win[1] = gray[(r-1)*W + c-1];
+                        win[2] = gray[(r-2)*W + c];
+                        win[3] = gray[r*W + c-2];
+                        win[4] = gray[r*W + c-1];
+                        win[5] = gray[(r-1)*W + c];
+                        win[6] = gray[r*W + c];
+                        win[7] = gray[r*W + c];
+                        win[8] = gray[r*W + c];
+                        for (a = 0; a < 9; a = a + 1)
+                            for (b = a + 1; b < 9; b = b + 1)
+                                if (win[a] > win[b]) begin
+                                    t = win[a];
+                                    win[a] = win[b];
+                                    win[b] = t;
+                                end
+                        expected[f*TOTAL_PIXELS + r*W + c] = win[4];
+                    end else begin
+                        expected[f*TOTAL_PIXELS + r*W + c] = gray[r*W + c];
+                    end
+                end
+        end
+
+        #20 rst = 0;
+
+        // Loader: one pixel per clock whenever the ping-pong memory has a free bank
+        load_index = 0;
+        while (load_index < FRAMES * TOTAL_PIXELS) begin
+            @(negedge clk);
+            load_data = frames[load_index];
+            load_valid = 1;
+            @(posedge clk);
+            if (load_ready)
+                load_index = load_index + 1;
+        end
+        @(negedge clk) load_valid = 0;
+
+        wait (out_count == FRAMES * TOTAL_PIXELS);
+        repeat (3) @(posedge clk);
+
+        $display("------ Ping-Pong Frame Metrics ------");
+        $display("Frames: %0d of %0dx%0d", sent_frames, W, H);
+        $display("Idle cycles at the frame buffer output between the first and last beat: %0d", idle_cycles);
+        $display("Filtered output: %0d cycles, %0.1f cycles/frame, %0.1f frames/s at 100 MHz",
+                 (last_out_time - first_out_time) / 10 + 1,
+                 (1.0 * ((last_out_time - first_out_time) / 10 + 1)) / FRAMES,
+                 FRAMES * 1.0e9 / (last_out_time - first_out_time + 10));
+        $display("-------------------------------------");
+        if (errors == 0 && idle_cycles == 0 && sent_frames == FRAMES)
+            $display("PASS");
+        else
+            $fatal(1, "FAIL (%0d mismatches, %0d idle cycles, %0d of %0d frames sent)", errors, idle_cycles,
+                   sent_frames, FRAMES);
+        $finish;
+    end
+
+    // A bank that is never handed over must fail instead of hanging
+    initial begin
+        #(TIMEOUT * 10);
+        $fatal(1, "FAIL: timed out after %0d clocks (%0d of %0d pixels loaded, %0d filtered)", TIMEOUT,
+               load_index, FRAMES * TOTAL_PIXELS, out_count);
+    end
+
+    // Ping-pong output: count clocks without a beat once streaming has started
+    always @(posedge clk) begin
+        if (!rst) begin
+            if (rgb_tvalid && rgb_tready)
+                streaming = 1;
+            else if (streaming && sent_frames < FRAMES)
+                idle_cycles = idle_cycles + 1;
+            if (frame_sent)
+                sent_frames = sent_frames + 1;
+        end
+    end
+
+    // Check filtered frames
+    always @(posedge clk) begin
+        if (!rst && filt_tvalid && out_count < FRAMES * TOTAL_PIXELS) begin
+            if (filt_tdata !== expected[out_count] || filt_tuser !== (out_count % TOTAL_PIXELS == 0) ||
+                filt_tlast !== (out_count % W == W - 1)) begin
+                if (errors < 10)
+                    $display("Mismatch at frame %0d pixel %0d: %02x tuser %b tlast %b, expected %02x",
+                             out_count / TOTAL_PIXELS, out_count % TOTAL_PIXELS, filt_tdata, filt_tuser,
+                             filt_tlast, expected[out_count]);
+                errors = errors + 1;
+            end
+            if (out_count == 0)
+                first_out_time = $time;
+            last_out_time = $time;
+            out_count = out_count + 1;
+        end
+    end
+
+endmodule
@@ -0,0 +1,302 @@
+`timescale 1ns / 1ps
+
+// AXI4-Stream wrappers for the pipeline modules. Video stream conventions: tuser marks the first
+// pixel of a frame (start of frame) and tlast the last pixel of each line. A beat moves when tvalid
+// and tready are both high; stalls propagate back to the frame source and no pixel is dropped.
+// The frame size comes from cfg_width / cfg_height, as in median_filter.
+// Parameter checks stay within Verilog-2001, which has no elaboration-time $error: a failing check
+// instantiates a module that does not exist, named after the rule, so elaboration stops on it.
+
+// ==============================================================================================
+// bram_rgb_reader as an AXI4-Stream frame source (24-bit RRGGBB beats)
+// ==============================================================================================
+module axis_bram_rgb #(
+    parameter MAX_PIXELS = 3600,
+    parameter MEM_FILE = "rgb_image.mem"
+)(
+    input wire clk,
+    input wire rst,
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height,
+    output wire [23:0] m_axis_tdata,
+    output wire m_axis_tvalid,
+    input wire m_axis_tready,
+    output wire m_axis_tlast,
+    output wire m_axis_tuser
+);
+
+    // The reader repeats the frame, taking a new size at each frame boundary, and flags every pixel
+    bram_rgb_reader #(.MAX_PIXELS(MAX_PIXELS), .MEM_FILE(MEM_FILE)) reader_inst (
+        .clk(clk), .rst(rst),
+        .cfg_width(cfg_width), .cfg_height(cfg_height),
+        .m_rgb(m_axis_tdata), .m_valid(m_axis_tvalid), .m_ready(m_axis_tready),
+        .m_first(m_axis_tuser), .m_line_end(m_axis_tlast)
+    );
+endmodule
+
+// ==============================================================================================
+// rgb_to_gray_pipe with AXI4-Stream ports
+// ==============================================================================================
+module axis_rgb_to_gray (
+    input wire clk,
+    input wire rst,
+    input wire [23:0] s_axis_tdata,
+    input wire s_axis_tvalid,
+    output wire s_axis_tready,
+    input wire s_axis_tlast,
+    input wire s_axis_tuser,
+    output wire [7:0] m_axis_tdata,
+    output wire m_axis_tvalid,
+    input wire m_axis_tready,
+    output reg m_axis_tlast,
+    output reg m_axis_tuser
+);
+
+    reg last1, user1;
+
+    rgb_to_gray_pipe gray_inst (
+        .clk(clk), .rst(rst),
+        .s_rgb(s_axis_tdata), .s_valid(s_axis_tvalid), .s_ready(s_axis_tready),
+        .m_gray(m_axis_tdata), .m_valid(m_axis_tvalid), .m_ready(m_axis_tready)
+    );
+
+    // tlast/tuser follow the pixel through both stages; s_ready is the pipeline's advance enable
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            last1 <= 0;
+            user1 <= 0;
+            m_axis_tlast <= 0;
+            m_axis_tuser <= 0;
+        end else if (s_axis_tready) begin
+            last1 <= s_axis_tlast;
+            user1 <= s_axis_tuser;
+            m_axis_tlast <= last1;
+            m_axis_tuser <= user1;
+        end
+    end
+endmodule
+
+// ==============================================================================================
+// median_filter with AXI4-Stream ports
+// ==============================================================================================
+// median_filter cannot stall: a pixel leaves exactly PIPE_STAGES + 1 clocks after it enters. The
+// wrapper therefore only accepts a pixel when the output FIFO is sure to have room for it, counting
+// the pixels still inside the filter (credit-based flow control). FIFO_DEPTH must be at least
+// PIPE_STAGES + 3 for one pixel per clock (checked at elaboration); the default leaves 3 more entries
+// to ride out short sink stalls. Frames must be exactly cfg_width x cfg_height: the filter keeps its
+// own row/column count, tuser is only carried through.
+module axis_median_filter #(
+    parameter MAX_W = 1920,
+    parameter PIPE_STAGES = 2,
+    parameter FIFO_DEPTH = PIPE_STAGES + 6
+)(
+    input wire clk,
+    input wire rst,
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height,
+    input wire [7:0] s_axis_tdata,
+    input wire s_axis_tvalid,
+    output wire s_axis_tready,
+    input wire s_axis_tlast,
+    input wire s_axis_tuser,
+    output wire [7:0] m_axis_tdata,
+    output wire m_axis_tvalid,
+    input wire m_axis_tready,
+    output wire m_axis_tlast,
+    output wire m_axis_tuser
+);
+
+    localparam LATENCY = PIPE_STAGES + 1;
+    localparam PTR_WIDTH = $clog2(FIFO_DEPTH);
+    localparam CNT_WIDTH = $clog2(FIFO_DEPTH + 1);
+
+    generate
+        if (FIFO_DEPTH < PIPE_STAGES + 3) begin : fifo_depth_check
+            axis_median_filter_FIFO_DEPTH_must_be_at_least_PIPE_STAGES_plus_3 check_failed ();
+        end
+    endgenerate
+
+    // Output FIFO: {tuser, tlast, tdata}
+    reg [9:0] fifo [0:FIFO_DEPTH-1];
+    reg [PTR_WIDTH-1:0] wr_ptr, rd_ptr;
+    reg [CNT_WIDTH-1:0] count;
+    reg [CNT_WIDTH-1:0] in_flight; // Accepted but not yet out of median_filter
+
+    wire accept = s_axis_tvalid && s_axis_tready;
+    assign s_axis_tready = (in_flight + count) < FIFO_DEPTH;
+
+    wire [7:0] filt_out;
+    wire filt_valid;
+
+    median_filter #(.MAX_W(MAX_W), .PIPE_STAGES(PIPE_STAGES)) filter_inst (
+        .clk(clk), .rst(rst),
+        .pixel_in(s_axis_tdata), .pixel_valid(accept),
+        .pixel_out(filt_out), .pixel_out_valid(filt_valid),
+        .cfg_width(cfg_width), .cfg_height(cfg_height)
+    );
+
+    // tlast/tuser delay line with the same latency as the filter
+    reg [1:0] side [0:LATENCY-1];
+    integer s;
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            for (s = 0; s < LATENCY; s = s + 1)
+                side[s] <= 0;
+        end else begin
+            side[0] <= {s_axis_tuser, s_axis_tlast};
+            for (s = 1; s < LATENCY; s = s + 1)
+                side[s] <= side[s-1];
+        end
+    end
+
+    wire push = filt_valid;
+    wire pop = m_axis_tvalid && m_axis_tready;
+
+    assign m_axis_tvalid = (count != 0);
+    assign {m_axis_tuser, m_axis_tlast, m_axis_tdata} = fifo[rd_ptr];
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            wr_ptr <= 0;
+            rd_ptr <= 0;
+            count <= 0;
+            in_flight <= 0;
+        end else begin
+            if (push) begin
+                fifo[wr_ptr] <= {side[LATENCY-1], filt_out};
+                wr_ptr <= (wr_ptr == FIFO_DEPTH - 1) ? 0 : wr_ptr + 1;
+            end
+            if (pop)
+                rd_ptr <= (rd_ptr == FIFO_DEPTH - 1) ? 0 : rd_ptr + 1;
+            count <= count + push - pop;
+            in_flight <= in_flight + accept - push;
+        end
+    end
+endmodule
+
+// ==============================================================================================
+// sobel_edge with AXI4-Stream ports
+// ==============================================================================================
+// sobel_edge writes into an output FIFO, and its clock enable is "the FIFO has room for every edge
+// pixel its three pipeline stages may still hold, plus one": a function of the FIFO count alone, so
+// s_axis_tready does not depend combinationally on m_axis_tready. FIFO_DEPTH must be at least
+// SOBEL_LATENCY + 2 for one pixel per clock (checked at elaboration). Edge pixel n leaves W + 1 inputs
+// after pixel n enters and the last W + 1 leave without any input, so s_axis_tlast / s_axis_tuser
+// cannot be carried through; they are regenerated from the output position instead. Frames must be
+// exactly cfg_width x cfg_height, and the size may only change once the previous frame has left m_axis.
+module axis_sobel_edge #(
+    parameter MAX_W = 1920,
+    parameter FIFO_DEPTH = 8
+)(
+    input wire clk,
+    input wire rst,
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height,
+    input wire [7:0] s_axis_tdata,
+    input wire s_axis_tvalid,
+    output wire s_axis_tready,
+    input wire s_axis_tlast,
+    input wire s_axis_tuser,
+    output wire [7:0] m_axis_tdata,
+    output wire m_axis_tvalid,
+    input wire m_axis_tready,
+    output wire m_axis_tlast,
+    output wire m_axis_tuser
+);
+
+    // Registers between an input and its edge pixel (gradients, squared magnitude, square root)
+    localparam SOBEL_LATENCY = 3;
+    localparam PTR_WIDTH = $clog2(FIFO_DEPTH);
+    localparam CNT_WIDTH = $clog2(FIFO_DEPTH + 1);
+
+    generate
+        if (FIFO_DEPTH < SOBEL_LATENCY + 2) begin : fifo_depth_check
+            axis_sobel_edge_FIFO_DEPTH_must_be_at_least_5 check_failed ();
+        end
+    endgenerate
+
+    integer col = 0, row = 0; // Position of the beat on m_axis
+    reg [15:0] frame_w, frame_h; // Size of the frame on m_axis once primed
+    reg primed;                  // frame_w / frame_h have been loaded since reset
+    wire [15:0] cur_w = primed ? frame_w : cfg_width;
+    wire [15:0] cur_h = primed ? frame_h : cfg_height;
+
+    // Output FIFO
+    reg [7:0] fifo [0:FIFO_DEPTH-1];
+    reg [PTR_WIDTH-1:0] wr_ptr, rd_ptr;
+    reg [CNT_WIDTH-1:0] count;
+
+    // Each enabled clock adds at most one pixel, so with this much room the up to SOBEL_LATENCY
+    // pixels in the pipeline always fit
+    wire run = count + SOBEL_LATENCY + 1 <= FIFO_DEPTH;
+
+    wire [7:0] edge_out;
+    wire edge_valid;
+
+    sobel_edge #(.MAX_W(MAX_W)) sobel_inst (
+        .clk(clk), .rst(rst),
+        .pixel_in(s_axis_tdata), .pixel_valid(s_axis_tvalid), .pixel_ready(s_axis_tready),
+        .edge_out(edge_out), .edge_valid(edge_valid), .m_ready(run),
+        .cfg_width(cfg_width), .cfg_height(cfg_height)
+    );
+
+    // edge_valid holds while run is low, so a pixel moves into the FIFO only on an enabled clock
+    wire push = edge_valid && run;
+    wire pop = m_axis_tvalid && m_axis_tready;
+
+    assign m_axis_tvalid = (count != 0);
+    assign m_axis_tdata = fifo[rd_ptr];
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            wr_ptr <= 0;
+            rd_ptr <= 0;
+            count <= 0;
+        end else begin
+            if (push) begin
+                fifo[wr_ptr] <= edge_out;
+                wr_ptr <= (wr_ptr == FIFO_DEPTH - 1) ? 0 : wr_ptr + 1;
+            end
+            if (pop)
+                rd_ptr <= (rd_ptr == FIFO_DEPTH - 1) ? 0 : rd_ptr + 1;
+            count <= count + push - pop;
+        end
+    end
+
+    assign m_axis_tuser = (col == 0) && (row == 0);
+    assign m_axis_tlast = (col == cur_w - 1);
+
+    // The size registers reset to a constant and load cfg_* synchronously: on the first clock after
+    // reset and after the last beat of every frame
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            col <= 0;
+            row <= 0;
+            frame_w <= 0;
+            frame_h <= 0;
+            primed <= 0;
+        end else begin
+            primed <= 1'b1;
+            if (!primed) begin
+                frame_w <= cfg_width;
+                frame_h <= cfg_height;
+            end
+
+            if (m_axis_tvalid && m_axis_tready) begin
+                if (col == cur_w - 1) begin
+                    col <= 0;
+                    if (row == cur_h - 1) begin
+                        row <= 0;
+                        frame_w <= cfg_width;
+                        frame_h <= cfg_height;
+                    end else begin
+                        row <= row + 1;
+                    end
+                end else begin
+                    col <= col + 1;
+                end
+            end
+        end
+    end
+endmodule
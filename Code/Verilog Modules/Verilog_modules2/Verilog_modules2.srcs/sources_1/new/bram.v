@@ -21,3 +21,117 @@ module bram_rgb #(
     end
 
 endmodule
+
+// Streams the W*H frame held in a 24-bit bram_rgb (one RRGGBB word per pixel, as written by
+// image_to_mem.py) at one pixel per clock with valid/ready, over and over. The BRAM read takes a clock,
+// so reads are only issued while the 2-entry output queue has room for them; a stalled consumer never
+// loses a pixel. The frame size is cfg_width x cfg_height (at most MAX_PIXELS), sampled on the first
+// clock after reset and when the last pixel of every frame is read, as median_filter does at frame_end, so a new size takes
+// effect from the next frame. m_first / m_line_end flag the first pixel of a frame and the last of each
+// line; they travel with the pixel through the queue, so they follow the size that pixel was read with.
+module bram_rgb_reader #(
+    parameter MAX_PIXELS = 3600,
+    parameter MEM_FILE = "rgb_image.mem"
+)(
+    input wire clk,
+    input wire rst,
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height,
+    output wire [23:0] m_rgb,
+    output wire m_valid,
+    input wire m_ready,
+    output wire m_first,
+    output wire m_line_end
+);
+
+    localparam ADDR_WIDTH = $clog2(MAX_PIXELS + 1);
+
+    reg [ADDR_WIDTH-1:0] addr;
+    reg [15:0] frame_w, frame_h; // Size of the frame being read once primed
+    reg primed;                  // frame_w / frame_h have been loaded since reset
+    wire [15:0] cur_w = primed ? frame_w : cfg_width;
+    wire [15:0] cur_h = primed ? frame_h : cfg_height;
+    reg [15:0] rd_col, rd_row;   // Position of addr in it
+    reg rd_pending;              // A read was issued last clock; its data is on data_out now
+    reg [1:0] rd_flags;          // { first, line_end } of that read
+    wire [23:0] data_out;
+
+    bram_rgb #(24, ADDR_WIDTH, MEM_FILE) bram_inst (
+        .clk(clk),
+        .addr(addr),
+        .data_out(data_out)
+    );
+
+    // Output queue of { first, line_end, rgb }: q[0] is the head
+    reg [25:0] q [0:1];
+    reg [1:0] count;
+
+    wire pop = m_valid && m_ready;
+    // Room for one more word once the pending read and this clock's pop are accounted for
+    wire issue = (count + rd_pending - pop < 2);
+    wire line_end = (rd_col == cur_w - 1);
+    wire frame_end = line_end && (rd_row == cur_h - 1);
+
+    assign m_valid = (count != 0);
+    assign {m_first, m_line_end, m_rgb} = q[0];
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            addr <= 0;
+            frame_w <= 0;
+            frame_h <= 0;
+            primed <= 0;
+            rd_col <= 0;
+            rd_row <= 0;
+            rd_pending <= 0;
+            rd_flags <= 0;
+            count <= 0;
+            q[0] <= 0;
+            q[1] <= 0;
+        end else begin
+            // Constant reset, synchronous load of cfg_*
+            primed <= 1'b1;
+            if (!primed) begin
+                frame_w <= cfg_width;
+                frame_h <= cfg_height;
+            end
+
+            rd_pending <= issue;
+            if (issue) begin
+                rd_flags <= {(rd_col == 0) && (rd_row == 0), line_end};
+                if (frame_end) begin
+                    addr <= 0;
+                    rd_col <= 0;
+                    rd_row <= 0;
+                    frame_w <= cfg_width;
+                    frame_h <= cfg_height;
+                end else begin
+                    addr <= addr + 1;
+                    rd_col <= line_end ? 0 : rd_col + 1;
+                    rd_row <= line_end ? rd_row + 1 : rd_row;
+                end
+            end
+
+            // Pop shifts the queue; the returning read lands in the first free slot
+            case ({rd_pending, pop})
+                2'b01: begin
+                    q[0] <= q[1];
+                    count <= count - 1;
+                end
+                2'b10: begin
+                    q[count] <= {rd_flags, data_out};
+                    count <= count + 1;
+                end
+                2'b11: begin
+                    if (count == 1) begin
+                        q[0] <= {rd_flags, data_out};
+                    end else begin
+                        q[0] <= q[1];
+                        q[1] <= {rd_flags, data_out};
+                    end
+                end
+                default: ;
+            endcase
+        end
+    end
+endmodule
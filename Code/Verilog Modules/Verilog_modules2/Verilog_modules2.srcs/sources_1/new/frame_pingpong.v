@@ -0,0 +1,198 @@
+`timescale 1ns / 1ps
+
+// Double-buffered frame memory with a frame-sequencing controller. Frames arrive on s_axis (e.g. from
+// a loader or DMA) and are written into one bank while the previous frame is streamed out of the other
+// bank on m_axis. A bank is handed to the reader as soon as its last pixel is written and back to the
+// writer as soon as its last pixel is read, so with the writer at least as fast as the reader, frames
+// leave back to back with no idle cycles between them.
+//
+// The frame size is cfg_width * cfg_height (at most MAX_PIXELS). The writer samples it on the first
+// clock after reset and after the last pixel of every frame, as median_filter does at frame_end, and stores it with the bank it
+// fills; the reader and the output framing use the size stored with the bank they are draining, so a
+// size change takes effect from the next frame written. m_axis carries tuser on the first pixel of each
+// frame and tlast on the last pixel of each line. The input side only counts
+// pixels; its tlast / tuser are not needed.
+module frame_pingpong #(
+    parameter DATA_WIDTH = 24,
+    parameter MAX_PIXELS = 3600
+)(
+    input wire clk,
+    input wire rst,
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height,
+    // Frame input
+    input wire [DATA_WIDTH-1:0] s_axis_tdata,
+    input wire s_axis_tvalid,
+    output wire s_axis_tready,
+    // Frame output
+    output wire [DATA_WIDTH-1:0] m_axis_tdata,
+    output wire m_axis_tvalid,
+    input wire m_axis_tready,
+    output wire m_axis_tlast,
+    output wire m_axis_tuser,
+    // One-clock pulses, e.g. for frame rate counters
+    output wire frame_loaded,
+    output wire frame_sent
+);
+
+    localparam ADDR_WIDTH = $clog2(MAX_PIXELS + 1);
+
+    // Both banks in one memory: bank b holds addresses b*MAX_PIXELS ... b*MAX_PIXELS + MAX_PIXELS - 1
+    reg [DATA_WIDTH-1:0] mem [0:2*MAX_PIXELS-1];
+    reg [1:0] full;           // Bank holds a complete frame not yet read
+    reg [31:0] bank_pixels [0:1]; // Size of the frame in each bank
+    reg [15:0] bank_w [0:1];
+
+    // ------------------------------------------------------------------
+    // Writer
+    // ------------------------------------------------------------------
+    reg wr_bank;
+    reg [ADDR_WIDTH-1:0] wr_addr;
+    reg [31:0] wr_pixels;     // Size of the frame being written once primed
+    reg [15:0] wr_w;
+    reg primed;               // wr_pixels / wr_w have been loaded since reset
+    // The size registers reset to constants and load cfg_* synchronously; until the first load the
+    // size is cfg_* itself, as if it had been sampled at reset
+    wire [31:0] cfg_pixels = {16'd0, cfg_width} * {16'd0, cfg_height};
+    wire [31:0] cur_pixels = primed ? wr_pixels : cfg_pixels;
+    wire [15:0] cur_w = primed ? wr_w : cfg_width;
+
+    assign s_axis_tready = !full[wr_bank];
+    wire wr_accept = s_axis_tvalid && s_axis_tready;
+    wire wr_last = wr_accept && (wr_addr == cur_pixels - 1);
+    assign frame_loaded = wr_last;
+
+    always @(posedge clk) begin
+        if (wr_accept)
+            mem[wr_bank * MAX_PIXELS + wr_addr] <= s_axis_tdata;
+    end
+
+    // ------------------------------------------------------------------
+    // Reader: one-clock memory read into a 2-entry output queue (as bram_rgb_reader)
+    // ------------------------------------------------------------------
+    reg rd_bank;
+    reg [ADDR_WIDTH-1:0] rd_addr;
+    reg rd_pending;
+    reg [DATA_WIDTH-1:0] data_out;
+    reg [DATA_WIDTH-1:0] q [0:1];
+    reg [1:0] count;
+
+    wire pop = m_axis_tvalid && m_axis_tready;
+    wire issue = full[rd_bank] && (count + rd_pending - pop < 2);
+    wire rd_last = issue && (rd_addr == bank_pixels[rd_bank] - 1);
+
+    assign m_axis_tvalid = (count != 0);
+    assign m_axis_tdata = q[0];
+
+    always @(posedge clk) begin
+        data_out <= mem[rd_bank * MAX_PIXELS + rd_addr];
+    end
+
+    // Output framing, from the bank whose pixels are leaving (the reader may already be on the next one)
+    reg out_bank;
+    integer col = 0, row = 0, sent = 0;
+    wire [31:0] out_pixels = bank_pixels[out_bank];
+    wire [15:0] out_w = bank_w[out_bank];
+    assign m_axis_tuser = (col == 0) && (row == 0);
+    assign m_axis_tlast = (col == out_w - 1);
+    assign frame_sent = pop && (sent == out_pixels - 1);
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            full <= 0;
+            bank_pixels[0] <= 0;
+            bank_pixels[1] <= 0;
+            bank_w[0] <= 0;
+            bank_w[1] <= 0;
+            wr_pixels <= 0;
+            wr_w <= 0;
+            primed <= 0;
+            wr_bank <= 0;
+            wr_addr <= 0;
+            rd_bank <= 0;
+            rd_addr <= 0;
+            rd_pending <= 0;
+            count <= 0;
+            q[0] <= 0;
+            q[1] <= 0;
+            out_bank <= 0;
+            col <= 0;
+            row <= 0;
+            sent <= 0;
+        end else begin
+            primed <= 1'b1;
+            if (!primed) begin
+                wr_pixels <= cfg_pixels;
+                wr_w <= cfg_width;
+            end
+
+            // Writer: a full bank goes to the reader with its frame size, the writer moves on to the
+            // other bank and takes the size of the next frame
+            if (wr_accept) begin
+                if (wr_last) begin
+                    wr_addr <= 0;
+                    wr_bank <= !wr_bank;
+                    bank_pixels[wr_bank] <= cur_pixels;
+                    bank_w[wr_bank] <= cur_w;
+                    wr_pixels <= cfg_pixels;
+                    wr_w <= cfg_width;
+                end else begin
+                    wr_addr <= wr_addr + 1;
+                end
+            end
+
+            // Reader: the bank is free again once its last pixel has been read out of the memory
+            rd_pending <= issue;
+            if (issue) begin
+                if (rd_last) begin
+                    rd_addr <= 0;
+                    rd_bank <= !rd_bank;
+                end else begin
+                    rd_addr <= rd_addr + 1;
+                end
+            end
+
+            // The writer only fills an empty bank and the reader only drains a full one, so they never
+            // update the same flag in the same clock
+            if (wr_last)
+                full[wr_bank] <= 1'b1;
+            if (rd_last)
+                full[rd_bank] <= 1'b0;
+
+            // Output queue
+            case ({rd_pending, pop})
+                2'b01: begin
+                    q[0] <= q[1];
+                    count <= count - 1;
+                end
+                2'b10: begin
+                    q[count] <= data_out;
+                    count <= count + 1;
+                end
+                2'b11: begin
+                    if (count == 1) begin
+                        q[0] <= data_out;
+                    end else begin
+                        q[0] <= q[1];
+                        q[1] <= data_out;
+                    end
+                end
+                default: ;
+            endcase
+
+            // Output position
+            if (pop) begin
+                sent <= (sent == out_pixels - 1) ? 0 : sent + 1;
+                if (sent == out_pixels - 1)
+                    out_bank <= !out_bank;
+                if (col == out_w - 1) begin
+                    col <= 0;
+                    row <= (sent == out_pixels - 1) ? 0 : row + 1;
+                end else begin
+                    col <= col + 1;
+                end
+            end
+        end
+    end
+
+endmodule
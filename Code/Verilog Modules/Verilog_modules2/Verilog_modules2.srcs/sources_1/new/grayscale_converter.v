@@ -10,13 +10,17 @@ module rgb_to_gray #(
     output reg gray_valid
 );
 
+    // Address wide enough for any frame size (16 bits only covered 65,536 bytes)
+    localparam ADDR_WIDTH = $clog2(TOTAL_BYTES + 1);
+
     reg [7:0] mem [0:TOTAL_BYTES-1];
     reg [1:0] state = 0;
-    reg [15:0] addr = 0;
+    reg [ADDR_WIDTH-1:0] addr = 0;
     reg [7:0] r, g, b;
     reg ready = 0;
 
-    integer i;
+    // Weighted sum of r, g, b; 16 bits hold the largest one (255 * 256)
+    wire [15:0] luma = {8'd0, r} * 16'd77 + {8'd0, g} * 16'd150 + {8'd0, b} * 16'd29;
 
     initial begin
         $display("Loading RGB image from '%s'", MEM_FILE);
@@ -38,30 +42,75 @@ module rgb_to_gray #(
             gray_valid <= 0;
             case (state)
                 0: begin
-                    if (addr < TOTAL_BYTES) begin
+                    if (addr < TOTAL_BYTES[ADDR_WIDTH-1:0]) begin
                         r <= mem[addr];
                         addr <= addr + 1;
                         state <= 1;
                     end
                 end
                 1: begin
-                    if (addr < TOTAL_BYTES) begin
+                    if (addr < TOTAL_BYTES[ADDR_WIDTH-1:0]) begin
                         g <= mem[addr];
                         addr <= addr + 1;
                         state <= 2;
                     end
                 end
                 2: begin
-                    if (addr < TOTAL_BYTES) begin
+                    if (addr < TOTAL_BYTES[ADDR_WIDTH-1:0]) begin
                         b <= mem[addr];
                         addr <= addr + 1;
                         // Now that R, G, B are guaranteed to be loaded, compute gray
-                        gray_out <= (r * 77 + g * 150 + b * 29) >> 8;
+                        gray_out <= luma[15:8];
                         gray_valid <= 1;
                         state <= 0;
                     end
                 end
+                default: state <= 0;
             endcase
         end
     end
 endmodule
+
+// Fully pipelined converter: one RRGGBB pixel per clock in, one grey pixel per clock out, with
+// valid/ready on both sides. Same weights as rgb_to_gray, but every pixel uses its own blue value
+// (rgb_to_gray reads b from the previous pixel). Two register stages: weighted channels, then sum.
+// The whole pipeline holds while the output is valid and not accepted, so no pixel is dropped.
+module rgb_to_gray_pipe (
+    input wire clk,
+    input wire rst,
+    input wire [23:0] s_rgb,       // {R, G, B}, the RRGGBB layout written by image_to_mem.py
+    input wire s_valid,
+    output wire s_ready,
+    output reg [7:0] m_gray,
+    output reg m_valid,
+    input wire m_ready
+);
+
+    reg [15:0] r_w, g_w, b_w; // Weighted channels
+    reg v1;
+
+    // Advance when the output register is empty or being read
+    wire en = !m_valid || m_ready;
+    assign s_ready = en;
+
+    wire [15:0] sum = r_w + g_w + b_w;
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            r_w <= 0;
+            g_w <= 0;
+            b_w <= 0;
+            v1 <= 0;
+            m_gray <= 0;
+            m_valid <= 0;
+        end else if (en) begin
+            r_w <= s_rgb[23:16] * 77;
+            g_w <= s_rgb[15:8] * 150;
+            b_w <= s_rgb[7:0] * 29;
+            v1 <= s_valid;
+
+            m_gray <= sum[15:8];
+            m_valid <= v1;
+        end
+    end
+endmodule
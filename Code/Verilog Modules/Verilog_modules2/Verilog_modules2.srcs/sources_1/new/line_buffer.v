@@ -0,0 +1,33 @@
+`timescale 1ns / 1ps
+
+// Row memory of one streaming 3x3 stage: one WIDTH-bit word per column, e.g. { row r-2, row r-1 }.
+// Reads are asynchronous, like the line buffers median_filter used before; writes land on the rising
+// edge, so a read in the same cycle returns the old word. Every stage keeps its own instance: the
+// stages sit at different columns and rows, so their rows cannot share storage.
+module line_buffer #(
+    parameter W = 60,
+    parameter WIDTH = 16
+)(
+    input wire clk,
+    input wire [$clog2(W)-1:0] addr,
+    input wire we,
+    input wire [WIDTH-1:0] wdata,
+    output wire [WIDTH-1:0] rdata
+);
+
+    reg [WIDTH-1:0] mem [0:W-1];
+    integer i;
+
+    initial begin
+        for (i = 0; i < W; i = i + 1)
+            mem[i] = 0;
+    end
+
+    assign rdata = mem[addr];
+
+    always @(posedge clk) begin
+        if (we)
+            mem[addr] <= wdata;
+    end
+
+endmodule
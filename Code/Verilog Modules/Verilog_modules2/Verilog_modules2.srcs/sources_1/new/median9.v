@@ -0,0 +1,76 @@
+`timescale 1ns / 1ps
+
+// Median of 9 pixels with the 19 compare-exchange network (same result as sorting the window
+// and taking element 4). window[8*i +: 8] is pixel i.
+// The network is 9 compare-exchange layers deep; STAGES (0..8) pipeline registers split it into
+// STAGES+1 segments of about equal depth, so median is valid STAGES clocks after window.
+// The registers run every clock, so a new window can enter on every cycle.
+// The longest segment is 9 / 5 / 3 / 3 / 2 / 1 compare-exchanges at STAGES 0 / 1 / 2 / 3 / 4 / 8.
+module median9 #(
+    parameter STAGES = 0
+)(
+    input wire clk,
+    input wire [71:0] window,
+    output wire [7:0] median
+);
+
+    localparam LAYERS = 9;
+
+    // Returns {max, min}
+    function [15:0] ce;
+        input [7:0] a, b;
+        begin
+            ce = (a > b) ? {a, b} : {b, a};
+        end
+    endfunction
+
+    // One layer of the network: the compare-exchanges that can run in parallel
+    function [71:0] layer;
+        input [71:0] v;
+        input integer l;
+        reg [7:0] p0, p1, p2, p3, p4, p5, p6, p7, p8;
+        begin
+            {p8, p7, p6, p5, p4, p3, p2, p1, p0} = v;
+            case (l)
+                // Sort each group of three
+                1, 3: begin {p2, p1} = ce(p1, p2); {p5, p4} = ce(p4, p5); {p8, p7} = ce(p7, p8); end
+                2:    begin {p1, p0} = ce(p0, p1); {p4, p3} = ce(p3, p4); {p7, p6} = ce(p6, p7); end
+                // Max of mins, min of maxes, median of medians
+                4:    begin {p3, p0} = ce(p0, p3); {p8, p5} = ce(p5, p8); {p7, p4} = ce(p4, p7); end
+                5:    begin {p6, p3} = ce(p3, p6); {p4, p1} = ce(p1, p4); {p5, p2} = ce(p2, p5); end
+                6:    {p7, p4} = ce(p4, p7);
+                7, 9: {p2, p4} = ce(p4, p2);
+                8:    {p4, p6} = ce(p6, p4);
+                default: ;
+            endcase
+            layer = {p8, p7, p6, p5, p4, p3, p2, p1, p0};
+        end
+    endfunction
+
+    // s[72*l +: 72] holds the 9 pixels after layer l. Each layer reads the one before it, which Verilator
+    // would report as a combinational loop through s (UNOPTFLAT) unless it splits s into its layers
+    wire [72*(LAYERS+1)-1:0] s /*verilator split_var*/;
+    assign s[71:0] = window;
+
+    genvar l;
+    generate
+        for (l = 1; l <= LAYERS; l = l + 1) begin : net
+            wire [71:0] result = layer(s[72*(l-1) +: 72], l);
+
+            // Register after this layer when it ends one of the STAGES+1 segments
+            if (l < LAYERS && (l * (STAGES + 1)) / LAYERS > ((l - 1) * (STAGES + 1)) / LAYERS) begin : cut
+                reg [71:0] r;
+                always @(posedge clk) begin
+                    r <= result;
+                end
+                assign s[72*l +: 72] = r;
+            end else begin : comb
+                assign s[72*l +: 72] = result;
+            end
+        end
+    endgenerate
+
+    // Pixel 4 after the last layer
+    assign median = s[72*LAYERS + 32 +: 8];
+
+endmodule
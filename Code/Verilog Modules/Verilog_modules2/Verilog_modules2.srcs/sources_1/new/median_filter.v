@@ -1,96 +1,136 @@
 `timescale 1ns / 1ps
 
+// Frame size comes from cfg_width / cfg_height (cfg_width <= MAX_W), sampled on the first clock after
+// reset and after the last pixel of every frame, so one build handles any frame up to MAX_W pixels wide and of any height.
 module median_filter #(
-    parameter W = 60,
-    parameter H = 60
+    parameter MAX_W = 1920,
+    // Pipeline registers inside the median network (0..8). Each adds one clock of latency;
+    // a new pixel can still enter every clock.
+    parameter PIPE_STAGES = 2
 )(
     input wire clk,
     input wire rst,
     input wire [7:0] pixel_in,
     input wire pixel_valid,
     output reg [7:0] pixel_out,
-    output reg pixel_out_valid
+    output reg pixel_out_valid,
+    // Frame size for the next frame
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height
 );
 
-    reg [7:0] line_buf1 [0:W-1];
-    reg [7:0] line_buf2 [0:W-1];
-    reg [7:0] window [0:8];
-    reg [7:0] lb2_col, lb2_col_1, lb2_col_2;
-    reg [7:0] lb1_col, lb1_col_1, lb1_col_2;
-    integer col = 0, row = 0;
-    integer i;
+    reg [15:0] col, row;         // Position of the next input pixel, as wide as cfg_width / cfg_height
+    reg [15:0] frame_w, frame_h; // Size of the current frame once primed
+    reg primed;                  // frame_w / frame_h have been loaded since reset
+    // The size registers reset to a constant and load cfg_* synchronously; until the first load the
+    // size is cfg_* itself, as if it had been sampled at reset
+    wire [15:0] cur_w = primed ? frame_w : cfg_width;
+    wire [15:0] cur_h = primed ? frame_h : cfg_height;
+    wire frame_end = pixel_valid && (col == cur_w - 1) && (row == cur_h - 1);
 
-    task sort_window;
-        integer i, j;
-        reg [7:0] temp;
-        begin
-            for (i = 0; i < 9; i = i + 1)
-                for (j = i + 1; j < 9; j = j + 1)
-                    if (window[i] > window[j]) begin
-                        temp = window[i];
-                        window[i] = window[j];
-                        window[j] = temp;
-                    end
+    // Rows r-1 and r-2 of the current column
+    wire [15:0] lb_word;
+
+    line_buffer #(.W(MAX_W), .WIDTH(16)) lb_inst (
+        .clk(clk),
+        .addr(col[$clog2(MAX_W)-1:0]), .we(pixel_valid), .wdata({lb_word[7:0], pixel_in}), .rdata(lb_word)
+    );
+
+    // Columns c-1 and c-2 of the current row and of row r-1
+    reg [7:0] cur_d1, cur_d2;
+    reg [7:0] lb1_d1, lb1_d2;
+
+    // Window of pixel (r, c): { P[r-1][c-2], P[r-1][c-1], P[r-2][c], P[r][c-2], P[r][c-1], P[r-1][c], P[r][c] x3 }.
+    // The median is only used from row 2 and column 2 on, where every entry has been written.
+    wire [7:0] lb2_col   = lb_word[15:8];
+    wire [7:0] lb2_col_1 = lb1_d1;
+    wire [7:0] lb2_col_2 = lb1_d2;
+    wire [7:0] lb1_col   = lb_word[7:0];
+    wire [7:0] lb1_col_1 = cur_d1;
+    wire [7:0] lb1_col_2 = cur_d2;
+
+    // window[0..8] = lb2_col_2, lb2_col_1, lb2_col, lb1_col_2, lb1_col_1, lb1_col, pixel_in x3
+    wire [71:0] window = {pixel_in, pixel_in, pixel_in,
+                          lb1_col, lb1_col_1, lb1_col_2,
+                          lb2_col, lb2_col_1, lb2_col_2};
+    wire [7:0] median;
+
+    // Pipelined compare-exchange network
+    median9 #(.STAGES(PIPE_STAGES)) sort_inst (
+        .clk(clk),
+        .window(window),
+        .median(median)
+    );
+
+    // Valid, median/pass-through select and the pass-through pixel travel alongside the network
+    wire use_median = (row >= 2) && (col >= 2);
+    wire [9:0] side_in = {pixel_valid, use_median, pixel_in};
+    wire [9:0] side_out;
+
+    generate
+        if (PIPE_STAGES == 0) begin : no_pipe
+            assign side_out = side_in;
+        end else begin : side_pipe
+            reg [9:0] pipe [0:PIPE_STAGES-1];
+            integer s;
+            always @(posedge clk or posedge rst) begin
+                if (rst) begin
+                    for (s = 0; s < PIPE_STAGES; s = s + 1)
+                        pipe[s] <= 0;
+                end else begin
+                    pipe[0] <= side_in;
+                    for (s = 1; s < PIPE_STAGES; s = s + 1)
+                        pipe[s] <= pipe[s-1];
+                end
+            end
+            assign side_out = pipe[PIPE_STAGES-1];
         end
-    endtask
+    endgenerate
 
+    // Output register
     always @(posedge clk or posedge rst) begin
         if (rst) begin
             pixel_out <= 0;
             pixel_out_valid <= 0;
+        end else begin
+            pixel_out_valid <= side_out[9];
+            if (side_out[9])
+                pixel_out <= side_out[8] ? median : side_out[7:0];
+        end
+    end
+
+    // Column shift registers, position and frame size (the line buffer is written through lb_inst)
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
             col <= 0;
             row <= 0;
-            for (i = 0; i < W; i = i + 1) begin
-                line_buf1[i] <= 0;
-                line_buf2[i] <= 0;
-            end
-            for (i = 0; i < 9; i = i + 1) begin
-                window[i] <= 0;
-            end
-            lb2_col   <= 0;
-            lb2_col_1 <= 0;
-            lb2_col_2 <= 0;
-            lb1_col   <= 0;
-            lb1_col_1 <= 0;
-            lb1_col_2 <= 0;
-        end else if (pixel_valid) begin
-            // -- Use pixel_in if on first row (row==0), otherwise use buffer
-            lb2_col   = (row >= 2) ? line_buf2[col]    : pixel_in;
-            lb2_col_1 = (row >= 2 && col >= 1) ? line_buf2[col-1] : pixel_in;
-            lb2_col_2 = (row >= 2 && col >= 2) ? line_buf2[col-2] : pixel_in;
-            lb1_col   = (row >= 1) ? line_buf1[col]    : pixel_in;
-            lb1_col_1 = (row >= 1 && col >= 1) ? line_buf1[col-1] : pixel_in;
-            lb1_col_2 = (row >= 1 && col >= 2) ? line_buf1[col-2] : pixel_in;
-
-            window[0] = lb2_col_2;
-            window[1] = lb2_col_1;
-            window[2] = lb2_col;
-            window[3] = lb1_col_2;
-            window[4] = lb1_col_1;
-            window[5] = lb1_col;
-            window[6] = pixel_in;
-            window[7] = pixel_in;
-            window[8] = pixel_in;
-
-            pixel_out_valid <= 1;
-            if ((row >= 2) && (col >= 2)) begin
-                sort_window();
-                pixel_out <= window[4];
-            end else begin
-                pixel_out <= pixel_in;
+            frame_w <= 0;
+            frame_h <= 0;
+            primed <= 0;
+            cur_d1 <= 0;
+            cur_d2 <= 0;
+            lb1_d1 <= 0;
+            lb1_d2 <= 0;
+        end else begin
+            primed <= 1'b1;
+            if (!primed || frame_end) begin
+                frame_w <= cfg_width;
+                frame_h <= cfg_height;
             end
 
-            line_buf2[col] <= line_buf1[col];
-            line_buf1[col] <= pixel_in;
+            if (pixel_valid) begin
+                cur_d1 <= pixel_in;
+                cur_d2 <= cur_d1;
+                lb1_d1 <= lb_word[7:0];
+                lb1_d2 <= lb1_d1;
 
-            if (col == W - 1) begin
-                col <= 0;
-                row <= row + 1;
-            end else begin
-                col <= col + 1;
+                if (col == cur_w - 1) begin
+                    col <= 0;
+                    row <= (row == cur_h - 1) ? 0 : row + 1; // Next frame starts at row 0
+                end else begin
+                    col <= col + 1;
+                end
             end
-        end else begin
-            pixel_out_valid <= 0;
         end
     end
 endmodule
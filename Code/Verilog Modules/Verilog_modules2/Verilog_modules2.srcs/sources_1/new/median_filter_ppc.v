@@ -0,0 +1,174 @@
+`timescale 1ns / 1ps
+
+// Multi-pixel-per-clock median_filter. PPC pixels enter per clock (lane k of pixel_in is column
+// PPC*word + k) and PPC filtered pixels leave per clock, so the pixel rate scales with PPC at the
+// same clock frequency. The output is bit-identical to median_filter, whose window for pixel (r, c)
+// is { P[r-1][c-2], P[r-1][c-1], P[r-2][c], P[r][c-2], P[r][c-1], P[r-1][c], P[r][c] x3 }.
+// As in median_filter, the frame size comes from cfg_width / cfg_height, sampled on the first clock
+// after reset and after the last word of every frame, so one build handles any frame up to MAX_W pixels
+// wide. MAX_W and cfg_width must be multiples of PPC, with at least two words per row. PIPE_STAGES is
+// the median9 pipeline depth, as in median_filter.
+module median_filter_ppc #(
+    parameter MAX_W = 1920,
+    parameter PPC = 2,
+    parameter PIPE_STAGES = 2
+)(
+    input wire clk,
+    input wire rst,
+    input wire [8*PPC-1:0] pixel_in,
+    input wire pixel_valid,
+    output reg [8*PPC-1:0] pixel_out,
+    output reg pixel_out_valid,
+    // Frame size for the next frame
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height
+);
+
+    localparam WORDS = MAX_W / PPC; // Line buffer depth
+
+    // A partial last word would shift every later row by PPC - MAX_W % PPC lanes; a single word per row
+    // leaves the line buffer with a zero-width address. Verilog-2001 has no elaboration-time $error, so
+    // a failing check instantiates a module that does not exist, named after the rule
+    generate
+        if (MAX_W % PPC != 0) begin : width_check
+            median_filter_ppc_MAX_W_must_be_a_multiple_of_PPC check_failed ();
+        end
+        if (WORDS < 2) begin : words_check
+            median_filter_ppc_MAX_W_must_be_at_least_2_PPC check_failed ();
+        end
+    endgenerate
+
+    // The two previous words of the current row and of row r-1 (columns c-1 and c-2 of lane 0)
+    reg [8*PPC-1:0] cur_d1, cur_d2;
+    reg [8*PPC-1:0] lb1_d1, lb1_d2;
+    reg [15:0] col, row;         // Position of the next input word; col counts words
+    reg [15:0] frame_w, frame_h; // Size of the current frame once primed, frame_w in words
+    reg primed;                  // frame_w / frame_h have been loaded since reset
+    // The size registers reset to constants and load cfg_* synchronously; until the first load the
+    // size is cfg_* itself, as if it had been sampled at reset
+    wire [15:0] cfg_words = cfg_width / PPC;
+    wire [15:0] cur_w = primed ? frame_w : cfg_words;
+    wire [15:0] cur_h = primed ? frame_h : cfg_height;
+    wire frame_end = pixel_valid && (col == cur_w - 1) && (row == cur_h - 1);
+    integer j;
+
+    // Line buffer, one word per PPC-pixel column group: { row r-2, row r-1 }. It has no reset (the medians
+    // only read it from row 2 on), so it maps to RAM instead of MAX_W x 16 flip-flops
+    wire [$clog2(WORDS)-1:0] lb_addr = col[$clog2(WORDS)-1:0];
+    wire [16*PPC-1:0] lb_word;
+    wire [8*PPC-1:0] lb1_word = lb_word[8*PPC-1:0];
+    wire [8*PPC-1:0] lb2_word = lb_word[16*PPC-1:8*PPC];
+
+    line_buffer #(.W(WORDS), .WIDTH(16*PPC)) lb_inst (
+        .clk(clk),
+        .addr(lb_addr), .we(pixel_valid), .wdata({lb1_word, pixel_in}), .rdata(lb_word)
+    );
+
+    // Three words side by side so every lane can reach columns c-1 and c-2
+    wire [24*PPC-1:0] cur_ext = {pixel_in, cur_d1, cur_d2};
+    wire [24*PPC-1:0] lb1_ext = {lb1_word, lb1_d1, lb1_d2};
+
+    // Per lane: median/pass-through select; the medians come out PIPE_STAGES clocks later
+    wire [PPC-1:0] use_median;
+    wire [8*PPC-1:0] median;
+
+    // One median per lane; neighbouring lanes share their window pixels
+    genvar k;
+    generate
+        for (k = 0; k < PPC; k = k + 1) begin : lane
+            localparam integer B = 2 * PPC + k; // Index of column c in the *_ext vectors
+            median9 #(.STAGES(PIPE_STAGES)) med_inst (
+                .clk(clk),
+                .window({pixel_in[8*k +: 8], pixel_in[8*k +: 8], pixel_in[8*k +: 8],
+                         lb1_word[8*k +: 8], cur_ext[8*(B-1) +: 8], cur_ext[8*(B-2) +: 8],
+                         lb2_word[8*k +: 8], lb1_ext[8*(B-1) +: 8], lb1_ext[8*(B-2) +: 8]}),
+                .median(median[8*k +: 8])
+            );
+
+            // Pass through the first two rows and columns, like median_filter
+            assign use_median[k] = (row >= 2 && col * PPC + k >= 2);
+        end
+    endgenerate
+
+    // Valid, selects and pass-through pixels travel alongside the median networks
+    localparam SIDE = 1 + 9 * PPC;
+    wire [SIDE-1:0] side_in = {pixel_valid, use_median, pixel_in};
+    wire [SIDE-1:0] side_out;
+
+    generate
+        if (PIPE_STAGES == 0) begin : no_pipe
+            assign side_out = side_in;
+        end else begin : side_pipe
+            reg [SIDE-1:0] pipe [0:PIPE_STAGES-1];
+            integer s;
+            always @(posedge clk or posedge rst) begin
+                if (rst) begin
+                    for (s = 0; s < PIPE_STAGES; s = s + 1)
+                        pipe[s] <= 0;
+                end else begin
+                    pipe[0] <= side_in;
+                    for (s = 1; s < PIPE_STAGES; s = s + 1)
+                        pipe[s] <= pipe[s-1];
+                end
+            end
+            assign side_out = pipe[PIPE_STAGES-1];
+        end
+    endgenerate
+
+    wire            out_valid  = side_out[SIDE-1];
+    wire [PPC-1:0]  out_select = side_out[8*PPC +: PPC];
+    wire [8*PPC-1:0] out_pass  = side_out[8*PPC-1:0];
+    reg  [8*PPC-1:0] next_out;
+
+    always @(*) begin
+        for (j = 0; j < PPC; j = j + 1)
+            next_out[8*j +: 8] = out_select[j] ? median[8*j +: 8] : out_pass[8*j +: 8];
+    end
+
+    // Output register
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            pixel_out <= 0;
+            pixel_out_valid <= 0;
+        end else begin
+            pixel_out_valid <= out_valid;
+            if (out_valid)
+                pixel_out <= next_out;
+        end
+    end
+
+    // Column shift registers, position and frame size (the line buffer is written through lb_inst)
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            col <= 0;
+            row <= 0;
+            frame_w <= 0;
+            frame_h <= 0;
+            primed <= 0;
+            cur_d1 <= 0;
+            cur_d2 <= 0;
+            lb1_d1 <= 0;
+            lb1_d2 <= 0;
+        end else begin
+            primed <= 1'b1;
+            if (!primed || frame_end) begin
+                frame_w <= cfg_words;
+                frame_h <= cfg_height;
+            end
+
+            if (pixel_valid) begin
+                cur_d1 <= pixel_in;
+                cur_d2 <= cur_d1;
+                lb1_d1 <= lb1_word;
+                lb1_d2 <= lb1_d1;
+
+                if (col == cur_w - 1) begin
+                    col <= 0;
+                    row <= (row == cur_h - 1) ? 0 : row + 1; // Next frame starts at row 0
+                end else begin
+                    col <= col + 1;
+                end
+            end
+        end
+    end
+endmodule
@@ -0,0 +1,180 @@
+`timescale 1ns / 1ps
+
+// Streaming Sobel edge detection, fed with median_filter's output stream (row-major, W x H). Like
+// median_filter, W and H come from cfg_width / cfg_height (W <= MAX_W), sampled on the first clock
+// after reset and after the last pixel of every frame.
+// Produces the same pixels as SobelEdgeDetection in the C pipeline: min(floor(sqrt(gx^2 + gy^2)), 255)
+// inside the frame and 0 on the one-pixel border.
+//
+// The 3x3 window of input pixel (r, c) is centred on (r-1, c-1), so edge pixel n leaves after input
+// pixel n + W + 1. After the last pixel of a frame the module emits the remaining W + 1 border zeros
+// (W for a one-row frame) on its own, one per clock. The next frame may start right away: its first
+// W' + 1 inputs produce no output, and if it is narrower than the previous frame (W' < W) pixel_ready
+// drops for the W - W' clocks the owed zeros still need, so no two outputs share a clock. A producer
+// that cannot stall (median_filter) must leave those W - W' idle clocks before a narrower frame
+// itself. Edge pixels leave 3 clocks after the input that completes their window.
+// m_ready is a clock enable for the whole module: while it is low the window, the position, the
+// owed-zero count and all three pipeline stages hold, edge_out / edge_valid stay as they are and
+// pixel_ready is low. Tie it high where the consumer never stalls.
+module sobel_edge #(
+    parameter MAX_W = 1920
+)(
+    input wire clk,
+    input wire rst,
+    input wire [7:0] pixel_in,
+    input wire pixel_valid,
+    output wire pixel_ready,
+    output reg [7:0] edge_out,
+    output reg edge_valid,
+    input wire m_ready,
+    // Frame size for the next frame
+    input wire [15:0] cfg_width,
+    input wire [15:0] cfg_height
+);
+
+    integer col = 0, row = 0;
+    integer flush = 0; // Border zeros still owed for the previous frames
+    reg [15:0] frame_w, frame_h; // Size of the current frame once primed
+    reg primed;                  // frame_w / frame_h have been loaded since reset
+    // Reset to a constant, loaded synchronously; cfg_* stands in until the first load, as in median_filter
+    wire [15:0] cur_w = primed ? frame_w : cfg_width;
+    wire [15:0] cur_h = primed ? frame_h : cfg_height;
+
+    // Input (r, c) completes the output pixel n = (r*W + c) - (W + 1); (r-1, c-1) is inside the
+    // border only when r >= 2 and c >= 2, otherwise the pixel is a border zero
+    wire emit_pos = (row >= 1) && (row > 1 || col >= 1);
+    wire use_sobel = (row >= 2) && (col >= 2);
+
+    // An input that would emit waits while the previous frames' zeros still own the output
+    assign pixel_ready = m_ready && ((flush == 0) || !emit_pos);
+    wire take = pixel_valid && pixel_ready;
+    wire emit = take && emit_pos;
+
+    // Rows r-1 and r-2 of the current column
+    wire [15:0] lb_word;
+
+    line_buffer #(.W(MAX_W), .WIDTH(16)) lb_inst (
+        .clk(clk),
+        .addr(col[$clog2(MAX_W)-1:0]), .we(take), .wdata({lb_word[7:0], pixel_in}), .rdata(lb_word)
+    );
+
+    // Window columns c-2 (t2/m2/b2) and c-1 (t1/m1/b1); column c is read straight from the line buffer
+    reg [7:0] t2, t1, m2, m1, b2, b1;
+    wire [7:0] t0 = lb_word[15:8]; // Row r-2 (top)
+    wire [7:0] m0 = lb_word[7:0];  // Row r-1 (middle)
+    wire [7:0] b0 = pixel_in;      // Row r (bottom)
+
+    // gx = right column - left column, gy = top row - bottom row, middle entries weighted by 2
+    wire signed [11:0] gx = ($signed({4'd0, t0}) + $signed({3'd0, m0, 1'b0}) + $signed({4'd0, b0}))
+                          - ($signed({4'd0, t2}) + $signed({3'd0, m2, 1'b0}) + $signed({4'd0, b2}));
+    wire signed [11:0] gy = ($signed({4'd0, t2}) + $signed({3'd0, t1, 1'b0}) + $signed({4'd0, t0}))
+                          - ($signed({4'd0, b2}) + $signed({3'd0, b1, 1'b0}) + $signed({4'd0, b0}));
+
+    // floor(sqrt(v)) for v < 65536, one result bit per step
+    function [7:0] isqrt16;
+        input [15:0] v;
+        reg [15:0] rem;
+        reg [7:0] root;
+        reg [15:0] trial;
+        integer b;
+        begin
+            rem = v;
+            root = 0;
+            for (b = 7; b >= 0; b = b - 1) begin
+                trial = ({8'd0, root} << (b + 1)) + (16'd1 << (2 * b));
+                if (rem >= trial) begin
+                    rem = rem - trial;
+                    root = root | (8'd1 << b);
+                end
+            end
+            isqrt16 = root;
+        end
+    endfunction
+
+    // Stage 1: gradients; stage 2: squared magnitude; stage 3: square root and clamp
+    reg s1_valid, s1_use;
+    reg signed [11:0] s1_gx, s1_gy;
+    reg s2_valid, s2_use;
+    reg [21:0] s2_mag2;
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            s1_valid <= 0;
+            s1_use <= 0;
+            s1_gx <= 0;
+            s1_gy <= 0;
+            s2_valid <= 0;
+            s2_use <= 0;
+            s2_mag2 <= 0;
+            edge_out <= 0;
+            edge_valid <= 0;
+        end else if (m_ready) begin
+            // emit and an owed zero never fall on the same clock (pixel_ready)
+            s1_valid <= emit || (flush > 0);
+            s1_use <= emit && use_sobel;
+            s1_gx <= gx;
+            s1_gy <= gy;
+
+            s2_valid <= s1_valid;
+            s2_use <= s1_use;
+            s2_mag2 <= s1_gx * s1_gx + s1_gy * s1_gy;
+
+            edge_valid <= s2_valid;
+            if (s2_valid) begin
+                if (!s2_use)
+                    edge_out <= 0;
+                else if (s2_mag2 >= 255 * 255)
+                    edge_out <= 255;
+                else
+                    edge_out <= isqrt16(s2_mag2[15:0]);
+            end
+        end
+    end
+
+    // Window shift registers, position and end-of-frame flush
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            col <= 0;
+            row <= 0;
+            flush <= 0;
+            frame_w <= 0;
+            frame_h <= 0;
+            primed <= 0;
+            t2 <= 0; t1 <= 0;
+            m2 <= 0; m1 <= 0;
+            b2 <= 0; b1 <= 0;
+        end else if (m_ready) begin
+            primed <= 1'b1;
+            if (!primed) begin
+                frame_w <= cfg_width;
+                frame_h <= cfg_height;
+            end
+
+            if (flush > 0)
+                flush <= flush - 1;
+
+            if (take) begin
+                t2 <= t1; t1 <= t0;
+                m2 <= m1; m1 <= m0;
+                b2 <= b1; b1 <= b0;
+
+                if (col == cur_w - 1) begin
+                    col <= 0;
+                    if (row == cur_h - 1) begin
+                        row <= 0;
+                        // A one-row frame emits nothing itself, so it owes W zeros and may still
+                        // be draining the frame before it
+                        flush <= (flush > 0 ? flush - 1 : 0) + cur_w + (cur_h > 1);
+                        frame_w <= cfg_width;
+                        frame_h <= cfg_height;
+                    end else begin
+                        row <= row + 1;
+                    end
+                end else begin
+                    col <= col + 1;
+                end
+            end
+        end
+    end
+
+endmodule
@@ -5,15 +5,23 @@ module tb_system;
     parameter W = 60;
     parameter H = 60;
     parameter TOTAL_PIXELS = W * H;
+    // Compare filtered.mem with a reference copy of it (e.g. a previous xsim run) before finishing;
+    // a difference stops the run with $fatal once filtered.mem and edges.mem are written
+    parameter CHECK_GOLDEN = 0;
+    parameter GOLDEN_FILE = "filtered_golden.mem";
 
     reg clk = 0, rst = 1;
     always #5 clk = ~clk; // 10ns clock period
 
-    wire [7:0] gray_out, filt_out;
-    wire gray_valid, filt_valid;
+    wire [7:0] gray_out, filt_out, edge_out;
+    wire gray_valid, filt_valid, edge_valid;
 
     reg [7:0] output_mem [0:TOTAL_PIXELS-1];
+    reg [7:0] edge_mem [0:TOTAL_PIXELS-1];
+    reg [7:0] golden_mem [0:TOTAL_PIXELS-1];
+    integer golden_errors = 0;
     integer output_index = 0;
+    integer edge_index = 0;
     integer i;
 
     // Timing variables (all declared at the top)
@@ -40,6 +48,11 @@ module tb_system;
     integer median_module_cycles;
     integer median_module_ns;
     integer gray_pixel_count = 0;
+    integer edge_first_output_cycle = 0;
+    integer edge_last_output_cycle = 0;
+    reg first_edge_output_seen = 0;
+    integer sobel_module_cycles;
+    integer sobel_module_ns;
 
     // Utility: returns 1 if val is any X
     function is_x;
@@ -53,15 +66,25 @@ module tb_system;
     rgb_to_gray #(.MEM_FILE("input_image.mem"), .TOTAL_BYTES(TOTAL_PIXELS*3))
         gray_inst (.clk(clk), .rst(rst), .gray_out(gray_out), .gray_valid(gray_valid));
 
-    median_filter #(.W(W), .H(H))
+    median_filter #(.MAX_W(W))
         filter_inst (.clk(clk), .rst(rst),
                      .pixel_in(gray_out), .pixel_valid(gray_valid),
-                     .pixel_out(filt_out), .pixel_out_valid(filt_valid));
+                     .pixel_out(filt_out), .pixel_out_valid(filt_valid),
+                     .cfg_width(W[15:0]), .cfg_height(H[15:0]));
+
+    // One frame: no border zeros are owed when it starts, so pixel_ready stays high
+    sobel_edge #(.MAX_W(W))
+        sobel_inst (.clk(clk), .rst(rst),
+                    .pixel_in(filt_out), .pixel_valid(filt_valid), .pixel_ready(),
+                    .edge_out(edge_out), .edge_valid(edge_valid), .m_ready(1'b1),
+                    .cfg_width(W[15:0]), .cfg_height(H[15:0]));
 
     // Initialize output memory
     initial begin
-        for (i = 0; i < TOTAL_PIXELS; i = i + 1)
+        for (i = 0; i < TOTAL_PIXELS; i = i + 1) begin
             output_mem[i] = 8'h00;
+            edge_mem[i] = 8'h00;
+        end
     end
 
     // Main simulation control
@@ -70,12 +93,27 @@ module tb_system;
         #20 rst = 0;
         input_cycle_start = $time;
 
-        wait (output_index == TOTAL_PIXELS);
+        wait (output_index == TOTAL_PIXELS && edge_index == TOTAL_PIXELS);
         repeat (3) @(posedge clk);
 
         $writememh("filtered.mem", output_mem);
         $display("Filtered output written to filtered.mem");
         $display("Total output pixels: %0d", output_index);
+        $writememh("edges.mem", edge_mem);
+        $display("Edge output written to edges.mem");
+        if (CHECK_GOLDEN) begin
+            $readmemh(GOLDEN_FILE, golden_mem);
+            for (i = 0; i < TOTAL_PIXELS; i = i + 1)
+                if (output_mem[i] !== golden_mem[i]) begin
+                    if (golden_errors < 10)
+                        $display("Filtered pixel %0d: %02x, %s has %02x", i, output_mem[i], GOLDEN_FILE, golden_mem[i]);
+                    golden_errors = golden_errors + 1;
+                end
+            if (golden_errors == 0)
+                $display("Filtered output matches %s", GOLDEN_FILE);
+            else
+                $fatal(1, "Filtered output differs from %s in %0d pixels", GOLDEN_FILE, golden_errors);
+        end
 
         // Assign metrics here, after output_index is complete
         latency_cycles = (first_output_cycle - input_cycle_start)/10; // 10ns per cycle
@@ -88,6 +126,8 @@ module tb_system;
         gray_module_ns = (gray_last_output_cycle - gray_first_output_cycle);
         median_module_cycles = (filt_last_output_cycle - filt_first_output_cycle)/10;
         median_module_ns = (filt_last_output_cycle - filt_first_output_cycle);
+        sobel_module_cycles = (edge_last_output_cycle - edge_first_output_cycle)/10;
+        sobel_module_ns = (edge_last_output_cycle - edge_first_output_cycle);
 
         $display("------ Pipeline Metrics ------");
         $display("Latency (input to first output): %0d cycles, %0d ns", latency_cycles, latency_ns);
@@ -96,6 +136,7 @@ module tb_system;
         $display("------ Module-specific Metrics ------");
         $display("Grayscale module: %0d cycles, %0d ns for %0d pixels", gray_module_cycles, gray_module_ns, gray_pixel_count);
         $display("Median filter module: %0d cycles, %0d ns for %0d pixels", median_module_cycles, median_module_ns, output_index);
+        $display("Sobel edge module: %0d cycles, %0d ns for %0d pixels", sobel_module_cycles, sobel_module_ns, edge_index);
         $display("-----------------------------");
 
         $finish;
@@ -134,4 +175,19 @@ module tb_system;
         end
     end
 
+    // Edge stream from sobel_edge
+    always @(posedge clk) begin
+        if (edge_valid && edge_index < TOTAL_PIXELS) begin
+            if (!is_x(edge_out)) begin
+                edge_mem[edge_index] <= edge_out;
+                if (!first_edge_output_seen) begin
+                    edge_first_output_cycle = $time;
+                    first_edge_output_seen = 1;
+                end
+                edge_last_output_cycle = $time;
+                edge_index = edge_index + 1;
+            end
+        end
+    end
+
 endmodule
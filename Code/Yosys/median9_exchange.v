@@ -0,0 +1,33 @@
+`timescale 1ns / 1ps
+
+// The exchange sort median_filter used before median9: sorts the whole window with compare-exchanges
+// in i < j order and takes element 4, in one clock. Kept only as the baseline of synth_sweep.py's
+// median core comparison; same ports as median9 with STAGES = 0.
+module median9_exchange (
+    input wire clk,
+    input wire [71:0] window,
+    output wire [7:0] median
+);
+
+    function [7:0] sort_median;
+        input [71:0] v;
+        reg [7:0] w [0:8];
+        reg [7:0] temp;
+        integer i, j;
+        begin
+            for (i = 0; i < 9; i = i + 1)
+                w[i] = v[8*i +: 8];
+            for (i = 0; i < 9; i = i + 1)
+                for (j = i + 1; j < 9; j = j + 1)
+                    if (w[i] > w[j]) begin
+                        temp = w[i];
+                        w[i] = w[j];
+                        w[j] = temp;
+                    end
+            sort_median = w[4];
+        end
+    endfunction
+
+    assign median = sort_median(window);
+
+endmodule
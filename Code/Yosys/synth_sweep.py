@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+# Synthesis benchmark for the RTL modules with Yosys (synth_xilinx, 7-series cells, same family as the
+# SP701 Spartan-7 in the Vivado project). Sweeps frame size, pixels per clock and median pipeline
+# stages and prints one CSV row per configuration, so datapath changes can be compared like software
+# benchmarks without opening Vivado.
+#
+# Usage: ./synth_sweep.py [--sizes 60x60 640x480 1920x1080] [--ppc 1 2 4] [--pipe-stages 0 2]
+#                         [--modules median_filter sobel_edge ...] [--csv results.csv] [--log results.log]
+#        ./synth_sweep.py --modules median9_exchange median9 median_filter --pipe-stages 0-8 --sizes 60x60
+#                         --csv results/pipe_stages.csv
+#                         (median core alone and in median_filter at every PIPE_STAGES value: the old
+#                         exchange sort against the median9 network)
+#
+# --pipe-stages takes values and inclusive ranges (0-8). The CSV holds one row per configuration that
+# synthesized; the log (default: the CSV name with .log) records the command, the Yosys version and
+# every configuration, including failed ones, so a checked-in CSV can be traced to the run that made it.
+# Without Yosys the script writes only the log, saying so, and exits with 1.
+#
+# Columns:
+#   lut, ff, lutram, carry4, dsp   cell counts after synth_xilinx -flatten (lutram includes SRLs)
+#   bram                           RAMB36 equivalents (a RAMB18 counts as 0.5, as Vivado reports)
+#   depth                          longest combinational path in LUT / MUXF / CARRY4 levels (ltp)
+#   est_mhz                        first-order Fmax from depth: 1000 / (T_FF + depth * T_LEVEL)
+#
+# est_mhz is only a comparison figure for changes to the same module; use Vivado for sign-off timing.
+# Needs yosys on PATH (or YOSYS=/path/to/yosys).
+
+import argparse
+import csv
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SRC = os.path.join(HERE, '..', 'Verilog Modules', 'Verilog_modules2', 'Verilog_modules2.srcs',
+                   'sources_1', 'new')
+YOSYS = os.environ.get('YOSYS', 'yosys')
+
+# Timing model for est_mhz (ns): clock-to-out + setup, and one LUT plus its net, speed grade -2
+T_FF = 1.0
+T_LEVEL = 0.7
+
+FF_CELLS = ('FDRE', 'FDSE', 'FDCE', 'FDPE', 'LDCE', 'LDPE')
+LUTRAM_CELLS = ('SRL16E', 'SRLC32E')
+
+
+# ===============================================================================================
+# Modules: source files and parameters for one configuration (None if it does not apply)
+# ===============================================================================================
+
+def median_filter_params(w, h, ppc, stages):
+    if ppc != 1:
+        return None
+    return {'MAX_W': w, 'PIPE_STAGES': stages}
+
+
+def median_filter_ppc_params(w, h, ppc, stages):
+    if ppc == 1 or w % ppc:
+        return None
+    return {'MAX_W': w, 'PPC': ppc, 'PIPE_STAGES': stages}
+
+
+def sobel_edge_params(w, h, ppc, stages):
+    if ppc != 1 or stages != STAGES_FIRST:
+        return None
+    return {'MAX_W': w}
+
+
+def rgb_to_gray_params(w, h, ppc, stages):
+    if ppc != 1 or stages != STAGES_FIRST:
+        return None
+    return {'TOTAL_BYTES': 3 * w * h}
+
+
+def rgb_to_gray_pipe_params(w, h, ppc, stages):
+    # No parameters: one row for the first frame size
+    if ppc != 1 or stages != STAGES_FIRST or (w, h) != SIZE_FIRST:
+        return None
+    return {}
+
+
+def median9_params(w, h, ppc, stages):
+    # No frame size: one row per stage count
+    if ppc != 1 or (w, h) != SIZE_FIRST:
+        return None
+    return {'STAGES': stages}
+
+
+def median9_exchange_params(w, h, ppc, stages):
+    # Unpipelined: one row, reported as 0 stages
+    if ppc != 1 or stages != 0 or (w, h) != SIZE_FIRST:
+        return None
+    return {}
+
+
+def axis_median_filter_params(w, h, ppc, stages):
+    if ppc != 1:
+        return None
+    return {'MAX_W': w, 'PIPE_STAGES': stages}
+
+
+def frame_pingpong_params(w, h, ppc, stages):
+    if ppc != 1 or stages != STAGES_FIRST:
+        return None
+    return {'MAX_PIXELS': w * h}
+
+
+# Sources are in SRC unless given with a path
+MODULES = {
+    'median9':            (['median9.v'], median9_params),
+    'median9_exchange':   ([os.path.join(HERE, 'median9_exchange.v')], median9_exchange_params),
+    'median_filter':      (['median9.v', 'line_buffer.v', 'median_filter.v'], median_filter_params),
+    'median_filter_ppc':  (['median9.v', 'line_buffer.v', 'median_filter_ppc.v'], median_filter_ppc_params),
+    'sobel_edge':         (['line_buffer.v', 'sobel_edge.v'], sobel_edge_params),
+    'rgb_to_gray':        (['grayscale_converter.v'], rgb_to_gray_params),
+    'rgb_to_gray_pipe':   (['grayscale_converter.v'], rgb_to_gray_pipe_params),
+    'axis_median_filter': (['median9.v', 'line_buffer.v', 'median_filter.v', 'grayscale_converter.v',
+                            'bram.v', 'axis_wrappers.v'], axis_median_filter_params),
+    'frame_pingpong':     (['frame_pingpong.v'], frame_pingpong_params),
+}
+
+DEFAULT_MODULES = ['median_filter', 'median_filter_ppc', 'sobel_edge', 'rgb_to_gray', 'rgb_to_gray_pipe']
+
+# Set from the command line; modules without a stage or size parameter report only the first one
+STAGES_FIRST = 2
+SIZE_FIRST = (60, 60)
+
+
+# ===============================================================================================
+# Synthesis
+# ===============================================================================================
+
+def synthesize(top, sources, params, work):
+    """Runs synth_xilinx on one configuration and returns (cell counts by type, logic depth)."""
+    os.makedirs(work, exist_ok=True)
+    stat_file = os.path.join(work, 'stat.txt')
+    ltp_file = os.path.join(work, 'ltp.txt')
+
+    script = ['read_verilog -sv ' + ' '.join('"%s"' % s for s in sources)]
+    if params:
+        script.append('chparam ' + ' '.join('-set %s %d' % kv for kv in params.items()) + ' ' + top)
+    script += [
+        'synth_xilinx -family xc7 -top %s -flatten' % top,
+        'tee -q -o "%s" stat' % stat_file,
+        'tee -q -o "%s" ltp -noff t:LUT* t:MUXF* t:CARRY4' % ltp_file,
+    ]
+    script_file = os.path.join(work, 'synth.ys')
+    with open(script_file, 'w') as f:
+        f.write('\n'.join(script) + '\n')
+
+    # Run from the source directory so $readmemh finds the .mem files
+    with open(os.path.join(work, 'yosys.log'), 'w') as log:
+        subprocess.run([YOSYS, '-q', '-s', script_file], cwd=SRC, stdout=log, stderr=subprocess.STDOUT,
+                       check=True)
+
+    cells = {}
+    with open(stat_file) as f:
+        for line in f:
+            # "     LUT6    123" (older yosys) or "      123   LUT6" (newer yosys)
+            m = re.match(r'^\s+([A-Z][A-Z0-9_]*)\s+(\d+)\s*$', line)
+            if m:
+                cells[m.group(1)] = cells.get(m.group(1), 0) + int(m.group(2))
+                continue
+            m = re.match(r'^\s+(\d+)\s+([A-Z][A-Z0-9_]*)\s*$', line)
+            if m:
+                cells[m.group(2)] = cells.get(m.group(2), 0) + int(m.group(1))
+
+    depth = 0
+    with open(ltp_file) as f:
+        m = re.search(r'length=(\d+)', f.read())
+        if m:
+            depth = int(m.group(1))
+    return cells, depth
+
+
+def summarize(cells, depth):
+    lut = sum(n for t, n in cells.items() if re.fullmatch(r'LUT\d', t))
+    ff = sum(cells.get(t, 0) for t in FF_CELLS)
+    lutram = sum(n for t, n in cells.items() if t.startswith('RAM') and not t.startswith('RAMB'))
+    lutram += sum(cells.get(t, 0) for t in LUTRAM_CELLS)
+    bram = cells.get('RAMB36E1', 0) + 0.5 * cells.get('RAMB18E1', 0)
+    return {
+        'lut': lut,
+        'ff': ff,
+        'lutram': lutram,
+        'carry4': cells.get('CARRY4', 0),
+        'dsp': cells.get('DSP48E1', 0),
+        'bram': bram,
+        'depth': depth,
+        'est_mhz': round(1000.0 / (T_FF + depth * T_LEVEL), 1),
+    }
+
+
+# ===============================================================================================
+# Main
+# ===============================================================================================
+
+def stage_list(values):
+    """--pipe-stages values: numbers and inclusive ranges such as 0-8, in order, without repeats."""
+    stages = []
+    for v in values:
+        lo, _, hi = v.partition('-')
+        for s in range(int(lo), int(hi or lo) + 1):
+            if s not in stages:
+                stages.append(s)
+    return stages
+
+
+def main():
+    global STAGES_FIRST, SIZE_FIRST
+
+    parser = argparse.ArgumentParser(description='Yosys resource / logic depth sweep of the RTL modules')
+    parser.add_argument('--sizes', nargs='+', default=['60x60', '640x480', '1920x1080'])
+    parser.add_argument('--ppc', nargs='+', type=int, default=[1, 2, 4])
+    parser.add_argument('--pipe-stages', nargs='+', default=['2', '0'])
+    parser.add_argument('--modules', nargs='+', default=DEFAULT_MODULES, choices=sorted(MODULES))
+    parser.add_argument('--csv', default=os.path.join(HERE, 'build', 'results.csv'))
+    parser.add_argument('--log', help='run log (default: the --csv path with .log)')
+    args = parser.parse_args()
+
+    sizes = [tuple(int(v) for v in s.lower().split('x')) for s in args.sizes]
+    args.pipe_stages = stage_list(args.pipe_stages)
+    STAGES_FIRST = args.pipe_stages[0]
+    SIZE_FIRST = sizes[0]
+
+    log_path = args.log or os.path.splitext(args.csv)[0] + '.log'
+    os.makedirs(os.path.dirname(os.path.abspath(log_path)), exist_ok=True)
+    log = open(log_path, 'w')
+    log.write('# %s\n' % ' '.join(sys.argv))
+    log.write('# %s\n' % time.strftime('%Y-%m-%d %H:%M:%S'))
+    log.write('# est_mhz = 1000 / (%.1f + depth * %.1f)\n' % (T_FF, T_LEVEL))
+    if not shutil.which(YOSYS):
+        log.write('# %s not found: nothing was synthesized, no results\n' % YOSYS)
+        log.close()
+        print('%s not found (set YOSYS=/path/to/yosys); wrote %s, no results' % (YOSYS, log_path),
+              file=sys.stderr)
+        sys.exit(1)
+    version = subprocess.run([YOSYS, '-V'], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True).stdout.strip()
+    log.write('# %s\n' % version)
+
+    columns = ['module', 'width', 'height', 'ppc', 'pipe_stages',
+               'lut', 'ff', 'lutram', 'carry4', 'dsp', 'bram', 'depth', 'est_mhz']
+    rows = []
+    writer = csv.DictWriter(sys.stdout, fieldnames=columns)
+    writer.writeheader()
+
+    for name in args.modules:
+        files, params_for = MODULES[name]
+        sources = [os.path.join(SRC, f) for f in files]
+        for w, h in sizes:
+            for ppc in args.ppc:
+                for stages in args.pipe_stages:
+                    params = params_for(w, h, ppc, stages)
+                    if params is None:
+                        continue
+                    work = os.path.join(HERE, 'build', '%s_%dx%d_ppc%d_p%d' % (name, w, h, ppc, stages))
+                    config = '%s %dx%d ppc %d pipe_stages %d' % (name, w, h, ppc, stages)
+                    try:
+                        cells, depth = synthesize(name, sources, params, work)
+                    except subprocess.CalledProcessError:
+                        print('%s: synthesis failed, see %s' % (work, os.path.join(work, 'yosys.log')),
+                              file=sys.stderr)
+                        log.write('%s: FAILED, see %s\n' % (config, os.path.join(work, 'yosys.log')))
+                        continue
+                    row = {'module': name, 'width': w, 'height': h, 'ppc': ppc, 'pipe_stages': stages}
+                    row.update(summarize(cells, depth))
+                    writer.writerow(row)
+                    sys.stdout.flush()
+                    rows.append(row)
+                    log.write('%s: %s\n' % (config, ', '.join('%s %s' % (c, row[c]) for c in columns[5:])))
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.csv)), exist_ok=True)
+    with open(args.csv, 'w', newline='') as f:
+        out = csv.DictWriter(f, fieldnames=columns)
+        out.writeheader()
+        out.writerows(rows)
+    log.write('# %d configurations in %s\n' % (len(rows), args.csv))
+    log.close()
+    print('Wrote %s and %s' % (args.csv, log_path), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()